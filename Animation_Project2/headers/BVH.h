@@ -0,0 +1,132 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cfloat>
+#include <vector>
+
+#include "..//headers/Bounds.h"
+
+class JobSystem;
+
+// Dynamic bounding volume hierarchy over world space boxes, one leaf per proxy. Queries
+// return the UserData of the proxies, typically an Entity.
+//
+// Proxies can be inserted and removed at any time; insertion walks down to the sibling that
+// grows the tree the least. Moving a proxy only writes its leaf, and Refit() then fixes the
+// boxes above all the moved leaves in one bottom-up pass, which keeps the shape of the tree.
+// When that shape has drifted too far from a good one (its SAH cost grew past
+// BVH_REBUILD_RATIO times the cost right after the last build), Refit() rebuilds the tree
+// top-down with a binned SAH. Proxy ids survive rebuilds.
+//
+// Queries see the internal boxes as of the last Refit(), Insert() or Remove(): after
+// Update()s, Refit() before querying. Queries are const and can run on several threads
+// at once.
+class BVH
+{
+public:
+    typedef unsigned int ProxyId;
+    static const ProxyId INVALID_PROXY = 0xFFFFFFFF;
+
+    // Frustums one QueryFrustums() can test at once
+    static const unsigned int MAX_BATCH_FRUSTUMS = 32;
+
+    struct RayHit {
+        ProxyId Proxy = INVALID_PROXY;
+        unsigned int UserData = 0;
+        float Distance = FLT_MAX;       // Where the ray enters the proxy's box
+    };
+
+    struct Stats {
+        unsigned long long NumInserts = 0;
+        unsigned long long NumRemoves = 0;
+        unsigned long long NumRefits = 0;
+        unsigned long long NumRebuilds = 0;
+        float Cost = 0.0f;              // As of the last Refit()
+        float BuildCost = 0.0f;         // Right after the last rebuild
+        double RefitTimeMs = 0.0;       // Last Refit(), rebuild included
+        double RebuildTimeMs = 0.0;     // Last rebuild
+    };
+
+    BVH() {};
+
+    BVH(const BVH&) = delete;
+    BVH& operator=(const BVH&) = delete;
+
+    ProxyId Insert(const AABB& Bounds, unsigned int UserData);
+    void Remove(ProxyId Proxy);
+
+    // Writes the leaf only, see Refit()
+    void Update(ProxyId Proxy, const AABB& Bounds);
+
+    // Fixes the boxes above the leaves moved since the last call, and rebuilds if the tree
+    // degraded
+    void Refit();
+
+    // Top-down binned SAH build over all the proxies
+    void Rebuild();
+
+    void Clear();
+
+    const AABB& GetBounds(ProxyId Proxy) const { return m_Nodes[Proxy].Bounds; }
+    unsigned int GetUserData(ProxyId Proxy) const { return m_Nodes[Proxy].UserData; }
+    unsigned int NumProxies() const { return m_NumProxies; }
+
+    // Appends the UserData of every proxy whose box is at least partly inside
+    void QueryFrustum(const Frustum& f, std::vector<unsigned int>& Result) const;
+
+    // Count frustums (shadow cascades, several views) in one walk of the tree: subtrees are
+    // only tested against the frustums that still see them. pResults[i] gets the proxies
+    // of pFrustums[i].
+    void QueryFrustums(const Frustum* pFrustums, unsigned int Count, std::vector<unsigned int>* pResults) const;
+
+    // Appends the UserData of every proxy whose box overlaps Box
+    void QueryAABB(const AABB& Box, std::vector<unsigned int>& Result) const;
+
+    // Nearest proxy box along the ray. Exact tests against the geometry are up to the
+    // caller, e.g. picking tests the mesh of the hit and casts again past it if it missed.
+    bool RayCast(const Ray& r, RayHit& Hit) const;
+
+    // One RayCast() per ray, split across the job system if there is one. Misses leave
+    // Proxy at INVALID_PROXY.
+    void RayCastBatch(const Ray* pRays, unsigned int Count, RayHit* pHits, JobSystem* pJobs = NULL) const;
+
+    // Sum of the areas of the internal nodes relative to the root: how many nodes an
+    // average query visits, give or take constant factors
+    float ComputeCost() const;
+
+    const Stats& GetStats() const { return m_Stats; }
+    void PrintStats(const char* pName) const;
+
+private:
+    static const unsigned int INVALID_NODE = 0xFFFFFFFF;
+
+    struct Node {
+        AABB Bounds;
+        unsigned int Parent = INVALID_NODE;     // Next free node while on the free list
+        unsigned int Child[2] = { INVALID_NODE, INVALID_NODE };
+        unsigned int UserData = 0;
+        bool IsFree = false;
+
+        bool IsLeaf() const { return Child[0] == INVALID_NODE; }
+    };
+
+    unsigned int AllocateNode();
+    void FreeNode(unsigned int Index);
+
+    unsigned int FindBestSibling(const AABB& Bounds) const;
+    void InsertLeaf(unsigned int Leaf);
+    void RemoveLeaf(unsigned int Leaf);
+    void RefitAncestors(unsigned int Index);
+
+    std::vector<Node> m_Nodes;                  // Leaves and internal nodes, by index
+    unsigned int m_Root = INVALID_NODE;
+    unsigned int m_FreeList = INVALID_NODE;
+    unsigned int m_NumProxies = 0;
+    bool m_NeedsRefit = false;
+
+    std::vector<unsigned int> m_Order;          // Scratch of Refit()
+
+    Stats m_Stats;
+};
+
+#endif  /* BVH_H */
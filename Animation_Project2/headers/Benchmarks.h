@@ -0,0 +1,11 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+// Command line benchmark modes, e.g. Animation_Project2 --bench-jobs. Each one prints its
+// usage and its results to the console; see Benchmarks.cpp for the list.
+//
+// Runs the mode that argv[1] names and stores what main() should return in ExitCode.
+// Returns false if argv[1] is not a benchmark.
+bool RunBenchmark(int argc, char* argv[], int& ExitCode);
+
+#endif  /* BENCHMARKS_H */
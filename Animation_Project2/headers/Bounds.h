@@ -0,0 +1,86 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+#include <cfloat>
+
+// Axis aligned box. The default one is empty: Min above Max, so that merging a point or a
+// box into it gives just that point or box.
+struct AABB {
+    glm::vec3 Min = glm::vec3(FLT_MAX);
+    glm::vec3 Max = glm::vec3(-FLT_MAX);
+
+    AABB() {};
+    AABB(const glm::vec3& _Min, const glm::vec3& _Max) : Min(_Min), Max(_Max) {};
+
+    static AABB FromSphere(const glm::vec3& Center, float Radius) { return AABB(Center - glm::vec3(Radius), Center + glm::vec3(Radius)); }
+
+    bool IsEmpty() const { return Min.x > Max.x || Min.y > Max.y || Min.z > Max.z; }
+
+    glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+    glm::vec3 GetExtent() const { return Max - Min; }
+
+    // Half the surface area, all the SAH needs
+    float GetHalfArea() const
+    {
+        glm::vec3 e = Max - Min;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    void Merge(const glm::vec3& p) { Min = glm::min(Min, p); Max = glm::max(Max, p); }
+    void Merge(const AABB& b) { Min = glm::min(Min, b.Min); Max = glm::max(Max, b.Max); }
+
+    bool Contains(const AABB& b) const { return glm::all(glm::lessThanEqual(Min, b.Min)) && glm::all(glm::greaterThanEqual(Max, b.Max)); }
+    bool Overlaps(const AABB& b) const { return glm::all(glm::lessThanEqual(Min, b.Max)) && glm::all(glm::greaterThanEqual(Max, b.Min)); }
+
+    // Box around this one after the transform
+    AABB Transform(const glm::mat4& m) const;
+};
+
+inline AABB Merge(const AABB& a, const AABB& b) { return AABB(glm::min(a.Min, b.Min), glm::max(a.Max, b.Max)); }
+
+
+struct Ray {
+    glm::vec3 Origin = glm::vec3(0.0f);
+    glm::vec3 Direction = glm::vec3(0.0f, 0.0f, -1.0f);    // Need not be normalized, distances are in its units
+    float MaxDistance = FLT_MAX;
+
+    // 1 / Direction, with zero components nudged so that the slabs never see 0 * inf
+    glm::vec3 GetInvDirection() const;
+
+    // Entry distance into the box, or a negative value if the ray misses it within
+    // MaxDistance. InvDirection from GetInvDirection(), computed once per ray.
+    float Intersect(const AABB& Box, const glm::vec3& InvDirection) const;
+};
+
+
+// Six planes facing inwards, Normal.xyz and Distance in w: a point p is on the inner side
+// of a plane when dot(Normal, p) + Distance >= 0.
+struct Frustum {
+    enum PLANE {
+        PLANE_LEFT,
+        PLANE_RIGHT,
+        PLANE_BOTTOM,
+        PLANE_TOP,
+        PLANE_NEAR,
+        PLANE_FAR,
+        NUM_PLANES
+    };
+
+    glm::vec4 Planes[NUM_PLANES];
+
+    // From Projection * View (GL clip space, z in [-w, w]); the planes are in world space
+    // and normalized, so that the plane distances of spheres are in world units.
+    static Frustum FromMatrix(const glm::mat4& ViewProj);
+
+    enum RESULT {
+        OUTSIDE,
+        INTERSECTS,
+        INSIDE
+    };
+
+    RESULT Test(const AABB& Box) const;
+    bool IsVisible(const glm::vec3& Center, float Radius) const;
+};
+
+#endif  /* BOUNDS_H */
@@ -5,22 +5,41 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <GLFW/glfw3.h>
 
+// What the view matrix is built from; the frame loop interpolates between two of these
+struct CameraState {
+    glm::vec3 Position = glm::vec3(0.0f);
+    glm::vec3 Target = glm::vec3(0.0f);
+    glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    glm::mat4 GetMatrix() const { return glm::lookAt(Position, Target, Up); }
+};
+
+CameraState Lerp(const CameraState& a, const CameraState& b, float Factor);
+
 class Camera {
 public:
     Camera(int windowWidth, int windowHeight);
     Camera(int windowWidth, int windowHeight, const glm::vec3& position, const glm::vec3& target, const glm::vec3& up);
 
     void SetPosition(float x, float y, float z);
+
+    // Places the camera at Position looking at the Target point, e.g. for scripted paths
+    void SetLookAt(const glm::vec3& Position, const glm::vec3& Target);
     void OnKeyboard(int key, float deltaTime); // key from GLFW_KEY_*, deltaTime passed in from main loop
     void OnMouse(float xpos, float ypos);
     void OnRender();
 
     glm::mat4 GetMatrix() const;
+    CameraState GetState() const;
 
     const glm::vec3& GetPosition() const { return m_position; }
     const glm::vec3& GetFront() const { return m_front; }
     const glm::vec3& GetTarget() { return m_target; }
 
+    // Bumped whenever the position or orientation changes, so that users can cache
+    // anything derived from the view matrix
+    unsigned int GetVersion() const { return m_Version; }
+
 private:
     void Update();
     void UpdateCameraVectors();
@@ -52,6 +71,8 @@ private:
     bool m_OnLowerEdge;
     bool m_OnLeftEdge;
     bool m_OnRightEdge;
+
+    unsigned int m_Version = 0;
 };
 
 #endif // CAMERA_H
@@ -0,0 +1,36 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Scripted camera movement for offline captures. Keys are linearly interpolated and the
+// path holds its first and last key outside of their time range.
+class CameraPath
+{
+public:
+    struct Key {
+        float Time = 0.0f;      // Seconds
+        glm::vec3 Position = glm::vec3(0.0f);
+        glm::vec3 Target = glm::vec3(0.0f);
+    };
+
+    CameraPath() {};
+
+    // One key per line: "time px py pz tx ty tz". Empty lines and lines starting with '#'
+    // are skipped; keys must be in increasing time order.
+    bool LoadFromFile(const char* pFilename);
+
+    // A full circle around Center in Duration seconds
+    void MakeOrbit(const glm::vec3& Center, float Radius, float Height, float Duration, unsigned int NumKeys = 64);
+
+    void Evaluate(float Time, glm::vec3& Position, glm::vec3& Target) const;
+
+    float GetDuration() const { return m_Keys.empty() ? 0.0f : m_Keys.back().Time; }
+    unsigned int GetNumKeys() const { return (unsigned int)m_Keys.size(); }
+
+private:
+    std::vector<Key> m_Keys;
+};
+
+#endif  /* CAMERA_PATH_H */
@@ -1 +1,245 @@
-#pragma once
+#ifndef CHARACTER_H
+#define CHARACTER_H
+
+#include <glm/glm.hpp>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "..//headers/BVH.h"
+#include "..//headers/Culling.h"
+#include "..//headers/ResourcePools.h"
+#include "..//headers/Skeleton.h"
+
+class JobSystem;
+
+// A character is an entity: an id with no data of its own. Its data lives in component
+// arrays, one per kind of component, and the systems of CharacterWorld walk those arrays
+// from start to end. There are no per-character objects, no virtual calls and no pointers
+// to follow.
+//
+// The low bits of an Entity index the sparse tables, the high bits count how often the
+// index was reused so that a destroyed entity's id does not come back to life.
+typedef unsigned int Entity;
+
+#define ENTITY_INDEX_BITS 20
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define INVALID_ENTITY 0xFFFFFFFFu
+
+inline unsigned int GetEntityIndex(Entity e) { return e & ENTITY_INDEX_MASK; }
+
+
+// Sparse set: the components are packed in m_Data, and m_Sparse maps an entity index to
+// its position there. Adding appends, removing moves the last component into the hole, so
+// the packed array never has gaps but its order changes.
+template<typename T>
+class ComponentArray
+{
+public:
+    static const unsigned int INVALID_INDEX = 0xFFFFFFFF;
+
+    T& Add(Entity e, const T& Component = T());
+    void Remove(Entity e);
+
+    bool Has(Entity e) const { return GetPackedIndex(e) != INVALID_INDEX; }
+
+    // NULL if the entity has no such component
+    T* Get(Entity e);
+
+    unsigned int GetPackedIndex(Entity e) const;
+
+    unsigned int Size() const { return (unsigned int)m_Data.size(); }
+    T* Data() { return m_Data.data(); }
+    const T* Data() const { return m_Data.data(); }
+    Entity GetEntity(unsigned int PackedIndex) const { return m_Entities[PackedIndex]; }
+
+private:
+    std::vector<T> m_Data;
+    std::vector<Entity> m_Entities;         // Owner of each packed component
+    std::vector<unsigned int> m_Sparse;     // By entity index, INVALID_INDEX if absent
+};
+
+
+// Components
+
+struct CharacterTransform {
+    glm::vec3 Position = glm::vec3(0.0f);
+    float Heading = 0.0f;                   // Radians around +Y, 0 faces +Z
+    float Speed = 0.0f;                     // Units per second along the heading
+    glm::mat4 World = glm::mat4(1.0f);      // Written by UpdateWorld()
+};
+
+// The character's own copy of its skeleton's pose. The skeleton itself is shared by every
+// character of the same model; poses of all the characters sit in CharacterWorld::Poses,
+// this says where.
+struct SkeletonInstance {
+    std::shared_ptr<const SkeletonAsset> pAsset;
+    unsigned int NumJoints = 0;
+    unsigned int PoseOffset = 0;            // First joint in the pose buffer
+};
+
+struct AnimationState {
+    unsigned int Clip = 0;
+    float Time = 0.0f;                      // Seconds into the clip
+    float Duration = 1.0f;                  // Kept positive by UpdateAnimation()
+    float PlaybackRate = 1.0f;
+    bool Loop = true;
+};
+
+struct MeshRef {
+    MeshHandle Mesh;
+};
+
+// Bounding sphere, in model space and in world space. Characters with a skeleton get the
+// model space sphere from the bounds of their current clip.
+struct CharacterBounds {
+    glm::vec3 LocalCenter = glm::vec3(0.0f);
+    float LocalRadius = 0.0f;
+    glm::vec3 Center = glm::vec3(0.0f);     // Written by UpdateBounds()
+    float Radius = 0.0f;
+};
+
+
+// Owns the characters and their components, and runs the systems over them. The systems
+// take a job system to split the arrays across threads, or NULL to run on the caller.
+class CharacterWorld
+{
+public:
+    CharacterWorld() {};
+
+    CharacterWorld(const CharacterWorld&) = delete;
+    CharacterWorld& operator=(const CharacterWorld&) = delete;
+
+    Entity Create();
+
+    // Removes all its components
+    void Destroy(Entity e);
+
+    // Gives the entity a SkeletonInstance of the asset with room for its pose. The room of a
+    // destroyed skeleton with the same number of joints is reused first.
+    SkeletonInstance& AddSkeleton(Entity e, const std::shared_ptr<const SkeletonAsset>& pAsset);
+
+    bool IsAlive(Entity e) const;
+    unsigned int NumEntities() const { return m_NumAlive; }
+
+    ComponentArray<CharacterTransform> Transforms;
+    ComponentArray<SkeletonInstance> Skeletons;
+    ComponentArray<AnimationState> Animations;
+    ComponentArray<MeshRef> Meshes;
+    ComponentArray<CharacterBounds> Bounds;
+
+    // World spheres of Bounds in the same order, as arrays for CullSpheres()
+    SphereArray BoundSpheres;
+
+    // Local joint transforms of every skeleton instance. Ranges are handed out by
+    // AddSkeleton() and given back when the skeleton goes away.
+    std::vector<glm::mat4> Poses;
+
+    // World bounds of everything with CharacterBounds, UserData is the Entity. Refitted by
+    // UpdateTree(); picking, audio and AI query it between updates.
+    BVH Tree;
+
+    // Walks along the heading, turning back towards the center past Radius
+    void UpdateLocomotion(float DeltaTime, float Radius, JobSystem* pJobs = NULL);
+    void UpdateAnimation(float DeltaTime, JobSystem* pJobs = NULL);
+    void UpdateWorld(JobSystem* pJobs = NULL);
+    void UpdateBounds(JobSystem* pJobs = NULL);
+    void UpdateTree();
+
+    // Samples each skeleton's clip at its AnimationState time into Poses; skeletons with
+    // no AnimationState keep the bind pose. Not part of Update(), only drawn characters
+    // need it.
+    void UpdatePoses(JobSystem* pJobs = NULL);
+
+    // Same for the listed entities only, e.g. the visible ones
+    void UpdatePoses(const Entity* pEntities, unsigned int Count, JobSystem* pJobs = NULL);
+
+    // All of the above but UpdatePoses(), in order
+    void Update(float DeltaTime, float Radius, JobSystem* pJobs = NULL);
+
+private:
+    void ReleasePose(Entity e);
+
+    std::vector<unsigned int> m_Generations;    // By entity index
+    std::vector<unsigned int> m_FreeIndices;
+    unsigned int m_NumAlive = 0;
+
+    // Unused ranges of Poses, their offsets by number of joints
+    std::map<unsigned int, std::vector<unsigned int> > m_FreePoseRanges;
+
+    ComponentArray<BVH::ProxyId> m_Proxies;     // In Tree, for the entities with bounds
+};
+
+
+template<typename T>
+const unsigned int ComponentArray<T>::INVALID_INDEX;
+
+
+template<typename T>
+T& ComponentArray<T>::Add(Entity e, const T& Component)
+{
+    unsigned int Index = GetEntityIndex(e);
+
+    if (Index >= m_Sparse.size()) {
+        m_Sparse.resize(Index + 1, INVALID_INDEX);
+    }
+
+    if (m_Sparse[Index] != INVALID_INDEX) {
+        m_Data[m_Sparse[Index]] = Component;
+        return m_Data[m_Sparse[Index]];
+    }
+
+    m_Sparse[Index] = (unsigned int)m_Data.size();
+    m_Data.push_back(Component);
+    m_Entities.push_back(e);
+
+    return m_Data.back();
+}
+
+
+template<typename T>
+void ComponentArray<T>::Remove(Entity e)
+{
+    unsigned int PackedIndex = GetPackedIndex(e);
+
+    if (PackedIndex == INVALID_INDEX) {
+        return;
+    }
+
+    unsigned int Last = (unsigned int)m_Data.size() - 1;
+
+    if (PackedIndex != Last) {
+        m_Data[PackedIndex] = m_Data[Last];
+        m_Entities[PackedIndex] = m_Entities[Last];
+        m_Sparse[GetEntityIndex(m_Entities[PackedIndex])] = PackedIndex;
+    }
+
+    m_Data.pop_back();
+    m_Entities.pop_back();
+    m_Sparse[GetEntityIndex(e)] = INVALID_INDEX;
+}
+
+
+template<typename T>
+T* ComponentArray<T>::Get(Entity e)
+{
+    unsigned int PackedIndex = GetPackedIndex(e);
+    return (PackedIndex == INVALID_INDEX) ? NULL : &m_Data[PackedIndex];
+}
+
+
+template<typename T>
+unsigned int ComponentArray<T>::GetPackedIndex(Entity e) const
+{
+    unsigned int Index = GetEntityIndex(e);
+
+    if (Index >= m_Sparse.size()) {
+        return INVALID_INDEX;
+    }
+
+    // The slot may belong to a newer entity with the same index
+    unsigned int PackedIndex = m_Sparse[Index];
+    return (PackedIndex != INVALID_INDEX && m_Entities[PackedIndex] == e) ? PackedIndex : INVALID_INDEX;
+}
+
+#endif  /* CHARACTER_H */
@@ -0,0 +1,98 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <vector>
+
+#include "..//headers/Bounds.h"
+
+class JobSystem;
+
+// Frustum culling of many bounds at once. The bounds are kept as structure of arrays, so
+// that one SIMD register holds the same coordinate of 4 (SSE) or 8 (AVX) objects and each
+// plane is tested against all of them in a handful of instructions. The result is the
+// compacted list of the indices that are at least partly inside, in increasing order.
+//
+// SSE is used on every x86 build (x64 always has it). The AVX versions are built on x86 too,
+// without /arch:AVX, and only run when the CPU and the OS support AVX. Other CPUs get the
+// scalar loop.
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE
+#endif
+
+#if defined(CULLING_SSE) && (defined(_MSC_VER) || defined(__GNUC__))
+#define CULLING_AVX
+#endif
+
+// Arrays are padded to this many entries with bounds that are never visible
+#define CULLING_PADDING 8
+
+enum CULL_PATH {
+    CULL_SCALAR,
+    CULL_SSE,
+    CULL_AVX,
+    CULL_BEST               // Widest one built in that the CPU runs
+};
+
+// Bounding spheres
+class SphereArray
+{
+public:
+    void Resize(unsigned int Count);
+
+    void Set(unsigned int i, const glm::vec3& Center, float Radius)
+    {
+        m_X[i] = Center.x;
+        m_Y[i] = Center.y;
+        m_Z[i] = Center.z;
+        m_Radius[i] = Radius;
+    }
+
+    unsigned int Size() const { return m_Size; }
+
+    const float* X() const { return m_X.data(); }
+    const float* Y() const { return m_Y.data(); }
+    const float* Z() const { return m_Z.data(); }
+    const float* Radius() const { return m_Radius.data(); }
+
+private:
+    std::vector<float> m_X;
+    std::vector<float> m_Y;
+    std::vector<float> m_Z;
+    std::vector<float> m_Radius;
+    unsigned int m_Size = 0;
+};
+
+// Axis aligned boxes, as center and half extent
+class BoxArray
+{
+public:
+    void Resize(unsigned int Count);
+
+    void Set(unsigned int i, const AABB& Box);
+
+    unsigned int Size() const { return m_Size; }
+
+    const float* Center(int Axis) const { return m_Center[Axis].data(); }
+    const float* Extent(int Axis) const { return m_Extent[Axis].data(); }
+
+private:
+    std::vector<float> m_Center[3];
+    std::vector<float> m_Extent[3];
+    unsigned int m_Size = 0;
+};
+
+// Writes the indices of the visible bounds to pVisible, which has room for all of them,
+// and returns how many there are. With a job system large arrays are split across its
+// threads.
+unsigned int CullSpheres(const Frustum& f, const SphereArray& Spheres, unsigned int* pVisible,
+                         JobSystem* pJobs = NULL, CULL_PATH Path = CULL_BEST);
+
+unsigned int CullBoxes(const Frustum& f, const BoxArray& Boxes, unsigned int* pVisible,
+                       JobSystem* pJobs = NULL, CULL_PATH Path = CULL_BEST);
+
+// Of the path that actually runs: CULL_BEST and the paths that are not built in or that
+// the CPU lacks are resolved
+const char* GetCullPathName(CULL_PATH Path);
+
+#endif  /* CULLING_H */
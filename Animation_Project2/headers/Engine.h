@@ -6,6 +6,15 @@
 #include "..//headers/Camera.h"
 #include "..//headers/SkinnedMesh.h"
 #include "..//headers/SkinningTechnique.h"
+#include "..//headers/TextureManager.h"
+#include "..//headers/TextureStreamer.h"
+#include "..//headers/RenderQueue.h"
+#include "..//headers/StreamBuffer.h"
+#include "..//headers/FramePacket.h"
+#include "..//headers/ResourcePools.h"
+#include "..//headers/Scene.h"
+#include "..//headers/Character.h"
+#include "..//headers/OcclusionBuffer.h"
 #include <chrono>
 
 
@@ -17,11 +26,38 @@ public:
 
     bool Init();
 
-    void RenderSceneCB();
+    // Count animated characters of one model, in a grid around the origin. The model is
+    // loaded once and shared; each character only adds its components and its pose.
+    bool SpawnCharacters(const std::string& Filename, unsigned int Count);
+
+    // Count walls in rows across the crowd, the model scaled to fit each one. They are drawn
+    // and their bounding box goes to the occlusion buffer, so the characters behind them are
+    // neither animated nor drawn. The model should be a solid slab that fills its bounds.
+    bool AddWalls(const std::string& Filename, unsigned int Count);
+
+    // Main thread: samples the keyboard and the mouse for the next Simulate()
+    void GatherInput(GLFWwindow* window, SimulationInput& Input);
+
+    // Simulation stage: input, camera, simulation time and the list of what to draw. Runs
+    // Input.NumSteps fixed steps, then fills the packet. No GL calls, so it can run on
+    // another thread while Render() draws the previous packet (see FramePipeline).
+    void Simulate(const SimulationInput& Input, FramePacket& Packet);
+
+    // Render stage, GL thread only. Reads nothing the simulation writes but the packet.
+    void Render(const FramePacket& Packet);
+
+    // Packs the current state without stepping and renders it, for the tools that drive
+    // the camera themselves (capture, benchmarks). Alpha as in FrameLoop.
+    void RenderSceneCB(float Alpha = 1.0f);
 
     // 🔑 Add these static methods:
     static void MouseCallback(GLFWwindow* window, double xpos, double ypos);
-    void ProcessInput(GLFWwindow* window, float deltaTime);
+    static void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
+
+    void OnResize(int Width, int Height);
+    void SetFOV(float FOV);
+
+    Camera* GetCamera() { return pGameCamera; }
 
     struct PersProjInfo
     {
@@ -36,12 +72,52 @@ private:
     GLuint WVPLocation;
     GLuint SamplerLocation;
     Camera* pGameCamera = NULL;
-    SkinnedMesh* pMesh1 = NULL;
+    TextureManager* pTextureManager = NULL;
+    TextureStreamer* pTextureStreamer = NULL;
     PersProjInfo persProjInfo;
+    RenderQueue renderQueue;
+    StreamBuffer* pFrameData = NULL;    // Per-frame uniform data, rewritten every frame
     SkinningTechnique* pSkinningTech = NULL;
+    ResourcePools m_Resources;          // Meshes, resolved by the render stage only
+
+    // Set by Init(), then only read
+    MeshHandle m_Mesh;
+
+    // Simulation stage only
     PointLight pointLights[SkinningTechnique::MAX_POINT_LIGHTS];
     SpotLight spotLights[SkinningTechnique::MAX_SPOT_LIGHTS];
-    long long StartTime = 0;
+    unsigned int m_LightsVersion = 1;   // Bumped whenever a light moves or changes
+    CameraState m_PrevCameraState;      // At the start of the last simulation step
+    CameraState m_PackedCameraState;    // In the last packet, moves the flashlight
+    double m_SimulationTime = 0.0;      // Seconds, advanced in fixed steps only
+    Scene m_Scene;
+    Scene::NodeId m_MeshNode = Scene::INVALID_NODE;
+    CharacterWorld m_Characters;
+    unsigned long long m_NumCharactersDrawn = 0;
+    unsigned long long m_NumCharactersCulled = 0;
+    unsigned long long m_NumCharactersOccluded = 0;
+    OcclusionBuffer m_Occlusion;
+    MeshHandle m_WallMesh;
+    glm::mat4 m_WallModel = glm::mat4(1.0f);   // Fits the wall model in a unit box at its node
+    std::vector<Scene::NodeId> m_WallNodes;
+    std::vector<Occluder> m_Occluders;  // One per wall, moved with its node
+
+    // Render stage only
+    glm::mat4 m_Projection = glm::mat4(1.0f);
+    bool m_ProjectionDirty = true;      // Rebuilt on resize or FOV change only
+    CameraState m_SentCameraState;      // In the camera block
+    unsigned long long m_NumBindPosePalettes = 0;   // Palettes that did not fit in pFrameData
+    FrameArena m_RenderArena;           // Scratch data of Render(), reset every frame
+    unsigned int m_CommittedLightsVersion = 0;
+    FramePacket m_SerialPacket;         // RenderSceneCB() only
+
+    // Main thread, handed to the simulation by GatherInput()
+    float m_MouseX = 0.0f;
+    float m_MouseY = 0.0f;
+    bool m_MouseMoved = false;
+    bool m_ReloadKeyDown = false;
+    bool m_ReloadRequested = false;     // F5, reloads the meshes at the start of the next Render()
+
     int DisplayBoneIndex = 0;
 
     int WINDOW_WIDTH = 1280;
@@ -49,8 +125,13 @@ private:
     GLFWwindow* m_Window;
 
 
+    void Step(const SimulationInput& Input);
+    void BuildPacket(float Alpha, const glm::mat4& Projection, FramePacket& Packet);
+    void AddCharacters(const glm::mat4& ViewProj, FramePacket& Packet);
     void ProcessKey(int key, int action, float deltaTime);
     void ProcessMouse(double xpos, double ypos);
+    void UpdateProjection();
+    glm::mat4 ComputeProjection() const;
 
 };
 
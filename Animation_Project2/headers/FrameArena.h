@@ -0,0 +1,120 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// Default size of the block of each thread
+#define FRAME_ARENA_DEFAULT_SIZE (256 * 1024)
+
+// Linear allocator for data that lives for one frame (draw packets, visible lists, scratch
+// arrays). Allocating bumps a pointer and nothing is freed until Reset(), which rewinds
+// every block at once.
+//
+// There is one block per thread of the job system, so jobs allocate without locking; the
+// threads that are not workers share the first block under a mutex. Allocations that do
+// not fit fall back to the heap and are released by the next Reset(), and the overflow
+// count tells when the blocks should be larger.
+//
+// Reset() must not run while another thread allocates, i.e. only between frames.
+class FrameArena
+{
+public:
+    struct Stats {
+        size_t PeakBytes = 0;                   // Most used in one frame, overflows included
+        unsigned long long NumAllocations = 0;
+        unsigned long long NumOverflows = 0;
+        unsigned long long NumResets = 0;
+    };
+
+    explicit FrameArena(size_t BytesPerThread = FRAME_ARENA_DEFAULT_SIZE);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* Allocate(size_t Size, size_t Alignment = 16);
+
+    template<typename T>
+    T* AllocateArray(size_t Count) { return static_cast<T*>(Allocate(sizeof(T) * Count, std::alignment_of<T>::value)); }
+
+    void Reset();
+
+    size_t GetBytesUsed() const;
+
+    const Stats& GetStats() const { return m_Stats; }
+    void PrintStats(const char* pName) const;
+
+private:
+    struct Block {
+        std::mutex Mutex;                       // Only taken for the shared block
+        unsigned char* pData = NULL;            // Allocated on the first use by its thread
+        size_t Offset = 0;
+        size_t OverflowBytes = 0;
+        std::vector<void*> Overflows;
+        unsigned long long NumAllocations = 0;
+        unsigned long long NumOverflows = 0;
+
+        char Padding[64];                       // Keeps the blocks of two threads apart
+    };
+
+    void* AllocateFromBlock(Block& b, size_t Size, size_t Alignment);
+
+    size_t m_BlockSize;
+    std::vector<Block*> m_Blocks;               // Indexed by JobSystem::GetThreadIndex()
+
+    Stats m_Stats;
+};
+
+
+// STL allocator on top of a FrameArena, e.g. FrameVector<int> v(FrameAllocator<int>(&Arena)).
+// Deallocation does nothing: the memory comes back at the next Reset(), so containers
+// using it must not outlive the frame's data. Without an arena it uses the heap.
+template<typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    FrameAllocator(FrameArena* pArena = NULL) : m_pArena(pArena) {}
+
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& Other) : m_pArena(Other.GetArena()) {}
+
+    T* allocate(size_t Count)
+    {
+        if (m_pArena) {
+            return m_pArena->AllocateArray<T>(Count);
+        }
+
+        return static_cast<T*>(::operator new(Count * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t /*Count*/)
+    {
+        if (!m_pArena) {
+            ::operator delete(p);
+        }
+    }
+
+    FrameArena* GetArena() const { return m_pArena; }
+
+private:
+    FrameArena* m_pArena;
+};
+
+template<typename T, typename U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.GetArena() == b.GetArena(); }
+
+template<typename T, typename U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.GetArena() != b.GetArena(); }
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T> >;
+
+#endif  /* FRAME_ARENA_H */
@@ -0,0 +1,64 @@
+#ifndef FRAME_LOOP_H
+#define FRAME_LOOP_H
+
+#include <chrono>
+#include <vector>
+
+// Frame pacing for the main loop. The simulation (camera, animation) advances in fixed
+// steps taken from an accumulator, so its cost and results do not depend on the render
+// rate; rendering happens once per frame and interpolates between the last two steps
+// with GetAlpha().
+//
+// Per frame:
+//     NumSteps = BeginFrame();
+//     NumSteps x Engine::Update(GetFixedStep())
+//     Engine::RenderSceneCB(GetAlpha()), swap
+//     EndFrame();     // Sleeps when a frame cap is set
+class FrameLoop
+{
+public:
+    struct Settings {
+        double FixedStep = 1.0 / 60.0;      // Seconds per simulation step
+        unsigned int MaxStepsPerFrame = 5;  // Past this the simulation slows down instead of spiraling
+        bool VSync = true;                  // Only read by the caller (glfwSwapInterval)
+        double MaxFPS = 0.0;                // 0 means no cap
+    };
+
+    FrameLoop() {};
+
+    void Init(const Settings& s);
+
+    // Returns the number of fixed steps to run before rendering this frame
+    unsigned int BeginFrame();
+
+    // Where the render time falls between the previous and the last step, 0 to 1
+    float GetAlpha() const { return m_Alpha; }
+
+    float GetFixedStep() const { return (float)m_Settings.FixedStep; }
+    const Settings& GetSettings() const { return m_Settings; }
+
+    // Records the frame time and waits for the frame cap
+    void EndFrame();
+
+    // Frame time percentiles over the whole run
+    void PrintStats() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static double Seconds(Clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+    Settings m_Settings;
+
+    Clock::time_point m_LastFrameStart;
+    Clock::time_point m_FrameStart;
+    double m_Accumulator = 0.0;
+    float m_Alpha = 1.0f;
+    bool m_FirstFrame = true;
+
+    std::vector<float> m_FrameTimesMs;      // Start to start, so it includes the swap and the cap
+    unsigned long long m_NumSteps = 0;
+    double m_DroppedTime = 0.0;             // Simulation time lost to MaxStepsPerFrame
+};
+
+#endif  /* FRAME_LOOP_H */
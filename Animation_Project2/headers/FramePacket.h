@@ -0,0 +1,63 @@
+#ifndef FRAME_PACKET_H
+#define FRAME_PACKET_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "..//headers/Camera.h"
+#include "..//headers/FrameArena.h"
+#include "..//headers/ResourcePools.h"
+#include "..//headers/SkinningTechnique.h"
+
+// What the simulation of one frame gets from the main thread. Everything the simulation
+// reads from the outside world is in here, so that a frame replays the same way whether
+// it runs on the main thread or on the simulation thread.
+struct SimulationInput {
+    enum INPUT_KEY {
+        KEY_FORWARD = 1 << 0,
+        KEY_BACK = 1 << 1,
+        KEY_LEFT = 1 << 2,
+        KEY_RIGHT = 1 << 3,
+        KEY_UP = 1 << 4,
+        KEY_DOWN = 1 << 5
+    };
+
+    unsigned long long FrameIndex = 0;
+    unsigned int NumSteps = 0;          // Fixed steps to run, from FrameLoop
+    float FixedStep = 0.0f;
+    float Alpha = 1.0f;                 // Interpolation factor for the packet
+    unsigned int Keys = 0;              // INPUT_KEY bits held this frame
+    bool MouseMoved = false;
+    float MouseX = 0.0f;                // Last cursor position of the frame
+    float MouseY = 0.0f;
+    glm::mat4 Projection = glm::mat4(1.0f);     // Of the window as of this frame, for culling
+};
+
+
+// Everything the render stage needs for one frame. Written by the simulation, then only
+// read by the render stage; the simulation of the next frame fills the other packet.
+// Variable sized data lives in the packet's arena, which is reset when the packet is
+// filled again.
+struct FramePacket {
+    struct MeshInstance {
+        MeshHandle Mesh;                // Shared asset, skipped if it was released meanwhile
+        glm::mat4 World = glm::mat4(1.0f);
+        const glm::mat4* pPalette = NULL;   // NumBones skinning matrices in the arena, NULL for the bind pose
+        unsigned int NumBones = 0;
+    };
+
+    unsigned long long FrameIndex = 0;
+    double SimulationTime = 0.0;
+
+    CameraState Camera;                 // Already interpolated
+
+    unsigned int LightsVersion = 0;     // Bumped by the simulation when a light changed
+    PointLight PointLights[SkinningTechnique::MAX_POINT_LIGHTS];
+    SpotLight SpotLights[SkinningTechnique::MAX_SPOT_LIGHTS];
+
+    FrameArena Arena;
+    FrameVector<MeshInstance> Meshes;   // Visible this frame
+};
+
+#endif  /* FRAME_PACKET_H */
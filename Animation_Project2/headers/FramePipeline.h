@@ -0,0 +1,68 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <functional>
+
+#include "..//headers/FramePacket.h"
+#include "..//headers/JobSystem.h"
+
+// Runs the simulation of frame N+1 as a job while the main (GL) thread renders frame N.
+// There are two packets: the simulation writes one while the render stage reads the other,
+// and they swap when both sides are done.
+//
+// The simulation sees frames in order with the input gathered for them, so the packets
+// are the same with or without the thread; the threaded mode shows each one a frame later,
+// and its first frame shows the state before any input.
+// The serial mode runs the simulation inline, for debugging. While the main thread waits
+// for the simulation it runs other jobs, including the ones the simulation spawns.
+class FramePipeline
+{
+public:
+    typedef std::function<void(const SimulationInput&, FramePacket&)> SimulateFunc;
+
+    struct Stats {
+        unsigned long long NumFrames = 0;
+        double SimulateTimeMs = 0.0;    // On whichever thread ran it
+        double WaitTimeMs = 0.0;        // Main thread blocked on the simulation
+    };
+
+    FramePipeline() {};
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // Without a job system the simulation runs inline (serial mode)
+    bool Init(const SimulateFunc& Simulate, JobSystem* pJobs);
+
+    // Main thread, once per frame. Starts the simulation of Input and returns the packet
+    // to render now. The packet stays valid until the next call.
+    const FramePacket& Advance(const SimulationInput& Input);
+
+    // Waits for the simulation in flight, e.g. before tearing the engine down
+    void Flush();
+
+    bool IsThreaded() const { return m_pJobs != NULL; }
+
+    const Stats& GetStats() const { return m_Stats; }
+    void PrintStats() const;
+
+private:
+    static void SimulateJob(void* pData, unsigned int Begin, unsigned int End);
+    void Simulate(const SimulationInput& Input, FramePacket& Packet);
+
+    SimulateFunc m_Simulate;
+
+    FramePacket m_Packets[2];
+    unsigned int m_Front = 0;           // Index of the packet the render stage reads
+    bool m_HasFront = false;
+
+    JobSystem* m_pJobs = NULL;
+    JobCounter m_Counter;               // The simulation in flight
+    SimulationInput m_PendingInput;     // Its input
+    bool m_Kicked = false;              // The back packet holds a newer frame than the front one
+
+    Stats m_Stats;
+};
+
+#endif  /* FRAME_PIPELINE_H */
@@ -0,0 +1,47 @@
+#ifndef GL_CAPABILITIES_H
+#define GL_CAPABILITIES_H
+
+#include <set>
+#include <string>
+#include <glad/glad.h>
+
+// Everything we need to know about the context, queried once after it is created
+struct GLCapabilities {
+    int MajorVersion = 0;
+    int MinorVersion = 0;
+
+    bool DirectStateAccess = false;         // 4.5 or ARB_direct_state_access
+    bool MultiDrawIndirect = false;         // 4.3 or ARB_multi_draw_indirect, with 4.2 or ARB_base_instance
+    bool BufferStorage = false;             // 4.4 or ARB_buffer_storage
+    bool ShaderDrawParameters = false;      // 4.6 or ARB_shader_draw_parameters
+    bool TextureCompressionS3TC = false;    // EXT_texture_compression_s3tc (BC1-BC3)
+    bool TextureCompressionBPTC = false;    // 4.2 or ARB_texture_compression_bptc (BC7)
+
+    GLint MaxArrayTextureLayers = 0;
+    GLint MaxUniformBlockSize = 0;
+    GLint UniformBufferOffsetAlignment = 0;
+    GLint MaxTextureImageUnits = 0;
+
+    std::set<std::string> Extensions;
+
+    bool IsVersionAtLeast(int Major, int Minor) const
+    {
+        return MajorVersion > Major || (MajorVersion == Major && MinorVersion >= Minor);
+    }
+
+    bool HasExtension(const char* pName) const { return Extensions.count(pName) > 0; }
+};
+
+// Entry points that have a DSA and a bind-to-edit variant. Picked once in InitGLCapabilities()
+// so the hot path doesn't branch on the version.
+struct GLFunctionTable {
+    void (*BindTextureUnit)(GLuint Unit, GLenum Target, GLuint Texture) = NULL;
+};
+
+// Call once the context is current and GLAD is loaded
+bool InitGLCapabilities();
+
+const GLCapabilities& GetGLCapabilities();
+const GLFunctionTable& GetGLFunctions();
+
+#endif  /* GL_CAPABILITIES_H */
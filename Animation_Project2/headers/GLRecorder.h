@@ -0,0 +1,89 @@
+#ifndef GL_RECORDER_H
+#define GL_RECORDER_H
+
+#include <glad/glad.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Replaces the GLAD function pointers used by the engine with stubs that count and log
+// every call and never touch a GPU. Object names are handed out, shaders always compile
+// and mapped buffers point at CPU memory, so Engine::Init() and RenderSceneCB() run
+// unchanged on machines without a GL driver.
+//
+// Only the entry points the engine calls are stubbed; anything else is left NULL so that
+// a new GL call shows up as a crash here instead of as missing numbers.
+class GLRecorder
+{
+public:
+    enum CALL_TYPE {
+        CALL_DRAW = 0,          // glDraw*, glMultiDraw*
+        CALL_STATE = 1,         // Binds, enables, program and viewport changes
+        CALL_UNIFORM = 2,       // glUniform*, constant vertex attributes
+        CALL_UPLOAD = 3,        // Buffer and texture data
+        CALL_OTHER = 4,         // Object creation, queries, sync
+        NUM_CALL_TYPES = 5
+    };
+
+    struct FrameStats {
+        unsigned int NumCalls[NUM_CALL_TYPES] = { 0 };
+        unsigned int NumSubDraws = 0;           // Draws inside multi-draws count once each here
+        unsigned long long UploadedBytes = 0;   // Writes through persistent mappings are not seen
+    };
+
+    GLRecorder() {};
+    ~GLRecorder();
+
+    // Installs the stubs and makes GLAD report the given version, which decides the
+    // paths the engine takes (multi-draw, buffer storage, DSA). Only one recorder can be
+    // installed at a time.
+    bool Install(int MajorVersion = 4, int MinorVersion = 5);
+
+    // Puts the previous function pointers back
+    void Uninstall();
+
+    // Keeps the text of every call, see WriteLog(). Off by default.
+    void SetLogging(bool Enable) { m_Logging = Enable; }
+
+    // Closes the current frame and starts a new one
+    void EndFrame();
+
+    const FrameStats& GetCurrentFrame() const { return m_CurFrame; }
+    const std::vector<FrameStats>& GetFrames() const { return m_Frames; }
+    const std::vector<std::string>& GetLog() const { return m_Log; }
+
+    bool WriteLog(const char* pFilename) const;
+
+    // Stubs only
+    static GLRecorder* Get() { return s_pRecorder; }
+    void Record(CALL_TYPE Type, const char* pName, const char* pFormat, ...);
+    void AddUploadBytes(unsigned long long Bytes) { m_CurFrame.UploadedBytes += Bytes; }
+    void AddSubDraws(unsigned int NumDraws) { m_CurFrame.NumSubDraws += NumDraws; }
+    GLuint NewName() { return ++m_LastName; }
+    void SetBoundBuffer(GLenum Target, GLuint Buffer) { m_BoundBuffers[Target] = Buffer; }
+    GLuint GetBoundBuffer(GLenum Target) { return m_BoundBuffers[Target]; }
+    void* MapBuffer(GLuint Buffer, GLsizeiptr Size);
+    void UnmapBuffer(GLuint Buffer) { m_MappedBuffers.erase(Buffer); }
+    GLuint GetUniformLocation(GLuint Program, const std::string& Name);
+
+private:
+    static GLRecorder* s_pRecorder;
+
+    bool m_Installed = false;
+    bool m_Logging = false;
+
+    FrameStats m_CurFrame;
+    std::vector<FrameStats> m_Frames;
+    std::vector<std::string> m_Log;
+
+    GLuint m_LastName = 0;
+    std::map<GLenum, GLuint> m_BoundBuffers;
+    std::map<GLuint, std::vector<unsigned char> > m_MappedBuffers;
+    std::map<std::string, GLuint> m_UniformLocations;
+
+    int m_SavedMajorVersion = 0;
+    int m_SavedMinorVersion = 0;
+};
+
+#endif  /* GL_RECORDER_H */
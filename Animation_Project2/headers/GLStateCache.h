@@ -0,0 +1,79 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+// Shadow copy of the bindings we change most often. Calls that would set the state to what
+// it already is are dropped before they reach the driver. Code that changes these bindings
+// directly must call Invalidate(), and deleted objects must be reported with the OnDelete*()
+// functions because GL unbinds them implicitly.
+class GLStateCache
+{
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 32;
+    static const unsigned int EDIT_TEXTURE_UNIT = MAX_TEXTURE_UNITS - 1;   // Unless one is active
+
+    struct Stats {
+        unsigned int NumIssued = 0;
+        unsigned int NumFiltered = 0;
+    };
+
+    GLStateCache() { Invalidate(); }
+
+    void UseProgram(GLuint Program);
+    void BindVertexArray(GLuint VAO);
+    void BindBuffer(GLenum Target, GLuint Buffer);
+    void BindBufferBase(GLenum Target, GLuint Index, GLuint Buffer);
+
+    // Sub-allocated ranges move every frame, so these always reach the driver
+    void BindBufferRange(GLenum Target, GLuint Index, GLuint Buffer, GLintptr Offset, GLsizeiptr Size);
+    void ActiveTexture(GLenum TextureUnit);
+
+    // Unit is an index, not GL_TEXTUREi
+    void BindTexture(GLuint Unit, GLenum Target, GLuint Texture);
+
+    // For creating/editing a texture: binds to the active unit, or EDIT_TEXTURE_UNIT if
+    // none was selected through the cache
+    void BindTextureForEdit(GLenum Target, GLuint Texture);
+
+    void OnDeleteProgram(GLuint Program);
+    void OnDeleteVertexArray(GLuint VAO);
+    void OnDeleteBuffer(GLuint Buffer);
+    void OnDeleteTexture(GLuint Texture);
+
+    // Forget everything - the next call of each kind goes to the driver
+    void Invalidate();
+
+    const Stats& GetFrameStats() const { return m_FrameStats; }
+    const Stats& GetTotalStats() const { return m_TotalStats; }
+    void BeginFrame() { m_FrameStats = Stats(); }
+    void PrintStats() const;
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+    // Targets with a tracked binding per unit / buffer binding points
+    enum TEXTURE_TARGET_INDEX { TEX_2D = 0, TEX_2D_ARRAY = 1, TEX_CUBE_MAP = 2, NUM_TEXTURE_TARGETS = 3 };
+    enum BUFFER_TARGET_INDEX { BUF_ARRAY = 0, BUF_ELEMENT_ARRAY = 1, BUF_UNIFORM = 2, BUF_DRAW_INDIRECT = 3, NUM_BUFFER_TARGETS = 4 };
+    static const unsigned int MAX_UNIFORM_BINDINGS = 16;
+
+    static int GetTextureTargetIndex(GLenum Target);
+    static int GetBufferTargetIndex(GLenum Target);
+
+    bool Filter(GLuint& Cached, GLuint Value);
+
+    GLuint m_Program;
+    GLuint m_VAO;
+    GLuint m_ActiveTexture;
+    GLuint m_Buffers[NUM_BUFFER_TARGETS];
+    GLuint m_UniformBindings[MAX_UNIFORM_BINDINGS];
+    GLuint m_Textures[MAX_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+
+    Stats m_FrameStats;
+    Stats m_TotalStats;
+};
+
+// There is a single GL context so there is a single cache
+GLStateCache& GetGLState();
+
+#endif  /* GL_STATE_CACHE_H */
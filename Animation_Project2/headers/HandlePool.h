@@ -0,0 +1,229 @@
+#ifndef HANDLE_POOL_H
+#define HANDLE_POOL_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Reference to an object of a HandlePool. The generation tells a live object from one
+// that has been released and whose slot was reused, so a stale handle looks up NULL
+// instead of someone else's object. A default constructed handle is never valid.
+template<typename T>
+struct Handle {
+    static const unsigned int INVALID_INDEX = 0xFFFFFFFF;
+
+    unsigned int Index = INVALID_INDEX;
+    unsigned int Generation = 0;
+
+    bool IsNull() const { return Index == INVALID_INDEX; }
+
+    bool operator==(const Handle& Other) const { return Index == Other.Index && Generation == Other.Generation; }
+    bool operator!=(const Handle& Other) const { return !(*this == Other); }
+};
+
+
+// Owns objects of type T, handed out as Handle<T>. The live objects are packed in one
+// array, so iterating over them touches no holes; a table of slots indexed by the handle
+// maps to the packed position in O(1).
+//
+// Releasing does not destroy the object right away: the handle stops resolving at once,
+// but the object waits until Collect() is told that the GPU has finished the frame it was
+// released in, so that nothing still queued on the GPU loses its buffers or textures.
+//
+// Create() and Release() move objects around, pointers returned by Get() only last until
+// the next one. T must be movable.
+template<typename T>
+class HandlePool
+{
+public:
+    HandlePool() {};
+
+    HandlePool(const HandlePool&) = delete;
+    HandlePool& operator=(const HandlePool&) = delete;
+
+    template<typename... Args>
+    Handle<T> Create(Args&&... args);
+
+    // NULL for a null, stale or released handle
+    T* Get(Handle<T> h);
+    const T* Get(Handle<T> h) const;
+
+    bool IsAlive(Handle<T> h) const { return Get(h) != NULL; }
+
+    // The object is destroyed by the first Collect() with CompletedFrame >= Frame.
+    // Returns false if the handle was not alive.
+    bool Release(Handle<T> h, unsigned long long Frame);
+
+    // Swaps in a new object under the same handle, e.g. a reloaded asset. The old object
+    // is retired like in Release().
+    bool Replace(Handle<T> h, T&& Object, unsigned long long Frame);
+
+    // Destroys the released objects the GPU is done with
+    void Collect(unsigned long long CompletedFrame);
+
+    // Live objects, packed
+    unsigned int Size() const { return (unsigned int)m_Objects.size(); }
+    T* begin() { return m_Objects.data(); }
+    T* end() { return m_Objects.data() + m_Objects.size(); }
+    Handle<T> GetHandle(unsigned int PackedIndex) const;
+
+    // Released objects not destroyed yet
+    unsigned int NumRetired() const { return (unsigned int)m_Retired.size(); }
+
+private:
+    struct Slot {
+        unsigned int PackedIndex = Handle<T>::INVALID_INDEX;   // INVALID_INDEX when free
+        unsigned int Generation = 1;
+    };
+
+    struct RetiredObject {
+        T Object;
+        unsigned long long Frame;
+    };
+
+    std::vector<T> m_Objects;
+    std::vector<unsigned int> m_PackedToSlot;   // Parallel to m_Objects
+    std::vector<Slot> m_Slots;
+    std::vector<unsigned int> m_FreeSlots;
+    std::vector<RetiredObject> m_Retired;
+};
+
+
+template<typename T>
+template<typename... Args>
+Handle<T> HandlePool<T>::Create(Args&&... args)
+{
+    unsigned int SlotIndex;
+
+    if (m_FreeSlots.empty()) {
+        SlotIndex = (unsigned int)m_Slots.size();
+        m_Slots.push_back(Slot());
+    }
+    else {
+        SlotIndex = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+    }
+
+    m_Objects.emplace_back(std::forward<Args>(args)...);
+    m_PackedToSlot.push_back(SlotIndex);
+
+    Slot& s = m_Slots[SlotIndex];
+    s.PackedIndex = (unsigned int)m_Objects.size() - 1;
+
+    Handle<T> h;
+    h.Index = SlotIndex;
+    h.Generation = s.Generation;
+
+    return h;
+}
+
+
+template<typename T>
+T* HandlePool<T>::Get(Handle<T> h)
+{
+    return const_cast<T*>(static_cast<const HandlePool*>(this)->Get(h));
+}
+
+
+template<typename T>
+const T* HandlePool<T>::Get(Handle<T> h) const
+{
+    if (h.Index >= m_Slots.size()) {
+        return NULL;
+    }
+
+    const Slot& s = m_Slots[h.Index];
+
+    if (s.Generation != h.Generation || s.PackedIndex == Handle<T>::INVALID_INDEX) {
+        return NULL;
+    }
+
+    return &m_Objects[s.PackedIndex];
+}
+
+
+template<typename T>
+bool HandlePool<T>::Release(Handle<T> h, unsigned long long Frame)
+{
+    if (!IsAlive(h)) {
+        return false;
+    }
+
+    Slot& s = m_Slots[h.Index];
+    unsigned int PackedIndex = s.PackedIndex;
+
+    RetiredObject r = { std::move(m_Objects[PackedIndex]), Frame };
+    m_Retired.push_back(std::move(r));
+
+    // Fill the hole with the last object to keep the array packed
+    unsigned int LastIndex = (unsigned int)m_Objects.size() - 1;
+
+    if (PackedIndex != LastIndex) {
+        m_Objects[PackedIndex] = std::move(m_Objects[LastIndex]);
+        m_PackedToSlot[PackedIndex] = m_PackedToSlot[LastIndex];
+        m_Slots[m_PackedToSlot[PackedIndex]].PackedIndex = PackedIndex;
+    }
+
+    m_Objects.pop_back();
+    m_PackedToSlot.pop_back();
+
+    // Every handle to the slot goes stale
+    s.PackedIndex = Handle<T>::INVALID_INDEX;
+    s.Generation++;
+    m_FreeSlots.push_back(h.Index);
+
+    return true;
+}
+
+
+template<typename T>
+bool HandlePool<T>::Replace(Handle<T> h, T&& Object, unsigned long long Frame)
+{
+    T* pOld = Get(h);
+
+    if (!pOld) {
+        return false;
+    }
+
+    RetiredObject r = { std::move(*pOld), Frame };
+    m_Retired.push_back(std::move(r));
+    *pOld = std::move(Object);
+
+    return true;
+}
+
+
+template<typename T>
+void HandlePool<T>::Collect(unsigned long long CompletedFrame)
+{
+    unsigned int NumKept = 0;
+
+    for (unsigned int i = 0; i < m_Retired.size(); i++) {
+        if (m_Retired[i].Frame > CompletedFrame) {
+            if (i != NumKept) {
+                m_Retired[NumKept] = std::move(m_Retired[i]);
+            }
+
+            NumKept++;
+        }
+    }
+
+    // Destroys the moved-from and the collected objects
+    m_Retired.erase(m_Retired.begin() + NumKept, m_Retired.end());
+}
+
+
+template<typename T>
+Handle<T> HandlePool<T>::GetHandle(unsigned int PackedIndex) const
+{
+    Handle<T> h;
+
+    if (PackedIndex < m_Objects.size()) {
+        h.Index = m_PackedToSlot[PackedIndex];
+        h.Generation = m_Slots[h.Index].Generation;
+    }
+
+    return h;
+}
+
+#endif  /* HANDLE_POOL_H */
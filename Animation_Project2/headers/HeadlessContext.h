@@ -0,0 +1,69 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+
+// GL context without a visible window, for batch rendering on machines with no display
+// and no GPU (Mesa llvmpipe). Tried in order:
+//   1. EGL on Mesa's surfaceless platform, when built with USE_EGL_HEADLESS
+//   2. A hidden GLFW window with an OSMesa context
+//   3. A hidden GLFW window with the native context API (needs a display)
+// The default framebuffer is not used; render into an OffscreenTarget.
+class HeadlessContext
+{
+public:
+    HeadlessContext() {};
+    ~HeadlessContext();
+
+    // Creates the context, makes it current and loads the GL functions
+    bool Init(int MajorVersion, int MinorVersion);
+
+    void Destroy();
+
+    const char* GetBackendName() const { return m_pBackendName; }
+
+private:
+    bool InitEGL(int MajorVersion, int MinorVersion);
+    bool InitGLFW(int MajorVersion, int MinorVersion, int ContextAPI);
+
+    const char* m_pBackendName = "none";
+
+    // EGLDisplay and EGLContext, kept opaque so that the EGL headers are only needed with
+    // USE_EGL_HEADLESS
+    void* m_EGLDisplay = NULL;
+    void* m_EGLContext = NULL;
+
+    GLFWwindow* m_pWindow = NULL;
+    bool m_GLFWInitialized = false;
+};
+
+
+// Color and depth render target of a fixed size with CPU readback
+class OffscreenTarget
+{
+public:
+    OffscreenTarget() {};
+    ~OffscreenTarget();
+
+    bool Init(int Width, int Height);
+
+    // Makes it the draw and read framebuffer
+    void Bind();
+
+    // RGBA8, bottom row first as returned by glReadPixels
+    void ReadPixels(std::vector<unsigned char>& Pixels);
+
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+
+private:
+    GLuint m_FBO = 0;
+    GLuint m_ColorBuffer = 0;
+    GLuint m_DepthBuffer = 0;
+    int m_Width = 0;
+    int m_Height = 0;
+};
+
+#endif  /* HEADLESS_CONTEXT_H */
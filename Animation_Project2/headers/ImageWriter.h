@@ -0,0 +1,9 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+// Writes 8-bit RGBA pixels as a PNG. The image data is stored without compression (deflate
+// "stored" blocks), which keeps the writer small and fast at the cost of file size.
+// FlipY writes the rows bottom-up, for data read back with glReadPixels.
+bool WritePNG(const char* pFilename, int Width, int Height, const unsigned char* pRGBA, bool FlipY = false);
+
+#endif  /* IMAGE_WRITER_H */
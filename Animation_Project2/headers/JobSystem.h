@@ -0,0 +1,188 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+// ParallelFor jobs get their index range in Begin/End, other jobs get 0, 0
+typedef void (*JobFunc)(void* pData, unsigned int Begin, unsigned int End);
+
+struct Job {
+    JobFunc pFunc = NULL;
+    void* pData = NULL;
+    unsigned int Begin = 0;
+    unsigned int End = 0;
+    JobCounter* pCounter = NULL;        // Decremented once the job has run
+};
+
+
+// Number of unfinished jobs of a batch. Wait for it with JobSystem::Wait(), or start more
+// jobs once it reaches zero with JobSystem::RunAfter(). It can be destroyed as soon as
+// IsDone() returns true.
+class JobCounter
+{
+public:
+    JobCounter() {};
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return m_Value.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::mutex m_Mutex;
+    unsigned int m_Count = 0;               // Under m_Mutex
+    std::vector<Job> m_Continuations;       // Under m_Mutex, started when m_Count drops to 0
+
+    // m_Count as seen by waiters. It only reaches zero after the last job has let go of
+    // the counter, which is what makes destroying it right after IsDone() safe.
+    std::atomic<unsigned int> m_Value{ 0 };
+};
+
+
+// One scheduler for all the engine's parallel work. Each worker thread owns a deque: jobs
+// it spawns go to the back and it takes from the back, idle workers steal from the front
+// of the others. Threads that are not workers (the main thread, the simulation) share one
+// queue, and help run jobs while they Wait().
+class JobSystem
+{
+public:
+    struct Stats {
+        unsigned long long NumJobs = 0;
+        unsigned long long NumSteals = 0;
+        unsigned long long NumSleeps = 0;
+    };
+
+    // NumWorkers extra threads; 0 picks one less than the number of hardware threads
+    explicit JobSystem(unsigned int NumWorkers = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Workers plus the thread that waits
+    unsigned int GetNumThreads() const { return (unsigned int)m_Workers.size() + 1; }
+
+    // 1 to GetNumThreads() - 1 on the workers, 0 on any other thread. For per-thread data.
+    int GetThreadIndex() const { return GetWorkerIndex() + 1; }
+
+    void Run(JobFunc pFunc, void* pData, JobCounter* pCounter);
+    void Run(const Job* pJobs, unsigned int NumJobs, JobCounter* pCounter);
+
+    // Starts the job once Dependency is done
+    void RunAfter(JobCounter& Dependency, JobFunc pFunc, void* pData, JobCounter* pCounter);
+
+    // Runs other jobs until the counter is done
+    void Wait(JobCounter& Counter);
+
+    // Calls Func(Begin, End) over [0, Count) in batches of at least MinBatchSize and
+    // returns when all are done. The calling thread runs the first batch.
+    template<typename Func>
+    void ParallelFor(unsigned int Count, unsigned int MinBatchSize, const Func& f);
+
+    Stats GetStats() const;
+    void PrintStats() const;
+
+private:
+    static const unsigned int QUEUE_SIZE = 4096;
+    static const unsigned int MAX_PARALLEL_FOR_BATCHES = 256;
+
+    // Fixed ring so that pushing a job never allocates
+    struct WorkQueue {
+        std::mutex Mutex;
+        std::vector<Job> Jobs;
+        unsigned int Head = 0;              // Oldest job, stolen first
+        unsigned int Size = 0;
+
+        // Of the thread owning the queue; atomic only so that GetStats() can read them
+        std::atomic<unsigned long long> NumJobs{ 0 };
+        std::atomic<unsigned long long> NumSteals{ 0 };
+        std::atomic<unsigned long long> NumSleeps{ 0 };
+
+        char Padding[64];                   // Keeps the next queue's lock off this cache line
+
+        bool PushBack(const Job& j);
+        bool PopBack(Job& j);
+        bool PopFront(Job& j);
+    };
+
+    template<typename Func>
+    static void ParallelForBatch(void* pData, unsigned int Begin, unsigned int End) { (*(const Func*)pData)(Begin, End); }
+
+    void WorkerMain(unsigned int Index);
+    int GetWorkerIndex() const;
+    void Push(const Job* pJobs, unsigned int NumJobs);
+    bool FindJob(int WorkerIndex, Job& j);
+    void Execute(const Job& j);
+    static void AddToCounter(JobCounter* pCounter, unsigned int NumJobs);
+
+    std::vector<std::thread> m_Workers;
+    std::vector<WorkQueue*> m_Queues;       // One per worker
+    WorkQueue m_SharedQueue;                // Jobs pushed by threads that are not workers, and
+                                            // the stats of those threads
+
+    std::atomic<unsigned int> m_NumQueued{ 0 };
+    std::atomic<unsigned int> m_NumSleeping{ 0 };
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeUp;
+    std::atomic<bool> m_Quit{ false };
+};
+
+
+// Shared by the whole engine, created with the default number of workers on first use
+JobSystem& GetJobSystem();
+
+
+template<typename Func>
+void JobSystem::ParallelFor(unsigned int Count, unsigned int MinBatchSize, const Func& f)
+{
+    if (Count == 0) {
+        return;
+    }
+
+    if (MinBatchSize == 0) {
+        MinBatchSize = 1;
+    }
+
+    // A few batches per thread so that stealing can even out uneven work
+    unsigned int NumBatches = Count / MinBatchSize;
+    unsigned int MaxBatches = GetNumThreads() * 4;
+
+    if (MaxBatches > MAX_PARALLEL_FOR_BATCHES) {
+        MaxBatches = MAX_PARALLEL_FOR_BATCHES;
+    }
+
+    if (NumBatches > MaxBatches) {
+        NumBatches = MaxBatches;
+    }
+
+    if (NumBatches <= 1 || m_Workers.empty()) {
+        f(0, Count);
+        return;
+    }
+
+    Job Jobs[MAX_PARALLEL_FOR_BATCHES];
+
+    for (unsigned int i = 0; i < NumBatches; i++) {
+        Jobs[i].pFunc = &ParallelForBatch<Func>;
+        Jobs[i].pData = (void*)&f;
+        Jobs[i].Begin = (unsigned int)((unsigned long long)Count * i / NumBatches);
+        Jobs[i].End = (unsigned int)((unsigned long long)Count * (i + 1) / NumBatches);
+    }
+
+    JobCounter Counter;
+    Run(Jobs + 1, NumBatches - 1, &Counter);
+
+    f(Jobs[0].Begin, Jobs[0].End);
+
+    Wait(Counter);
+}
+
+#endif  /* JOB_SYSTEM_H */
@@ -1,7 +1,14 @@
 #ifndef MATERIAL_H
 #define MATERIAL_H
 
+#include "GLCapabilities.h"
+#include "GLStateCache.h"
+
 #include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cassert>
 #include <glm/glm.hpp>
 #include <gli/gli.hpp>
 #include <stb_image.h>
@@ -11,9 +18,6 @@
 #include <GL/gl.h>
 
 #define STB_IMAGE_IMPLEMENTATION
-// Helper function to check OpenGL version (implement outside)
-bool IsGLVersionHigher(int major, int minor);
-
 struct Texture {
     unsigned int id = 0;           // OpenGL texture object ID
     GLenum m_textureTarget = GL_TEXTURE_2D; // Texture target (usually GL_TEXTURE_2D)
@@ -28,93 +32,297 @@ struct Texture {
     int imageBPP = 0;
     bool isKTX = false;
     gli::gl::format ktxFormat;
+    int numLevels = 1;            // Mip levels stored in the file, 1 means generate at load
+    bool isCompressed = false;
+
+    // Streaming (see TextureStreamer). GL levels match the file's levels; residentBaseLevel is
+    // the GL base level, the finest one sampled. Finer levels down to uploadedBaseLevel may
+    // still hold data, so going back to them needs no upload.
+    int residentBaseLevel = 0;
+    int uploadedBaseLevel = 0;
+    int streamerIndex = -1;       // Slot in the TextureStreamer, -1 when not streamed
 
     Texture(GLenum target, const char* p) : m_textureTarget(target), path(p) {
         // Initially, no texture object created (id=0)
         m_textureObj = 0;
     }
 
-    void BindInternalNonDSA(GLenum TextureUnit)
-    {
-        glActiveTexture(TextureUnit); // TextureUnit is GL_TEXTURE0 + unitIndex
-        glBindTexture(m_textureTarget, m_textureObj);
-    }
+    // Textures are shared through the TextureManager, never copied
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
 
-    void BindInternalDSA(GLenum TextureUnit)
-    {
-        // Pass the unit index to glBindTextureUnit
-        glBindTextureUnit(TextureUnit - GL_TEXTURE0, m_textureObj);
+    ~Texture() {
+        if (!isKTX && m_pStagingData) {
+            stbi_image_free(m_pStagingData);
+        }
+
+        if (m_textureObj != 0) {
+            GetGLState().OnDeleteTexture(m_textureObj);
+            glDeleteTextures(1, &m_textureObj);
+        }
     }
 
+    // TextureUnit is GL_TEXTURE0 + unitIndex. DSA or not was decided when the context was created.
     void Bind(GLenum TextureUnit)
     {
-        if (IsGLVersionHigher(4, 5)) {
-            BindInternalDSA(TextureUnit);
+        GetGLState().BindTexture(TextureUnit - GL_TEXTURE0, m_textureTarget, m_textureObj);
+    }
+
+    // Approximate GPU footprint including the mip chain
+    size_t GetSizeInBytes() const {
+        if (isKTX) {
+            return numLevels > 1 ? GetLevelChainSize(uploadedBaseLevel) : m_ktxSizeInBytes;
         }
-        else {
-            BindInternalNonDSA(TextureUnit);
+
+        size_t BaseLevel = (size_t)imageWidth * (size_t)imageHeight * (size_t)imageBPP;
+        return BaseLevel + BaseLevel / 3;
+    }
+
+    // Size of the levels from BaseLevel down to the smallest one
+    size_t GetLevelChainSize(int BaseLevel) const {
+        size_t Size = 0;
+        for (int Level = BaseLevel; Level < (int)m_levelSizes.size(); Level++) {
+            Size += m_levelSizes[Level];
+        }
+        return Size;
+    }
+
+    // First level whose larger side is at most MaxDimension texels
+    int GetLevelForSize(int MaxDimension) const {
+        int Level = 0;
+        while (Level < numLevels - 1 && std::max(imageWidth >> Level, imageHeight >> Level) > MaxDimension) {
+            Level++;
         }
+        return Level;
     }
 
+    bool IsStreamable() const { return isKTX && numLevels > 1; }
+    bool IsStreamed() const { return streamerIndex >= 0; }
+
     // Loads texture from disk; returns true if successful
     bool Load() {
-        const char* pExt = strrchr(path.c_str(), '.');
-        isKTX = pExt && !strcmp(pExt, ".ktx");
+        stbi_set_flip_vertically_on_load(1);
+
+        if (!Decode()) {
+            return false;
+        }
+
+        Upload();
+
+        return true;
+    }
+
+    // Decodes the file into staging memory. Touches no GL state so it can run on any thread.
+    // The stb_image vertical flip is global state and must be set by the caller.
+    bool Decode() {
+        if (IsDecoded()) {
+            return true;
+        }
 
-        unsigned char* pImageData = nullptr;
+        // Decoding again (streaming, texture arrays) only fills the staging memory: the
+        // description may be read on the render thread meanwhile
+        bool FirstDecode = (imageWidth == 0);
+
+        if (FirstDecode) {
+            const char* pExt = strrchr(path.c_str(), '.');
+            isKTX = pExt && !strcmp(pExt, ".ktx");
+        }
 
         if (isKTX) {
-            gli::texture gliTex = gli::load_ktx(path.c_str());
-            if (gliTex.empty()) {
+            m_ktxStaging = gli::load_ktx(path.c_str());
+            if (m_ktxStaging.empty()) {
                 printf("Failed to load KTX texture: %s\n", path.c_str());
                 return false;
             }
+            m_pStagingData = (unsigned char*)m_ktxStaging.data();
+        }
+        else {
+            m_pStagingData = stbi_load(path.c_str(), &imageWidth, &imageHeight, &imageBPP, 0);
+            if (!m_pStagingData) {
+                printf("Can't load texture from '%s' - %s\n", path.c_str(), stbi_failure_reason());
+                return false;
+            }
+        }
+
+        if (FirstDecode && isKTX) {
             gli::gl GL(gli::gl::PROFILE_KTX);
-            ktxFormat = GL.translate(gliTex.format(), gliTex.swizzles());
-            glm::tvec3<GLsizei> extent(gliTex.extent(0));
+            ktxFormat = GL.translate(m_ktxStaging.format(), m_ktxStaging.swizzles());
+            glm::tvec3<GLsizei> extent(m_ktxStaging.extent(0));
             imageWidth = extent.x;
             imageHeight = extent.y;
             // imageBPP is bytes per pixel, but extent.z is depth, so better to set manually
             imageBPP = 4; // or appropriate value for KTX texture
-            pImageData = (unsigned char*)gliTex.data();
-        }
-        else {
-            stbi_set_flip_vertically_on_load(1);
-            pImageData = stbi_load(path.c_str(), &imageWidth, &imageHeight, &imageBPP, 0);
-            if (!pImageData) {
-                printf("Can't load texture from '%s' - %s\n", path.c_str(), stbi_failure_reason());
-                return false;
+            numLevels = static_cast<int>(m_ktxStaging.levels());
+            isCompressed = gli::is_compressed(m_ktxStaging.format());
+            m_ktxSizeInBytes = m_ktxStaging.size();
+            m_levelSizes.clear();
+            for (int Level = 0; Level < numLevels; Level++) {
+                m_levelSizes.push_back(m_ktxStaging.size(Level));
             }
+            if (numLevels == 1) {
+                m_ktxSizeInBytes += m_ktxSizeInBytes / 3;
+            }
+        }
+
+        if (FirstDecode) {
+            printf("Loaded texture: %s (Width: %d, Height: %d, BPP: %d)\n", path.c_str(), imageWidth, imageHeight, imageBPP);
         }
 
-        printf("Loaded texture: %s (Width: %d, Height: %d, BPP: %d)\n", path.c_str(), imageWidth, imageHeight, imageBPP);
+        return true;
+    }
+
+    // Uploads the decoded image and releases the staging memory. Render thread only.
+    void Upload() {
+        LoadInternal(m_pStagingData);
+        ReleaseStagingData();
+    }
+
+    // Samples from Level down, among the levels that are on the GPU. No upload.
+    void SetBaseLevel(int Level) {
+        residentBaseLevel = std::min(std::max(Level, uploadedBaseLevel), numLevels - 1);
 
-        LoadInternal(pImageData);
+        GetGLState().BindTextureForEdit(m_textureTarget, m_textureObj);
+        glTexParameteri(m_textureTarget, GL_TEXTURE_BASE_LEVEL, residentBaseLevel);
+        GetGLState().BindTextureForEdit(m_textureTarget, 0);
+    }
 
-        if (!isKTX && pImageData) {
-            stbi_image_free(pImageData);
+    // After Decode(), which may run on another thread: uploads the levels from BaseLevel down
+    // that are not on the GPU yet and samples from BaseLevel. With Reallocate the GL texture is
+    // created again with only those levels, which frees the finer ones. Releases the staging
+    // memory. KTX textures only, render thread only.
+    void UploadLevels(int BaseLevel, bool Reallocate) {
+        assert(isKTX && IsDecoded());
+
+        BaseLevel = std::min(std::max(BaseLevel, 0), numLevels - 1);
+
+        if (Reallocate && m_textureObj != 0) {
+            GetGLState().OnDeleteTexture(m_textureObj);
+            glDeleteTextures(1, &m_textureObj);
+            m_textureObj = 0;
+        }
+
+        if (m_textureObj == 0) {
+            residentBaseLevel = BaseLevel;
+            Upload();
+            return;
+        }
+
+        GetGLState().BindTextureForEdit(m_textureTarget, m_textureObj);
+
+        for (int Level = BaseLevel; Level < uploadedBaseLevel; Level++) {
+            UploadKTXLevel(Level);
+        }
+
+        GetGLState().BindTextureForEdit(m_textureTarget, 0);
+
+        uploadedBaseLevel = std::min(uploadedBaseLevel, BaseLevel);
+        SetBaseLevel(BaseLevel);
+        ReleaseStagingData();
+    }
+
+    // Frees the staging memory without uploading it
+    void ReleaseStagingData() {
+        if (!isKTX && m_pStagingData) {
+            stbi_image_free(m_pStagingData);
         }
 
+        m_ktxStaging = gli::texture();
+        m_pStagingData = nullptr;
+    }
+
+    bool IsDecoded() const { return m_pStagingData != nullptr; }
+    bool IsLoaded() const { return m_textureObj != 0; }
+
+    // Sized format of the GPU copy, for the texture arrays
+    GLenum GetInternalFormat() const {
+        if (isKTX) {
+            return ktxFormat.Internal;
+        }
+
+        return (imageBPP == 4) ? GL_RGBA8 : GL_RGB8;
+    }
+
+    // Bytes in one level of the file, KTX textures only
+    size_t GetLevelSize(int Level) const { return m_levelSizes[Level]; }
+
+    // Decodes the file again and copies its levels, unchanged, into layer Layer of the bound
+    // GL_TEXTURE_2D_ARRAY, which must have this texture's format, size and level count.
+    // Render thread only.
+    bool CopyToArrayLayer(int Layer) {
+        if (!Decode()) {
+            return false;
+        }
+
+        if (isKTX) {
+            for (int Level = 0; Level < numLevels; Level++) {
+                glm::tvec3<GLsizei> Extent(m_ktxStaging.extent(Level));
+                const void* pLevelData = m_ktxStaging.data(0, 0, Level);
+
+                if (isCompressed) {
+                    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, Level, 0, 0, Layer, Extent.x, Extent.y, 1,
+                        ktxFormat.Internal, static_cast<GLsizei>(m_ktxStaging.size(Level)), pLevelData);
+                }
+                else {
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, Level, 0, 0, Layer, Extent.x, Extent.y, 1,
+                        ktxFormat.External, ktxFormat.Type, pLevelData);
+                }
+            }
+        }
+        else {
+            GLenum format = (imageBPP == 4) ? GL_RGBA : GL_RGB;
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, Layer, imageWidth, imageHeight, 1, format, GL_UNSIGNED_BYTE, m_pStagingData);
+        }
+
+        ReleaseStagingData();
+
         return true;
     }
 
 private:
+    unsigned char* m_pStagingData = nullptr;
+    gli::texture m_ktxStaging;
+    size_t m_ktxSizeInBytes = 0;
+    std::vector<size_t> m_levelSizes;
+
+    // Into GL level Level of the bound texture
+    void UploadKTXLevel(int Level) {
+        glm::tvec3<GLsizei> Extent(m_ktxStaging.extent(Level));
+        const void* pLevelData = m_ktxStaging.data(0, 0, Level);
+
+        if (isCompressed) {
+            glCompressedTexImage2D(m_textureTarget, Level, ktxFormat.Internal,
+                Extent.x, Extent.y, 0,
+                static_cast<GLsizei>(m_ktxStaging.size(Level)), pLevelData);
+        }
+        else {
+            glTexImage2D(m_textureTarget, Level,
+                ktxFormat.Internal,   // internal format
+                Extent.x, Extent.y, 0,
+                ktxFormat.External,   // format
+                ktxFormat.Type,       // data type
+                pLevelData);
+        }
+    }
+
     void LoadInternal(unsigned char* pData) {
         // Generate texture object if needed
         if (m_textureObj == 0) {
             glGenTextures(1, &m_textureObj);
             id = m_textureObj; // Keep id and m_textureObj synced
         }
-        glBindTexture(m_textureTarget, m_textureObj);
+        GetGLState().BindTextureForEdit(m_textureTarget, m_textureObj);
 
         if (isKTX) {
-            // Upload KTX texture data
-            glTexImage2D(m_textureTarget, 0,
-                ktxFormat.Internal,   // internal format
-                imageWidth, imageHeight, 0,
-                ktxFormat.External,   // format
-                ktxFormat.Type,       // data type
-                pData);
+            // Upload every level the file provides; cooked textures come with the full chain.
+            // Streamed textures skip the levels above residentBaseLevel, which stay undefined
+            // below the base level.
+            for (int Level = residentBaseLevel; Level < numLevels; Level++) {
+                UploadKTXLevel(Level);
+            }
+
+            uploadedBaseLevel = residentBaseLevel;
+            glTexParameteri(m_textureTarget, GL_TEXTURE_BASE_LEVEL, residentBaseLevel);
+            glTexParameteri(m_textureTarget, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
         }
         else {
             GLint format = (imageBPP == 4) ? GL_RGBA : GL_RGB;
@@ -124,12 +332,21 @@ private:
         // Texture parameters
         glTexParameteri(m_textureTarget, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(m_textureTarget, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(m_textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(m_textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        glGenerateMipmap(m_textureTarget);
+        if (numLevels > 1) {
+            glTexParameteri(m_textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+        else if (isCompressed) {
+            // The driver can't generate mips for block compressed data
+            glTexParameteri(m_textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        }
+        else {
+            glTexParameteri(m_textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glGenerateMipmap(m_textureTarget);
+        }
 
-        glBindTexture(m_textureTarget, 0);
+        GetGLState().BindTextureForEdit(m_textureTarget, 0);
     }
 };
 
@@ -162,23 +379,20 @@ struct Material {
     // PBR material parameters
     PBRMaterial pbr;
 
-    // Optional textures
-    Texture* diffuseMap = nullptr;
-    Texture* normalMap = nullptr;
-    Texture* metallicRoughnessMap = nullptr;
-    Texture* aoMap = nullptr;
-    Texture* emissiveMap = nullptr;
-    Texture* pSpecularExponent = NULL;
+    // Optional textures, shared with every other material that uses the same file
+    std::shared_ptr<Texture> diffuseMap;
+    std::shared_ptr<Texture> normalMap;
+    std::shared_ptr<Texture> metallicRoughnessMap;
+    std::shared_ptr<Texture> aoMap;
+    std::shared_ptr<Texture> emissiveMap;
+    std::shared_ptr<Texture> pSpecularExponent;
 
+    // Layers in the owning mesh's texture arrays, -1 when the texture is bound on its own
+    int diffuseLayer = -1;
+    int specularLayer = -1;
 
-    // Destructor to manage texture cleanup
-    ~Material() {
-        delete diffuseMap;
-        delete normalMap;
-        delete metallicRoughnessMap;
-        delete aoMap;
-        delete emissiveMap;
-    }
+    // Material field of the render queue sort key, see RenderQueue::NewMaterialId()
+    unsigned int renderId = 0;
 };
 
 // Rest of your structs (PBRMaterial, Material) remain unchanged
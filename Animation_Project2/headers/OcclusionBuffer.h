@@ -0,0 +1,123 @@
+#ifndef OCCLUSION_BUFFER_H
+#define OCCLUSION_BUFFER_H
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "..//headers/Bounds.h"
+#include "..//headers/Culling.h"
+
+class JobSystem;
+
+// Triangles of an occluder, in model space. Should be a few dozen triangles that lie inside
+// what is drawn (a wall, a building's box), never a full render mesh.
+struct OccluderMesh {
+    std::vector<glm::vec3> Positions;
+    std::vector<unsigned int> Indices;      // Three per triangle
+};
+
+struct Occluder {
+    std::shared_ptr<const OccluderMesh> pMesh;
+    glm::mat4 World = glm::mat4(1.0f);
+};
+
+// The 12 triangles of a box
+std::shared_ptr<const OccluderMesh> CreateBoxOccluder(const AABB& Box);
+
+
+// Low resolution depth buffer drawn on the CPU, to find what hides behind the occluders.
+//
+// Per frame: Render() draws the occluders' triangles, then IsVisible() / FilterVisible()
+// test bounds against it. Occluders only write the pixels they cover entirely. The screen is
+// split into tiles; the triangles are binned to the tiles they touch and each tile is
+// rasterized by one job, so the tiles need no locking. Each pixel keeps the nearest occluder
+// depth. Once a tile is done its hierarchical Z is built: the farthest depth of every 8x8
+// block. A box is hidden when its nearest point is behind the farthest occluder depth of
+// every block it covers; blocks where that is not clear are settled pixel by pixel.
+//
+// Everything runs on the CPU in a fixed order, so the same frame always culls the same way
+// and no GPU is needed to test it.
+class OcclusionBuffer
+{
+public:
+    static const int WIDTH = 320;
+    static const int HEIGHT = 192;
+    static const int TILE_WIDTH = 64;
+    static const int TILE_HEIGHT = 32;
+    static const int BLOCK_SIZE = 8;        // Pixels per side of a hierarchical Z entry
+
+    struct Stats {
+        unsigned int NumPolygons = 0;       // Last Render(), after near plane rejection and quad merging
+        unsigned int NumTested = 0;         // Since the last Render()
+        unsigned int NumOccluded = 0;       // Since the last Render()
+        double RenderTimeMs = 0.0;          // Last Render()
+        unsigned long long TotalTested = 0;
+        unsigned long long TotalOccluded = 0;
+    };
+
+    OcclusionBuffer();
+
+    OcclusionBuffer(const OcclusionBuffer&) = delete;
+    OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+
+    // Clears the buffer and draws the occluders as seen through ViewProj (GL clip space)
+    void Render(const glm::mat4& ViewProj, const Occluder* pOccluders, unsigned int NumOccluders, JobSystem* pJobs = NULL);
+
+    // False if the world space box is certainly hidden
+    bool IsVisible(const AABB& Box);
+
+    // Keeps the indices of the spheres that may be visible, in order, and returns how many
+    // there are. pIndices are indices into Spheres, e.g. from CullSpheres().
+    unsigned int FilterVisible(const SphereArray& Spheres, unsigned int* pIndices, unsigned int Count, JobSystem* pJobs = NULL);
+
+    // Nearest occluder depth per pixel, 0 at the near plane and 1 at the far plane, row 0 at
+    // the bottom
+    const float* GetDepth() const { return m_Depth.data(); }
+
+    // Grey levels, near is white, for looking at what the occluders cover
+    bool WriteDepthImage(const char* pFilename) const;
+
+    const Stats& GetStats() const { return m_Stats; }
+    void PrintStats() const;
+
+private:
+    static const int TILES_X = WIDTH / TILE_WIDTH;
+    static const int TILES_Y = HEIGHT / TILE_HEIGHT;
+    static const int BLOCKS_X = WIDTH / BLOCK_SIZE;
+    static const int BLOCKS_Y = HEIGHT / BLOCK_SIZE;
+
+    // Screen space convex polygon, counter-clockwise, ready for the edge functions: a triangle,
+    // or the quad of two coplanar triangles that share an edge
+    struct Polygon {
+        glm::vec2 v[4];
+        int NumVerts;
+        float z0;                           // Depth plane: z = z0 + dzdx * x + dzdy * y
+        float dzdx;
+        float dzdy;
+        int MinX, MinY, MaxX, MaxY;         // Pixel bounds, inclusive, clamped to the screen
+    };
+
+    void SetupPolygons(const glm::mat4& ViewProj, const Occluder* pOccluders, unsigned int NumOccluders, JobSystem* pJobs);
+    static bool MergeQuad(Polygon& t, const unsigned int* pIndices, const unsigned int* pNext, const glm::vec4* pClip);
+    void RasterizeTile(unsigned int Tile);
+    void RasterizePolygon(const Polygon& t, int MinX, int MinY, int MaxX, int MaxY);
+    bool IsRectVisible(int MinX, int MinY, int MaxX, int MaxY, float Depth) const;
+    bool TestBox(const AABB& Box) const;
+
+    glm::mat4 m_ViewProj = glm::mat4(1.0f);
+
+    std::vector<float> m_Depth;             // WIDTH * HEIGHT
+    std::vector<float> m_HiZ;               // BLOCKS_X * BLOCKS_Y, farthest depth of each block
+
+    std::vector<Polygon> m_Polygons;                    // One per occluder triangle, the second one of a quad is left invalid
+    std::vector<unsigned char> m_PolygonValid;
+    std::vector<unsigned int> m_FirstPolygon;           // By occluder, into m_Polygons
+    std::vector<unsigned int> m_Bins[TILES_X * TILES_Y];
+
+    std::vector<unsigned char> m_Visible;               // FilterVisible() results, by position in pIndices
+
+    Stats m_Stats;
+};
+
+#endif  /* OCCLUSION_BUFFER_H */
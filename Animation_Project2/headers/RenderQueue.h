@@ -0,0 +1,116 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "..//headers/FrameArena.h"
+
+struct Material;
+class TextureArray;
+class SkinningTechnique;
+
+// Layout fixed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint Count;
+    GLuint InstanceCount;
+    GLuint FirstIndex;
+    GLint BaseVertex;
+    GLuint BaseInstance;    // Used as the draw id, it selects the per-draw vertex attributes
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "Indirect commands are tightly packed");
+
+// Everything needed to issue one indexed draw, or one multi-draw of a whole model. Meshes
+// fill these in and the queue decides the order in which they are submitted.
+struct DrawPacket {
+    SkinningTechnique* pTechnique = NULL;
+    const Material* pMaterial = NULL;
+    const TextureArray* pDiffuseArray = NULL;      // NULL when the mesh has no packed textures
+    const TextureArray* pSpecularArray = NULL;
+    GLuint VAO = 0;
+
+    glm::mat4 World = glm::mat4(1.0f);
+    float Depth = 0.0f;                             // Distance from the camera, used for sorting
+
+    // BonesBlock of the instance, BoneBuffer 0 draws the bind pose
+    GLuint BoneBuffer = 0;
+    GLintptr BoneOffset = 0;
+
+    // Single draw
+    GLsizei NumIndices = 0;
+    unsigned int BaseIndex = 0;
+    GLint BaseVertex = 0;
+
+    // Multi-draw: IndirectBuffer holds DrawCount commands, the material colours come
+    // from MaterialTable and the per-draw parameters from an instanced attribute of the VAO
+    GLuint IndirectBuffer = 0;
+    GLsizei DrawCount = 0;
+    GLuint MaterialTable = 0;
+};
+
+// Collects the draws of a frame, sorts them on a 64-bit key and submits them so that
+// programs, materials and VAOs change as rarely as possible. From the most significant bits:
+//
+//   | program (12) | material (20) | VAO (12) | depth (20) |
+//
+// Opaque draws with the same state are then issued front to back.
+class RenderQueue
+{
+public:
+    struct Stats {
+        unsigned int NumPackets = 0;
+        unsigned int NumDrawCalls = 0;      // A multi-draw packet is a single call
+        unsigned int NumProgramChanges = 0;
+        unsigned int NumMaterialChanges = 0;
+        unsigned int NumVAOChanges = 0;
+    };
+
+    RenderQueue() {};
+
+    // Depths are normalized against MaxDepth (usually the far plane) before being quantized.
+    // With an arena the packets and sort keys of the frame are allocated from it; it must
+    // not be reset before Submit().
+    void BeginFrame(float MaxDepth, FrameArena* pArena = NULL);
+
+    void Add(const DrawPacket& Packet);
+
+    // Sorts the packets and issues them. The queue is empty afterwards.
+    void Submit();
+
+    unsigned int NumPackets() const { return static_cast<unsigned int>(m_Packets.size()); }
+
+    const Stats& GetFrameStats() const { return m_FrameStats; }
+    void PrintStats() const;
+
+    // Small ids for the material field of the key, handed out once per material at load time
+    static unsigned int NewMaterialId();
+
+    static uint64_t MakeSortKey(GLuint Program, unsigned int MaterialId, GLuint VAO, float Depth01);
+
+private:
+    void Sort();
+    void BindMaterial(const DrawPacket& Packet);
+
+    struct SortEntry {
+        uint64_t Key;
+        unsigned int PacketIndex;
+    };
+
+    FrameVector<DrawPacket> m_Packets;
+    FrameVector<SortEntry> m_Keys;
+    FrameVector<SortEntry> m_SortScratch;
+    size_t m_PeakPackets = 0;                   // Reserved up front when using an arena
+
+    float m_MaxDepth = 1.0f;
+
+    Stats m_FrameStats;
+    Stats m_TotalStats;
+    unsigned int m_NumFrames = 0;
+};
+
+#endif  /* RENDER_QUEUE_H */
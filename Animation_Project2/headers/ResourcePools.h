@@ -0,0 +1,94 @@
+#ifndef RESOURCE_POOLS_H
+#define RESOURCE_POOLS_H
+
+#include <glad/glad.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "..//headers/HandlePool.h"
+
+class SkinnedMesh;
+class TextureManager;
+
+struct MeshResource {
+    std::unique_ptr<SkinnedMesh> pMesh;
+    std::string Filename;                       // For ReloadMesh()
+    TextureManager* pTextureManager = NULL;
+};
+
+typedef Handle<MeshResource> MeshHandle;
+
+
+// Owns the engine's GPU assets and hands them out as handles. A handle is looked up when
+// it is drawn, so an asset can be released or reloaded while frame packets still refer to
+// it: the old object is kept until a fence says the GPU has finished the last frame that
+// could have used it, and stale handles simply stop drawing.
+//
+// GL thread only. The simulation copies handles around but never resolves them.
+//
+// Per frame: BeginFrame(), draw, EndFrame().
+class ResourcePools
+{
+public:
+    struct Stats {
+        unsigned int NumLoads = 0;
+        unsigned int NumReloads = 0;
+        unsigned int NumReleases = 0;
+        unsigned int NumDestroyed = 0;          // Released or replaced objects collected so far
+    };
+
+    // Out of line, where SkinnedMesh is complete
+    ResourcePools();
+    ~ResourcePools();
+
+    ResourcePools(const ResourcePools&) = delete;
+    ResourcePools& operator=(const ResourcePools&) = delete;
+
+    // Returns a null handle if the mesh fails to load
+    MeshHandle LoadMesh(const std::string& Filename, TextureManager* pTextureManager);
+
+    // Loads the file again and swaps it in under the same handle. On failure the old
+    // mesh stays.
+    bool ReloadMesh(MeshHandle h);
+    void ReloadAllMeshes();
+
+    bool ReleaseMesh(MeshHandle h);
+
+    // NULL once the handle has been released
+    SkinnedMesh* GetMesh(MeshHandle h) const;
+
+    unsigned int NumMeshes() const { return m_Meshes.Size(); }
+
+    // Destroys what the GPU is done with
+    void BeginFrame();
+
+    // Fences the frame's commands
+    void EndFrame();
+
+    // Releases everything and waits for the GPU to destroy it, before the context and
+    // the TextureManager go away
+    void Clear();
+
+    const Stats& GetStats() const { return m_Stats; }
+    void PrintStats() const;
+
+private:
+    struct FrameFence {
+        GLsync Fence;
+        unsigned long long Frame;
+    };
+
+    void Collect();
+
+    unsigned long long m_CurrentFrame = 1;      // Being recorded, anything released now is retired with it
+    unsigned long long m_CompletedFrame = 0;    // Last frame the GPU is known to have finished
+    std::deque<FrameFence> m_Fences;            // Oldest first
+
+    HandlePool<MeshResource> m_Meshes;
+
+    Stats m_Stats;
+};
+
+#endif  /* RESOURCE_POOLS_H */
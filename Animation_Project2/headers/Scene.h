@@ -1 +1,106 @@
-#pragma once
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+class JobSystem;
+
+// Transform hierarchy of the scene. Each field of the nodes is its own array (structure of
+// arrays), and the arrays are sorted by depth: the roots first, then their children, and so
+// on. A parent therefore always comes before its children, and all the nodes of one depth
+// can be updated at the same time once the depth above is done.
+//
+// Setting a local transform marks the node dirty. Update() only recomputes the dirty nodes
+// and whatever lies below them, and skips the depths that have nothing to do.
+//
+// Nodes are referred to by a NodeId that stays the same when the arrays are reordered.
+// Creating and destroying nodes reorders the arrays lazily, at the next Update().
+class Scene
+{
+public:
+    typedef unsigned int NodeId;
+    static const NodeId INVALID_NODE = 0xFFFFFFFF;
+
+    struct Stats {
+        unsigned int NumNodes = 0;
+        unsigned int NumUpdated = 0;            // In the last Update()
+        unsigned int NumLevelsSkipped = 0;      // In the last Update()
+        double UpdateTimeMs = 0.0;              // Last Update(), sort included
+        unsigned long long NumSorts = 0;
+    };
+
+    Scene() {};
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    NodeId CreateNode(NodeId Parent = INVALID_NODE);
+
+    // Destroys the node and everything below it
+    void DestroyNode(NodeId Node);
+
+    bool IsAlive(NodeId Node) const;
+
+    void SetPosition(NodeId Node, const glm::vec3& Position);
+    void SetRotation(NodeId Node, const glm::quat& Rotation);
+    void SetScale(NodeId Node, const glm::vec3& Scale);
+    void SetLocal(NodeId Node, const glm::vec3& Position, const glm::quat& Rotation, const glm::vec3& Scale);
+
+    const glm::vec3& GetPosition(NodeId Node) const { return m_Positions[m_IdToIndex[Node]]; }
+    const glm::quat& GetRotation(NodeId Node) const { return m_Rotations[m_IdToIndex[Node]]; }
+    const glm::vec3& GetScale(NodeId Node) const { return m_Scales[m_IdToIndex[Node]]; }
+    NodeId GetParent(NodeId Node) const;
+
+    // As of the last Update()
+    const glm::mat4& GetWorld(NodeId Node) const { return m_World[m_IdToIndex[Node]]; }
+
+    // Recomputes the world matrices of the dirty subtrees. With a job system the nodes of
+    // each depth are split across its threads; NULL updates on the calling thread.
+    void Update(JobSystem* pJobs = NULL);
+
+    unsigned int NumNodes() const { return (unsigned int)m_Positions.size() - m_NumDestroyed; }
+
+    const Stats& GetStats() const { return m_Stats; }
+    void PrintStats() const;
+
+private:
+    enum NODE_FLAGS {
+        NODE_DIRTY = 1 << 0,        // Local transform set since the last Update()
+        NODE_CHANGED = 1 << 1,      // World matrix recomputed by the last Update()
+        NODE_DESTROYED = 1 << 2
+    };
+
+    struct Level {
+        unsigned int Begin = 0;
+        unsigned int End = 0;
+        unsigned int NumDirty = 0;
+        bool HasChanged = false;    // Some NODE_CHANGED flags are set
+    };
+
+    void MarkDirty(unsigned int Index);
+    void Sort();
+    void UpdateRange(unsigned int Begin, unsigned int End);
+
+    // Node data, indexed by position in depth order
+    std::vector<glm::vec3> m_Positions;
+    std::vector<glm::quat> m_Rotations;
+    std::vector<glm::vec3> m_Scales;
+    std::vector<glm::mat4> m_World;
+    std::vector<unsigned int> m_Parents;    // Index of the parent, INVALID_NODE for roots
+    std::vector<unsigned int> m_Depths;
+    std::vector<unsigned char> m_Flags;     // NODE_FLAGS
+    std::vector<NodeId> m_IndexToId;
+
+    std::vector<unsigned int> m_IdToIndex;  // INVALID_NODE for free ids
+    std::vector<NodeId> m_FreeIds;
+
+    std::vector<Level> m_Levels;            // Ranges of the arrays, by depth
+    bool m_NeedsSort = false;               // Nodes were created or destroyed
+    unsigned int m_NumDestroyed = 0;        // Still in the arrays until the next sort
+
+    Stats m_Stats;
+};
+
+#endif  /* SCENE_H */
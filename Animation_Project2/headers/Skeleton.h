@@ -0,0 +1,86 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "..//headers/Bounds.h"
+#include "..//headers/UniformBlocks.h"
+
+// Joint of the node hierarchy of a model. Not every joint is a bone: only the ones that
+// vertices are weighted to get a slot in the bone palette.
+struct SkeletonJoint {
+    std::string Name;
+    int Parent = -1;                        // Always a lower index, -1 for the root
+    int Bone = -1;                          // Palette slot, -1 if no vertex uses the joint
+    glm::mat4 BindLocal = glm::mat4(1.0f);  // Relative to the parent, when no clip moves it
+};
+
+struct Skeleton {
+    std::vector<SkeletonJoint> Joints;      // Parents first
+    std::vector<glm::mat4> BoneOffsets;     // Model space to bone space, by palette slot
+    std::vector<unsigned int> BoneJoints;   // Joint of each palette slot
+    glm::mat4 GlobalInverse = glm::mat4(1.0f);
+
+    // Sphere around the vertices each bone moves, in bind pose model space: center in xyz,
+    // radius in w, negative for bones that move no vertex
+    std::vector<glm::vec4> BoneSpheres;
+    AABB BindBounds;                        // Model space, every vertex
+
+    unsigned int NumJoints() const { return (unsigned int)Joints.size(); }
+
+    // Palette slots filled by ComputePalette(), at most BONES_BLOCK_MAX_BONES
+    unsigned int NumBones() const;
+
+    int FindJoint(const std::string& Name) const;
+};
+
+template<typename T>
+struct Keyframe {
+    float Time;                             // Seconds
+    T Value;
+};
+
+// Keys of one joint. A joint with no keys at all keeps its bind pose.
+struct JointTrack {
+    std::vector<Keyframe<glm::vec3> > Positions;
+    std::vector<Keyframe<glm::quat> > Rotations;
+    std::vector<Keyframe<glm::vec3> > Scales;
+
+    bool IsEmpty() const { return Positions.empty() && Rotations.empty() && Scales.empty(); }
+};
+
+struct AnimationClip {
+    std::string Name;
+    float Duration = 0.0f;                  // Seconds
+    std::vector<JointTrack> Tracks;         // By joint
+    AABB Bounds;                            // Model space, around every pose of the clip
+};
+
+// What every instance of a model shares: the skeleton and its clips. Never changed once
+// loaded, so the simulation can read it on any thread while the mesh stays on the GL side.
+struct SkeletonAsset {
+    Skeleton Skel;
+    std::vector<AnimationClip> Clips;
+};
+
+// Local transform of every joint at Time, clamped to the clip. A NULL clip gives the bind pose.
+void SampleClip(const Skeleton& Skel, const AnimationClip* pClip, float Time, glm::mat4* pLocalPose);
+
+// Skinning matrices of the pose, Skel.NumBones() of them. pGlobalPose is scratch space for
+// Skel.NumJoints() matrices.
+void ComputePalette(const Skeleton& Skel, const glm::mat4* pLocalPose, glm::mat4* pGlobalPose, glm::mat4* pPalette);
+
+// Model space box of the posed mesh, from the bone spheres moved by the palette. Loose, but
+// it never misses a vertex as long as the bones do not scale.
+AABB ComputePoseBounds(const Skeleton& Skel, const glm::mat4* pPalette);
+
+// Union of the pose bounds at SampleRate poses per second over the whole clip, computed at
+// load time. Characters use it instead of their current pose, so their bounds only move with
+// their world transform and the ones nobody looks at need no pose at all.
+AABB ComputeClipBounds(const Skeleton& Skel, const AnimationClip& Clip, float SampleRate);
+
+#endif  /* SKELETON_H */
@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <cassert>
@@ -15,25 +16,50 @@
 #include <assimp/scene.h>           // Output data structure
 #include <assimp/postprocess.h>     // Post processing flags
 #include "Material.h"
+#include "TextureManager.h"
+#include "TextureArray.h"
+#include "RenderQueue.h"
+#include "Skeleton.h"
 
 #define ARRAY_SIZE_IN_ELEMENTS(a) (sizeof(a)/sizeof(a[0]))
 
+// Shared asset: GPU buffers, materials, skeleton and clips of one model file. Nothing in
+// here belongs to one character; every instance brings its own world transform and bone
+// palette when it is drawn, so any number of characters can share one SkinnedMesh.
 class SkinnedMesh
 {
 public:
-    SkinnedMesh() {};
+    SkinnedMesh(TextureManager* pTextureManager) : m_pTextureManager(pTextureManager) {};
+    ~SkinnedMesh() { Clear(); }
+
+    SkinnedMesh(const SkinnedMesh&) = delete;
+    SkinnedMesh& operator=(const SkinnedMesh&) = delete;
 
     bool LoadMesh(const std::string& Filename);
-    void Render();
+
+    // Emits one draw packet per sub-mesh. CameraPos is in world space. BoneBuffer and
+    // BoneOffset locate the instance's BonesBlock, 0 draws the bind pose.
+    void AddToRenderQueue(RenderQueue& Queue, SkinningTechnique* pTechnique, const glm::mat4& World, const glm::vec3& CameraPos,
+                          GLuint BoneBuffer = 0, GLintptr BoneOffset = 0);
 
     unsigned int NumBones() const
     {
         return static_cast<unsigned int>(m_BoneNameToIndexMap.size());
     }
 
-    // You need to define your own transform & material types or integrate here
-    // For now, just placeholders:
-     glm::mat4& GetWorldTransform();
+    // Object space bounding sphere of all the vertices
+    const glm::vec3& GetBoundsCenter() const { return m_BoundsCenter; }
+    float GetBoundsRadius() const { return m_BoundsRadius; }
+
+    // Tells the streamer how large this mesh's textures appear from CameraLocalPos
+    void RequestTextureMips(TextureStreamer& Streamer, const glm::vec3& CameraLocalPos);
+
+    // Skeleton and clips, shared with the instances. Never NULL once loaded.
+    std::shared_ptr<const SkeletonAsset> GetSkeletonAsset() const { return m_pSkeleton; }
+
+    // Bind pose triangles of all the sub-meshes, in object space, three indices each
+    void GetTriangles(std::vector<glm::vec3>& Positions, std::vector<unsigned int>& Indices) const;
+
      const Material& GetMaterial();
 
 private:
@@ -47,12 +73,17 @@ private:
     void ReserveSpace(unsigned int NumVertices, unsigned int NumIndices);
     void InitAllMeshes(const aiScene* pScene);
     void InitSingleMesh(unsigned int MeshIndex, const aiMesh* paiMesh);
+    void CalcBounds();
     bool InitMaterials(const aiScene* pScene, const std::string& Filename);
     void PopulateBuffers();
+    bool CanUseMultiDraw() const;
+    void PopulateMultiDrawBuffers();
     void LoadTextures(const std::string& Dir, const aiMaterial* pMaterial, int index);
     void LoadDiffuseTexture(const std::string& Dir, const aiMaterial* pMaterial, int index);
     void LoadSpecularTexture(const std::string& Dir, const aiMaterial* pMaterial, int index);
     void LoadColors(const aiMaterial* pMaterial, int index);
+    void PackTextures();
+    void PackTextureChannel(std::shared_ptr<Texture> Material::* pChannel, int Material::* pLayer, TextureArray& Array);
 
     // Texture loading functions omitted, implement as needed or integrate with your own texture loader
 
@@ -76,6 +107,9 @@ private:
         }
     };
 
+    void LoadSkeleton(const aiScene* pScene);
+    void CalcBoneSpheres(Skeleton& Skel) const;
+    void LoadClips(const aiScene* pScene, SkeletonAsset& Asset);
     void LoadMeshBones(unsigned int MeshIndex, const aiMesh* paiMesh);
     void LoadSingleBone(unsigned int MeshIndex, const aiBone* pBone);
     int GetBoneId(const aiBone* pBone);
@@ -88,20 +122,23 @@ private:
         TEXCOORD_VB = 2,
         NORMAL_VB = 3,
         BONE_VB = 4,
-        NUM_BUFFERS = 5
+        INDIRECT_BUFFER = 5,    // One DrawElementsIndirectCommand per sub-mesh
+        DRAW_PARAMS_VB = 6,     // Per-draw texture layers and material index
+        MATERIAL_TABLE_UB = 7,  // MaterialTableBlock
+        NUM_BUFFERS = 8
     };
 
-    // Replace or implement your own transform type
-    glm::mat4 m_worldTransform;
     GLuint m_VAO = 0;
     GLuint m_Buffers[NUM_BUFFERS] = { 0 };
+    bool m_UseMultiDraw = false;    // All the sub-meshes go out with one glMultiDrawElementsIndirect
 
     struct BasicMeshEntry {
         BasicMeshEntry()
             : NumIndices(0),
             BaseVertex(0),
             BaseIndex(0),
-            MaterialIndex(INVALID_MATERIAL)
+            MaterialIndex(INVALID_MATERIAL),
+            UVDensity(0.0f)
         {
         }
 
@@ -109,11 +146,17 @@ private:
         unsigned int BaseVertex;
         unsigned int BaseIndex;
         unsigned int MaterialIndex;
+        float UVDensity;    // Texture coordinate units per object space unit
     };
 
+    TextureManager* m_pTextureManager = NULL;
+
     std::vector<BasicMeshEntry> m_Meshes;
     std::vector<Material> m_Materials;
 
+    TextureArray m_DiffuseArray;
+    TextureArray m_SpecularArray;
+
     // Temporary space for vertex data before loading into GPU
     std::vector<glm::vec3> m_Positions;
     std::vector<glm::vec3> m_Normals;
@@ -122,6 +165,12 @@ private:
     std::vector<VertexBoneData> m_Bones;
 
     std::map<std::string, unsigned int> m_BoneNameToIndexMap;
+    std::vector<glm::mat4> m_BoneOffsets;   // By bone id
+
+    std::shared_ptr<const SkeletonAsset> m_pSkeleton;
+
+    glm::vec3 m_BoundsCenter = glm::vec3(0.0f);
+    float m_BoundsRadius = 0.0f;
 };
 
 #endif  /* SKINNED_MESH_H */
@@ -2,12 +2,20 @@
 #define SKINNING_TECHNIQUE_H
 
 #include "technique.h"
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "..//headers/Material.h"
+#include "..//headers/UniformBlocks.h"
 
 typedef unsigned int uint;
 
+// Texture units the skinning shader samples from
+#define COLOR_TEXTURE_UNIT_INDEX            0
+#define SPECULAR_EXPONENT_UNIT_INDEX        8
+#define COLOR_ARRAY_UNIT_INDEX              1
+#define SPECULAR_EXPONENT_ARRAY_UNIT_INDEX  9
+
 class BaseLight {
 public:
     glm::vec3 Color = glm::vec3(1.0f);
@@ -54,72 +62,88 @@ public:
     }
 };
 
+// Lights, material and camera live in std140 uniform blocks (see UniformBlocks.h).
+// The Set*() functions only fill the CPU copies; each block is sent with one buffer update,
+// and only when its contents differ from what the GPU already has.
 class SkinningTechnique : public Technique {
 public:
-    static const unsigned int MAX_POINT_LIGHTS = 2;
-    static const unsigned int MAX_SPOT_LIGHTS = 2;
+    static const unsigned int MAX_POINT_LIGHTS = LIGHTS_BLOCK_MAX_POINT_LIGHTS;
+    static const unsigned int MAX_SPOT_LIGHTS = LIGHTS_BLOCK_MAX_SPOT_LIGHTS;
+
+    // Integer attribute with the per-draw parameters: diffuse layer, specular exponent layer
+    // and material table index (-1 to use the Material block). It is a constant for single
+    // draws and an instanced array selected by the base instance for multi-draws.
+    static constexpr GLuint DRAW_PARAMS_LOCATION = 5;
 
     SkinningTechnique();
+    ~SkinningTechnique();
     virtual bool Init();
 
-    void SetWVP(const glm::mat4& WVP);
+    void SetWorldMatrix(const glm::mat4& World);
     void SetTextureUnit(unsigned int TextureUnit);
     void SetSpecularExponentTextureUnit(unsigned int TextureUnit);
+    void SetTextureArrayUnits(unsigned int DiffuseTextureUnit, unsigned int SpecularExponentTextureUnit);
+    void SetDisplayBoneIndex(uint DisplayBoneIndex);
+
+    // World space lights, sent by CommitLights()
     void SetDirectionalLight(const DirectionalLight& Light);
     void SetPointLights(unsigned int NumLights, const PointLight* pLights);
     void SetSpotLights(unsigned int NumLights, const SpotLight* pLights);
-    void SetCameraLocalPos(const glm::vec3& CameraLocalPos);
+    void CommitLights();
+
+    // Both upload their block right away if it changed
     void SetMaterial(const Material& material);
-    void SetDisplayBoneIndex(uint DisplayBoneIndex);
+    void SetCamera(const glm::mat4& ViewProj, const glm::vec3& CameraWorldPos);
+
+    // Points the Bones block at a BonesBlock in Buffer, or at identity matrices if Buffer is 0
+    void SetBonePalette(GLuint Buffer, GLintptr Offset);
+
+    // Uploads issued, and uploads skipped because the data was unchanged
+    void GetUploadStats(unsigned int& NumUploads, unsigned int& NumSkipped) const;
+    void PrintStats() const;
 
 private:
-    GLuint WVPLoc;
+    GLuint CreateUniformBuffer(UNIFORM_BLOCK_BINDING Binding, size_t Size);
+    void UploadUniformBuffer(GLuint Buffer, const void* pData, size_t Size);
+
+    template<typename T> bool UpdateBlock(T& Block, const T& NewData, bool& IsValid)
+    {
+        if (IsValid && memcmp(&Block, &NewData, sizeof(T)) == 0) {
+            m_NumSkippedUploads++;
+            return false;
+        }
+
+        Block = NewData;
+        IsValid = true;
+        return true;
+    }
+
+    GLuint WorldLoc;
     GLuint samplerLoc;
     GLuint samplerSpecularExponentLoc;
-    GLuint CameraLocalPosLoc;
-    GLuint NumPointLightsLocation;
-    GLuint NumSpotLightsLocation;
-
-    struct {
-        GLuint AmbientColor;
-        GLuint DiffuseColor;
-        GLuint SpecularColor;
-    } materialLoc;
-
-    struct {
-        GLuint Color;
-        GLuint AmbientIntensity;
-        GLuint Direction;
-        GLuint DiffuseIntensity;
-    } dirLightLoc;
-
-    struct {
-        GLuint Color;
-        GLuint AmbientIntensity;
-        GLuint Position;
-        GLuint DiffuseIntensity;
-        struct {
-            GLuint Constant;
-            GLuint Linear;
-            GLuint Exp;
-        } Atten;
-    } PointLightsLocation[MAX_POINT_LIGHTS];
-
-    struct {
-        GLuint Color;
-        GLuint AmbientIntensity;
-        GLuint DiffuseIntensity;
-        GLuint Position;
-        GLuint Direction;
-        GLuint Cutoff;
-        struct {
-            GLuint Constant;
-            GLuint Linear;
-            GLuint Exp;
-        } Atten;
-    } SpotLightsLocation[MAX_SPOT_LIGHTS];
-
+    GLuint samplerArrayLoc;
+    GLuint samplerSpecularExponentArrayLoc;
     GLuint displayBoneIndexLocation;
+
+    GLuint m_LightsUBO = 0;
+    GLuint m_MaterialUBO = 0;
+    GLuint m_CameraUBO = 0;
+    GLuint m_DefaultMaterialTableUBO = 0;
+    GLuint m_IdentityBonesUBO = 0;
+
+    LightsBlock m_Lights;          // Staged by the Set*Light*() calls
+    LightsBlock m_UploadedLights;  // What the GPU has
+    MaterialBlock m_Material;
+    CameraBlock m_Camera;
+    glm::mat4 m_World = glm::mat4(1.0f);
+
+    bool m_LightsValid = false;
+    bool m_MaterialValid = false;
+    bool m_CameraValid = false;
+    bool m_WorldValid = false;
+
+    unsigned int m_NumUploads = 0;
+    unsigned int m_NumSkippedUploads = 0;
 };
 
 #endif  // SKINNING_TECHNIQUE_H
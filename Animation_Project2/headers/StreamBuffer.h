@@ -0,0 +1,88 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// Ring buffer for data that is rewritten every frame (bone palettes, instance data,
+// per-frame uniform blocks). It is split into one region per frame in flight; the CPU
+// writes into the current region while the GPU reads the older ones, and a fence per region
+// tells when it can be reused.
+//
+// With GL 4.4 / ARB_buffer_storage the buffer is mapped once, persistently and coherently,
+// and Allocate() hands out pointers straight into it. Otherwise allocations go to a CPU
+// staging copy which Flush() uploads with glBufferSubData after orphaning the buffer.
+//
+// Per frame: BeginFrame(), Allocate()..., Flush(), draw, EndFrame().
+class StreamBuffer
+{
+public:
+    struct Allocation {
+        void* pData = NULL;         // Write the data here before Flush()
+        GLuint Buffer = 0;
+        GLintptr Offset = 0;        // For glBindBufferRange / attribute pointers
+        GLsizeiptr Size = 0;
+    };
+
+    struct Stats {
+        unsigned long long NumAllocations = 0;
+        unsigned long long BytesAllocated = 0;
+        unsigned int NumOverflows = 0;      // Allocations that did not fit in a frame region
+        unsigned int NumFenceWaits = 0;     // Region reuses that found the fence not yet signaled
+        double FenceWaitTimeMs = 0.0;
+    };
+
+    StreamBuffer() {};
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // FrameSize is the most that can be allocated in one frame. Target is only used to
+    // bind the buffer while creating and updating it.
+    bool Init(GLenum Target, GLsizeiptr FrameSize, unsigned int NumFrames = 3);
+
+    // Waits until the GPU is done with the region this frame is about to overwrite
+    void BeginFrame();
+
+    // Returns false if the frame region is full. Alignment 0 uses the default for the target
+    // (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform buffers).
+    bool Allocate(GLsizeiptr Size, Allocation& Alloc, GLsizeiptr Alignment = 0);
+
+    // Makes everything allocated so far visible to the GPU. A no-op when persistently mapped.
+    void Flush();
+
+    // Fences the region used by this frame
+    void EndFrame();
+
+    bool IsPersistent() const { return m_pMapped != NULL; }
+    GLuint GetBuffer() const { return m_Buffer; }
+    GLsizeiptr GetFrameSize() const { return m_FrameSize; }
+    GLsizeiptr GetDefaultAlignment() const { return m_DefaultAlignment; }
+
+    const Stats& GetStats() const { return m_Stats; }
+    void PrintStats(const char* pName) const;
+
+private:
+    void Clear();
+
+    GLenum m_Target = GL_ARRAY_BUFFER;
+    GLuint m_Buffer = 0;
+    GLsizeiptr m_FrameSize = 0;
+    GLsizeiptr m_DefaultAlignment = 16;
+
+    unsigned int m_NumFrames = 0;
+    unsigned int m_CurFrame = 0;
+    std::vector<GLsync> m_Fences;
+
+    unsigned char* m_pMapped = NULL;            // Whole buffer, persistent path
+    std::vector<unsigned char> m_Staging;       // One region, fallback path
+
+    GLsizeiptr m_Head = 0;                      // Next free byte in the current region
+    GLsizeiptr m_FlushedHead = 0;               // Fallback: bytes already uploaded
+
+    Stats m_Stats;
+};
+
+#endif  /* STREAM_BUFFER_H */
@@ -0,0 +1,45 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <vector>
+#include <cstddef>
+#include <glad/glad.h>
+
+struct Texture;
+
+// Packs a set of 2D textures into the layers of one GL_TEXTURE_2D_ARRAY so that every
+// sub-mesh using them can be drawn with a single bind. The layers keep the format and the
+// levels of their source, block compressed ones included, so only textures that share the
+// format, the size and the level count go in the same array.
+class TextureArray
+{
+public:
+    TextureArray() {};
+    ~TextureArray();
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    // Layer i receives the levels of Textures[i], decoded again from its file.
+    // Returns false if the array could not be created.
+    bool Build(const std::vector<Texture*>& Textures);
+
+    // True if a and b can be layers of the same array
+    static bool CanShareArray(const Texture& a, const Texture& b);
+
+    void Bind(GLenum TextureUnit) const;
+
+    unsigned int NumLayers() const { return m_numLayers; }
+    size_t GetSizeInBytes() const;
+
+private:
+    void Clear();
+
+    GLuint m_textureObj = 0;
+    int m_width = 0;
+    int m_height = 0;
+    unsigned int m_numLayers = 0;
+    size_t m_sizeInBytes = 0;
+};
+
+#endif  /* TEXTURE_ARRAY_H */
@@ -0,0 +1,25 @@
+#ifndef TEXTURE_COOKER_H
+#define TEXTURE_COOKER_H
+
+#include <string>
+
+// Block compressed formats the cooker can write
+enum TEXTURE_COOK_FORMAT {
+    COOK_FORMAT_AUTO = 0,   // BC1 for opaque images, BC3 when there is an alpha channel
+    COOK_FORMAT_BC1 = 1,    // RGB, 4 bits per texel
+    COOK_FORMAT_BC3 = 2,    // RGBA, 8 bits per texel
+    COOK_FORMAT_BC5 = 3,    // Two channels (RG), for normal maps
+    COOK_FORMAT_BC7 = 4     // RGBA, 8 bits per texel, higher quality than BC3
+};
+
+// Converts a JPG/PNG source into a KTX file holding a block compressed, fully mipmapped
+// image. The runtime picks up "<name>.ktx" instead of "<name>.jpg" when it exists next to it.
+bool CookTexture(const std::string& SrcPath, const std::string& DstPath, TEXTURE_COOK_FORMAT Format = COOK_FORMAT_AUTO);
+
+// Returns the path of the cooked version of a source texture
+std::string GetCookedTexturePath(const std::string& SrcPath);
+
+// Parses "bc1", "bc3", "bc5", "bc7" or "auto". Returns false for anything else.
+bool ParseCookFormat(const char* pName, TEXTURE_COOK_FORMAT& Format);
+
+#endif  /* TEXTURE_COOKER_H */
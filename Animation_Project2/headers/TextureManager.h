@@ -0,0 +1,83 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <glad/glad.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Material.h"
+#include "JobSystem.h"
+#include "TextureStreamer.h"
+
+// Owns every texture loaded by the meshes. Textures are keyed by their normalized path
+// and load parameters so that materials pointing at the same file share one GL object.
+class TextureManager
+{
+public:
+    TextureManager() {};
+    ~TextureManager();
+
+    // Returns the cached texture or loads it on first use. Returns nullptr on failure.
+    std::shared_ptr<Texture> Load(const std::string& Path, GLenum TextureTarget = GL_TEXTURE_2D);
+
+    // Like Load() but defers the work to the next FlushPendingLoads() so that a whole
+    // model's textures are decoded concurrently. The texture is not usable before that.
+    std::shared_ptr<Texture> Request(const std::string& Path, GLenum TextureTarget = GL_TEXTURE_2D);
+
+    // Decodes all requested textures on the decode pool, then uploads them on the calling
+    // thread. Textures that fail are dropped from the cache. Returns the number of failures.
+    unsigned int FlushPendingLoads();
+
+    // Drops textures that nobody outside the cache references, least recently used first,
+    // until the resident size fits in BudgetBytes (0 drops every unused texture)
+    void EvictUnused(size_t BudgetBytes = 0);
+
+    // Textures with a cooked mip chain are handed to the streamer instead of being fully uploaded
+    void SetStreamer(TextureStreamer* pStreamer) { m_pStreamer = pStreamer; }
+
+    // Load "<name>.ktx" from the texture cooker instead of the source image when it exists
+    void SetPreferCooked(bool PreferCooked) { m_PreferCooked = PreferCooked; }
+
+    // 0 means unlimited. Checked after every load.
+    void SetMemoryBudget(size_t BudgetBytes) { m_MemoryBudget = BudgetBytes; }
+
+    // Sum of the resident sizes. Streamed textures change size as levels come and go.
+    size_t GetMemoryUsage() const;
+    unsigned int NumTextures() const { return static_cast<unsigned int>(m_Textures.size()); }
+
+    void PrintStats() const;
+
+    static std::string NormalizePath(const std::string& Path);
+
+private:
+    struct TextureEntry {
+        std::shared_ptr<Texture> pTexture;
+        unsigned long long LastUse = 0;
+    };
+
+    static std::string MakeKey(const std::string& NormalizedPath, GLenum TextureTarget);
+
+    std::string ResolvePath(const std::string& Path) const;
+
+    std::map<std::string, TextureEntry> m_Textures;
+    std::vector<std::string> m_PendingLoads;
+
+    TextureStreamer* m_pStreamer = NULL;
+
+    bool m_PreferCooked = true;
+
+    size_t m_MemoryBudget = 0;
+    unsigned long long m_UseCounter = 0;
+
+    unsigned int m_NumHits = 0;
+    unsigned int m_NumMisses = 0;
+    unsigned int m_NumEvictions = 0;
+
+    double m_DecodeTimeMs = 0.0;
+    double m_UploadTimeMs = 0.0;
+};
+
+#endif  /* TEXTURE_MANAGER_H */
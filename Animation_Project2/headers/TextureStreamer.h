@@ -0,0 +1,112 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+
+class FrameArena;
+
+struct Texture;
+
+// Keeps only the mip levels that are actually visible on the GPU. Textures start with
+// their small tail levels resident; each frame the meshes report how large their textures
+// appear on screen and Update() uploads finer levels or drops them to stay in the budget.
+//
+// Dropping a level only moves the texture's base level, so it costs nothing and the level
+// can come back for free. Finer levels are read from the file by a job and uploaded on a
+// later Update(). Dropped levels stay allocated until the memory is over budget, then the
+// textures furthest away are trimmed the same way.
+class TextureStreamer
+{
+public:
+    TextureStreamer() {};
+
+    // Waits for the files being read
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Takes over the upload of a decoded texture that has a full mip chain. Only the tail
+    // is uploaded and the decoded data is released; finer levels are read from the file
+    // again when they are needed.
+    void Register(const std::shared_ptr<Texture>& pTexture);
+
+    // Call once per frame before the Request() calls
+    void BeginFrame(const glm::vec3& CameraPos, float FOVDegrees, float ViewportHeight);
+
+    // UVDensity is in texture coordinate units per world unit (see SkinnedMesh) and
+    // Distance is the distance from the camera to the closest point using the texture
+    void Request(Texture* pTexture, float UVDensity, float Distance);
+
+    // Applies the requests of the frame under the memory budget. Scratch lists come from
+    // the arena when one is given.
+    void Update(FrameArena* pArena = NULL);
+
+    // 0 means unlimited
+    void SetMemoryBudget(size_t BudgetBytes) { m_MemoryBudget = BudgetBytes; }
+
+    // Levels whose larger side fits in TailSize texels are always resident
+    void SetTailSize(int TailSize) { m_TailSize = TailSize; }
+
+    // Limits the number of files read for finer levels or trims started in one frame
+    void SetMaxUploadsPerFrame(unsigned int MaxUploads) { m_MaxUploadsPerFrame = MaxUploads; }
+
+    // Frames a texture keeps its levels after the last request, so that a mesh that flickers
+    // in and out of view does not drop and reload them
+    void SetGracePeriod(unsigned int NumFrames) { m_GracePeriod = NumFrames; }
+
+    const glm::vec3& GetCameraPos() const { return m_CameraPos; }
+
+    size_t GetMemoryUsage() const;
+    void PrintStats() const;
+
+private:
+    struct StreamedTexture {
+        std::weak_ptr<Texture> pTexture;
+        Texture* pRaw = NULL;           // Valid while pTexture has not expired
+        int TailLevel = 0;              // Coarsest level that is always resident
+        int WantedLevel = 0;            // Finest level requested this frame
+        int TargetLevel = 0;            // WantedLevel after the budget has been applied
+        float MinDistance = 0.0f;       // Of this frame's requests, used for priority
+        bool Requested = false;
+        bool Loading = false;           // A file read is in flight
+        unsigned long long LastRequestFrame = 0;
+    };
+
+    // A file read on the job system. The texture is kept alive until the upload.
+    struct PendingLoad {
+        std::shared_ptr<Texture> pTexture;
+        int BaseLevel = 0;
+        bool Trim = false;              // Recreate the texture without the finer levels
+        bool Decoded = false;
+        JobCounter Counter;
+    };
+
+    static void DecodeJob(void* pData, unsigned int Begin, unsigned int End);
+
+    void StartLoad(StreamedTexture& Entry, int BaseLevel, bool Trim);
+    void FinishLoads();
+
+    std::vector<StreamedTexture> m_Textures;
+    std::vector<std::unique_ptr<PendingLoad>> m_PendingLoads;
+    unsigned long long m_Frame = 0;
+
+    glm::vec3 m_CameraPos = glm::vec3(0.0f);
+    float m_PixelsPerUnitAtUnitDistance = 1.0f;
+
+    size_t m_MemoryBudget = 0;
+    int m_TailSize = 64;
+    unsigned int m_MaxUploadsPerFrame = 2;
+    unsigned int m_GracePeriod = 30;
+
+    unsigned int m_NumUploads = 0;
+    unsigned int m_NumDrops = 0;
+    unsigned int m_NumTrims = 0;
+};
+
+#endif  /* TEXTURE_STREAMER_H */
@@ -0,0 +1,102 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// C++ mirrors of the std140 uniform blocks in shaders/skinning.vs and shaders/skinning.fs.
+// Every vec3 is followed by a scalar so that nothing needs implicit padding; the asserts
+// below catch any change that breaks the std140 offsets.
+
+#define LIGHTS_BLOCK_MAX_POINT_LIGHTS 2
+#define LIGHTS_BLOCK_MAX_SPOT_LIGHTS 2
+#define MATERIAL_TABLE_SIZE 64
+#define BONES_BLOCK_MAX_BONES 128
+
+enum UNIFORM_BLOCK_BINDING {
+    LIGHTS_BLOCK_BINDING = 0,
+    MATERIAL_BLOCK_BINDING = 1,
+    CAMERA_BLOCK_BINDING = 2,
+    MATERIAL_TABLE_BLOCK_BINDING = 3,
+    BONES_BLOCK_BINDING = 4
+};
+
+struct DirectionalLightStd140 {
+    glm::vec3 Color = glm::vec3(0.0f);
+    float AmbientIntensity = 0.0f;
+    glm::vec3 Direction = glm::vec3(0.0f);
+    float DiffuseIntensity = 0.0f;
+};
+
+struct PointLightStd140 {
+    glm::vec3 Color = glm::vec3(0.0f);
+    float AmbientIntensity = 0.0f;
+    glm::vec3 Position = glm::vec3(0.0f);
+    float DiffuseIntensity = 0.0f;
+    glm::vec3 Atten = glm::vec3(1.0f, 0.0f, 0.0f);  // Constant, Linear, Exp
+    float Padding = 0.0f;
+};
+
+struct SpotLightStd140 {
+    PointLightStd140 Base;
+    glm::vec3 Direction = glm::vec3(0.0f);
+    float Cutoff = 0.0f;                            // Cosine of the cutoff angle
+};
+
+struct LightsBlock {
+    DirectionalLightStd140 DirectionalLight;
+    PointLightStd140 PointLights[LIGHTS_BLOCK_MAX_POINT_LIGHTS];
+    SpotLightStd140 SpotLights[LIGHTS_BLOCK_MAX_SPOT_LIGHTS];
+    int NumPointLights = 0;
+    int NumSpotLights = 0;
+    int Padding[2] = { 0, 0 };
+};
+
+struct MaterialBlock {
+    glm::vec4 AmbientColor = glm::vec4(0.0f);
+    glm::vec4 DiffuseColor = glm::vec4(0.0f);
+    glm::vec4 SpecularColor = glm::vec4(0.0f);
+};
+
+// Colours of every material of a model, indexed by the draw parameters of a multi-draw
+struct MaterialTableBlock {
+    MaterialBlock Materials[MATERIAL_TABLE_SIZE];
+};
+
+// Skinning matrices of one instance. Each skinned draw binds its own range of the frame's
+// stream buffer.
+struct BonesBlock {
+    glm::mat4 Bones[BONES_BLOCK_MAX_BONES];
+};
+
+struct CameraBlock {
+    glm::mat4 ViewProj = glm::mat4(1.0f);
+    glm::vec3 CameraWorldPos = glm::vec3(0.0f);
+    float Padding = 0.0f;
+};
+
+static_assert(sizeof(DirectionalLightStd140) == 32, "std140 layout of DirectionalLight");
+static_assert(offsetof(DirectionalLightStd140, Direction) == 16, "std140 layout of DirectionalLight");
+
+static_assert(sizeof(PointLightStd140) == 48, "std140 layout of PointLight");
+static_assert(offsetof(PointLightStd140, Position) == 16, "std140 layout of PointLight");
+static_assert(offsetof(PointLightStd140, Atten) == 32, "std140 layout of PointLight");
+
+static_assert(sizeof(SpotLightStd140) == 64, "std140 layout of SpotLight");
+static_assert(offsetof(SpotLightStd140, Direction) == 48, "std140 layout of SpotLight");
+
+static_assert(offsetof(LightsBlock, PointLights) == 32, "std140 layout of Lights");
+static_assert(offsetof(LightsBlock, SpotLights) == 128, "std140 layout of Lights");
+static_assert(offsetof(LightsBlock, NumPointLights) == 256, "std140 layout of Lights");
+static_assert(offsetof(LightsBlock, NumSpotLights) == 260, "std140 layout of Lights");
+
+static_assert(sizeof(MaterialBlock) == 48, "std140 layout of Material");
+
+static_assert(sizeof(MaterialTableBlock) == 48 * MATERIAL_TABLE_SIZE, "std140 layout of MaterialTable");
+
+static_assert(sizeof(BonesBlock) == 64 * BONES_BLOCK_MAX_BONES, "std140 layout of Bones");
+
+static_assert(sizeof(CameraBlock) == 80, "std140 layout of Camera");
+static_assert(offsetof(CameraBlock, CameraWorldPos) == 64, "std140 layout of Camera");
+
+#endif  /* UNIFORM_BLOCKS_H */
@@ -3,6 +3,7 @@
 #define TECHNIQUE_H
 
 #include <list>
+#include <cstddef>
 #include <glad/glad.h>
 
 class Technique
@@ -25,8 +26,16 @@ protected:
 
     bool Finalize();
 
+    // Checks the program against the current state, so call it once the sampler units
+    // are assigned - samplers of different types all start on unit 0, which is invalid
+    bool Validate();
+
     GLint GetUniformLocation(const char* pUniformName);
 
+    // Attaches a uniform block to a binding point and checks that the shader's layout
+    // fits in the HostSize bytes the C++ side uploads
+    bool BindUniformBlock(const char* pBlockName, GLuint BindingPoint, size_t HostSize);
+
     GLuint m_shaderProg = 0;
 
 private:
@@ -2,72 +2,116 @@
 
 const int MAX_POINT_LIGHTS = 2;
 const int MAX_SPOT_LIGHTS = 2;
+const int MATERIAL_TABLE_SIZE = 64;
 
 in vec2 TexCoord0;
 in vec3 Normal0;
-in vec3 LocalPos0;
+in vec3 WorldPos0;
 flat in ivec4 BoneIDs0;
 in vec4 Weights0;
+flat in ivec4 DrawParams0;  // x: diffuse layer, y: specular exponent layer, -1 for the 2D samplers
+                            // z: material table index, -1 for the Material block
 
 out vec4 FragColor;
 
-struct BaseLight
+// Layouts mirror headers/UniformBlocks.h
+struct DirectionalLight
 {
     vec3 Color;
     float AmbientIntensity;
+    vec3 Direction;
     float DiffuseIntensity;
 };
 
-struct DirectionalLight
+struct PointLight
+{
+    vec3 Color;
+    float AmbientIntensity;
+    vec3 Position;
+    float DiffuseIntensity;
+    vec3 Atten;         // x: constant, y: linear, z: exp
+};
+
+struct SpotLight
 {
-    BaseLight Base;
+    PointLight Base;
     vec3 Direction;
+    float Cutoff;       // Cosine of the cutoff angle
 };
 
-struct Attenuation
+layout (std140) uniform Lights
 {
-    float Constant;
-    float Linear;
-    float Exp;
+    DirectionalLight gDirectionalLight;
+    PointLight gPointLights[MAX_POINT_LIGHTS];
+    SpotLight gSpotLights[MAX_SPOT_LIGHTS];
+    int gNumPointLights;
+    int gNumSpotLights;
 };
 
-struct PointLight
+struct MaterialColors
 {
-    BaseLight Base;
-    vec3 LocalPos;
-    Attenuation Atten;
+    vec4 AmbientColor;
+    vec4 DiffuseColor;
+    vec4 SpecularColor;
 };
 
-struct SpotLight
+layout (std140) uniform Material
 {
-    PointLight Base;
-    vec3 Direction;
-    float Cutoff;
+    MaterialColors gMaterial;
 };
 
-struct Material
+// All the materials of a model drawn with a single multi-draw
+layout (std140) uniform MaterialTable
 {
-    vec3 AmbientColor;
-    vec3 DiffuseColor;
-    vec3 SpecularColor;
+    MaterialColors gMaterials[MATERIAL_TABLE_SIZE];
+};
+
+layout (std140) uniform Camera
+{
+    mat4 gViewProj;
+    vec3 gCameraWorldPos;
 };
 
-uniform DirectionalLight gDirectionalLight;
-uniform int gNumPointLights;
-uniform PointLight gPointLights[MAX_POINT_LIGHTS];
-uniform int gNumSpotLights;
-uniform SpotLight gSpotLights[MAX_SPOT_LIGHTS];
-uniform Material gMaterial;
 uniform sampler2D gSampler;
 uniform sampler2D gSamplerSpecularExponent;
-uniform vec3 gCameraLocalPos;
+uniform sampler2DArray gSamplerArray;
+uniform sampler2DArray gSamplerSpecularExponentArray;
 uniform int gDisplayBoneIndex;
 
-vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal)
+vec4 SampleDiffuse()
 {
-    vec4 AmbientColor = vec4(Light.Color, 1.0f) *
-                        Light.AmbientIntensity *
-                        vec4(gMaterial.AmbientColor, 1.0f);
+    if (DrawParams0.x >= 0) {
+        return texture(gSamplerArray, vec3(TexCoord0, DrawParams0.x));
+    }
+
+    return texture(gSampler, TexCoord0);
+}
+
+float SampleSpecularExponent()
+{
+    if (DrawParams0.y >= 0) {
+        return texture(gSamplerSpecularExponentArray, vec3(TexCoord0, DrawParams0.y)).r;
+    }
+
+    return texture(gSamplerSpecularExponent, TexCoord0).r;
+}
+
+MaterialColors GetMaterial()
+{
+    if (DrawParams0.z >= 0) {
+        return gMaterials[DrawParams0.z];
+    }
+
+    return gMaterial;
+}
+
+vec4 CalcLightInternal(vec3 Color, float AmbientIntensity, float DiffuseIntensity, vec3 LightDirection, vec3 Normal)
+{
+    MaterialColors Colors = GetMaterial();
+
+    vec4 AmbientColor = vec4(Color, 1.0f) *
+                        AmbientIntensity *
+                        vec4(Colors.AmbientColor.rgb, 1.0f);
 
     float DiffuseFactor = dot(Normal, -LightDirection);
 
@@ -75,20 +119,20 @@ vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal)
     vec4 SpecularColor = vec4(0, 0, 0, 0);
 
     if (DiffuseFactor > 0) {
-        DiffuseColor = vec4(Light.Color, 1.0f) *
-                       Light.DiffuseIntensity *
-                       vec4(gMaterial.DiffuseColor, 1.0f) *
+        DiffuseColor = vec4(Color, 1.0f) *
+                       DiffuseIntensity *
+                       vec4(Colors.DiffuseColor.rgb, 1.0f) *
                        DiffuseFactor;
 
-        vec3 PixelToCamera = normalize(gCameraLocalPos - LocalPos0);
+        vec3 PixelToCamera = normalize(gCameraWorldPos - WorldPos0);
         vec3 LightReflect = normalize(reflect(LightDirection, Normal));
         float SpecularFactor = dot(PixelToCamera, LightReflect);
         if (SpecularFactor > 0) {
-            float SpecularExponent = texture(gSamplerSpecularExponent, TexCoord0).r * 255.0;
+            float SpecularExponent = SampleSpecularExponent() * 255.0;
             SpecularFactor = pow(SpecularFactor, SpecularExponent);
-            SpecularColor = vec4(Light.Color, 1.0f) *
-                            Light.DiffuseIntensity * // using the diffuse intensity for diffuse/specular
-                            vec4(gMaterial.SpecularColor, 1.0f) *
+            SpecularColor = vec4(Color, 1.0f) *
+                            DiffuseIntensity * // using the diffuse intensity for diffuse/specular
+                            vec4(Colors.SpecularColor.rgb, 1.0f) *
                             SpecularFactor;
         }
     }
@@ -99,26 +143,30 @@ vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal)
 
 vec4 CalcDirectionalLight(vec3 Normal)
 {
-    return CalcLightInternal(gDirectionalLight.Base, gDirectionalLight.Direction, Normal);
+    return CalcLightInternal(gDirectionalLight.Color,
+                             gDirectionalLight.AmbientIntensity,
+                             gDirectionalLight.DiffuseIntensity,
+                             gDirectionalLight.Direction,
+                             Normal);
 }
 
 vec4 CalcPointLight(PointLight l, vec3 Normal)
 {
-    vec3 LightDirection = LocalPos0 - l.LocalPos;
+    vec3 LightDirection = WorldPos0 - l.Position;
     float Distance = length(LightDirection);
     LightDirection = normalize(LightDirection);
 
-    vec4 Color = CalcLightInternal(l.Base, LightDirection, Normal);
-    float Attenuation =  l.Atten.Constant +
-                         l.Atten.Linear * Distance +
-                         l.Atten.Exp * Distance * Distance;
+    vec4 Color = CalcLightInternal(l.Color, l.AmbientIntensity, l.DiffuseIntensity, LightDirection, Normal);
+    float Attenuation =  l.Atten.x +
+                         l.Atten.y * Distance +
+                         l.Atten.z * Distance * Distance;
 
     return Color / Attenuation;
 }
 
 vec4 CalcSpotLight(SpotLight l, vec3 Normal)
 {
-    vec3 LightToPixel = normalize(LocalPos0 - l.Base.LocalPos);
+    vec3 LightToPixel = normalize(WorldPos0 - l.Base.Position);
     float SpotFactor = dot(LightToPixel, l.Direction);
 
     if (SpotFactor > l.Cutoff) {
@@ -162,6 +210,6 @@ void main()
     }
 
     if (!found ) {
-         FragColor = texture(gSampler, TexCoord0.xy) * TotalLight * vec4(0.0001) + vec4(0.0, 0.0, 1.0, 0.0);
+         FragColor = SampleDiffuse() * TotalLight * vec4(0.0001) + vec4(0.0, 0.0, 1.0, 0.0);
     }
 }
\ No newline at end of file
@@ -1,25 +1,56 @@
 #version 330
 
+const int MAX_BONES = 128;
+
 layout (location = 0) in vec3 Position;
 layout (location = 1) in vec2 TexCoord;
 layout (location = 2) in vec3 Normal;
 layout (location = 3) in ivec4 BoneIDs;
 layout (location = 4) in vec4 Weights;
+layout (location = 5) in ivec4 DrawParams;
 
 out vec2 TexCoord0;
 out vec3 Normal0;
-out vec3 LocalPos0;
+out vec3 WorldPos0;
 flat out ivec4 BoneIDs0;
 out vec4 Weights0;
+flat out ivec4 DrawParams0;
+
+uniform mat4 gWorld;
+
+layout (std140) uniform Camera
+{
+    mat4 gViewProj;
+    vec3 gCameraWorldPos;
+};
 
-uniform mat4 gWVP;
+// Palette of the instance being drawn, identity matrices for meshes drawn in bind pose.
+// Layout mirrors headers/UniformBlocks.h
+layout (std140) uniform Bones
+{
+    mat4 gBones[MAX_BONES];
+};
 
 void main()
 {
-    gl_Position = gWVP * vec4(Position, 1.0);
+    // Vertices with no weights at all belong to meshes without bones
+    mat4 BoneTransform = mat4(1.0);
+
+    if (Weights.x + Weights.y + Weights.z + Weights.w > 0.0) {
+        ivec4 IDs = min(BoneIDs, ivec4(MAX_BONES - 1));
+
+        BoneTransform = gBones[IDs.x] * Weights.x +
+                        gBones[IDs.y] * Weights.y +
+                        gBones[IDs.z] * Weights.z +
+                        gBones[IDs.w] * Weights.w;
+    }
+
+    vec4 WorldPos = gWorld * (BoneTransform * vec4(Position, 1.0));
+    gl_Position = gViewProj * WorldPos;
     TexCoord0 = TexCoord;
-    Normal0 = Normal;
-    LocalPos0 = Position;
+    Normal0 = mat3(gWorld) * mat3(BoneTransform) * Normal;
+    WorldPos0 = WorldPos.xyz;
     BoneIDs0 = BoneIDs;
     Weights0 = Weights;
+    DrawParams0 = DrawParams;
 }
\ No newline at end of file
@@ -0,0 +1,600 @@
+#include "..//headers/BVH.h"
+#include "..//headers/JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+// Rebuild once the SAH cost is this much worse than after the last build
+#define BVH_REBUILD_RATIO       1.5f
+// Not worth rebuilding below this many proxies, refitting keeps up
+#define BVH_MIN_REBUILD_PROXIES 64
+#define BVH_SAH_BINS            16
+#define BVH_RAY_MIN_BATCH       64
+
+const BVH::ProxyId BVH::INVALID_PROXY;
+const unsigned int BVH::MAX_BATCH_FRUSTUMS;
+const unsigned int BVH::INVALID_NODE;
+
+
+unsigned int BVH::AllocateNode()
+{
+    if (m_FreeList == INVALID_NODE) {
+        m_Nodes.push_back(Node());
+        return (unsigned int)m_Nodes.size() - 1;
+    }
+
+    unsigned int Index = m_FreeList;
+    m_FreeList = m_Nodes[Index].Parent;
+    m_Nodes[Index] = Node();
+
+    return Index;
+}
+
+
+void BVH::FreeNode(unsigned int Index)
+{
+    m_Nodes[Index].IsFree = true;
+    m_Nodes[Index].Parent = m_FreeList;
+    m_FreeList = Index;
+}
+
+
+BVH::ProxyId BVH::Insert(const AABB& Bounds, unsigned int UserData)
+{
+    unsigned int Leaf = AllocateNode();
+    m_Nodes[Leaf].Bounds = Bounds;
+    m_Nodes[Leaf].UserData = UserData;
+
+    InsertLeaf(Leaf);
+
+    m_NumProxies++;
+    m_Stats.NumInserts++;
+
+    return Leaf;
+}
+
+
+void BVH::Remove(ProxyId Proxy)
+{
+    RemoveLeaf(Proxy);
+    FreeNode(Proxy);
+
+    m_NumProxies--;
+    m_Stats.NumRemoves++;
+}
+
+
+void BVH::Update(ProxyId Proxy, const AABB& Bounds)
+{
+    m_Nodes[Proxy].Bounds = Bounds;
+    m_NeedsRefit = true;
+}
+
+
+void BVH::Clear()
+{
+    m_Nodes.clear();
+    m_Order.clear();
+    m_Root = INVALID_NODE;
+    m_FreeList = INVALID_NODE;
+    m_NumProxies = 0;
+    m_NeedsRefit = false;
+}
+
+
+// Walks down towards the child whose box grows the least, and stops where pairing with the
+// current node is cheaper than going down to either child
+unsigned int BVH::FindBestSibling(const AABB& Bounds) const
+{
+    unsigned int Index = m_Root;
+
+    while (!m_Nodes[Index].IsLeaf()) {
+        const Node& n = m_Nodes[Index];
+
+        float Area = n.Bounds.GetHalfArea();
+        float CombinedArea = Merge(n.Bounds, Bounds).GetHalfArea();
+
+        // A new parent here, and what every node above pays for growing
+        float Cost = CombinedArea;
+        float InheritedCost = CombinedArea - Area;
+
+        float ChildCost[2];
+
+        for (int c = 0; c < 2; c++) {
+            const Node& Child = m_Nodes[n.Child[c]];
+            float Combined = Merge(Child.Bounds, Bounds).GetHalfArea();
+
+            ChildCost[c] = Child.IsLeaf() ? Combined + InheritedCost
+                                          : (Combined - Child.Bounds.GetHalfArea()) + InheritedCost;
+        }
+
+        if (Cost < ChildCost[0] && Cost < ChildCost[1]) {
+            break;
+        }
+
+        Index = (ChildCost[0] <= ChildCost[1]) ? n.Child[0] : n.Child[1];
+    }
+
+    return Index;
+}
+
+
+void BVH::InsertLeaf(unsigned int Leaf)
+{
+    if (m_Root == INVALID_NODE) {
+        m_Root = Leaf;
+        m_Nodes[Leaf].Parent = INVALID_NODE;
+        return;
+    }
+
+    unsigned int Sibling = FindBestSibling(m_Nodes[Leaf].Bounds);
+    unsigned int OldParent = m_Nodes[Sibling].Parent;
+    unsigned int NewParent = AllocateNode();
+
+    m_Nodes[NewParent].Parent = OldParent;
+    m_Nodes[NewParent].Child[0] = Sibling;
+    m_Nodes[NewParent].Child[1] = Leaf;
+    m_Nodes[NewParent].Bounds = Merge(m_Nodes[Sibling].Bounds, m_Nodes[Leaf].Bounds);
+
+    m_Nodes[Sibling].Parent = NewParent;
+    m_Nodes[Leaf].Parent = NewParent;
+
+    if (OldParent == INVALID_NODE) {
+        m_Root = NewParent;
+    }
+    else {
+        Node& p = m_Nodes[OldParent];
+        p.Child[p.Child[0] == Sibling ? 0 : 1] = NewParent;
+        RefitAncestors(OldParent);
+    }
+}
+
+
+void BVH::RemoveLeaf(unsigned int Leaf)
+{
+    if (Leaf == m_Root) {
+        m_Root = INVALID_NODE;
+        return;
+    }
+
+    // The sibling takes the parent's place
+    unsigned int Parent = m_Nodes[Leaf].Parent;
+    unsigned int GrandParent = m_Nodes[Parent].Parent;
+    unsigned int Sibling = m_Nodes[Parent].Child[m_Nodes[Parent].Child[0] == Leaf ? 1 : 0];
+
+    m_Nodes[Sibling].Parent = GrandParent;
+
+    if (GrandParent == INVALID_NODE) {
+        m_Root = Sibling;
+    }
+    else {
+        Node& g = m_Nodes[GrandParent];
+        g.Child[g.Child[0] == Parent ? 0 : 1] = Sibling;
+        RefitAncestors(GrandParent);
+    }
+
+    FreeNode(Parent);
+    m_Nodes[Leaf].Parent = INVALID_NODE;
+}
+
+
+void BVH::RefitAncestors(unsigned int Index)
+{
+    while (Index != INVALID_NODE) {
+        Node& n = m_Nodes[Index];
+        n.Bounds = Merge(m_Nodes[n.Child[0]].Bounds, m_Nodes[n.Child[1]].Bounds);
+        Index = n.Parent;
+    }
+}
+
+
+void BVH::Refit()
+{
+    if (!m_NeedsRefit || m_Root == INVALID_NODE) {
+        return;
+    }
+
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+    // Parents before children, so walking the list backwards visits children first
+    m_Order.clear();
+    m_Order.push_back(m_Root);
+
+    for (unsigned int i = 0; i < m_Order.size(); i++) {
+        const Node& n = m_Nodes[m_Order[i]];
+
+        if (!n.IsLeaf()) {
+            m_Order.push_back(n.Child[0]);
+            m_Order.push_back(n.Child[1]);
+        }
+    }
+
+    // The cost comes along for free: the root is the last one done
+    float Sum = 0.0f;
+
+    for (unsigned int i = (unsigned int)m_Order.size(); i-- > 0;) {
+        Node& n = m_Nodes[m_Order[i]];
+
+        if (!n.IsLeaf()) {
+            n.Bounds = Merge(m_Nodes[n.Child[0]].Bounds, m_Nodes[n.Child[1]].Bounds);
+            Sum += n.Bounds.GetHalfArea();
+        }
+    }
+
+    float RootArea = m_Nodes[m_Root].Bounds.GetHalfArea();
+
+    m_NeedsRefit = false;
+    m_Stats.NumRefits++;
+    m_Stats.Cost = (RootArea > 0.0f && !m_Nodes[m_Root].IsLeaf()) ? Sum / RootArea : 0.0f;
+
+    if (m_NumProxies >= BVH_MIN_REBUILD_PROXIES && m_Stats.Cost > m_Stats.BuildCost * BVH_REBUILD_RATIO) {
+        Rebuild();
+    }
+
+    m_Stats.RefitTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+}
+
+
+float BVH::ComputeCost() const
+{
+    if (m_Root == INVALID_NODE || m_Nodes[m_Root].IsLeaf()) {
+        return 0.0f;
+    }
+
+    float RootArea = m_Nodes[m_Root].Bounds.GetHalfArea();
+
+    if (RootArea <= 0.0f) {
+        return 0.0f;
+    }
+
+    float Sum = 0.0f;
+
+    for (unsigned int i = 0; i < m_Nodes.size(); i++) {
+        if (!m_Nodes[i].IsFree && !m_Nodes[i].IsLeaf()) {
+            Sum += m_Nodes[i].Bounds.GetHalfArea();
+        }
+    }
+
+    return Sum / RootArea;
+}
+
+
+void BVH::Rebuild()
+{
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+    // Keep the leaves where they are, so that the proxy ids stay; drop everything else
+    std::vector<unsigned int> Leaves;
+    Leaves.reserve(m_NumProxies);
+    m_FreeList = INVALID_NODE;
+
+    for (unsigned int i = (unsigned int)m_Nodes.size(); i-- > 0;) {
+        if (!m_Nodes[i].IsFree && m_Nodes[i].IsLeaf()) {
+            Leaves.push_back(i);
+        }
+        else {
+            FreeNode(i);
+        }
+    }
+
+    m_Root = INVALID_NODE;
+
+    struct Task {
+        unsigned int Begin;
+        unsigned int End;
+        unsigned int Parent;
+        int Slot;
+    };
+
+    std::vector<Task> Tasks;
+
+    if (!Leaves.empty()) {
+        Task Root = { 0, (unsigned int)Leaves.size(), INVALID_NODE, 0 };
+        Tasks.push_back(Root);
+    }
+
+    while (!Tasks.empty()) {
+        Task t = Tasks.back();
+        Tasks.pop_back();
+
+        unsigned int Index;
+
+        if (t.End - t.Begin == 1) {
+            Index = Leaves[t.Begin];
+        }
+        else {
+            AABB Bounds;
+            AABB Centroids;
+
+            for (unsigned int i = t.Begin; i < t.End; i++) {
+                const AABB& b = m_Nodes[Leaves[i]].Bounds;
+                Bounds.Merge(b);
+                Centroids.Merge(b.GetCenter());
+            }
+
+            // Binned SAH over all three axes: the split with the smallest
+            // Area(left) * Count(left) + Area(right) * Count(right)
+            int BestAxis = -1;
+            int BestSplit = 0;
+            float BestCost = FLT_MAX;
+            glm::vec3 Extent = Centroids.GetExtent();
+
+            for (int Axis = 0; Axis < 3; Axis++) {
+                if (Extent[Axis] <= 0.0f) {
+                    continue;
+                }
+
+                AABB BinBounds[BVH_SAH_BINS];
+                unsigned int BinCounts[BVH_SAH_BINS] = { 0 };
+                float Scale = BVH_SAH_BINS / Extent[Axis];
+
+                for (unsigned int i = t.Begin; i < t.End; i++) {
+                    const AABB& b = m_Nodes[Leaves[i]].Bounds;
+                    int Bin = std::min((int)((b.GetCenter()[Axis] - Centroids.Min[Axis]) * Scale), BVH_SAH_BINS - 1);
+                    BinBounds[Bin].Merge(b);
+                    BinCounts[Bin]++;
+                }
+
+                // Sweep from the right, then from the left
+                float RightArea[BVH_SAH_BINS];
+                unsigned int RightCount[BVH_SAH_BINS];
+                AABB Right;
+                unsigned int Count = 0;
+
+                for (int b = BVH_SAH_BINS - 1; b > 0; b--) {
+                    Right.Merge(BinBounds[b]);
+                    Count += BinCounts[b];
+                    RightArea[b] = Right.IsEmpty() ? 0.0f : Right.GetHalfArea();
+                    RightCount[b] = Count;
+                }
+
+                AABB Left;
+                Count = 0;
+
+                for (int b = 0; b < BVH_SAH_BINS - 1; b++) {
+                    Left.Merge(BinBounds[b]);
+                    Count += BinCounts[b];
+
+                    if (Count == 0 || RightCount[b + 1] == 0) {
+                        continue;
+                    }
+
+                    float Cost = Left.GetHalfArea() * Count + RightArea[b + 1] * RightCount[b + 1];
+
+                    if (Cost < BestCost) {
+                        BestCost = Cost;
+                        BestAxis = Axis;
+                        BestSplit = b + 1;
+                    }
+                }
+            }
+
+            unsigned int Middle;
+
+            if (BestAxis >= 0) {
+                float Scale = BVH_SAH_BINS / Extent[BestAxis];
+                float Min = Centroids.Min[BestAxis];
+                const std::vector<Node>& Nodes = m_Nodes;
+
+                unsigned int* pMiddle = std::partition(Leaves.data() + t.Begin, Leaves.data() + t.End, [&Nodes, BestAxis, BestSplit, Scale, Min](unsigned int Leaf) {
+                    int Bin = std::min((int)((Nodes[Leaf].Bounds.GetCenter()[BestAxis] - Min) * Scale), BVH_SAH_BINS - 1);
+                    return Bin < BestSplit;
+                });
+
+                Middle = (unsigned int)(pMiddle - Leaves.data());
+            }
+            else {
+                // All the centroids in one spot, any split is as good
+                Middle = (t.Begin + t.End) / 2;
+            }
+
+            Index = AllocateNode();
+            m_Nodes[Index].Bounds = Bounds;
+
+            Task Children[2] = { { t.Begin, Middle, Index, 0 }, { Middle, t.End, Index, 1 } };
+            Tasks.push_back(Children[0]);
+            Tasks.push_back(Children[1]);
+        }
+
+        m_Nodes[Index].Parent = t.Parent;
+
+        if (t.Parent == INVALID_NODE) {
+            m_Root = Index;
+        }
+        else {
+            m_Nodes[t.Parent].Child[t.Slot] = Index;
+        }
+    }
+
+    m_NeedsRefit = false;
+    m_Stats.NumRebuilds++;
+    m_Stats.BuildCost = ComputeCost();
+    m_Stats.Cost = m_Stats.BuildCost;
+    m_Stats.RebuildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+}
+
+
+void BVH::QueryFrustum(const Frustum& f, std::vector<unsigned int>& Result) const
+{
+    QueryFrustums(&f, 1, &Result);
+}
+
+
+void BVH::QueryFrustums(const Frustum* pFrustums, unsigned int Count, std::vector<unsigned int>* pResults) const
+{
+    if (m_Root == INVALID_NODE || Count == 0) {
+        return;
+    }
+
+    Count = std::min(Count, MAX_BATCH_FRUSTUMS);
+
+    // Active: frustums that may still see the subtree. Inside: frustums that see all of it,
+    // which stop testing and take every leaf below.
+    struct Entry {
+        unsigned int Node;
+        unsigned int Active;
+        unsigned int Inside;
+    };
+
+    std::vector<Entry> Stack;
+    Entry Root = { m_Root, (Count == 32) ? 0xFFFFFFFFu : ((1u << Count) - 1), 0 };
+    Stack.push_back(Root);
+
+    while (!Stack.empty()) {
+        Entry e = Stack.back();
+        Stack.pop_back();
+
+        const Node& n = m_Nodes[e.Node];
+
+        for (unsigned int i = 0; i < Count; i++) {
+            unsigned int Bit = 1u << i;
+
+            if (!(e.Active & Bit) || (e.Inside & Bit)) {
+                continue;
+            }
+
+            Frustum::RESULT r = pFrustums[i].Test(n.Bounds);
+
+            if (r == Frustum::OUTSIDE) {
+                e.Active &= ~Bit;
+            }
+            else if (r == Frustum::INSIDE) {
+                e.Inside |= Bit;
+            }
+        }
+
+        if (!e.Active) {
+            continue;
+        }
+
+        if (n.IsLeaf()) {
+            for (unsigned int i = 0; i < Count; i++) {
+                if (e.Active & (1u << i)) {
+                    pResults[i].push_back(n.UserData);
+                }
+            }
+        }
+        else {
+            Entry Children[2] = { { n.Child[0], e.Active, e.Inside }, { n.Child[1], e.Active, e.Inside } };
+            Stack.push_back(Children[0]);
+            Stack.push_back(Children[1]);
+        }
+    }
+}
+
+
+void BVH::QueryAABB(const AABB& Box, std::vector<unsigned int>& Result) const
+{
+    if (m_Root == INVALID_NODE) {
+        return;
+    }
+
+    std::vector<unsigned int> Stack;
+    Stack.push_back(m_Root);
+
+    while (!Stack.empty()) {
+        const Node& n = m_Nodes[Stack.back()];
+        Stack.pop_back();
+
+        if (!n.Bounds.Overlaps(Box)) {
+            continue;
+        }
+
+        if (n.IsLeaf()) {
+            Result.push_back(n.UserData);
+        }
+        else {
+            Stack.push_back(n.Child[0]);
+            Stack.push_back(n.Child[1]);
+        }
+    }
+}
+
+
+bool BVH::RayCast(const Ray& r, RayHit& Hit) const
+{
+    Hit = RayHit();
+
+    if (m_Root == INVALID_NODE) {
+        return false;
+    }
+
+    glm::vec3 InvDirection = r.GetInvDirection();
+
+    if (r.Intersect(m_Nodes[m_Root].Bounds, InvDirection) < 0.0f) {
+        return false;
+    }
+
+    // Nodes with their entry distance; the nearer child is visited first so that the
+    // best hit shrinks early and prunes the farther one
+    struct Entry {
+        unsigned int Node;
+        float Distance;
+    };
+
+    std::vector<Entry> Stack;
+    Entry Root = { m_Root, 0.0f };
+    Stack.push_back(Root);
+
+    while (!Stack.empty()) {
+        Entry e = Stack.back();
+        Stack.pop_back();
+
+        if (e.Distance >= Hit.Distance) {
+            continue;
+        }
+
+        const Node& n = m_Nodes[e.Node];
+
+        if (n.IsLeaf()) {
+            Hit.Proxy = e.Node;
+            Hit.UserData = n.UserData;
+            Hit.Distance = e.Distance;
+            continue;
+        }
+
+        Entry Children[2];
+
+        for (int c = 0; c < 2; c++) {
+            Children[c].Node = n.Child[c];
+            Children[c].Distance = r.Intersect(m_Nodes[n.Child[c]].Bounds, InvDirection);
+        }
+
+        if (Children[0].Distance > Children[1].Distance) {
+            std::swap(Children[0], Children[1]);
+        }
+
+        for (int c = 1; c >= 0; c--) {
+            if (Children[c].Distance >= 0.0f && Children[c].Distance < Hit.Distance) {
+                Stack.push_back(Children[c]);
+            }
+        }
+    }
+
+    return Hit.Proxy != INVALID_PROXY;
+}
+
+
+void BVH::RayCastBatch(const Ray* pRays, unsigned int Count, RayHit* pHits, JobSystem* pJobs) const
+{
+    auto CastBatch = [this, pRays, pHits](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            RayCast(pRays[i], pHits[i]);
+        }
+    };
+
+    if (pJobs) {
+        pJobs->ParallelFor(Count, BVH_RAY_MIN_BATCH, CastBatch);
+    }
+    else if (Count > 0) {
+        CastBatch(0, Count);
+    }
+}
+
+
+void BVH::PrintStats(const char* pName) const
+{
+    printf("BVH %s: %u proxies, %u nodes, cost %.1f (%.1f after build), %llu refits (last %.3f ms), %llu rebuilds (last %.3f ms)\n",
+        pName, m_NumProxies, (unsigned int)m_Nodes.size(), m_Stats.Cost, m_Stats.BuildCost,
+        m_Stats.NumRefits, m_Stats.RefitTimeMs, m_Stats.NumRebuilds, m_Stats.RebuildTimeMs);
+}
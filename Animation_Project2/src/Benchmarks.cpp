@@ -0,0 +1,921 @@
+#include <glad/glad.h>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#include "..//headers/Benchmarks.h"
+#include "..//headers/Engine.h"
+#include "..//headers/GLCapabilities.h"
+#include "..//headers/GLRecorder.h"
+#include "..//headers/JobSystem.h"
+#include "..//headers/Scene.h"
+#include "..//headers/Character.h"
+#include "..//headers/BVH.h"
+#include "..//headers/Culling.h"
+#include "..//headers/OcclusionBuffer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <vector>
+
+
+static void PrintFrameStats(const char* pLabel, const GLRecorder::FrameStats& Stats, double Scale)
+{
+    printf("%-10s %10.1f %10.1f %10.1f %10.1f %10.1f %14.1f\n", pLabel,
+        Stats.NumCalls[GLRecorder::CALL_DRAW] * Scale,
+        Stats.NumSubDraws * Scale,
+        Stats.NumCalls[GLRecorder::CALL_STATE] * Scale,
+        Stats.NumCalls[GLRecorder::CALL_UNIFORM] * Scale,
+        Stats.NumCalls[GLRecorder::CALL_UPLOAD] * Scale,
+        Stats.UploadedBytes * Scale);
+}
+
+
+// GPU-less submission benchmark: Animation_Project2 --headless-bench <frames> [gl version] [log file]
+// Runs Engine::Init() and the frames against the recording GL backend and reports what
+// each frame would have sent to the driver. The version (e.g. 3.3) selects the fallback paths.
+static int HeadlessBenchMain(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " --headless-bench <frames> [gl version] [log file]\n";
+        return -1;
+    }
+
+    int NumFrames = atoi(argv[2]);
+    int MajorVersion = 4, MinorVersion = 5;
+
+    if (argc > 3 && sscanf(argv[3], "%d.%d", &MajorVersion, &MinorVersion) != 2) {
+        std::cerr << "Invalid GL version '" << argv[3] << "'\n";
+        return -1;
+    }
+
+    GLRecorder Recorder;
+    Recorder.SetLogging(argc > 4);
+
+    if (!Recorder.Install(MajorVersion, MinorVersion) || !InitGLCapabilities()) {
+        return -1;
+    }
+
+    Engine* engine = new Engine();
+
+    if (!engine->Init()) {
+        std::cerr << "Engine initialization failed.\n";
+        return -1;
+    }
+
+    Recorder.EndFrame();
+
+    for (int i = 0; i < NumFrames; i++) {
+        engine->RenderSceneCB();
+        Recorder.EndFrame();
+    }
+
+    delete engine;
+
+    const std::vector<GLRecorder::FrameStats>& Frames = Recorder.GetFrames();
+
+    GLRecorder::FrameStats Total;
+
+    for (unsigned int i = 1; i < Frames.size(); i++) {
+        for (unsigned int j = 0; j < GLRecorder::NUM_CALL_TYPES; j++) {
+            Total.NumCalls[j] += Frames[i].NumCalls[j];
+        }
+        Total.NumSubDraws += Frames[i].NumSubDraws;
+        Total.UploadedBytes += Frames[i].UploadedBytes;
+    }
+
+    printf("\n%-10s %10s %10s %10s %10s %10s %14s\n", "", "draw calls", "draws", "state", "uniforms", "uploads", "uploaded bytes");
+    PrintFrameStats("init", Frames[0], 1.0);
+
+    if (NumFrames > 0) {
+        PrintFrameStats("per frame", Total, 1.0 / NumFrames);
+        PrintFrameStats("last frame", Frames.back(), 1.0);
+    }
+
+    if (argc > 4 && !Recorder.WriteLog(argv[4])) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void EmptyJob(void* /*pData*/, unsigned int /*Begin*/, unsigned int /*End*/)
+{
+}
+
+
+// Same arithmetic per item whatever the thread, so that only the scheduling differs
+static float BenchWork(unsigned int Index)
+{
+    float x = (float)Index;
+
+    for (int i = 0; i < 64; i++) {
+        x = sqrtf(x * 1.0001f + 1.0f);
+    }
+
+    return x;
+}
+
+
+// Scheduler micro-benchmarks: Animation_Project2 --bench-jobs [max threads]
+// Max threads defaults to the hardware thread count; more than that is allowed, to look
+// at oversubscription or at the scaling of a larger machine.
+static int BenchJobsMain(int argc, char* argv[])
+{
+    unsigned int MaxThreads = (argc > 2) ? (unsigned int)atoi(argv[2]) : std::thread::hardware_concurrency();
+
+    if (MaxThreads == 0) {
+        MaxThreads = 1;
+    }
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // Spawn overhead, on the shared system
+    {
+        JobSystem& Jobs = GetJobSystem();
+        const unsigned int NumJobs = 100000;
+        JobCounter Counter;
+
+        Clock::time_point Start = Clock::now();
+
+        for (unsigned int i = 0; i < NumJobs; i++) {
+            Jobs.Run(&EmptyJob, NULL, &Counter);
+        }
+
+        Jobs.Wait(Counter);
+        double SingleMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+        std::vector<Job> Batch(1000);
+
+        for (unsigned int i = 0; i < Batch.size(); i++) {
+            Batch[i].pFunc = &EmptyJob;
+        }
+
+        Start = Clock::now();
+
+        for (unsigned int i = 0; i < NumJobs / Batch.size(); i++) {
+            JobCounter BatchCounter;
+            Jobs.Run(Batch.data(), (unsigned int)Batch.size(), &BatchCounter);
+            Jobs.Wait(BatchCounter);
+        }
+
+        double BatchMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+        // Dependency chain: every job starts the next one, so nothing runs in parallel
+        const unsigned int ChainLength = 10000;
+        std::vector<JobCounter> Chain(ChainLength);
+
+        Start = Clock::now();
+
+        Jobs.Run(&EmptyJob, NULL, &Chain[0]);
+
+        for (unsigned int i = 1; i < ChainLength; i++) {
+            Jobs.RunAfter(Chain[i - 1], &EmptyJob, NULL, &Chain[i]);
+        }
+
+        Jobs.Wait(Chain[ChainLength - 1]);
+        double ChainMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+        const unsigned int NumLoops = 10000;
+        unsigned int Sink = 0;
+
+        Start = Clock::now();
+
+        for (unsigned int i = 0; i < NumLoops; i++) {
+            Jobs.ParallelFor(Jobs.GetNumThreads(), 1, [&Sink](unsigned int Begin, unsigned int /*End*/) {
+                if (Begin == 0xFFFFFFFF) {
+                    Sink++;
+                }
+            });
+        }
+
+        double ParallelForMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+        printf("\nSpawn overhead (%u threads)\n", Jobs.GetNumThreads());
+        printf("  single jobs      %8.1f ns per job\n", SingleMs * 1e6 / NumJobs);
+        printf("  batches of %u  %8.1f ns per job\n", (unsigned int)Batch.size(), BatchMs * 1e6 / NumJobs);
+        printf("  dependent jobs   %8.1f ns per link\n", ChainMs * 1e6 / ChainLength);
+        printf("  empty ParallelFor %7.2f us per call\n", ParallelForMs * 1e3 / NumLoops);
+    }
+
+    // Scaling of a ParallelFor over independent items, best of 3 runs per thread count
+    const unsigned int NumItems = 1 << 22;
+    std::vector<float> Results(NumItems);
+    double BaseMs = 0.0;
+
+    printf("\n%8s %12s %10s %12s %10s\n", "threads", "time (ms)", "speedup", "efficiency", "steals");
+
+    for (unsigned int NumThreads = 1; ; NumThreads = (NumThreads * 2 > MaxThreads && NumThreads < MaxThreads) ? MaxThreads : NumThreads * 2) {
+        JobSystem Jobs(NumThreads > 1 ? NumThreads - 1 : 1);
+        double BestMs = 0.0;
+
+        for (int Run = 0; Run < 3; Run++) {
+            Clock::time_point Start = Clock::now();
+
+            if (NumThreads == 1) {
+                for (unsigned int i = 0; i < NumItems; i++) {
+                    Results[i] = BenchWork(i);
+                }
+            }
+            else {
+                Jobs.ParallelFor(NumItems, 1024, [&Results](unsigned int Begin, unsigned int End) {
+                    for (unsigned int i = Begin; i < End; i++) {
+                        Results[i] = BenchWork(i);
+                    }
+                });
+            }
+
+            double TimeMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+            BestMs = (Run == 0) ? TimeMs : std::min(BestMs, TimeMs);
+        }
+
+        if (NumThreads == 1) {
+            BaseMs = BestMs;
+        }
+
+        printf("%8u %12.2f %9.2fx %11.0f%% %10llu\n", NumThreads, BestMs, BaseMs / BestMs,
+            100.0 * BaseMs / BestMs / NumThreads, NumThreads > 1 ? Jobs.GetStats().NumSteals : 0ULL);
+
+        if (NumThreads >= MaxThreads) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+// Scene update benchmark: Animation_Project2 --bench-scene [nodes] [budget ms]
+// A forest of random trees, updated with more or less of it dirty, on the calling thread
+// and on the job system.
+static int BenchSceneMain(int argc, char* argv[])
+{
+    unsigned int NumNodes = (argc > 2) ? (unsigned int)atoi(argv[2]) : 100000;
+    double BudgetMs = (argc > 3) ? atof(argv[3]) : 2.0;
+    const unsigned int MaxDepth = 8;
+    const int NumRuns = 20;
+
+    if (NumNodes < 100) {
+        NumNodes = 100;
+    }
+
+    // Fixed seed, every run builds the same forest
+    unsigned int Seed = 12345;
+    auto Random = [&Seed](unsigned int Max) {
+        Seed = Seed * 1664525u + 1013904223u;
+        return (Seed >> 8) % Max;
+    };
+
+    Scene s;
+    std::vector<Scene::NodeId> Nodes;
+    std::vector<unsigned int> Depths;
+    std::vector<Scene::NodeId> Roots;
+
+    for (unsigned int i = 0; i < NumNodes; i++) {
+        // One root in a hundred, the other nodes hang below a random earlier one
+        Scene::NodeId Parent = Scene::INVALID_NODE;
+        unsigned int Depth = 0;
+
+        if (i % 100 != 0) {
+            unsigned int p = Random(i);
+
+            while (Depths[p] + 1 >= MaxDepth) {
+                p = Random(i);
+            }
+
+            Parent = Nodes[p];
+            Depth = Depths[p] + 1;
+        }
+
+        Scene::NodeId Node = s.CreateNode(Parent);
+        s.SetLocal(Node, glm::vec3((float)Random(100), 0.0f, 1.0f), glm::angleAxis(0.1f * Random(60), glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f));
+
+        Nodes.push_back(Node);
+        Depths.push_back(Depth);
+
+        if (Parent == Scene::INVALID_NODE) {
+            Roots.push_back(Node);
+        }
+    }
+
+    s.Update(NULL);
+
+    const struct {
+        const char* pName;
+        unsigned int OneIn;     // Every OneIn-th node is set, 0 for a single root
+    } Cases[] = {
+        { "all dirty", 1 },
+        { "10% dirty", 10 },
+        { "1% dirty", 100 },
+        { "one root", 0 },
+        { "static", 0xFFFFFFFF },
+    };
+
+    printf("\n%u nodes, %u roots, %u threads, budget %.2f ms\n", s.NumNodes(), (unsigned int)Roots.size(), GetJobSystem().GetNumThreads(), BudgetMs);
+    printf("%-10s %10s %12s %12s %9s %8s\n", "case", "updated", "serial (ms)", "jobs (ms)", "speedup", "budget");
+
+    for (unsigned int c = 0; c < sizeof(Cases) / sizeof(Cases[0]); c++) {
+        double TimeMs[2] = { 0.0, 0.0 };
+        unsigned int NumUpdated = 0;
+
+        for (int Mode = 0; Mode < 2; Mode++) {
+            for (int Run = 0; Run < NumRuns; Run++) {
+                if (Cases[c].OneIn == 0) {
+                    s.SetPosition(Roots[Run % Roots.size()], glm::vec3((float)Run, 0.0f, 0.0f));
+                }
+                else if (Cases[c].OneIn != 0xFFFFFFFF) {
+                    for (unsigned int i = Run % Cases[c].OneIn; i < Nodes.size(); i += Cases[c].OneIn) {
+                        s.SetPosition(Nodes[i], glm::vec3((float)Run, 0.0f, 1.0f));
+                    }
+                }
+
+                s.Update(Mode == 0 ? NULL : &GetJobSystem());
+                TimeMs[Mode] += s.GetStats().UpdateTimeMs / NumRuns;
+                NumUpdated = s.GetStats().NumUpdated;
+            }
+        }
+
+        printf("%-10s %10u %12.3f %12.3f %8.2fx %8s\n", Cases[c].pName, NumUpdated, TimeMs[0], TimeMs[1],
+            TimeMs[0] / TimeMs[1], std::min(TimeMs[0], TimeMs[1]) <= BudgetMs ? "ok" : "over");
+    }
+
+    return 0;
+}
+
+
+// What --bench-crowd measures the component arrays against: one heap object per agent,
+// its parts in separate allocations, updated through a virtual call
+class CrowdAgentObject
+{
+public:
+    virtual ~CrowdAgentObject() {};
+    virtual void Update(float DeltaTime, float Radius) = 0;
+};
+
+
+class WalkingAgentObject : public CrowdAgentObject
+{
+public:
+    WalkingAgentObject(const CharacterTransform& Transform, const AnimationState& Animation, const CharacterBounds& Bounds)
+        : m_pTransform(new CharacterTransform(Transform)), m_pAnimation(new AnimationState(Animation)), m_pBounds(new CharacterBounds(Bounds)) {}
+
+    ~WalkingAgentObject()
+    {
+        delete m_pTransform;
+        delete m_pAnimation;
+        delete m_pBounds;
+    }
+
+    // Same arithmetic as the CharacterWorld systems
+    virtual void Update(float DeltaTime, float Radius)
+    {
+        CharacterTransform& t = *m_pTransform;
+
+        glm::vec3 Forward(sinf(t.Heading), 0.0f, cosf(t.Heading));
+        t.Position += Forward * (t.Speed * DeltaTime);
+
+        if (t.Position.x * t.Position.x + t.Position.z * t.Position.z > Radius * Radius && glm::dot(Forward, t.Position) > 0.0f) {
+            t.Heading = atan2f(-t.Position.x, -t.Position.z);
+        }
+
+        AnimationState& a = *m_pAnimation;
+        a.Time += DeltaTime * a.PlaybackRate;
+
+        if (a.Time >= a.Duration) {
+            a.Time = a.Loop ? fmodf(a.Time, a.Duration) : a.Duration;
+        }
+
+        float s = sinf(t.Heading);
+        float c = cosf(t.Heading);
+        t.World[0] = glm::vec4(c, 0.0f, -s, 0.0f);
+        t.World[1] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+        t.World[2] = glm::vec4(s, 0.0f, c, 0.0f);
+        t.World[3] = glm::vec4(t.Position, 1.0f);
+
+        m_pBounds->Center = glm::vec3(t.World * glm::vec4(m_pBounds->LocalCenter, 1.0f));
+        m_pBounds->Radius = m_pBounds->LocalRadius;
+    }
+
+private:
+    CharacterTransform* m_pTransform;
+    AnimationState* m_pAnimation;
+    CharacterBounds* m_pBounds;
+};
+
+
+// Crowd update benchmark: Animation_Project2 --bench-crowd [agents] [frames]
+// Updates the same crowd as component arrays, serially and on the job system, and as
+// one virtual object per agent.
+static int BenchCrowdMain(int argc, char* argv[])
+{
+    unsigned int NumAgents = (argc > 2) ? (unsigned int)atoi(argv[2]) : 10000;
+    unsigned int NumFrames = (argc > 3) ? (unsigned int)atoi(argv[3]) : 200;
+    const float DeltaTime = 1.0f / 60.0f;
+    const float Radius = 50.0f;
+
+    if (NumAgents == 0 || NumFrames == 0) {
+        std::cerr << "Usage: " << argv[0] << " --bench-crowd [agents] [frames]\n";
+        return -1;
+    }
+
+    unsigned int Seed = 12345;
+    auto Random = [&Seed]() {
+        Seed = Seed * 1664525u + 1013904223u;
+        return (float)(Seed >> 8) / (float)(1u << 24);
+    };
+
+    CharacterWorld World;
+    std::vector<CrowdAgentObject*> Objects;
+    std::vector<void*> Holes;
+
+    for (unsigned int i = 0; i < NumAgents; i++) {
+        CharacterTransform Transform;
+        Transform.Position = glm::vec3((Random() * 2.0f - 1.0f) * Radius, 0.0f, (Random() * 2.0f - 1.0f) * Radius);
+        Transform.Heading = Random() * 6.2831853f;
+        Transform.Speed = 1.0f + Random();
+
+        AnimationState Animation;
+        Animation.Duration = 1.2f;
+        Animation.Time = Random() * Animation.Duration;
+        Animation.PlaybackRate = Transform.Speed;
+
+        CharacterBounds Bounds;
+        Bounds.LocalCenter = glm::vec3(0.0f, 1.0f, 0.0f);
+        Bounds.LocalRadius = 1.0f;
+
+        Entity e = World.Create();
+        World.Transforms.Add(e, Transform);
+        World.Animations.Add(e, Animation);
+        World.Meshes.Add(e);
+        World.Bounds.Add(e, Bounds);
+
+        Objects.push_back(new WalkingAgentObject(Transform, Animation, Bounds));
+
+        // What a long running heap looks like: the agents' parts end up scattered
+        Holes.push_back(malloc(64 + (unsigned int)(Random() * 512.0f)));
+    }
+
+    for (unsigned int i = 0; i < Holes.size(); i++) {
+        free(Holes[i]);
+    }
+
+    // Objects get updated in whatever order they were registered, not allocated
+    for (unsigned int i = (unsigned int)Objects.size() - 1; i > 0; i--) {
+        std::swap(Objects[i], Objects[(unsigned int)(Random() * i)]);
+    }
+
+    typedef std::chrono::high_resolution_clock Clock;
+    double TimeMs[3] = { 0.0, 0.0, 0.0 };
+
+    for (int Run = 0; Run < 3; Run++) {
+        Clock::time_point Start = Clock::now();
+
+        for (unsigned int f = 0; f < NumFrames; f++) {
+            if (Run == 0) {
+                World.Update(DeltaTime, Radius, NULL);
+            }
+            else if (Run == 1) {
+                World.Update(DeltaTime, Radius, &GetJobSystem());
+            }
+            else {
+                for (unsigned int i = 0; i < Objects.size(); i++) {
+                    Objects[i]->Update(DeltaTime, Radius);
+                }
+            }
+        }
+
+        TimeMs[Run] = std::chrono::duration<double, std::milli>(Clock::now() - Start).count() / NumFrames;
+    }
+
+    printf("\n%u agents, %u frames, %u threads\n", NumAgents, NumFrames, GetJobSystem().GetNumThreads());
+    printf("%-28s %12s %14s\n", "layout", "ms / frame", "ns / agent");
+
+    const char* pNames[3] = { "components, serial", "components, job system", "virtual objects, serial" };
+
+    for (int Run = 0; Run < 3; Run++) {
+        printf("%-28s %12.3f %14.1f\n", pNames[Run], TimeMs[Run], TimeMs[Run] * 1e6 / NumAgents);
+    }
+
+    for (unsigned int i = 0; i < Objects.size(); i++) {
+        delete Objects[i];
+    }
+
+    return 0;
+}
+
+
+// BVH benchmark: Animation_Project2 --bench-bvh [objects] [queries]
+// Boxes scattered over a city block, a tenth of them moving every frame. Times the refit,
+// frustum and ray queries against testing every box, and checks that both agree.
+static int BenchBVHMain(int argc, char* argv[])
+{
+    unsigned int NumObjects = (argc > 2) ? (unsigned int)atoi(argv[2]) : 10000;
+    unsigned int NumQueries = (argc > 3) ? (unsigned int)atoi(argv[3]) : 1000;
+    const float Size = 500.0f;
+
+    if (NumObjects == 0 || NumQueries == 0) {
+        std::cerr << "Usage: " << argv[0] << " --bench-bvh [objects] [queries]\n";
+        return -1;
+    }
+
+    unsigned int Seed = 12345;
+    auto Random = [&Seed]() {
+        Seed = Seed * 1664525u + 1013904223u;
+        return (float)(Seed >> 8) / (float)(1u << 24);
+    };
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    std::vector<AABB> Boxes(NumObjects);
+    std::vector<BVH::ProxyId> Proxies(NumObjects);
+    BVH Tree;
+
+    Clock::time_point Start = Clock::now();
+
+    for (unsigned int i = 0; i < NumObjects; i++) {
+        glm::vec3 Center(Random() * Size, Random() * 4.0f, Random() * Size);
+        glm::vec3 Half(0.5f + Random(), 1.0f + Random(), 0.5f + Random());
+        Boxes[i] = AABB(Center - Half, Center + Half);
+        Proxies[i] = Tree.Insert(Boxes[i], i);
+    }
+
+    double InsertMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+    Start = Clock::now();
+    Tree.Rebuild();
+    double BuildMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+    // Walk for a while, refitting every frame
+    const unsigned int NumFrames = 100;
+    double RefitMs = 0.0;
+
+    for (unsigned int f = 0; f < NumFrames; f++) {
+        for (unsigned int i = 0; i < NumObjects / 10; i++) {
+            unsigned int j = (unsigned int)(Random() * (NumObjects - 1));
+            glm::vec3 Step((Random() - 0.5f) * 2.0f, 0.0f, (Random() - 0.5f) * 2.0f);
+            Boxes[j] = AABB(Boxes[j].Min + Step, Boxes[j].Max + Step);
+            Tree.Update(Proxies[j], Boxes[j]);
+        }
+
+        Clock::time_point RefitStart = Clock::now();
+        Tree.Refit();
+        RefitMs += std::chrono::duration<double, std::milli>(Clock::now() - RefitStart).count();
+    }
+
+    std::vector<Frustum> Frustums(NumQueries);
+    std::vector<Ray> Rays(NumQueries);
+
+    for (unsigned int i = 0; i < NumQueries; i++) {
+        glm::vec3 Eye(Random() * Size, 2.0f, Random() * Size);
+        glm::vec3 Target(Random() * Size, 0.0f, Random() * Size);
+
+        Frustums[i] = Frustum::FromMatrix(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+                                          glm::lookAt(Eye, Target, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        Rays[i].Origin = Eye;
+        Rays[i].Direction = glm::normalize(Target - Eye);
+    }
+
+    std::vector<unsigned int> Visible;
+    unsigned long long NumVisible[2] = { 0, 0 };
+    double FrustumMs[2] = { 0.0, 0.0 };
+
+    for (int Run = 0; Run < 2; Run++) {
+        Start = Clock::now();
+
+        for (unsigned int q = 0; q < NumQueries; q++) {
+            Visible.clear();
+
+            if (Run == 0) {
+                for (unsigned int i = 0; i < NumObjects; i++) {
+                    if (Frustums[q].Test(Boxes[i]) != Frustum::OUTSIDE) {
+                        Visible.push_back(i);
+                    }
+                }
+            }
+            else {
+                Tree.QueryFrustum(Frustums[q], Visible);
+            }
+
+            NumVisible[Run] += Visible.size();
+        }
+
+        FrustumMs[Run] = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+    }
+
+    std::vector<BVH::RayHit> Hits(NumQueries);
+    unsigned int NumMismatches = 0;
+    double RayMs[3] = { 0.0, 0.0, 0.0 };
+
+    for (int Run = 0; Run < 3; Run++) {
+        Start = Clock::now();
+
+        if (Run == 0) {
+            for (unsigned int q = 0; q < NumQueries; q++) {
+                glm::vec3 InvDirection = Rays[q].GetInvDirection();
+                Hits[q] = BVH::RayHit();
+
+                for (unsigned int i = 0; i < NumObjects; i++) {
+                    float Distance = Rays[q].Intersect(Boxes[i], InvDirection);
+
+                    if (Distance >= 0.0f && Distance < Hits[q].Distance) {
+                        Hits[q].Distance = Distance;
+                        Hits[q].UserData = i;
+                    }
+                }
+            }
+        }
+        else {
+            std::vector<BVH::RayHit> TreeHits(NumQueries);
+            Tree.RayCastBatch(Rays.data(), NumQueries, TreeHits.data(), (Run == 2) ? &GetJobSystem() : NULL);
+            RayMs[Run] = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+            for (unsigned int q = 0; q < NumQueries; q++) {
+                NumMismatches += (TreeHits[q].Distance != Hits[q].Distance) ? 1 : 0;
+            }
+
+            continue;
+        }
+
+        RayMs[Run] = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+    }
+
+    printf("\n%u objects, %u queries, %u threads\n", NumObjects, NumQueries, GetJobSystem().GetNumThreads());
+    printf("insert %.3f ms, SAH build %.3f ms, refit %.3f ms / frame\n", InsertMs, BuildMs, RefitMs / NumFrames);
+    printf("%-28s %12s\n", "query", "us / query");
+    printf("%-28s %12.2f\n", "frustum, every box", FrustumMs[0] * 1000.0 / NumQueries);
+    printf("%-28s %12.2f\n", "frustum, BVH", FrustumMs[1] * 1000.0 / NumQueries);
+    printf("%-28s %12.2f\n", "ray, every box", RayMs[0] * 1000.0 / NumQueries);
+    printf("%-28s %12.2f\n", "ray, BVH", RayMs[1] * 1000.0 / NumQueries);
+    printf("%-28s %12.2f\n", "ray, BVH, job system", RayMs[2] * 1000.0 / NumQueries);
+
+    Tree.PrintStats("bench");
+
+    if (NumVisible[0] != NumVisible[1] || NumMismatches > 0) {
+        printf("MISMATCH: %llu / %llu visible, %u rays differ\n", NumVisible[0], NumVisible[1], NumMismatches);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+// Frustum culling benchmark: Animation_Project2 --bench-cull [objects] [iterations]
+// Culls random spheres and boxes with each code path, then with the widest one on the job
+// system, and checks that they all keep the same objects.
+static int BenchCullMain(int argc, char* argv[])
+{
+    unsigned int NumObjects = (argc > 2) ? (unsigned int)atoi(argv[2]) : 100000;
+    unsigned int NumIterations = (argc > 3) ? (unsigned int)atoi(argv[3]) : 100;
+    const float Size = 500.0f;
+
+    if (NumObjects == 0 || NumIterations == 0) {
+        std::cerr << "Usage: " << argv[0] << " --bench-cull [objects] [iterations]\n";
+        return -1;
+    }
+
+    unsigned int Seed = 12345;
+    auto Random = [&Seed]() {
+        Seed = Seed * 1664525u + 1013904223u;
+        return (float)(Seed >> 8) / (float)(1u << 24);
+    };
+
+    SphereArray Spheres;
+    BoxArray Boxes;
+    Spheres.Resize(NumObjects);
+    Boxes.Resize(NumObjects);
+
+    for (unsigned int i = 0; i < NumObjects; i++) {
+        glm::vec3 Center(Random() * Size, Random() * 4.0f, Random() * Size);
+        glm::vec3 Half(0.5f + Random(), 1.0f + Random(), 0.5f + Random());
+        Spheres.Set(i, Center, glm::length(Half));
+        Boxes.Set(i, AABB(Center - Half, Center + Half));
+    }
+
+    // From the middle, looking at a different part of the block each iteration
+    glm::mat4 Projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+    std::vector<Frustum> Frustums(NumIterations);
+
+    for (unsigned int i = 0; i < NumIterations; i++) {
+        float Angle = 6.2831853f * i / NumIterations;
+        glm::vec3 Eye(Size * 0.5f, 2.0f, Size * 0.5f);
+        Frustums[i] = Frustum::FromMatrix(Projection * glm::lookAt(Eye, Eye + glm::vec3(sinf(Angle), 0.0f, cosf(Angle)), glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    struct Run {
+        CULL_PATH Path;
+        bool Jobs;
+    };
+
+    // Paths that are not built in run the next best one
+    Run Runs[] = {
+        { CULL_SCALAR, false },
+        { CULL_SSE, false },
+        { CULL_AVX, false },
+        { CULL_BEST, true },
+    };
+
+    typedef std::chrono::high_resolution_clock Clock;
+    std::vector<unsigned int> Visible(NumObjects);
+    std::vector<unsigned int> Reference[2];
+    bool Mismatch = false;
+
+    printf("\n%u objects, %u iterations, %u threads, best path %s\n", NumObjects, NumIterations,
+        GetJobSystem().GetNumThreads(), GetCullPathName(CULL_BEST));
+    printf("%-20s %14s %14s %14s\n", "path", "spheres (ms)", "boxes (ms)", "visible");
+
+    for (unsigned int r = 0; r < sizeof(Runs) / sizeof(Runs[0]); r++) {
+        JobSystem* pJobs = Runs[r].Jobs ? &GetJobSystem() : NULL;
+        double TimeMs[2] = { 0.0, 0.0 };
+        unsigned long long NumVisible[2] = { 0, 0 };
+
+        for (int Kind = 0; Kind < 2; Kind++) {
+            std::vector<unsigned int> Kept;
+            Clock::time_point Start = Clock::now();
+
+            for (unsigned int i = 0; i < NumIterations; i++) {
+                unsigned int Count = (Kind == 0) ? CullSpheres(Frustums[i], Spheres, Visible.data(), pJobs, Runs[r].Path)
+                                                 : CullBoxes(Frustums[i], Boxes, Visible.data(), pJobs, Runs[r].Path);
+                NumVisible[Kind] += Count;
+
+                // The first frustum's list is compared across the paths
+                if (i == 0) {
+                    Kept.assign(Visible.begin(), Visible.begin() + Count);
+                }
+            }
+
+            TimeMs[Kind] = std::chrono::duration<double, std::milli>(Clock::now() - Start).count() / NumIterations;
+
+            if (r == 0) {
+                Reference[Kind] = Kept;
+            }
+            else if (Kept != Reference[Kind]) {
+                Mismatch = true;
+            }
+        }
+
+        std::string Name = std::string(GetCullPathName(Runs[r].Path)) + (Runs[r].Jobs ? ", job system" : "");
+        printf("%-20s %14.3f %14.3f %14.1f\n", Name.c_str(), TimeMs[0], TimeMs[1], (double)NumVisible[0] / NumIterations);
+    }
+
+    if (Mismatch) {
+        printf("MISMATCH between the code paths\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+// Occlusion culling benchmark: Animation_Project2 --bench-occlusion [characters] [walls] [depth.png]
+// A city block of box buildings with a crowd in its streets, seen from street level while
+// turning around. Each view is frustum culled, then the buildings are rasterized and the
+// remaining bounds tested, on one thread and on the job system, which must agree.
+static int BenchOcclusionMain(int argc, char* argv[])
+{
+    unsigned int NumCharacters = (argc > 2) ? (unsigned int)atoi(argv[2]) : 20000;
+    unsigned int NumWalls = (argc > 3) ? (unsigned int)atoi(argv[3]) : 400;
+    const char* pDepthImage = (argc > 4) ? argv[4] : NULL;
+    const unsigned int NumViews = 64;
+    const float Size = 400.0f;
+    const float Street = 8.0f;
+
+    if (NumCharacters == 0) {
+        std::cerr << "Usage: " << argv[0] << " --bench-occlusion [characters] [walls] [depth.png]\n";
+        return -1;
+    }
+
+    unsigned int Seed = 12345;
+    auto Random = [&Seed]() {
+        Seed = Seed * 1664525u + 1013904223u;
+        return (float)(Seed >> 8) / (float)(1u << 24);
+    };
+
+    // Buildings on a grid of blocks, the streets between them left open
+    unsigned int Blocks = std::max(1u, (unsigned int)ceilf(sqrtf((float)NumWalls)));
+    float BlockSize = Size / Blocks;
+    std::vector<Occluder> Occluders;
+
+    for (unsigned int i = 0; i < NumWalls; i++) {
+        glm::vec3 Min((i % Blocks) * BlockSize + Street * 0.5f, 0.0f, (i / Blocks) * BlockSize + Street * 0.5f);
+        glm::vec3 Max = Min + glm::vec3(BlockSize - Street, 6.0f + Random() * 20.0f, BlockSize - Street);
+
+        Occluder Building;
+        Building.pMesh = CreateBoxOccluder(AABB(Min, Max));
+        Occluders.push_back(Building);
+    }
+
+    // The crowd walks the streets
+    SphereArray Spheres;
+    Spheres.Resize(NumCharacters);
+
+    for (unsigned int i = 0; i < NumCharacters; i++) {
+        float Along = Random() * Size;
+        float Across = floorf(Random() * Blocks) * BlockSize + (Random() - 0.5f) * Street * 0.8f;
+        glm::vec3 Center = (i & 1) ? glm::vec3(Along, 0.9f, Across) : glm::vec3(Across, 0.9f, Along);
+        Spheres.Set(i, Center, 1.0f);
+    }
+
+    glm::mat4 Projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    std::vector<glm::mat4> Views(NumViews);
+
+    for (unsigned int i = 0; i < NumViews; i++) {
+        float Angle = 6.2831853f * i / NumViews;
+        glm::vec3 Eye(0.0f, 1.7f, BlockSize * (Blocks / 2));
+        Views[i] = Projection * glm::lookAt(Eye, Eye + glm::vec3(sinf(Angle), 0.0f, cosf(Angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    typedef std::chrono::high_resolution_clock Clock;
+    std::vector<unsigned int> Visible(NumCharacters);
+    std::vector<unsigned int> Reference;
+    bool Mismatch = false;
+
+    printf("\n%u characters, %u buildings, %u views, %u threads\n", NumCharacters, NumWalls, NumViews, GetJobSystem().GetNumThreads());
+    printf("%-14s %12s %12s %12s %12s %12s\n", "", "render (ms)", "test (ms)", "in frustum", "visible", "occluded");
+
+    for (int Run = 0; Run < 2; Run++) {
+        JobSystem* pJobs = Run ? &GetJobSystem() : NULL;
+        OcclusionBuffer Buffer;
+        std::vector<unsigned int> Kept;
+        double RenderMs = 0.0;
+        double TestMs = 0.0;
+        unsigned long long NumInFrustum = 0;
+        unsigned long long NumVisible = 0;
+
+        for (unsigned int i = 0; i < NumViews; i++) {
+            unsigned int Count = CullSpheres(Frustum::FromMatrix(Views[i]), Spheres, Visible.data(), pJobs);
+            NumInFrustum += Count;
+
+            Buffer.Render(Views[i], Occluders.data(), (unsigned int)Occluders.size(), pJobs);
+            RenderMs += Buffer.GetStats().RenderTimeMs;
+
+            Clock::time_point Start = Clock::now();
+            Count = Buffer.FilterVisible(Spheres, Visible.data(), Count, pJobs);
+            TestMs += std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+            NumVisible += Count;
+
+            Kept.insert(Kept.end(), Visible.begin(), Visible.begin() + Count);
+        }
+
+        if (Run == 0) {
+            Reference = Kept;
+        }
+        else if (Kept != Reference) {
+            Mismatch = true;
+        }
+
+        printf("%-14s %12.3f %12.3f %12.1f %12.1f %11.1f%%\n", Run ? "job system" : "one thread", RenderMs / NumViews, TestMs / NumViews,
+            (double)NumInFrustum / NumViews, (double)NumVisible / NumViews,
+            NumInFrustum ? 100.0 * (NumInFrustum - NumVisible) / NumInFrustum : 0.0);
+
+        // The last view, for a look at what the buildings cover
+        if (pDepthImage && Run == 1 && !Buffer.WriteDepthImage(pDepthImage)) {
+            printf("Error writing '%s'\n", pDepthImage);
+        }
+    }
+
+    if (Mismatch) {
+        printf("MISMATCH between one thread and the job system\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+typedef int (*BenchmarkMain)(int argc, char* argv[]);
+
+struct BenchmarkMode {
+    const char* pName;
+    BenchmarkMain pMain;
+};
+
+static const BenchmarkMode s_Benchmarks[] = {
+    { "--headless-bench", HeadlessBenchMain },
+    { "--bench-jobs", BenchJobsMain },
+    { "--bench-scene", BenchSceneMain },
+    { "--bench-crowd", BenchCrowdMain },
+    { "--bench-bvh", BenchBVHMain },
+    { "--bench-cull", BenchCullMain },
+    { "--bench-occlusion", BenchOcclusionMain },
+};
+
+
+bool RunBenchmark(int argc, char* argv[], int& ExitCode)
+{
+    if (argc < 2) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < sizeof(s_Benchmarks) / sizeof(s_Benchmarks[0]); i++) {
+        if (!strcmp(argv[1], s_Benchmarks[i].pName)) {
+            ExitCode = s_Benchmarks[i].pMain(argc, argv);
+            return true;
+        }
+    }
+
+    return false;
+}
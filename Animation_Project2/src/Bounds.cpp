@@ -0,0 +1,119 @@
+#include "..//headers/Bounds.h"
+#include <algorithm>
+#include <cmath>
+
+
+AABB AABB::Transform(const glm::mat4& m) const
+{
+    if (IsEmpty()) {
+        return *this;
+    }
+
+    // Center moves with the matrix, the extent grows by the absolute values of its rows
+    glm::vec3 Center = GetCenter();
+    glm::vec3 Half = (Max - Min) * 0.5f;
+
+    glm::vec3 NewCenter = glm::vec3(m * glm::vec4(Center, 1.0f));
+    glm::vec3 NewHalf = glm::abs(glm::vec3(m[0])) * Half.x + glm::abs(glm::vec3(m[1])) * Half.y + glm::abs(glm::vec3(m[2])) * Half.z;
+
+    return AABB(NewCenter - NewHalf, NewCenter + NewHalf);
+}
+
+
+glm::vec3 Ray::GetInvDirection() const
+{
+    glm::vec3 Inv;
+
+    for (int i = 0; i < 3; i++) {
+        float d = Direction[i];
+
+        if (fabsf(d) < 1e-20f) {
+            d = (d < 0.0f) ? -1e-20f : 1e-20f;
+        }
+
+        Inv[i] = 1.0f / d;
+    }
+
+    return Inv;
+}
+
+
+float Ray::Intersect(const AABB& Box, const glm::vec3& InvDirection) const
+{
+    glm::vec3 t0 = (Box.Min - Origin) * InvDirection;
+    glm::vec3 t1 = (Box.Max - Origin) * InvDirection;
+
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+
+    float Enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float Exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, MaxDistance));
+
+    return (Enter <= Exit) ? Enter : -1.0f;
+}
+
+
+Frustum Frustum::FromMatrix(const glm::mat4& ViewProj)
+{
+    // Gribb & Hartmann: the planes are sums and differences of the rows of the matrix
+    glm::mat4 t = glm::transpose(ViewProj);
+    Frustum f;
+
+    f.Planes[PLANE_LEFT] = t[3] + t[0];
+    f.Planes[PLANE_RIGHT] = t[3] - t[0];
+    f.Planes[PLANE_BOTTOM] = t[3] + t[1];
+    f.Planes[PLANE_TOP] = t[3] - t[1];
+    f.Planes[PLANE_NEAR] = t[3] + t[2];
+    f.Planes[PLANE_FAR] = t[3] - t[2];
+
+    for (int i = 0; i < NUM_PLANES; i++) {
+        float Length = glm::length(glm::vec3(f.Planes[i]));
+
+        if (Length > 0.0f) {
+            f.Planes[i] /= Length;
+        }
+    }
+
+    return f;
+}
+
+
+Frustum::RESULT Frustum::Test(const AABB& Box) const
+{
+    RESULT Result = INSIDE;
+
+    for (int i = 0; i < NUM_PLANES; i++) {
+        glm::vec3 Normal(Planes[i]);
+
+        // Corner furthest along the normal, and the one furthest against it
+        glm::vec3 Positive(Normal.x >= 0.0f ? Box.Max.x : Box.Min.x,
+                           Normal.y >= 0.0f ? Box.Max.y : Box.Min.y,
+                           Normal.z >= 0.0f ? Box.Max.z : Box.Min.z);
+
+        if (glm::dot(Normal, Positive) + Planes[i].w < 0.0f) {
+            return OUTSIDE;
+        }
+
+        glm::vec3 Negative(Normal.x >= 0.0f ? Box.Min.x : Box.Max.x,
+                           Normal.y >= 0.0f ? Box.Min.y : Box.Max.y,
+                           Normal.z >= 0.0f ? Box.Min.z : Box.Max.z);
+
+        if (glm::dot(Normal, Negative) + Planes[i].w < 0.0f) {
+            Result = INTERSECTS;
+        }
+    }
+
+    return Result;
+}
+
+
+bool Frustum::IsVisible(const glm::vec3& Center, float Radius) const
+{
+    for (int i = 0; i < NUM_PLANES; i++) {
+        if (glm::dot(glm::vec3(Planes[i]), Center) + Planes[i].w < -Radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
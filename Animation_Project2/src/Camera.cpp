@@ -46,6 +46,17 @@ void Camera::SetPosition(float x, float y, float z) {
     UpdateCameraVectors();
 }
 
+void Camera::SetLookAt(const glm::vec3& Position, const glm::vec3& Target)
+{
+    glm::vec3 Front = glm::normalize(Target - Position);
+
+    m_position = Position;
+    m_target = Target;
+    m_yaw = glm::degrees(atan2(Front.z, Front.x));
+    m_pitch = glm::degrees(asin(Front.y));
+    UpdateCameraVectors();
+}
+
 void Camera::OnKeyboard(int key, float deltaTime) {
     float velocity = m_speed * deltaTime;
 
@@ -61,6 +72,8 @@ void Camera::OnKeyboard(int key, float deltaTime) {
         m_position += m_worldUp * velocity;
     if (key == GLFW_KEY_LEFT_SHIFT)
         m_position -= m_worldUp * velocity;
+
+    m_Version++;
 }
 
 void Camera::OnMouse(float xpos, float ypos)
@@ -146,6 +159,8 @@ void Camera::Update()
     m_target = glm::normalize(View);
 
     m_up = glm::normalize(glm::cross(m_target, U));
+
+    m_Version++;
 }
 
 void Camera::UpdateCameraVectors()
@@ -160,13 +175,29 @@ void Camera::UpdateCameraVectors()
     // Recalculate Right and Up vector
     m_right = glm::normalize(glm::cross(m_front, m_worldUp));
     m_up = glm::normalize(glm::cross(m_right, m_front));
+
+    m_Version++;
 }
 
 glm::mat4 Camera::GetMatrix() const
 {
-    return glm::lookAt(
-        m_position,          // Camera position
-        m_target, // Target position (where camera looks at)
-        m_up                 // Up vector
-    );
+    return GetState().GetMatrix();
+}
+
+CameraState Camera::GetState() const
+{
+    CameraState State;
+    State.Position = m_position;    // Camera position
+    State.Target = m_target;        // Target position (where camera looks at)
+    State.Up = m_up;                // Up vector
+    return State;
+}
+
+CameraState Lerp(const CameraState& a, const CameraState& b, float Factor)
+{
+    CameraState State;
+    State.Position = glm::mix(a.Position, b.Position, Factor);
+    State.Target = glm::mix(a.Target, b.Target, Factor);
+    State.Up = glm::normalize(glm::mix(a.Up, b.Up, Factor));
+    return State;
 }
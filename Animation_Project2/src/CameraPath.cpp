@@ -0,0 +1,117 @@
+#include "..//headers/CameraPath.h"
+#include <glm/gtc/constants.hpp>
+#include <math.h>
+#include <stdio.h>
+
+
+bool CameraPath::LoadFromFile(const char* pFilename)
+{
+    FILE* f = fopen(pFilename, "r");
+
+    if (!f) {
+        fprintf(stderr, "Unable to open camera path '%s'\n", pFilename);
+        return false;
+    }
+
+    m_Keys.clear();
+
+    char Line[512];
+    unsigned int LineNum = 0;
+    bool Ret = true;
+
+    while (fgets(Line, sizeof(Line), f)) {
+        LineNum++;
+
+        const char* p = Line;
+
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') {
+            continue;
+        }
+
+        Key k;
+
+        if (sscanf(p, "%f %f %f %f %f %f %f", &k.Time,
+                   &k.Position.x, &k.Position.y, &k.Position.z,
+                   &k.Target.x, &k.Target.y, &k.Target.z) != 7) {
+            fprintf(stderr, "%s:%d: expected 'time px py pz tx ty tz'\n", pFilename, LineNum);
+            Ret = false;
+            break;
+        }
+
+        if (!m_Keys.empty() && k.Time <= m_Keys.back().Time) {
+            fprintf(stderr, "%s:%d: key times must increase\n", pFilename, LineNum);
+            Ret = false;
+            break;
+        }
+
+        m_Keys.push_back(k);
+    }
+
+    fclose(f);
+
+    if (Ret && m_Keys.empty()) {
+        fprintf(stderr, "Camera path '%s' has no keys\n", pFilename);
+        Ret = false;
+    }
+
+    return Ret;
+}
+
+
+void CameraPath::MakeOrbit(const glm::vec3& Center, float Radius, float Height, float Duration, unsigned int NumKeys)
+{
+    m_Keys.clear();
+
+    if (NumKeys < 2) {
+        NumKeys = 2;
+    }
+
+    for (unsigned int i = 0; i < NumKeys; i++) {
+        float t = (float)i / (float)(NumKeys - 1);
+        float Angle = t * glm::two_pi<float>();
+
+        Key k;
+        k.Time = t * Duration;
+        k.Position = Center + glm::vec3(Radius * sinf(Angle), Height, Radius * cosf(Angle));
+        k.Target = Center;
+        m_Keys.push_back(k);
+    }
+}
+
+
+void CameraPath::Evaluate(float Time, glm::vec3& Position, glm::vec3& Target) const
+{
+    if (m_Keys.empty()) {
+        return;
+    }
+
+    if (Time <= m_Keys.front().Time) {
+        Position = m_Keys.front().Position;
+        Target = m_Keys.front().Target;
+        return;
+    }
+
+    if (Time >= m_Keys.back().Time) {
+        Position = m_Keys.back().Position;
+        Target = m_Keys.back().Target;
+        return;
+    }
+
+    // Paths are short, a linear search is fine
+    unsigned int i = 1;
+
+    while (m_Keys[i].Time < Time) {
+        i++;
+    }
+
+    const Key& k0 = m_Keys[i - 1];
+    const Key& k1 = m_Keys[i];
+    float Factor = (Time - k0.Time) / (k1.Time - k0.Time);
+
+    Position = glm::mix(k0.Position, k1.Position, Factor);
+    Target = glm::mix(k0.Target, k1.Target, Factor);
+}
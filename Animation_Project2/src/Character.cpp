@@ -0,0 +1,322 @@
+#include "..//headers/Character.h"
+#include "..//headers/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+// Characters per job; the systems do little per character
+#define CHARACTER_MIN_BATCH 1024
+
+// Shortest clip UpdateAnimation() loops over, so that a zero or negative Duration cannot
+// turn the time into NaN
+#define CHARACTER_MIN_CLIP_DURATION 1e-4f
+
+
+// Runs f(Begin, End) over [0, Count), split across the job system if there is one
+template<typename Func>
+static void ForEachBatch(JobSystem* pJobs, unsigned int Count, const Func& f)
+{
+    if (pJobs) {
+        pJobs->ParallelFor(Count, CHARACTER_MIN_BATCH, f);
+    }
+    else if (Count > 0) {
+        f(0, Count);
+    }
+}
+
+
+Entity CharacterWorld::Create()
+{
+    unsigned int Index;
+
+    if (m_FreeIndices.empty()) {
+        if (m_Generations.size() > ENTITY_INDEX_MASK) {
+            return INVALID_ENTITY;
+        }
+
+        Index = (unsigned int)m_Generations.size();
+        m_Generations.push_back(0);
+    }
+    else {
+        Index = m_FreeIndices.back();
+        m_FreeIndices.pop_back();
+    }
+
+    m_NumAlive++;
+
+    return (m_Generations[Index] << ENTITY_INDEX_BITS) | Index;
+}
+
+
+void CharacterWorld::Destroy(Entity e)
+{
+    if (!IsAlive(e)) {
+        return;
+    }
+
+    ReleasePose(e);
+
+    Transforms.Remove(e);
+    Skeletons.Remove(e);
+    Animations.Remove(e);
+    Meshes.Remove(e);
+    Bounds.Remove(e);
+
+    BVH::ProxyId* pProxy = m_Proxies.Get(e);
+
+    if (pProxy) {
+        Tree.Remove(*pProxy);
+        m_Proxies.Remove(e);
+    }
+
+    unsigned int Index = GetEntityIndex(e);
+
+    // Wraps around, but only after the index has been reused that many times
+    m_Generations[Index] = (m_Generations[Index] + 1) & (0xFFFFFFFFu >> ENTITY_INDEX_BITS);
+
+    // The all ones id stays INVALID_ENTITY
+    if (((m_Generations[Index] << ENTITY_INDEX_BITS) | Index) == INVALID_ENTITY) {
+        m_Generations[Index] = 0;
+    }
+
+    m_FreeIndices.push_back(Index);
+    m_NumAlive--;
+}
+
+
+SkeletonInstance& CharacterWorld::AddSkeleton(Entity e, const std::shared_ptr<const SkeletonAsset>& pAsset)
+{
+    SkeletonInstance Instance;
+    Instance.pAsset = pAsset;
+    Instance.NumJoints = pAsset->Skel.NumJoints();
+
+    // Replacing a skeleton gives its range back first
+    ReleasePose(e);
+
+    std::vector<unsigned int>& FreeRanges = m_FreePoseRanges[Instance.NumJoints];
+
+    if (!FreeRanges.empty()) {
+        Instance.PoseOffset = FreeRanges.back();
+        FreeRanges.pop_back();
+
+        std::fill(Poses.begin() + Instance.PoseOffset, Poses.begin() + Instance.PoseOffset + Instance.NumJoints, glm::mat4(1.0f));
+    }
+    else {
+        Instance.PoseOffset = (unsigned int)Poses.size();
+        Poses.resize(Poses.size() + Instance.NumJoints, glm::mat4(1.0f));
+    }
+
+    return Skeletons.Add(e, Instance);
+}
+
+
+void CharacterWorld::ReleasePose(Entity e)
+{
+    const SkeletonInstance* pSkeleton = Skeletons.Get(e);
+
+    if (pSkeleton && pSkeleton->NumJoints > 0) {
+        m_FreePoseRanges[pSkeleton->NumJoints].push_back(pSkeleton->PoseOffset);
+    }
+}
+
+
+bool CharacterWorld::IsAlive(Entity e) const
+{
+    unsigned int Index = GetEntityIndex(e);
+    return e != INVALID_ENTITY && Index < m_Generations.size() && (e >> ENTITY_INDEX_BITS) == m_Generations[Index];
+}
+
+
+void CharacterWorld::UpdateLocomotion(float DeltaTime, float Radius, JobSystem* pJobs)
+{
+    CharacterTransform* pTransforms = Transforms.Data();
+
+    ForEachBatch(pJobs, Transforms.Size(), [pTransforms, DeltaTime, Radius](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            CharacterTransform& t = pTransforms[i];
+
+            glm::vec3 Forward(sinf(t.Heading), 0.0f, cosf(t.Heading));
+            t.Position += Forward * (t.Speed * DeltaTime);
+
+            // Past the edge and still heading out: face the center again
+            if (t.Position.x * t.Position.x + t.Position.z * t.Position.z > Radius * Radius &&
+                glm::dot(Forward, t.Position) > 0.0f) {
+                t.Heading = atan2f(-t.Position.x, -t.Position.z);
+            }
+        }
+    });
+}
+
+
+void CharacterWorld::UpdateAnimation(float DeltaTime, JobSystem* pJobs)
+{
+    AnimationState* pStates = Animations.Data();
+
+    ForEachBatch(pJobs, Animations.Size(), [pStates, DeltaTime](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            AnimationState& a = pStates[i];
+            a.Duration = std::max(a.Duration, CHARACTER_MIN_CLIP_DURATION);
+            a.Time += DeltaTime * a.PlaybackRate;
+
+            if (a.Time >= a.Duration) {
+                a.Time = a.Loop ? fmodf(a.Time, a.Duration) : a.Duration;
+            }
+        }
+    });
+}
+
+
+void CharacterWorld::UpdateWorld(JobSystem* pJobs)
+{
+    CharacterTransform* pTransforms = Transforms.Data();
+
+    ForEachBatch(pJobs, Transforms.Size(), [pTransforms](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            CharacterTransform& t = pTransforms[i];
+
+            // Rotation around Y then translation, written out
+            float s = sinf(t.Heading);
+            float c = cosf(t.Heading);
+
+            t.World[0] = glm::vec4(c, 0.0f, -s, 0.0f);
+            t.World[1] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+            t.World[2] = glm::vec4(s, 0.0f, c, 0.0f);
+            t.World[3] = glm::vec4(t.Position, 1.0f);
+        }
+    });
+}
+
+
+void CharacterWorld::UpdateBounds(JobSystem* pJobs)
+{
+    CharacterBounds* pBounds = Bounds.Data();
+    ComponentArray<CharacterTransform>* pTransforms = &Transforms;
+    ComponentArray<CharacterBounds>* pBoundsArray = &Bounds;
+    ComponentArray<SkeletonInstance>* pSkeletons = &Skeletons;
+    ComponentArray<AnimationState>* pAnimations = &Animations;
+    SphereArray* pSpheres = &BoundSpheres;
+
+    pSpheres->Resize(Bounds.Size());
+
+    // Walks the bounds and looks the transform up through the sparse table: an index, not
+    // a pointer
+    ForEachBatch(pJobs, Bounds.Size(), [pBounds, pTransforms, pBoundsArray, pSkeletons, pAnimations, pSpheres](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            CharacterBounds& b = pBounds[i];
+            Entity e = pBoundsArray->GetEntity(i);
+            const CharacterTransform* pTransform = pTransforms->Get(e);
+            const SkeletonInstance* pSkeleton = pSkeletons->Get(e);
+            const AnimationState* pState = pAnimations->Get(e);
+
+            // Whatever pose the clip is in, it stays inside the clip's bounds
+            if (pSkeleton && pState && pState->Clip < pSkeleton->pAsset->Clips.size()) {
+                const AABB& Box = pSkeleton->pAsset->Clips[pState->Clip].Bounds;
+
+                if (!Box.IsEmpty()) {
+                    b.LocalCenter = Box.GetCenter();
+                    b.LocalRadius = glm::length(Box.GetExtent()) * 0.5f;
+                }
+            }
+
+            if (pTransform) {
+                b.Center = glm::vec3(pTransform->World * glm::vec4(b.LocalCenter, 1.0f));
+                b.Radius = b.LocalRadius;
+            }
+
+            pSpheres->Set(i, b.Center, b.Radius);
+        }
+    });
+}
+
+
+// A skeleton costs far more than a transform, smaller batches still pay off
+#define CHARACTER_POSE_MIN_BATCH (CHARACTER_MIN_BATCH / 16)
+
+
+static void SamplePose(const SkeletonInstance& s, const AnimationState* pState, glm::mat4* pPoses)
+{
+    const AnimationClip* pClip = NULL;
+
+    if (pState && pState->Clip < s.pAsset->Clips.size()) {
+        pClip = &s.pAsset->Clips[pState->Clip];
+    }
+
+    SampleClip(s.pAsset->Skel, pClip, pState ? pState->Time : 0.0f, pPoses + s.PoseOffset);
+}
+
+
+void CharacterWorld::UpdatePoses(JobSystem* pJobs)
+{
+    SkeletonInstance* pSkeletons = Skeletons.Data();
+    ComponentArray<SkeletonInstance>* pSkeletonArray = &Skeletons;
+    ComponentArray<AnimationState>* pAnimations = &Animations;
+    glm::mat4* pPoses = Poses.data();
+
+    auto SampleBatch = [pSkeletons, pSkeletonArray, pAnimations, pPoses](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            SamplePose(pSkeletons[i], pAnimations->Get(pSkeletonArray->GetEntity(i)), pPoses);
+        }
+    };
+
+    if (pJobs) {
+        pJobs->ParallelFor(Skeletons.Size(), CHARACTER_POSE_MIN_BATCH, SampleBatch);
+    }
+    else if (Skeletons.Size() > 0) {
+        SampleBatch(0, Skeletons.Size());
+    }
+}
+
+
+void CharacterWorld::UpdatePoses(const Entity* pEntities, unsigned int Count, JobSystem* pJobs)
+{
+    ComponentArray<SkeletonInstance>* pSkeletons = &Skeletons;
+    ComponentArray<AnimationState>* pAnimations = &Animations;
+    glm::mat4* pPoses = Poses.data();
+
+    auto SampleBatch = [pEntities, pSkeletons, pAnimations, pPoses](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            const SkeletonInstance* pSkeleton = pSkeletons->Get(pEntities[i]);
+
+            if (pSkeleton) {
+                SamplePose(*pSkeleton, pAnimations->Get(pEntities[i]), pPoses);
+            }
+        }
+    };
+
+    if (pJobs) {
+        pJobs->ParallelFor(Count, CHARACTER_POSE_MIN_BATCH, SampleBatch);
+    }
+    else if (Count > 0) {
+        SampleBatch(0, Count);
+    }
+}
+
+
+void CharacterWorld::UpdateTree()
+{
+    const CharacterBounds* pBounds = Bounds.Data();
+
+    for (unsigned int i = 0; i < Bounds.Size(); i++) {
+        Entity e = Bounds.GetEntity(i);
+        AABB Box = AABB::FromSphere(pBounds[i].Center, pBounds[i].Radius);
+        BVH::ProxyId* pProxy = m_Proxies.Get(e);
+
+        if (pProxy) {
+            Tree.Update(*pProxy, Box);
+        }
+        else {
+            m_Proxies.Add(e, Tree.Insert(Box, e));
+        }
+    }
+
+    Tree.Refit();
+}
+
+
+void CharacterWorld::Update(float DeltaTime, float Radius, JobSystem* pJobs)
+{
+    UpdateLocomotion(DeltaTime, Radius, pJobs);
+    UpdateAnimation(DeltaTime, pJobs);
+    UpdateWorld(pJobs);
+    UpdateBounds(pJobs);
+    UpdateTree();
+}
@@ -0,0 +1,442 @@
+#include "..//headers/Culling.h"
+#include "..//headers/JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(CULLING_SSE)
+#include <emmintrin.h>
+#endif
+
+#if defined(CULLING_AVX)
+#include <immintrin.h>
+
+// The rest of the file is built for the baseline CPU; the AVX functions are built for AVX on
+// their own and only called once HasAVX() says so. MSVC takes AVX intrinsics anywhere.
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CULLING_AVX_FUNCTION
+#else
+#define CULLING_AVX_FUNCTION __attribute__((target("avx")))
+#endif
+#endif
+
+// Bounds per job; one test is a few nanoseconds, so anything smaller is all overhead
+#define CULLING_MIN_BATCH 4096
+
+
+static unsigned int PaddedSize(unsigned int Count)
+{
+    return (Count + CULLING_PADDING - 1) / CULLING_PADDING * CULLING_PADDING;
+}
+
+
+void SphereArray::Resize(unsigned int Count)
+{
+    // The padding has a radius that no plane distance is above
+    unsigned int Padded = PaddedSize(Count);
+
+    m_X.resize(Padded, 0.0f);
+    m_Y.resize(Padded, 0.0f);
+    m_Z.resize(Padded, 0.0f);
+    m_Radius.resize(Padded);
+    std::fill(m_Radius.begin() + Count, m_Radius.end(), -FLT_MAX);
+
+    m_Size = Count;
+}
+
+
+void BoxArray::Resize(unsigned int Count)
+{
+    unsigned int Padded = PaddedSize(Count);
+
+    for (int Axis = 0; Axis < 3; Axis++) {
+        m_Center[Axis].resize(Padded, 0.0f);
+        m_Extent[Axis].resize(Padded);
+        std::fill(m_Extent[Axis].begin() + Count, m_Extent[Axis].end(), -FLT_MAX);
+    }
+
+    m_Size = Count;
+}
+
+
+void BoxArray::Set(unsigned int i, const AABB& Box)
+{
+    glm::vec3 Center = Box.GetCenter();
+    glm::vec3 Extent = Box.GetExtent() * 0.5f;
+
+    for (int Axis = 0; Axis < 3; Axis++) {
+        m_Center[Axis][i] = Center[Axis];
+        m_Extent[Axis][i] = Extent[Axis];
+    }
+}
+
+
+#if defined(CULLING_AVX)
+
+// The CPU must have AVX and the OS must save the YMM registers on a context switch
+static bool HasAVX()
+{
+#if defined(_MSC_VER)
+    int Info[4];
+    __cpuid(Info, 1);
+
+    bool OSXSave = (Info[2] & (1 << 27)) != 0;
+    bool AVX = (Info[2] & (1 << 28)) != 0;
+
+    return OSXSave && AVX && (_xgetbv(0) & 6) == 6;
+#else
+    // Checks the OS support as well
+    return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+
+#endif  /* CULLING_AVX */
+
+
+static CULL_PATH ResolvePath(CULL_PATH Path)
+{
+#if defined(CULLING_AVX)
+    static const bool AVXSupported = HasAVX();
+#else
+    const bool AVXSupported = false;
+#endif
+
+    if (Path == CULL_AVX && !AVXSupported) {
+        Path = CULL_BEST;
+    }
+
+    if (Path != CULL_BEST) {
+        return Path;
+    }
+
+    if (AVXSupported) {
+        return CULL_AVX;
+    }
+
+#if defined(CULLING_SSE)
+    return CULL_SSE;
+#else
+    return CULL_SCALAR;
+#endif
+}
+
+
+const char* GetCullPathName(CULL_PATH Path)
+{
+    switch (ResolvePath(Path)) {
+    case CULL_SCALAR:
+        return "scalar";
+    case CULL_SSE:
+        return "SSE";
+    default:
+        return "AVX";
+    }
+}
+
+
+// Scalar versions, also the tails of the SIMD ones
+
+static unsigned int CullSpheresScalar(const Frustum& f, const SphereArray& s, unsigned int Begin, unsigned int End, unsigned int* pOut)
+{
+    unsigned int n = 0;
+
+    for (unsigned int i = Begin; i < End; i++) {
+        bool Inside = true;
+
+        for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+            const glm::vec4& Plane = f.Planes[p];
+            float d = Plane.x * s.X()[i] + Plane.y * s.Y()[i] + Plane.z * s.Z()[i] + Plane.w;
+            Inside = Inside && (d >= -s.Radius()[i]);
+        }
+
+        pOut[n] = i;
+        n += Inside ? 1 : 0;
+    }
+
+    return n;
+}
+
+
+static unsigned int CullBoxesScalar(const Frustum& f, const BoxArray& b, unsigned int Begin, unsigned int End, unsigned int* pOut)
+{
+    unsigned int n = 0;
+
+    for (unsigned int i = Begin; i < End; i++) {
+        bool Inside = true;
+
+        for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+            const glm::vec4& Plane = f.Planes[p];
+
+            // Distance of the center, plus how far the box reaches along the normal
+            float d = Plane.x * b.Center(0)[i] + Plane.y * b.Center(1)[i] + Plane.z * b.Center(2)[i] + Plane.w +
+                      fabsf(Plane.x) * b.Extent(0)[i] + fabsf(Plane.y) * b.Extent(1)[i] + fabsf(Plane.z) * b.Extent(2)[i];
+            Inside = Inside && (d >= 0.0f);
+        }
+
+        pOut[n] = i;
+        n += Inside ? 1 : 0;
+    }
+
+    return n;
+}
+
+
+#if defined(CULLING_SSE)
+
+// Appends the indices of the set bits of Mask, without branches
+static inline unsigned int CompactMask(int Mask, unsigned int Base, unsigned int Width, unsigned int* pOut)
+{
+    unsigned int n = 0;
+
+    for (unsigned int k = 0; k < Width; k++) {
+        pOut[n] = Base + k;
+        n += (Mask >> k) & 1;
+    }
+
+    return n;
+}
+
+
+static unsigned int CullSpheresSSE(const Frustum& f, const SphereArray& s, unsigned int Begin, unsigned int End, unsigned int* pOut)
+{
+    __m128 Planes[Frustum::NUM_PLANES][4];
+
+    for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+        for (int c = 0; c < 4; c++) {
+            Planes[p][c] = _mm_set1_ps(f.Planes[p][c]);
+        }
+    }
+
+    unsigned int n = 0;
+    unsigned int i = Begin;
+
+    for (; i + 4 <= End; i += 4) {
+        __m128 x = _mm_loadu_ps(s.X() + i);
+        __m128 y = _mm_loadu_ps(s.Y() + i);
+        __m128 z = _mm_loadu_ps(s.Z() + i);
+        __m128 NegRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(s.Radius() + i));
+
+        __m128 Inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Planes[p][0], x), _mm_mul_ps(Planes[p][1], y)),
+                                  _mm_add_ps(_mm_mul_ps(Planes[p][2], z), Planes[p][3]));
+            Inside = _mm_and_ps(Inside, _mm_cmpge_ps(d, NegRadius));
+        }
+
+        n += CompactMask(_mm_movemask_ps(Inside), i, 4, pOut + n);
+    }
+
+    return n + CullSpheresScalar(f, s, i, End, pOut + n);
+}
+
+
+static unsigned int CullBoxesSSE(const Frustum& f, const BoxArray& b, unsigned int Begin, unsigned int End, unsigned int* pOut)
+{
+    __m128 Planes[Frustum::NUM_PLANES][4];
+    __m128 AbsNormals[Frustum::NUM_PLANES][3];
+
+    for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+        for (int c = 0; c < 4; c++) {
+            Planes[p][c] = _mm_set1_ps(f.Planes[p][c]);
+        }
+
+        for (int c = 0; c < 3; c++) {
+            AbsNormals[p][c] = _mm_set1_ps(fabsf(f.Planes[p][c]));
+        }
+    }
+
+    unsigned int n = 0;
+    unsigned int i = Begin;
+
+    for (; i + 4 <= End; i += 4) {
+        __m128 cx = _mm_loadu_ps(b.Center(0) + i);
+        __m128 cy = _mm_loadu_ps(b.Center(1) + i);
+        __m128 cz = _mm_loadu_ps(b.Center(2) + i);
+        __m128 ex = _mm_loadu_ps(b.Extent(0) + i);
+        __m128 ey = _mm_loadu_ps(b.Extent(1) + i);
+        __m128 ez = _mm_loadu_ps(b.Extent(2) + i);
+
+        __m128 Inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Planes[p][0], cx), _mm_mul_ps(Planes[p][1], cy)),
+                                  _mm_add_ps(_mm_mul_ps(Planes[p][2], cz), Planes[p][3]));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(AbsNormals[p][0], ex), _mm_mul_ps(AbsNormals[p][1], ey)),
+                                  _mm_mul_ps(AbsNormals[p][2], ez));
+            Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+        }
+
+        n += CompactMask(_mm_movemask_ps(Inside), i, 4, pOut + n);
+    }
+
+    return n + CullBoxesScalar(f, b, i, End, pOut + n);
+}
+
+#endif  /* CULLING_SSE */
+
+
+#if defined(CULLING_AVX)
+
+CULLING_AVX_FUNCTION static unsigned int CullSpheresAVX(const Frustum& f, const SphereArray& s, unsigned int Begin, unsigned int End, unsigned int* pOut)
+{
+    __m256 Planes[Frustum::NUM_PLANES][4];
+
+    for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+        for (int c = 0; c < 4; c++) {
+            Planes[p][c] = _mm256_set1_ps(f.Planes[p][c]);
+        }
+    }
+
+    unsigned int n = 0;
+    unsigned int i = Begin;
+
+    for (; i + 8 <= End; i += 8) {
+        __m256 x = _mm256_loadu_ps(s.X() + i);
+        __m256 y = _mm256_loadu_ps(s.Y() + i);
+        __m256 z = _mm256_loadu_ps(s.Z() + i);
+        __m256 NegRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(s.Radius() + i));
+
+        __m256 Inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Planes[p][0], x), _mm256_mul_ps(Planes[p][1], y)),
+                                     _mm256_add_ps(_mm256_mul_ps(Planes[p][2], z), Planes[p][3]));
+            Inside = _mm256_and_ps(Inside, _mm256_cmp_ps(d, NegRadius, _CMP_GE_OQ));
+        }
+
+        n += CompactMask(_mm256_movemask_ps(Inside), i, 8, pOut + n);
+    }
+
+    return n + CullSpheresScalar(f, s, i, End, pOut + n);
+}
+
+
+CULLING_AVX_FUNCTION static unsigned int CullBoxesAVX(const Frustum& f, const BoxArray& b, unsigned int Begin, unsigned int End, unsigned int* pOut)
+{
+    __m256 Planes[Frustum::NUM_PLANES][4];
+    __m256 AbsNormals[Frustum::NUM_PLANES][3];
+
+    for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+        for (int c = 0; c < 4; c++) {
+            Planes[p][c] = _mm256_set1_ps(f.Planes[p][c]);
+        }
+
+        for (int c = 0; c < 3; c++) {
+            AbsNormals[p][c] = _mm256_set1_ps(fabsf(f.Planes[p][c]));
+        }
+    }
+
+    unsigned int n = 0;
+    unsigned int i = Begin;
+
+    for (; i + 8 <= End; i += 8) {
+        __m256 cx = _mm256_loadu_ps(b.Center(0) + i);
+        __m256 cy = _mm256_loadu_ps(b.Center(1) + i);
+        __m256 cz = _mm256_loadu_ps(b.Center(2) + i);
+        __m256 ex = _mm256_loadu_ps(b.Extent(0) + i);
+        __m256 ey = _mm256_loadu_ps(b.Extent(1) + i);
+        __m256 ez = _mm256_loadu_ps(b.Extent(2) + i);
+
+        __m256 Inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Planes[p][0], cx), _mm256_mul_ps(Planes[p][1], cy)),
+                                     _mm256_add_ps(_mm256_mul_ps(Planes[p][2], cz), Planes[p][3]));
+            __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(AbsNormals[p][0], ex), _mm256_mul_ps(AbsNormals[p][1], ey)),
+                                     _mm256_mul_ps(AbsNormals[p][2], ez));
+            Inside = _mm256_and_ps(Inside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        n += CompactMask(_mm256_movemask_ps(Inside), i, 8, pOut + n);
+    }
+
+    return n + CullBoxesScalar(f, b, i, End, pOut + n);
+}
+
+#endif  /* CULLING_AVX */
+
+
+// Each batch compacts into its own part of pVisible, starting at its first index; the
+// parts are then moved down next to each other. A part never moves up, so one pass in
+// order is safe.
+template<typename RangeFunc>
+static unsigned int CullParallel(unsigned int Count, unsigned int* pVisible, JobSystem* pJobs, const RangeFunc& CullRange)
+{
+    if (!pJobs || Count < CULLING_MIN_BATCH * 2) {
+        return CullRange(0, Count, pVisible);
+    }
+
+    struct BatchResult {
+        unsigned int Begin;
+        unsigned int NumVisible;
+    };
+
+    std::vector<BatchResult> Batches(Count / CULLING_MIN_BATCH + 1);
+    std::atomic<unsigned int> NumBatches{ 0 };
+
+    pJobs->ParallelFor(Count, CULLING_MIN_BATCH, [&CullRange, &Batches, &NumBatches, pVisible](unsigned int Begin, unsigned int End) {
+        BatchResult Result = { Begin, CullRange(Begin, End, pVisible + Begin) };
+        Batches[NumBatches.fetch_add(1)] = Result;
+    });
+
+    Batches.resize(NumBatches.load());
+    std::sort(Batches.begin(), Batches.end(), [](const BatchResult& a, const BatchResult& b) { return a.Begin < b.Begin; });
+
+    unsigned int NumVisible = 0;
+
+    for (unsigned int i = 0; i < Batches.size(); i++) {
+        if (NumVisible != Batches[i].Begin) {
+            memmove(pVisible + NumVisible, pVisible + Batches[i].Begin, Batches[i].NumVisible * sizeof(unsigned int));
+        }
+
+        NumVisible += Batches[i].NumVisible;
+    }
+
+    return NumVisible;
+}
+
+
+unsigned int CullSpheres(const Frustum& f, const SphereArray& Spheres, unsigned int* pVisible, JobSystem* pJobs, CULL_PATH Path)
+{
+    Path = ResolvePath(Path);
+
+    return CullParallel(Spheres.Size(), pVisible, pJobs, [&f, &Spheres, Path](unsigned int Begin, unsigned int End, unsigned int* pOut) {
+        switch (Path) {
+#if defined(CULLING_AVX)
+        case CULL_AVX:
+            return CullSpheresAVX(f, Spheres, Begin, End, pOut);
+#endif
+#if defined(CULLING_SSE)
+        case CULL_SSE:
+            return CullSpheresSSE(f, Spheres, Begin, End, pOut);
+#endif
+        default:
+            return CullSpheresScalar(f, Spheres, Begin, End, pOut);
+        }
+    });
+}
+
+
+unsigned int CullBoxes(const Frustum& f, const BoxArray& Boxes, unsigned int* pVisible, JobSystem* pJobs, CULL_PATH Path)
+{
+    Path = ResolvePath(Path);
+
+    return CullParallel(Boxes.Size(), pVisible, pJobs, [&f, &Boxes, Path](unsigned int Begin, unsigned int End, unsigned int* pOut) {
+        switch (Path) {
+#if defined(CULLING_AVX)
+        case CULL_AVX:
+            return CullBoxesAVX(f, Boxes, Begin, End, pOut);
+#endif
+#if defined(CULLING_SSE)
+        case CULL_SSE:
+            return CullBoxesSSE(f, Boxes, Begin, End, pOut);
+#endif
+        default:
+            return CullBoxesScalar(f, Boxes, Begin, End, pOut);
+        }
+    });
+}
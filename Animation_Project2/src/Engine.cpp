@@ -1,13 +1,23 @@
 ﻿
 #include <glad/glad.h>
 #include "..//headers/Engine.h"
+#include "..//headers/JobSystem.h"
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <cstring>
 #include <glm/gtx/string_cast.hpp>
 
 
-#define COLOR_TEXTURE_UNIT_INDEX        0
-#define SPECULAR_EXPONENT_UNIT_INDEX       8
+#define TEXTURE_STREAMING_BUDGET        (256 * 1024 * 1024)
+#define FRAME_DATA_SIZE                 (4 * 1024 * 1024)   // Bone palettes, grown by SpawnCharacters()
+#define CHARACTER_SPACING               2.0f
+#define CHARACTER_WANDER_RADIUS         50.0f
+#define CHARACTER_PALETTE_MIN_BATCH     64
+// Walls stand in rows across the crowd, the odd rows shifted to close the gaps
+#define WALL_SIZE                       glm::vec3(10.0f, 4.0f, 0.5f)
+#define WALL_GAP                        2.0f
+#define WALLS_PER_ROW                   4
+#define WALL_ROW_SPACING                12.0f
 
 
 
@@ -34,10 +44,13 @@ Engine::Engine() {
     pointLights[0].Attenuation.Linear = 0.0f;
     pointLights[0].Attenuation.Exp = 0.0f;
 
+    pointLights[0].WorldPosition = glm::vec3(0.0f, 1.0f, 1.0f);
+
     pointLights[1].DiffuseIntensity = 0.0f;
     pointLights[1].Color = glm::vec3(0.0f, 1.0f, 1.0f);
     pointLights[1].Attenuation.Linear = 0.0f;
     pointLights[1].Attenuation.Exp = 0.2f;
+    pointLights[1].WorldPosition = glm::vec3(10.0f, 1.0f, 0.0f);
 
     spotLights[0].DiffuseIntensity = 1.0f;
     spotLights[0].Color = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -48,6 +61,8 @@ Engine::Engine() {
     spotLights[1].Color = glm::vec3(1.0f, 1.0f, 0.0f);
     spotLights[1].Attenuation.Linear = 0.01f;
     spotLights[1].Cutoff = 30.0f;
+    spotLights[1].WorldPosition = glm::vec3(0.0f, 1.0f, 0.0f);
+    spotLights[1].WorldDirection = glm::vec3(0.0f, -1.0f, 0.0f);
 }
 
 Engine::~Engine()
@@ -56,8 +71,39 @@ Engine::~Engine()
         delete pGameCamera;
     }
 
-    if (pMesh1) {
-        delete pMesh1;
+    m_Scene.PrintStats();
+    printf("Characters: %u, %llu drawn, %llu culled, %llu of them occluded\n", m_Characters.NumEntities(),
+        m_NumCharactersDrawn, m_NumCharactersCulled, m_NumCharactersOccluded);
+    m_Occlusion.PrintStats();
+    m_Characters.Tree.PrintStats("characters");
+    GetGLState().PrintStats();
+
+    if (pSkinningTech) {
+        pSkinningTech->PrintStats();
+    }
+
+    renderQueue.PrintStats();
+    m_RenderArena.PrintStats("render");
+
+    if (m_NumBindPosePalettes > 0) {
+        printf("%llu character draws fell back to the bind pose, the frame data was full\n", m_NumBindPosePalettes);
+    }
+
+    if (pFrameData) {
+        pFrameData->PrintStats("frame data");
+        delete pFrameData;
+    }
+
+    m_Resources.PrintStats();
+    m_Resources.Clear();
+
+    // Last, so that the meshes have released their textures
+    if (pTextureManager) {
+        delete pTextureManager;
+    }
+
+    if (pTextureStreamer) {
+        delete pTextureStreamer;
     }
 }
 
@@ -69,14 +115,28 @@ bool Engine::Init() {
     glm::vec3 CameraUp(0.0f, 1.0f, 0.0f);
 
     pGameCamera = new Camera(WINDOW_WIDTH, WINDOW_HEIGHT, CameraPos, CameraTarget, CameraUp);
-    pMesh1 = new SkinnedMesh();
+    m_PrevCameraState = pGameCamera->GetState();
+    pTextureStreamer = new TextureStreamer();
+    pTextureStreamer->SetMemoryBudget(TEXTURE_STREAMING_BUDGET);
 
-    if (!pMesh1->LoadMesh("res/donut/donut.obj")) {
+    pTextureManager = new TextureManager();
+    pTextureManager->SetStreamer(pTextureStreamer);
+    m_Mesh = m_Resources.LoadMesh("res/donut/donut.obj", pTextureManager);
+
+    if (m_Mesh.IsNull()) {
         printf("Mesh load failedddddddddd\n");
         return false;
     }
+
+    m_MeshNode = m_Scene.CreateNode();  // At the origin
     //////////  SKININNG PART  //////////////////
 
+    pFrameData = new StreamBuffer();
+
+    if (!pFrameData->Init(GL_UNIFORM_BUFFER, FRAME_DATA_SIZE)) {
+        return false;
+    }
+
     pSkinningTech = new SkinningTechnique();
 
     if (!pSkinningTech->Init())  // create a shader program initialize it and setup the uniforms and lightining variables
@@ -84,10 +144,11 @@ bool Engine::Init() {
         return false;
     }
 
-    pSkinningTech->Enable();  //  glUseProgram(m_shaderProg);
+    pSkinningTech->Enable();  //  glUseProgram(m_shaderProg) through the GL state cache
 
     pSkinningTech->SetTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
     pSkinningTech->SetSpecularExponentTextureUnit(SPECULAR_EXPONENT_UNIT_INDEX);
+    pSkinningTech->SetTextureArrayUnits(COLOR_ARRAY_UNIT_INDEX, SPECULAR_EXPONENT_ARRAY_UNIT_INDEX);
     pSkinningTech->SetDisplayBoneIndex(DisplayBoneIndex);
 
 
@@ -95,114 +156,489 @@ bool Engine::Init() {
 }
 
 
-//void Engine::Update(float deltaTime) {
-    // TODO: Handle character logic, camera movement, user input, and branching decisions}
+bool Engine::SpawnCharacters(const std::string& Filename, unsigned int Count)
+{
+    MeshHandle Mesh = m_Resources.LoadMesh(Filename, pTextureManager);
+    SkinnedMesh* pMesh = m_Resources.GetMesh(Mesh);
+
+    if (!pMesh) {
+        printf("Error loading character model '%s'\n", Filename.c_str());
+        return false;
+    }
+
+    std::shared_ptr<const SkeletonAsset> pAsset = pMesh->GetSkeletonAsset();
+    unsigned int Columns = (unsigned int)ceilf(sqrtf((float)Count));
+
+    for (unsigned int i = 0; i < Count; i++) {
+        Entity e = m_Characters.Create();
 
-void Engine::RenderSceneCB()
+        if (e == INVALID_ENTITY) {
+            printf("Out of entities after %u characters\n", i);
+            break;
+        }
+
+        CharacterTransform& Transform = m_Characters.Transforms.Add(e);
+        Transform.Position = glm::vec3(((float)(i % Columns) - Columns * 0.5f) * CHARACTER_SPACING, 0.0f,
+                                       -((float)(i / Columns)) * CHARACTER_SPACING);
+
+        m_Characters.AddSkeleton(e, pAsset);
+
+        // Spread over the clip so that they do not all move in step
+        AnimationState& State = m_Characters.Animations.Add(e);
+
+        if (!pAsset->Clips.empty()) {
+            State.Duration = pAsset->Clips[0].Duration > 0.0f ? pAsset->Clips[0].Duration : 1.0f;
+            State.Time = State.Duration * (float)((i * 7919u) % 1000u) / 1000.0f;
+        }
+
+        MeshRef Ref;
+        Ref.Mesh = Mesh;
+        m_Characters.Meshes.Add(e, Ref);
+
+        CharacterBounds& Sphere = m_Characters.Bounds.Add(e);
+        Sphere.LocalCenter = pMesh->GetBoundsCenter();
+        Sphere.LocalRadius = pMesh->GetBoundsRadius();
+    }
+
+    printf("%u characters of '%s', %u pose matrices\n", m_Characters.NumEntities(), Filename.c_str(), (unsigned int)m_Characters.Poses.size());
+
+    // Every character may be on screen: one BonesBlock range each per frame
+    GLsizeiptr Alignment = pFrameData->GetDefaultAlignment();
+    GLsizeiptr BlockSize = ((GLsizeiptr)sizeof(BonesBlock) + Alignment - 1) / Alignment * Alignment;
+    GLsizeiptr FrameSize = BlockSize * m_Characters.Meshes.Size();
+
+    if (FrameSize > pFrameData->GetFrameSize()) {
+        if (!pFrameData->Init(GL_UNIFORM_BUFFER, FrameSize)) {
+            printf("Error growing the frame data to %d KB\n", (int)(FrameSize / 1024));
+            return false;
+        }
+
+        printf("Frame data grown to %d KB per frame\n", (int)(pFrameData->GetFrameSize() / 1024));
+    }
+
+    return true;
+}
+
+
+bool Engine::AddWalls(const std::string& Filename, unsigned int Count)
 {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_WallMesh = m_Resources.LoadMesh(Filename, pTextureManager);
+    SkinnedMesh* pMesh = m_Resources.GetMesh(m_WallMesh);
+
+    if (!pMesh) {
+        printf("Error loading wall model '%s'\n", Filename.c_str());
+        return false;
+    }
+
+    std::vector<glm::vec3> Positions;
+    std::vector<unsigned int> Indices;
+    pMesh->GetTriangles(Positions, Indices);
+
+    AABB Box;
+
+    for (unsigned int i = 0; i < Positions.size(); i++) {
+        Box.Merge(Positions[i]);
+    }
+
+    if (Box.IsEmpty()) {
+        printf("Wall model '%s' has no vertices\n", Filename.c_str());
+        return false;
+    }
+
+    // A wall fills its bounds, so the 12 triangles of the box stand in for the model
+    std::shared_ptr<const OccluderMesh> pOccluder = CreateBoxOccluder(Box);
+
+    glm::vec3 Extent = glm::max(Box.Max - Box.Min, glm::vec3(1e-4f));
+    m_WallModel = glm::scale(glm::mat4(1.0f), 1.0f / Extent) * glm::translate(glm::mat4(1.0f), -(Box.Min + Box.Max) * 0.5f);
+
+    for (unsigned int i = 0; i < Count; i++) {
+        unsigned int Row = i / WALLS_PER_ROW;
+        float Shift = (Row & 1) ? (WALL_SIZE.x + WALL_GAP) * 0.5f : 0.0f;
+        float x = ((float)(i % WALLS_PER_ROW) - (WALLS_PER_ROW - 1) * 0.5f) * (WALL_SIZE.x + WALL_GAP) + Shift;
+
+        Scene::NodeId Node = m_Scene.CreateNode();
+        m_Scene.SetPosition(Node, glm::vec3(x, WALL_SIZE.y * 0.5f, -WALL_ROW_SPACING * (Row + 0.5f)));
+        m_Scene.SetScale(Node, WALL_SIZE);
+        m_WallNodes.push_back(Node);
+
+        Occluder Wall;
+        Wall.pMesh = pOccluder;
+        m_Occluders.push_back(Wall);
+    }
+
+    printf("%u walls of '%s', %u triangles each, occluded by their box\n", Count, Filename.c_str(), (unsigned int)Indices.size() / 3);
+
+    return true;
+}
+
+
+// Keys that move the camera, in SimulationInput::Keys
+static const struct {
+    unsigned int Bit;
+    int Key;
+} s_CameraKeys[] = {
+    { SimulationInput::KEY_FORWARD, GLFW_KEY_W },
+    { SimulationInput::KEY_BACK, GLFW_KEY_S },
+    { SimulationInput::KEY_LEFT, GLFW_KEY_A },
+    { SimulationInput::KEY_RIGHT, GLFW_KEY_D },
+    { SimulationInput::KEY_UP, GLFW_KEY_SPACE },
+    { SimulationInput::KEY_DOWN, GLFW_KEY_LEFT_SHIFT },
+};
+
+
+void Engine::GatherInput(GLFWwindow* window, SimulationInput& Input)
+{
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true); // Close window on ESC
+
+    bool ReloadKeyDown = (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS);
+
+    if (ReloadKeyDown && !m_ReloadKeyDown) {
+        m_ReloadRequested = true;
+    }
+
+    m_ReloadKeyDown = ReloadKeyDown;
+
+    Input.Keys = 0;
+
+    for (unsigned int i = 0; i < sizeof(s_CameraKeys) / sizeof(s_CameraKeys[0]); i++) {
+        if (glfwGetKey(window, s_CameraKeys[i].Key) == GLFW_PRESS) {
+            Input.Keys |= s_CameraKeys[i].Bit;
+        }
+    }
+
+    // The simulation culls with it; resizes happen on this thread
+    Input.Projection = ComputeProjection();
+
+    Input.MouseMoved = m_MouseMoved;
+    Input.MouseX = m_MouseX;
+    Input.MouseY = m_MouseY;
+    m_MouseMoved = false;
+}
+
+
+void Engine::Simulate(const SimulationInput& Input, FramePacket& Packet)
+{
+    // Mouse look is applied once per frame, before the steps
+    if (Input.MouseMoved) {
+        pGameCamera->OnMouse(Input.MouseX, Input.MouseY);
+    }
+
+    for (unsigned int i = 0; i < Input.NumSteps; i++) {
+        Step(Input);
+    }
+
+    BuildPacket(Input.Alpha, Input.Projection, Packet);
+    Packet.FrameIndex = Input.FrameIndex;
+}
+
+
+void Engine::Step(const SimulationInput& Input)
+{
+    // Everything that moves does so here, in fixed steps, never in Render()
+    m_PrevCameraState = pGameCamera->GetState();
+
+    for (unsigned int i = 0; i < sizeof(s_CameraKeys) / sizeof(s_CameraKeys[0]); i++) {
+        if (Input.Keys & s_CameraKeys[i].Bit) {
+            ProcessKey(s_CameraKeys[i].Key, GLFW_PRESS, Input.FixedStep);
+        }
+    }
+
     pGameCamera->OnRender();
 
-    glm::mat4 World = glm::mat4(1.0f);  // No translate, no rotate, no scale
+    m_Characters.Update(Input.FixedStep, CHARACTER_WANDER_RADIUS, &GetJobSystem());
 
+    m_SimulationTime += Input.FixedStep;
+}
 
-    // Get View and Projection from your camera and projection info (assuming compatible types)
-    glm::mat4 View = pGameCamera->GetMatrix();
-    glm::mat4 Projection;
-    // Replace your InitPersProjTransform with glm::perspective or your own function
 
-    float aspect;
-    if (persProjInfo.Height == 0.0f) {
-        std::cerr << "[ERROR] Projection height is zero. Setting fallback height = 1.\n";
-        aspect = 1.0f;
+void Engine::BuildPacket(float Alpha, const glm::mat4& Projection, FramePacket& Packet)
+{
+    Packet.SimulationTime = m_SimulationTime;
+    Packet.Camera = (Alpha >= 1.0f) ? pGameCamera->GetState() : Lerp(m_PrevCameraState, pGameCamera->GetState(), Alpha);
+
+    if (memcmp(&Packet.Camera, &m_PackedCameraState, sizeof(CameraState)) != 0) {
+        m_PackedCameraState = Packet.Camera;
+
+        // The first spot light is a flashlight that follows the camera
+        spotLights[0].WorldPosition = Packet.Camera.Position;
+        spotLights[0].WorldDirection = Packet.Camera.Target;
+        m_LightsVersion++;
     }
-    else {
-        aspect = persProjInfo.Width / persProjInfo.Height;
+
+    Packet.LightsVersion = m_LightsVersion;
+
+    for (unsigned int i = 0; i < SkinningTechnique::MAX_POINT_LIGHTS; i++) {
+        Packet.PointLights[i] = pointLights[i];
     }
 
-    Projection = glm::perspective(
-        glm::radians(persProjInfo.FOV),
-        persProjInfo.Width / persProjInfo.Height,
-        persProjInfo.zNear,
-        persProjInfo.zFar
-    );
+    for (unsigned int i = 0; i < SkinningTechnique::MAX_SPOT_LIGHTS; i++) {
+        Packet.SpotLights[i] = spotLights[i];
+    }
 
-    glm::mat4 WVP = Projection * View * World;
-    pSkinningTech->SetWVP(WVP);
+    // World matrices of whatever the steps moved
+    m_Scene.Update(&GetJobSystem());
 
-    // For lights, convert their world positions/directions to local space of the mesh:
-    glm::mat4 invWorld = glm::inverse(World);
+    // The render stage is done with this packet, its arena can be reused
+    Packet.Arena.Reset();
+    Packet.Meshes = FrameVector<FramePacket::MeshInstance>(FrameAllocator<FramePacket::MeshInstance>(&Packet.Arena));
 
-    // Point Lights
-    pointLights[0].WorldPosition = glm::vec3(0.0f, 1.0f, 1.0f);
-    glm::vec4 localPos = invWorld * glm::vec4(pointLights[0].WorldPosition, 1.0f);
-    pointLights[0].LocalPosition = glm::vec3(localPos);
+    FramePacket::MeshInstance Instance;
+    Instance.Mesh = m_Mesh;
+    Instance.World = m_Scene.GetWorld(m_MeshNode);
+    Packet.Meshes.push_back(Instance);
 
-    pointLights[1].WorldPosition = glm::vec3(10.0f, 1.0f, 0.0f);
-    localPos = invWorld * glm::vec4(pointLights[1].WorldPosition, 1.0f);
-    pointLights[1].LocalPosition = glm::vec3(localPos);
+    for (unsigned int i = 0; i < m_WallNodes.size(); i++) {
+        Instance.Mesh = m_WallMesh;
+        Instance.World = m_Scene.GetWorld(m_WallNodes[i]) * m_WallModel;
+        Packet.Meshes.push_back(Instance);
+
+        m_Occluders[i].World = Instance.World;
+    }
+
+    AddCharacters(Projection * Packet.Camera.GetMatrix(), Packet);
+}
 
-    pSkinningTech->SetPointLights(2, pointLights);
 
-    // Spot Lights
-    spotLights[0].WorldPosition = pGameCamera->GetPosition();
-    spotLights[0].WorldDirection = pGameCamera->GetTarget();
+// Culls the character bounds against the view and against the walls, then samples the poses
+// of the visible ones and writes one skinning palette each straight into the packet's arena
+void Engine::AddCharacters(const glm::mat4& ViewProj, FramePacket& Packet)
+{
+    unsigned int NumBounds = m_Characters.BoundSpheres.Size();
 
-    localPos = invWorld * glm::vec4(spotLights[0].WorldPosition, 1.0f);
-    glm::vec4 localDir = invWorld * glm::vec4(spotLights[0].WorldDirection, 0.0f);
+    if (m_Characters.Meshes.Size() == 0 || NumBounds == 0) {
+        return;
+    }
 
-    spotLights[0].LocalPosition = glm::vec3(localPos);
-    spotLights[0].LocalDirection = glm::normalize(glm::vec3(localDir));
+    unsigned int* pVisible = Packet.Arena.AllocateArray<unsigned int>(NumBounds);
+    unsigned int NumVisible = CullSpheres(Frustum::FromMatrix(ViewProj), m_Characters.BoundSpheres, pVisible, &GetJobSystem());
 
-    spotLights[1].WorldPosition = glm::vec3(0.0f, 1.0f, 0.0f);
-    spotLights[1].WorldDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+    // Behind a wall: no pose, no palette, no draw
+    if (!m_Occluders.empty()) {
+        m_Occlusion.Render(ViewProj, m_Occluders.data(), (unsigned int)m_Occluders.size(), &GetJobSystem());
+
+        unsigned int NumInFrustum = NumVisible;
+        NumVisible = m_Occlusion.FilterVisible(m_Characters.BoundSpheres, pVisible, NumVisible, &GetJobSystem());
+        m_NumCharactersOccluded += NumInFrustum - NumVisible;
+    }
+
+    // Packed bounds indices to the entities that have something to draw
+    Entity* pEntities = Packet.Arena.AllocateArray<Entity>(NumVisible + 1);
+    unsigned int NumEntities = 0;
+
+    for (unsigned int i = 0; i < NumVisible; i++) {
+        if (pVisible[i] >= m_Characters.Bounds.Size()) {
+            continue;
+        }
+
+        Entity e = m_Characters.Bounds.GetEntity(pVisible[i]);
+
+        if (m_Characters.Meshes.Has(e)) {
+            pEntities[NumEntities++] = e;
+        }
+    }
 
-    localPos = invWorld * glm::vec4(spotLights[1].WorldPosition, 1.0f);
-    localDir = invWorld * glm::vec4(spotLights[1].WorldDirection, 0.0f);
+    m_NumCharactersDrawn += NumEntities;
+    m_NumCharactersCulled += m_Characters.Meshes.Size() - NumEntities;
 
-    spotLights[1].LocalPosition = glm::vec3(localPos);
-    spotLights[1].LocalDirection = glm::normalize(glm::vec3(localDir));
+    m_Characters.UpdatePoses(pEntities, NumEntities, &GetJobSystem());
 
-    pSkinningTech->SetSpotLights(2, spotLights);
+    unsigned int First = (unsigned int)Packet.Meshes.size();
+    Packet.Meshes.resize(First + NumEntities);
 
-    // Material & camera local position
-    pSkinningTech->SetMaterial(pMesh1->GetMaterial());
+    FramePacket::MeshInstance* pInstances = Packet.Meshes.data() + First;
+    CharacterWorld* pCharacters = &m_Characters;
+    FrameArena* pArena = &Packet.Arena;
 
-    glm::vec4 camLocalPos4 = invWorld * glm::vec4(pGameCamera->GetPosition(), 1.0f);
-    glm::vec3 camLocalPos3 = glm::vec3(camLocalPos4);
-    pSkinningTech->SetCameraLocalPos(camLocalPos3);
+    GetJobSystem().ParallelFor(NumEntities, CHARACTER_PALETTE_MIN_BATCH, [pInstances, pEntities, pCharacters, pArena](unsigned int Begin, unsigned int End) {
+        glm::mat4* pGlobalPose = NULL;
+        unsigned int GlobalPoseSize = 0;
 
+        for (unsigned int i = Begin; i < End; i++) {
+            Entity e = pEntities[i];
+            FramePacket::MeshInstance& Instance = pInstances[i];
 
-    pMesh1->Render();
+            Instance.Mesh = pCharacters->Meshes.Get(e)->Mesh;
 
+            const CharacterTransform* pTransform = pCharacters->Transforms.Get(e);
+            Instance.World = pTransform ? pTransform->World : glm::mat4(1.0f);
 
+            const SkeletonInstance* pSkeleton = pCharacters->Skeletons.Get(e);
+
+            if (!pSkeleton) {
+                continue;
+            }
+
+            const Skeleton& Skel = pSkeleton->pAsset->Skel;
+
+            if (Skel.NumJoints() > GlobalPoseSize) {
+                GlobalPoseSize = Skel.NumJoints();
+                pGlobalPose = pArena->AllocateArray<glm::mat4>(GlobalPoseSize);
+            }
+
+            glm::mat4* pPalette = pArena->AllocateArray<glm::mat4>(Skel.NumBones());
+            ComputePalette(Skel, pCharacters->Poses.data() + pSkeleton->PoseOffset, pGlobalPose, pPalette);
+
+            Instance.pPalette = pPalette;
+            Instance.NumBones = Skel.NumBones();
+        }
+    });
 }
 
 
-#define ATTEN_STEP 0.01f
+void Engine::RenderSceneCB(float Alpha)
+{
+    BuildPacket(Alpha, ComputeProjection(), m_SerialPacket);
+    Render(m_SerialPacket);
+}
 
-#define ANGLE_STEP 1.0f
 
+void Engine::Render(const FramePacket& Packet)
+{
+    m_RenderArena.Reset();
+    GetGLState().BeginFrame();
+    pFrameData->BeginFrame();
+    m_Resources.BeginFrame();
+
+    // The packet keeps its handles, they resolve to the reloaded meshes
+    if (m_ReloadRequested) {
+        m_ReloadRequested = false;
+        m_Resources.ReloadAllMeshes();
+    }
 
-void Engine::ProcessInput(GLFWwindow* window, float deltaTime) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true); // Close window on ESC
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    const CameraState& View = Packet.Camera;
+
+    // Nothing below is sent to the GPU unless it changed since the last frame
+    bool CameraChanged = (memcmp(&View, &m_SentCameraState, sizeof(View)) != 0);
+
+    if (m_ProjectionDirty) {
+        UpdateProjection();
+        CameraChanged = true;
+    }
+
+    if (CameraChanged) {
+        m_SentCameraState = View;
+        pSkinningTech->SetCamera(m_Projection * View.GetMatrix(), View.Position);
+    }
+
+    if (Packet.LightsVersion != m_CommittedLightsVersion) {
+        pSkinningTech->SetPointLights(2, Packet.PointLights);
+        pSkinningTech->SetSpotLights(2, Packet.SpotLights);
+        pSkinningTech->CommitLights();
+        m_CommittedLightsVersion = Packet.LightsVersion;
+    }
+
+    // Stream in the mip levels the meshes need at their current screen size
+    pTextureStreamer->BeginFrame(View.Position, persProjInfo.FOV, persProjInfo.Height);
+
+    for (unsigned int i = 0; i < Packet.Meshes.size(); i++) {
+        // The mesh bounds are in model space
+        const FramePacket::MeshInstance& Instance = Packet.Meshes[i];
+        SkinnedMesh* pMesh = m_Resources.GetMesh(Instance.Mesh);
+
+        if (!pMesh) {
+            continue;
+        }
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        ProcessKey(GLFW_KEY_W, GLFW_PRESS, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        ProcessKey(GLFW_KEY_S, GLFW_PRESS, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        ProcessKey(GLFW_KEY_A, GLFW_PRESS, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        ProcessKey(GLFW_KEY_D, GLFW_PRESS, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
-        ProcessKey(GLFW_KEY_SPACE, GLFW_PRESS, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
-        ProcessKey(GLFW_KEY_LEFT_SHIFT, GLFW_PRESS, deltaTime);
+        glm::vec3 camLocalPos3 = glm::vec3(glm::inverse(Instance.World) * glm::vec4(View.Position, 1.0f));
+        pMesh->RequestTextureMips(*pTextureStreamer, camLocalPos3);
+    }
+
+    pTextureStreamer->Update(&m_RenderArena);
+
+    // Meshes only record their draws, the queue picks the submission order
+    renderQueue.BeginFrame(persProjInfo.zFar, &m_RenderArena);
+
+    for (unsigned int i = 0; i < Packet.Meshes.size(); i++) {
+        const FramePacket::MeshInstance& Instance = Packet.Meshes[i];
+        SkinnedMesh* pMesh = m_Resources.GetMesh(Instance.Mesh);
+
+        if (!pMesh) {
+            continue;
+        }
+
+        // Each palette gets its own BonesBlock range. SpawnCharacters() sized the buffer for
+        // all of them, so running out means something else took the space: say so once.
+        StreamBuffer::Allocation Bones;
+
+        if (Instance.pPalette) {
+            if (pFrameData->Allocate(sizeof(BonesBlock), Bones)) {
+                memcpy(Bones.pData, Instance.pPalette, sizeof(glm::mat4) * Instance.NumBones);
+            }
+            else if (m_NumBindPosePalettes++ == 0) {
+                printf("Frame data full: %d KB per frame, the characters past it are drawn in the bind pose\n",
+                    (int)(pFrameData->GetFrameSize() / 1024));
+            }
+        }
+
+        pMesh->AddToRenderQueue(renderQueue, pSkinningTech, Instance.World, View.Position, Bones.Buffer, Bones.Offset);
+    }
+
+    pFrameData->Flush();
+    renderQueue.Submit();
+    pFrameData->EndFrame();
+    m_Resources.EndFrame();
+}
+
+
+void Engine::UpdateProjection()
+{
+    m_Projection = ComputeProjection();
+    m_ProjectionDirty = false;
 }
 
 
+glm::mat4 Engine::ComputeProjection() const
+{
+    float aspect;
+    if (persProjInfo.Height == 0.0f) {
+        std::cerr << "[ERROR] Projection height is zero. Setting fallback height = 1.\n";
+        aspect = 1.0f;
+    }
+    else {
+        aspect = persProjInfo.Width / persProjInfo.Height;
+    }
+
+    return glm::perspective(
+        glm::radians(persProjInfo.FOV),
+        aspect,
+        persProjInfo.zNear,
+        persProjInfo.zFar
+    );
+}
+
+
+void Engine::OnResize(int Width, int Height)
+{
+    // Minimized windows report a zero sized framebuffer, keep the last projection
+    if (Width <= 0 || Height <= 0) {
+        return;
+    }
+
+    glViewport(0, 0, Width, Height);
+
+    persProjInfo.Width = (float)Width;
+    persProjInfo.Height = (float)Height;
+    m_ProjectionDirty = true;
+}
+
+
+void Engine::SetFOV(float FOV)
+{
+    if (FOV != persProjInfo.FOV) {
+        persProjInfo.FOV = FOV;
+        m_ProjectionDirty = true;
+    }
+}
+
+
+#define ATTEN_STEP 0.01f
+
+#define ANGLE_STEP 1.0f
+
+
 void Engine::ProcessKey(int key, int action, float deltaTime) {
         //outside switch
         if (pGameCamera) {
@@ -210,9 +646,18 @@ void Engine::ProcessKey(int key, int action, float deltaTime) {
         }
     }
 
+// Called from glfwPollEvents() on the main thread, the camera turns in the next Simulate()
 void Engine::ProcessMouse(double xpos, double ypos) {
-    if (pGameCamera) {
-        pGameCamera->OnMouse(static_cast<int>(xpos), static_cast<int>(ypos));
+    m_MouseX = static_cast<float>(static_cast<int>(xpos));
+    m_MouseY = static_cast<float>(static_cast<int>(ypos));
+    m_MouseMoved = true;
+}
+
+
+void Engine::FramebufferSizeCallback(GLFWwindow* window, int width, int height) {
+    Engine* engine = static_cast<Engine*>(glfwGetWindowUserPointer(window));
+    if (engine) {
+        engine->OnResize(width, height);
     }
 }
 
@@ -0,0 +1,125 @@
+#include "..//headers/FrameArena.h"
+#include "..//headers/JobSystem.h"
+#include <stdint.h>
+#include <stdio.h>
+
+
+FrameArena::FrameArena(size_t BytesPerThread)
+    : m_BlockSize(BytesPerThread)
+{
+    unsigned int NumThreads = GetJobSystem().GetNumThreads();
+
+    for (unsigned int i = 0; i < NumThreads; i++) {
+        m_Blocks.push_back(new Block());
+    }
+}
+
+
+FrameArena::~FrameArena()
+{
+    Reset();
+
+    for (unsigned int i = 0; i < m_Blocks.size(); i++) {
+        delete[] m_Blocks[i]->pData;
+        delete m_Blocks[i];
+    }
+}
+
+
+void* FrameArena::Allocate(size_t Size, size_t Alignment)
+{
+    if (Size == 0) {
+        Size = 1;
+    }
+
+    int Index = GetJobSystem().GetThreadIndex();
+
+    if (Index > 0 && (unsigned int)Index < m_Blocks.size()) {
+        return AllocateFromBlock(*m_Blocks[Index], Size, Alignment);
+    }
+
+    Block& Shared = *m_Blocks[0];
+    std::lock_guard<std::mutex> Lock(Shared.Mutex);
+
+    return AllocateFromBlock(Shared, Size, Alignment);
+}
+
+
+void* FrameArena::AllocateFromBlock(Block& b, size_t Size, size_t Alignment)
+{
+    if (!b.pData) {
+        b.pData = new unsigned char[m_BlockSize];
+    }
+
+    b.NumAllocations++;
+
+    uintptr_t Base = (uintptr_t)b.pData;
+    uintptr_t Aligned = (Base + b.Offset + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+
+    if (Aligned + Size <= Base + m_BlockSize) {
+        b.Offset = (size_t)(Aligned + Size - Base);
+        return (void*)Aligned;
+    }
+
+    // Aligned by hand, the aligned ::operator new is C++17. Reset() frees the block as it
+    // came from the heap.
+    void* p = ::operator new(Size + Alignment - 1);
+    b.Overflows.push_back(p);
+    b.OverflowBytes += Size;
+    b.NumOverflows++;
+
+    return (void*)(((uintptr_t)p + Alignment - 1) & ~(uintptr_t)(Alignment - 1));
+}
+
+
+size_t FrameArena::GetBytesUsed() const
+{
+    size_t Used = 0;
+
+    for (unsigned int i = 0; i < m_Blocks.size(); i++) {
+        Used += m_Blocks[i]->Offset + m_Blocks[i]->OverflowBytes;
+    }
+
+    return Used;
+}
+
+
+void FrameArena::Reset()
+{
+    size_t Used = GetBytesUsed();
+
+    if (Used > m_Stats.PeakBytes) {
+        m_Stats.PeakBytes = Used;
+    }
+
+    for (unsigned int i = 0; i < m_Blocks.size(); i++) {
+        Block& b = *m_Blocks[i];
+
+        for (unsigned int k = 0; k < b.Overflows.size(); k++) {
+            ::operator delete(b.Overflows[k]);
+        }
+
+        b.Overflows.clear();
+        b.Offset = 0;
+        b.OverflowBytes = 0;
+
+        m_Stats.NumAllocations += b.NumAllocations;
+        m_Stats.NumOverflows += b.NumOverflows;
+        b.NumAllocations = 0;
+        b.NumOverflows = 0;
+    }
+
+    m_Stats.NumResets++;
+}
+
+
+void FrameArena::PrintStats(const char* pName) const
+{
+    if (m_Stats.NumResets == 0) {
+        return;
+    }
+
+    printf("Frame arena '%s': %u x %.0f KB, peak %.1f KB per frame, %.1f allocations per frame, %llu overflows\n",
+        pName, (unsigned int)m_Blocks.size(), m_BlockSize / 1024.0, m_Stats.PeakBytes / 1024.0,
+        (double)m_Stats.NumAllocations / m_Stats.NumResets, m_Stats.NumOverflows);
+}
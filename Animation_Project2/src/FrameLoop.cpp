@@ -0,0 +1,128 @@
+#include "..//headers/FrameLoop.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <thread>
+
+// The OS sleep is only trusted up to this close to the deadline, the rest is spent yielding
+#define FRAME_CAP_SPIN_TIME 0.002
+
+
+void FrameLoop::Init(const Settings& s)
+{
+    m_Settings = s;
+
+    if (m_Settings.FixedStep <= 0.0) {
+        m_Settings.FixedStep = 1.0 / 60.0;
+    }
+
+    if (m_Settings.MaxStepsPerFrame == 0) {
+        m_Settings.MaxStepsPerFrame = 1;
+    }
+
+    m_Accumulator = 0.0;
+    m_Alpha = 1.0f;
+    m_FirstFrame = true;
+    m_FrameTimesMs.clear();
+    m_NumSteps = 0;
+    m_DroppedTime = 0.0;
+}
+
+
+unsigned int FrameLoop::BeginFrame()
+{
+    m_FrameStart = Clock::now();
+
+    if (m_FirstFrame) {
+        // One step so that the simulation has a state to render
+        m_FirstFrame = false;
+        m_LastFrameStart = m_FrameStart;
+        m_Accumulator = 0.0;
+        m_Alpha = 1.0f;
+        m_NumSteps++;
+        return 1;
+    }
+
+    double FrameTime = Seconds(m_FrameStart - m_LastFrameStart);
+    m_LastFrameStart = m_FrameStart;
+    m_FrameTimesMs.push_back((float)(FrameTime * 1000.0));
+
+    m_Accumulator += FrameTime;
+
+    unsigned int NumSteps = (unsigned int)(m_Accumulator / m_Settings.FixedStep);
+
+    if (NumSteps > m_Settings.MaxStepsPerFrame) {
+        m_DroppedTime += (NumSteps - m_Settings.MaxStepsPerFrame) * m_Settings.FixedStep;
+        NumSteps = m_Settings.MaxStepsPerFrame;
+        m_Accumulator = fmod(m_Accumulator, m_Settings.FixedStep) + NumSteps * m_Settings.FixedStep;
+    }
+
+    m_Accumulator -= NumSteps * m_Settings.FixedStep;
+    m_Alpha = (float)(m_Accumulator / m_Settings.FixedStep);
+    m_NumSteps += NumSteps;
+
+    return NumSteps;
+}
+
+
+void FrameLoop::EndFrame()
+{
+    if (m_Settings.MaxFPS <= 0.0) {
+        return;
+    }
+
+    Clock::time_point Deadline = m_FrameStart +
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_Settings.MaxFPS));
+
+    double Remaining = Seconds(Deadline - Clock::now());
+
+    if (Remaining > FRAME_CAP_SPIN_TIME) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(Remaining - FRAME_CAP_SPIN_TIME));
+    }
+
+    while (Clock::now() < Deadline) {
+        std::this_thread::yield();
+    }
+}
+
+
+void FrameLoop::PrintStats() const
+{
+    if (m_FrameTimesMs.empty()) {
+        return;
+    }
+
+    std::vector<float> Sorted = m_FrameTimesMs;
+    std::sort(Sorted.begin(), Sorted.end());
+
+    double Total = 0.0;
+
+    for (unsigned int i = 0; i < Sorted.size(); i++) {
+        Total += Sorted[i];
+    }
+
+    // Nearest rank
+    static const double Percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+    float Values[4];
+
+    for (unsigned int i = 0; i < 4; i++) {
+        size_t Rank = (size_t)(Percentiles[i] / 100.0 * Sorted.size() + 0.5);
+        Rank = (Rank == 0) ? 0 : Rank - 1;
+
+        if (Rank >= Sorted.size()) {
+            Rank = Sorted.size() - 1;
+        }
+
+        Values[i] = Sorted[Rank];
+    }
+
+    printf("Frame loop: %d frames, %.2f ms average (%.1f fps), %.1f steps per frame\n",
+        (int)Sorted.size(), Total / Sorted.size(), 1000.0 * Sorted.size() / Total,
+        (double)m_NumSteps / (Sorted.size() + 1));
+    printf("Frame times: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, max %.2f ms\n",
+        Values[0], Values[1], Values[2], Values[3], Sorted.back());
+
+    if (m_DroppedTime > 0.0) {
+        printf("Frame loop: %.3f s of simulation time dropped by the step limit\n", m_DroppedTime);
+    }
+}
@@ -0,0 +1,108 @@
+#include "..//headers/FramePipeline.h"
+#include <chrono>
+#include <stdio.h>
+
+
+FramePipeline::~FramePipeline()
+{
+    Flush();
+}
+
+
+bool FramePipeline::Init(const SimulateFunc& Simulate, JobSystem* pJobs)
+{
+    if (!Simulate) {
+        return false;
+    }
+
+    m_Simulate = Simulate;
+    m_pJobs = pJobs;
+
+    return true;
+}
+
+
+// Only one simulation is in flight at a time, and the main thread reads the stats after
+// waiting for it, so they need no lock
+void FramePipeline::Simulate(const SimulationInput& Input, FramePacket& Packet)
+{
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+    m_Simulate(Input, Packet);
+
+    m_Stats.SimulateTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+    m_Stats.NumFrames++;
+}
+
+
+void FramePipeline::SimulateJob(void* pData, unsigned int /*Begin*/, unsigned int /*End*/)
+{
+    FramePipeline* pPipeline = (FramePipeline*)pData;
+    pPipeline->Simulate(pPipeline->m_PendingInput, pPipeline->m_Packets[pPipeline->m_Front ^ 1]);
+}
+
+
+const FramePacket& FramePipeline::Advance(const SimulationInput& Input)
+{
+    if (!IsThreaded()) {
+        Simulate(Input, m_Packets[m_Front]);
+        return m_Packets[m_Front];
+    }
+
+    // First threaded frame: there is nothing to overlap with yet. Show the state as it is,
+    // without running the steps, and start the simulation of this frame's input at once so
+    // that the next frame has a new packet.
+    if (!m_HasFront) {
+        SimulationInput Current = Input;
+        Current.NumSteps = 0;
+        Current.MouseMoved = false;
+
+        Simulate(Current, m_Packets[m_Front]);
+        m_HasFront = true;
+
+        m_PendingInput = Input;
+        m_Kicked = true;
+        m_pJobs->Run(&FramePipeline::SimulateJob, this, &m_Counter);
+
+        return m_Packets[m_Front];
+    }
+
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+    m_pJobs->Wait(m_Counter);
+
+    m_Stats.WaitTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+
+    // The render stage is done with the front packet by now, so once the simulation of the
+    // back one has finished they can trade places
+    if (m_Kicked) {
+        m_Front ^= 1;
+    }
+
+    m_PendingInput = Input;
+    m_Kicked = true;
+    m_pJobs->Run(&FramePipeline::SimulateJob, this, &m_Counter);
+
+    return m_Packets[m_Front];
+}
+
+
+void FramePipeline::Flush()
+{
+    if (IsThreaded()) {
+        m_pJobs->Wait(m_Counter);
+    }
+}
+
+
+void FramePipeline::PrintStats() const
+{
+    if (m_Stats.NumFrames == 0) {
+        return;
+    }
+
+    printf("Frame pipeline (%s): simulation %.3f ms per frame, main thread waited %.3f ms per frame\n",
+        IsThreaded() ? "threaded" : "serial",
+        m_Stats.SimulateTimeMs / m_Stats.NumFrames,
+        m_Stats.WaitTimeMs / m_Stats.NumFrames);
+}
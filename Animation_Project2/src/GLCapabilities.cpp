@@ -0,0 +1,90 @@
+#include "..//headers/GLCapabilities.h"
+#include "..//headers/GLStateCache.h"
+#include <stdio.h>
+
+static GLCapabilities s_Capabilities;
+static GLFunctionTable s_Functions;
+
+
+static void BindTextureUnitNonDSA(GLuint Unit, GLenum Target, GLuint Texture)
+{
+    GetGLState().ActiveTexture(GL_TEXTURE0 + Unit);
+    glBindTexture(Target, Texture);
+}
+
+
+static void BindTextureUnitDSA(GLuint Unit, GLenum /*Target*/, GLuint Texture)
+{
+    glBindTextureUnit(Unit, Texture);
+}
+
+
+bool InitGLCapabilities()
+{
+    GLCapabilities& Caps = s_Capabilities;
+
+    // GLAD has already parsed GL_VERSION while loading
+    Caps.MajorVersion = GLVersion.major;
+    Caps.MinorVersion = GLVersion.minor;
+
+    if (Caps.MajorVersion == 0) {
+        fprintf(stderr, "No GL context - load GLAD before querying the capabilities\n");
+        return false;
+    }
+
+    GLint NumExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &NumExtensions);
+
+    Caps.Extensions.clear();
+
+    for (GLint i = 0; i < NumExtensions; i++) {
+        const char* pName = (const char*)glGetStringi(GL_EXTENSIONS, i);
+
+        if (pName) {
+            Caps.Extensions.insert(pName);
+        }
+    }
+
+    Caps.DirectStateAccess = Caps.IsVersionAtLeast(4, 5) || Caps.HasExtension("GL_ARB_direct_state_access");
+    // The commands pick their per draw data with BaseInstance, which is core in 4.2
+    Caps.MultiDrawIndirect = (Caps.IsVersionAtLeast(4, 3) || Caps.HasExtension("GL_ARB_multi_draw_indirect")) &&
+        (Caps.IsVersionAtLeast(4, 2) || Caps.HasExtension("GL_ARB_base_instance"));
+    Caps.BufferStorage = Caps.IsVersionAtLeast(4, 4) || Caps.HasExtension("GL_ARB_buffer_storage");
+    Caps.ShaderDrawParameters = Caps.IsVersionAtLeast(4, 6) || Caps.HasExtension("GL_ARB_shader_draw_parameters");
+    Caps.TextureCompressionS3TC = Caps.HasExtension("GL_EXT_texture_compression_s3tc");
+    Caps.TextureCompressionBPTC = Caps.IsVersionAtLeast(4, 2) || Caps.HasExtension("GL_ARB_texture_compression_bptc");
+
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &Caps.MaxArrayTextureLayers);
+    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &Caps.MaxUniformBlockSize);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &Caps.UniformBufferOffsetAlignment);
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &Caps.MaxTextureImageUnits);
+
+    // The extension string alone doesn't guarantee GLAD loaded the entry point
+    Caps.MultiDrawIndirect = Caps.MultiDrawIndirect && glMultiDrawElementsIndirect != NULL;
+    Caps.BufferStorage = Caps.BufferStorage && glBufferStorage != NULL;
+
+    if (Caps.DirectStateAccess && glBindTextureUnit) {
+        s_Functions.BindTextureUnit = BindTextureUnitDSA;
+    }
+    else {
+        s_Functions.BindTextureUnit = BindTextureUnitNonDSA;
+    }
+
+    printf("GL %d.%d (%s), %d extensions, DSA %s, multi draw indirect %s, buffer storage %s\n",
+        Caps.MajorVersion, Caps.MinorVersion, (const char*)glGetString(GL_RENDERER), NumExtensions,
+        Caps.DirectStateAccess ? "yes" : "no", Caps.MultiDrawIndirect ? "yes" : "no", Caps.BufferStorage ? "yes" : "no");
+
+    return true;
+}
+
+
+const GLCapabilities& GetGLCapabilities()
+{
+    return s_Capabilities;
+}
+
+
+const GLFunctionTable& GetGLFunctions()
+{
+    return s_Functions;
+}
@@ -0,0 +1,612 @@
+#include "..//headers/GLRecorder.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+GLRecorder* GLRecorder::s_pRecorder = NULL;
+
+#define REC GLRecorder::Get()
+
+// Every entry point the engine uses. X(name) is expanded with the GLAD names, so "glad_" ## name
+// is the function pointer and "Rec_" ## name the stub.
+#define RECORDED_GL_FUNCTIONS(X) \
+    X(glActiveTexture) X(glAttachShader) X(glBindBuffer) X(glBindBufferBase) X(glBindBufferRange) \
+    X(glBindTexture) X(glBindTextureUnit) X(glBindVertexArray) X(glBufferData) X(glBufferStorage) \
+    X(glBufferSubData) X(glClear) X(glClearColor) X(glClientWaitSync) X(glCompileShader) \
+    X(glCompressedTexImage2D) X(glCompressedTexImage3D) X(glCompressedTexSubImage3D) \
+    X(glCreateProgram) X(glCreateShader) X(glCullFace) X(glDeleteBuffers) \
+    X(glDeleteProgram) X(glDeleteShader) X(glDeleteSync) X(glDeleteTextures) X(glDeleteVertexArrays) \
+    X(glDisable) X(glDrawElementsBaseVertex) X(glEnable) X(glEnableVertexAttribArray) X(glFenceSync) \
+    X(glFrontFace) X(glGenBuffers) X(glGenTextures) X(glGenVertexArrays) X(glGenerateMipmap) \
+    X(glGetActiveUniform) X(glGetActiveUniformBlockiv) X(glGetError) X(glGetIntegerv) \
+    X(glGetProgramInfoLog) X(glGetProgramiv) X(glGetShaderInfoLog) X(glGetShaderiv) X(glGetString) \
+    X(glGetStringi) X(glGetTexImage) X(glGetUniformBlockIndex) X(glGetUniformLocation) \
+    X(glLinkProgram) X(glMapBufferRange) X(glMultiDrawElementsIndirect) X(glShaderSource) \
+    X(glTexImage2D) X(glTexImage3D) X(glTexParameteri) X(glTexSubImage3D) X(glUniform1i) \
+    X(glUniformBlockBinding) X(glUniformMatrix4fv) X(glUnmapBuffer) X(glUseProgram) \
+    X(glValidateProgram) X(glVertexAttribDivisor) X(glVertexAttribI4i) X(glVertexAttribIPointer) \
+    X(glVertexAttribPointer) X(glViewport)
+
+
+// Size of uncompressed pixel data, for the upload statistics
+static unsigned long long GetPixelDataSize(GLsizei Width, GLsizei Height, GLsizei Depth, GLenum Format, GLenum Type)
+{
+    unsigned int NumComponents = 4;
+
+    switch (Format) {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: NumComponents = 1; break;
+    case GL_RG: case GL_RG_INTEGER: NumComponents = 2; break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: NumComponents = 3; break;
+    default: break;
+    }
+
+    unsigned int ComponentSize = 1;
+
+    switch (Type) {
+    case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: ComponentSize = 2; break;
+    case GL_INT: case GL_UNSIGNED_INT: case GL_FLOAT: ComponentSize = 4; break;
+    default: break;
+    }
+
+    return (unsigned long long)Width * Height * Depth * NumComponents * ComponentSize;
+}
+
+
+static void APIENTRY Rec_glActiveTexture(GLenum texture)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glActiveTexture", "0x%x", texture);
+}
+
+static void APIENTRY Rec_glAttachShader(GLuint program, GLuint shader)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glAttachShader", "%u, %u", program, shader);
+}
+
+static void APIENTRY Rec_glBindBuffer(GLenum target, GLuint buffer)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glBindBuffer", "0x%x, %u", target, buffer);
+    REC->SetBoundBuffer(target, buffer);
+}
+
+static void APIENTRY Rec_glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glBindBufferBase", "0x%x, %u, %u", target, index, buffer);
+    REC->SetBoundBuffer(target, buffer);
+}
+
+static void APIENTRY Rec_glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glBindBufferRange", "0x%x, %u, %u, %lld, %lld", target, index, buffer, (long long)offset, (long long)size);
+    REC->SetBoundBuffer(target, buffer);
+}
+
+static void APIENTRY Rec_glBindTexture(GLenum target, GLuint texture)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glBindTexture", "0x%x, %u", target, texture);
+}
+
+static void APIENTRY Rec_glBindTextureUnit(GLuint unit, GLuint texture)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glBindTextureUnit", "%u, %u", unit, texture);
+}
+
+static void APIENTRY Rec_glBindVertexArray(GLuint array)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glBindVertexArray", "%u", array);
+}
+
+static void APIENTRY Rec_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glBufferData", "0x%x, %lld, %p, 0x%x", target, (long long)size, data, usage);
+
+    if (data) {
+        REC->AddUploadBytes(size);
+    }
+}
+
+static void APIENTRY Rec_glBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glBufferStorage", "0x%x, %lld, %p, 0x%x", target, (long long)size, data, flags);
+
+    if (data) {
+        REC->AddUploadBytes(size);
+    }
+}
+
+static void APIENTRY Rec_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glBufferSubData", "0x%x, %lld, %lld, %p", target, (long long)offset, (long long)size, data);
+    REC->AddUploadBytes(size);
+}
+
+static void APIENTRY Rec_glClear(GLbitfield mask)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glClear", "0x%x", mask);
+}
+
+static void APIENTRY Rec_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glClearColor", "%g, %g, %g, %g", red, green, blue, alpha);
+}
+
+static GLenum APIENTRY Rec_glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glClientWaitSync", "%p, 0x%x, %llu", (void*)sync, flags, (unsigned long long)timeout);
+    return GL_ALREADY_SIGNALED;
+}
+
+static void APIENTRY Rec_glCompileShader(GLuint shader)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glCompileShader", "%u", shader);
+}
+
+static void APIENTRY Rec_glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glCompressedTexImage2D", "0x%x, %d, 0x%x, %d, %d, %d, %d, %p", target, level, internalformat, width, height, border, imageSize, data);
+    REC->AddUploadBytes(imageSize);
+}
+
+static void APIENTRY Rec_glCompressedTexImage3D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLsizei imageSize, const void* data)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glCompressedTexImage3D", "0x%x, %d, 0x%x, %d, %d, %d, %d, %d, %p", target, level, internalformat, width, height, depth, border, imageSize, data);
+
+    if (data) {
+        REC->AddUploadBytes(imageSize);
+    }
+}
+
+static void APIENTRY Rec_glCompressedTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void* data)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glCompressedTexSubImage3D", "0x%x, %d, %d, %d, %d, %d, %d, %d, 0x%x, %d, %p", target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data);
+    REC->AddUploadBytes(imageSize);
+}
+
+static GLuint APIENTRY Rec_glCreateProgram()
+{
+    GLuint Name = REC->NewName();
+    REC->Record(GLRecorder::CALL_OTHER, "glCreateProgram", "= %u", Name);
+    return Name;
+}
+
+static GLuint APIENTRY Rec_glCreateShader(GLenum type)
+{
+    GLuint Name = REC->NewName();
+    REC->Record(GLRecorder::CALL_OTHER, "glCreateShader", "0x%x = %u", type, Name);
+    return Name;
+}
+
+static void APIENTRY Rec_glCullFace(GLenum mode)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glCullFace", "0x%x", mode);
+}
+
+static void GenNames(const char* pName, GLsizei n, GLuint* pNames)
+{
+    for (GLsizei i = 0; i < n; i++) {
+        pNames[i] = REC->NewName();
+    }
+
+    REC->Record(GLRecorder::CALL_OTHER, pName, "%d, first = %u", n, n > 0 ? pNames[0] : 0);
+}
+
+static void APIENTRY Rec_glDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glDeleteBuffers", "%d, first = %u", n, n > 0 ? buffers[0] : 0);
+
+    for (GLsizei i = 0; i < n; i++) {
+        REC->UnmapBuffer(buffers[i]);
+    }
+}
+
+static void APIENTRY Rec_glDeleteProgram(GLuint program)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glDeleteProgram", "%u", program);
+}
+
+static void APIENTRY Rec_glDeleteShader(GLuint shader)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glDeleteShader", "%u", shader);
+}
+
+static void APIENTRY Rec_glDeleteSync(GLsync sync)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glDeleteSync", "%p", (void*)sync);
+}
+
+static void APIENTRY Rec_glDeleteTextures(GLsizei n, const GLuint* textures)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glDeleteTextures", "%d, first = %u", n, n > 0 ? textures[0] : 0);
+}
+
+static void APIENTRY Rec_glDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glDeleteVertexArrays", "%d, first = %u", n, n > 0 ? arrays[0] : 0);
+}
+
+static void APIENTRY Rec_glDisable(GLenum cap)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glDisable", "0x%x", cap);
+}
+
+static void APIENTRY Rec_glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex)
+{
+    REC->Record(GLRecorder::CALL_DRAW, "glDrawElementsBaseVertex", "0x%x, %d, 0x%x, %p, %d", mode, count, type, indices, basevertex);
+    REC->AddSubDraws(1);
+}
+
+static void APIENTRY Rec_glEnable(GLenum cap)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glEnable", "0x%x", cap);
+}
+
+static void APIENTRY Rec_glEnableVertexAttribArray(GLuint index)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glEnableVertexAttribArray", "%u", index);
+}
+
+static GLsync APIENTRY Rec_glFenceSync(GLenum condition, GLbitfield flags)
+{
+    // Never dereferenced, it only has to be non-zero
+    GLsync Sync = (GLsync)(size_t)REC->NewName();
+    REC->Record(GLRecorder::CALL_OTHER, "glFenceSync", "0x%x, 0x%x = %p", condition, flags, (void*)Sync);
+    return Sync;
+}
+
+static void APIENTRY Rec_glFrontFace(GLenum mode)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glFrontFace", "0x%x", mode);
+}
+
+static void APIENTRY Rec_glGenBuffers(GLsizei n, GLuint* buffers)
+{
+    GenNames("glGenBuffers", n, buffers);
+}
+
+static void APIENTRY Rec_glGenTextures(GLsizei n, GLuint* textures)
+{
+    GenNames("glGenTextures", n, textures);
+}
+
+static void APIENTRY Rec_glGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    GenNames("glGenVertexArrays", n, arrays);
+}
+
+static void APIENTRY Rec_glGenerateMipmap(GLenum target)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glGenerateMipmap", "0x%x", target);
+}
+
+static void APIENTRY Rec_glGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glGetActiveUniform", "%u, %u", program, index);
+
+    if (length) *length = 0;
+    if (size) *size = 0;
+    if (type) *type = GL_FLOAT;
+    if (name && bufSize > 0) name[0] = 0;
+}
+
+static void APIENTRY Rec_glGetActiveUniformBlockiv(GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint* params)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glGetActiveUniformBlockiv", "%u, %u, 0x%x", program, uniformBlockIndex, pname);
+
+    // A size of 0 always fits whatever the C++ side uploads
+    *params = 0;
+}
+
+static GLenum APIENTRY Rec_glGetError()
+{
+    return GL_NO_ERROR;
+}
+
+static void APIENTRY Rec_glGetIntegerv(GLenum pname, GLint* data)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glGetIntegerv", "0x%x", pname);
+
+    switch (pname) {
+    case GL_MAX_ARRAY_TEXTURE_LAYERS: *data = 2048; break;
+    case GL_MAX_UNIFORM_BLOCK_SIZE: *data = 65536; break;
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: *data = 256; break;
+    case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS: *data = 32; break;
+    case GL_MAX_TEXTURE_SIZE: *data = 16384; break;
+    default: *data = 0; break;  // Includes GL_NUM_EXTENSIONS - the version alone picks the paths
+    }
+}
+
+static void APIENTRY Rec_glGetProgramInfoLog(GLuint /*program*/, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    if (length) *length = 0;
+    if (infoLog && bufSize > 0) infoLog[0] = 0;
+}
+
+static void APIENTRY Rec_glGetProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glGetProgramiv", "%u, 0x%x", program, pname);
+    *params = (pname == GL_LINK_STATUS || pname == GL_VALIDATE_STATUS) ? GL_TRUE : 0;
+}
+
+static void APIENTRY Rec_glGetShaderInfoLog(GLuint /*shader*/, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    if (length) *length = 0;
+    if (infoLog && bufSize > 0) infoLog[0] = 0;
+}
+
+static void APIENTRY Rec_glGetShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glGetShaderiv", "%u, 0x%x", shader, pname);
+    *params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+static const GLubyte* APIENTRY Rec_glGetString(GLenum name)
+{
+    switch (name) {
+    case GL_VENDOR: return (const GLubyte*)"GLRecorder";
+    case GL_RENDERER: return (const GLubyte*)"GLRecorder (no GPU)";
+    case GL_VERSION: return (const GLubyte*)"recorded";
+    default: return (const GLubyte*)"";
+    }
+}
+
+static const GLubyte* APIENTRY Rec_glGetStringi(GLenum /*name*/, GLuint /*index*/)
+{
+    return NULL;
+}
+
+static void APIENTRY Rec_glGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void* /*pixels*/)
+{
+    // The caller's buffer is left as it is, there is no texture to read back
+    REC->Record(GLRecorder::CALL_OTHER, "glGetTexImage", "0x%x, %d, 0x%x, 0x%x", target, level, format, type);
+}
+
+static GLuint APIENTRY Rec_glGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glGetUniformBlockIndex", "%u, \"%s\"", program, uniformBlockName);
+    return REC->GetUniformLocation(program, std::string("block:") + uniformBlockName);
+}
+
+static GLint APIENTRY Rec_glGetUniformLocation(GLuint program, const GLchar* name)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glGetUniformLocation", "%u, \"%s\"", program, name);
+    return (GLint)REC->GetUniformLocation(program, name);
+}
+
+static void APIENTRY Rec_glLinkProgram(GLuint program)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glLinkProgram", "%u", program);
+}
+
+static void* APIENTRY Rec_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glMapBufferRange", "0x%x, %lld, %lld, 0x%x", target, (long long)offset, (long long)length, access);
+    return (unsigned char*)REC->MapBuffer(REC->GetBoundBuffer(target), offset + length) + offset;
+}
+
+static void APIENTRY Rec_glMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride)
+{
+    REC->Record(GLRecorder::CALL_DRAW, "glMultiDrawElementsIndirect", "0x%x, 0x%x, %p, %d, %d", mode, type, indirect, drawcount, stride);
+    REC->AddSubDraws(drawcount);
+}
+
+static void APIENTRY Rec_glShaderSource(GLuint shader, GLsizei count, const GLchar* const* /*string*/, const GLint* /*length*/)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glShaderSource", "%u, %d", shader, count);
+}
+
+static void APIENTRY Rec_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glTexImage2D", "0x%x, %d, 0x%x, %d, %d, %d, 0x%x, 0x%x, %p", target, level, internalformat, width, height, border, format, type, pixels);
+
+    if (pixels) {
+        REC->AddUploadBytes(GetPixelDataSize(width, height, 1, format, type));
+    }
+}
+
+static void APIENTRY Rec_glTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glTexImage3D", "0x%x, %d, 0x%x, %d, %d, %d, %d, 0x%x, 0x%x, %p", target, level, internalformat, width, height, depth, border, format, type, pixels);
+
+    if (pixels) {
+        REC->AddUploadBytes(GetPixelDataSize(width, height, depth, format, type));
+    }
+}
+
+static void APIENTRY Rec_glTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glTexParameteri", "0x%x, 0x%x, %d", target, pname, param);
+}
+
+static void APIENTRY Rec_glTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+{
+    REC->Record(GLRecorder::CALL_UPLOAD, "glTexSubImage3D", "0x%x, %d, %d, %d, %d, %d, %d, %d, 0x%x, 0x%x, %p", target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+    REC->AddUploadBytes(GetPixelDataSize(width, height, depth, format, type));
+}
+
+static void APIENTRY Rec_glUniform1i(GLint location, GLint v0)
+{
+    REC->Record(GLRecorder::CALL_UNIFORM, "glUniform1i", "%d, %d", location, v0);
+    REC->AddUploadBytes(sizeof(GLint));
+}
+
+static void APIENTRY Rec_glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glUniformBlockBinding", "%u, %u, %u", program, uniformBlockIndex, uniformBlockBinding);
+}
+
+static void APIENTRY Rec_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* /*value*/)
+{
+    REC->Record(GLRecorder::CALL_UNIFORM, "glUniformMatrix4fv", "%d, %d, %d", location, count, transpose);
+    REC->AddUploadBytes(count * 16 * sizeof(GLfloat));
+}
+
+static GLboolean APIENTRY Rec_glUnmapBuffer(GLenum target)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glUnmapBuffer", "0x%x", target);
+    REC->UnmapBuffer(REC->GetBoundBuffer(target));
+    return GL_TRUE;
+}
+
+static void APIENTRY Rec_glUseProgram(GLuint program)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glUseProgram", "%u", program);
+}
+
+static void APIENTRY Rec_glValidateProgram(GLuint program)
+{
+    REC->Record(GLRecorder::CALL_OTHER, "glValidateProgram", "%u", program);
+}
+
+static void APIENTRY Rec_glVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glVertexAttribDivisor", "%u, %u", index, divisor);
+}
+
+static void APIENTRY Rec_glVertexAttribI4i(GLuint index, GLint x, GLint y, GLint z, GLint w)
+{
+    REC->Record(GLRecorder::CALL_UNIFORM, "glVertexAttribI4i", "%u, %d, %d, %d, %d", index, x, y, z, w);
+}
+
+static void APIENTRY Rec_glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glVertexAttribIPointer", "%u, %d, 0x%x, %d, %p", index, size, type, stride, pointer);
+}
+
+static void APIENTRY Rec_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glVertexAttribPointer", "%u, %d, 0x%x, %d, %d, %p", index, size, type, normalized, stride, pointer);
+}
+
+static void APIENTRY Rec_glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    REC->Record(GLRecorder::CALL_STATE, "glViewport", "%d, %d, %d, %d", x, y, width, height);
+}
+
+
+// The real entry points, restored by Uninstall()
+#define DECLARE_SAVED_POINTER(name) static decltype(glad_##name) s_Saved_##name = NULL;
+RECORDED_GL_FUNCTIONS(DECLARE_SAVED_POINTER)
+#undef DECLARE_SAVED_POINTER
+
+
+GLRecorder::~GLRecorder()
+{
+    Uninstall();
+}
+
+
+bool GLRecorder::Install(int MajorVersion, int MinorVersion)
+{
+    if (s_pRecorder) {
+        fprintf(stderr, "A GL recorder is already installed\n");
+        return false;
+    }
+
+    s_pRecorder = this;
+    m_Installed = true;
+
+#define INSTALL_STUB(name) s_Saved_##name = glad_##name; glad_##name = Rec_##name;
+    RECORDED_GL_FUNCTIONS(INSTALL_STUB)
+#undef INSTALL_STUB
+
+    m_SavedMajorVersion = GLVersion.major;
+    m_SavedMinorVersion = GLVersion.minor;
+    GLVersion.major = MajorVersion;
+    GLVersion.minor = MinorVersion;
+
+    return true;
+}
+
+
+void GLRecorder::Uninstall()
+{
+    if (!m_Installed) {
+        return;
+    }
+
+#define RESTORE_POINTER(name) glad_##name = s_Saved_##name;
+    RECORDED_GL_FUNCTIONS(RESTORE_POINTER)
+#undef RESTORE_POINTER
+
+    GLVersion.major = m_SavedMajorVersion;
+    GLVersion.minor = m_SavedMinorVersion;
+
+    s_pRecorder = NULL;
+    m_Installed = false;
+}
+
+
+void GLRecorder::Record(CALL_TYPE Type, const char* pName, const char* pFormat, ...)
+{
+    m_CurFrame.NumCalls[Type]++;
+
+    if (!m_Logging) {
+        return;
+    }
+
+    char Args[256];
+
+    va_list ArgList;
+    va_start(ArgList, pFormat);
+    vsnprintf(Args, sizeof(Args), pFormat, ArgList);
+    va_end(ArgList);
+
+    char Line[320];
+    snprintf(Line, sizeof(Line), "[%u] %s(%s)", (unsigned int)m_Frames.size(), pName, Args);
+
+    m_Log.push_back(Line);
+}
+
+
+void GLRecorder::EndFrame()
+{
+    m_Frames.push_back(m_CurFrame);
+    m_CurFrame = FrameStats();
+}
+
+
+void* GLRecorder::MapBuffer(GLuint Buffer, GLsizeiptr Size)
+{
+    std::vector<unsigned char>& Memory = m_MappedBuffers[Buffer];
+
+    if ((GLsizeiptr)Memory.size() < Size) {
+        Memory.resize(Size);
+    }
+
+    return Memory.data();
+}
+
+
+GLuint GLRecorder::GetUniformLocation(GLuint Program, const std::string& Name)
+{
+    std::string Key = std::to_string(Program) + ":" + Name;
+
+    auto it = m_UniformLocations.find(Key);
+
+    if (it != m_UniformLocations.end()) {
+        return it->second;
+    }
+
+    GLuint Location = static_cast<GLuint>(m_UniformLocations.size());
+    m_UniformLocations[Key] = Location;
+
+    return Location;
+}
+
+
+bool GLRecorder::WriteLog(const char* pFilename) const
+{
+    FILE* f = fopen(pFilename, "w");
+
+    if (!f) {
+        fprintf(stderr, "Unable to open '%s'\n", pFilename);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < m_Log.size(); i++) {
+        fprintf(f, "%s\n", m_Log[i].c_str());
+    }
+
+    fclose(f);
+
+    return true;
+}
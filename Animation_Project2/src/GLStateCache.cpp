@@ -0,0 +1,245 @@
+#include "..//headers/GLStateCache.h"
+#include "..//headers/GLCapabilities.h"
+#include <stdio.h>
+
+static GLStateCache s_StateCache;
+
+
+GLStateCache& GetGLState()
+{
+    return s_StateCache;
+}
+
+
+void GLStateCache::Invalidate()
+{
+    m_Program = UNKNOWN;
+    m_VAO = UNKNOWN;
+    m_ActiveTexture = UNKNOWN;
+
+    for (unsigned int i = 0; i < NUM_BUFFER_TARGETS; i++) {
+        m_Buffers[i] = UNKNOWN;
+    }
+
+    for (unsigned int i = 0; i < MAX_UNIFORM_BINDINGS; i++) {
+        m_UniformBindings[i] = UNKNOWN;
+    }
+
+    for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+        for (unsigned int j = 0; j < NUM_TEXTURE_TARGETS; j++) {
+            m_Textures[i][j] = UNKNOWN;
+        }
+    }
+}
+
+
+// Returns true if the call is redundant, otherwise records the new value
+bool GLStateCache::Filter(GLuint& Cached, GLuint Value)
+{
+    if (Cached == Value) {
+        m_FrameStats.NumFiltered++;
+        m_TotalStats.NumFiltered++;
+        return true;
+    }
+
+    Cached = Value;
+    m_FrameStats.NumIssued++;
+    m_TotalStats.NumIssued++;
+    return false;
+}
+
+
+int GLStateCache::GetTextureTargetIndex(GLenum Target)
+{
+    switch (Target) {
+    case GL_TEXTURE_2D:
+        return TEX_2D;
+    case GL_TEXTURE_2D_ARRAY:
+        return TEX_2D_ARRAY;
+    case GL_TEXTURE_CUBE_MAP:
+        return TEX_CUBE_MAP;
+    default:
+        return -1;
+    }
+}
+
+
+int GLStateCache::GetBufferTargetIndex(GLenum Target)
+{
+    switch (Target) {
+    case GL_ARRAY_BUFFER:
+        return BUF_ARRAY;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return BUF_ELEMENT_ARRAY;
+    case GL_UNIFORM_BUFFER:
+        return BUF_UNIFORM;
+    case GL_DRAW_INDIRECT_BUFFER:
+        return BUF_DRAW_INDIRECT;
+    default:
+        return -1;
+    }
+}
+
+
+void GLStateCache::UseProgram(GLuint Program)
+{
+    if (!Filter(m_Program, Program)) {
+        glUseProgram(Program);
+    }
+}
+
+
+void GLStateCache::BindVertexArray(GLuint VAO)
+{
+    if (Filter(m_VAO, VAO)) {
+        return;
+    }
+
+    glBindVertexArray(VAO);
+
+    // The element array binding is part of the VAO
+    m_Buffers[BUF_ELEMENT_ARRAY] = UNKNOWN;
+}
+
+
+void GLStateCache::BindBuffer(GLenum Target, GLuint Buffer)
+{
+    int Index = GetBufferTargetIndex(Target);
+
+    if (Index < 0) {
+        glBindBuffer(Target, Buffer);
+        return;
+    }
+
+    if (!Filter(m_Buffers[Index], Buffer)) {
+        glBindBuffer(Target, Buffer);
+    }
+}
+
+
+void GLStateCache::BindBufferBase(GLenum Target, GLuint Index, GLuint Buffer)
+{
+    if (Target != GL_UNIFORM_BUFFER || Index >= MAX_UNIFORM_BINDINGS) {
+        glBindBufferBase(Target, Index, Buffer);
+        return;
+    }
+
+    if (Filter(m_UniformBindings[Index], Buffer)) {
+        return;
+    }
+
+    glBindBufferBase(Target, Index, Buffer);
+
+    // Also binds the generic binding point
+    m_Buffers[BUF_UNIFORM] = Buffer;
+}
+
+
+void GLStateCache::BindBufferRange(GLenum Target, GLuint Index, GLuint Buffer, GLintptr Offset, GLsizeiptr Size)
+{
+    glBindBufferRange(Target, Index, Buffer, Offset, Size);
+
+    m_FrameStats.NumIssued++;
+    m_TotalStats.NumIssued++;
+
+    if (Target != GL_UNIFORM_BUFFER || Index >= MAX_UNIFORM_BINDINGS) {
+        return;
+    }
+
+    // A range is not the whole buffer, the next BindBufferBase() must not be filtered
+    m_UniformBindings[Index] = UNKNOWN;
+    m_Buffers[BUF_UNIFORM] = Buffer;
+}
+
+
+void GLStateCache::ActiveTexture(GLenum TextureUnit)
+{
+    if (!Filter(m_ActiveTexture, TextureUnit)) {
+        glActiveTexture(TextureUnit);
+    }
+}
+
+
+void GLStateCache::BindTexture(GLuint Unit, GLenum Target, GLuint Texture)
+{
+    int Index = GetTextureTargetIndex(Target);
+
+    if (Index >= 0 && Unit < MAX_TEXTURE_UNITS && Filter(m_Textures[Unit][Index], Texture)) {
+        return;
+    }
+
+    GetGLFunctions().BindTextureUnit(Unit, Target, Texture);
+}
+
+
+void GLStateCache::BindTextureForEdit(GLenum Target, GLuint Texture)
+{
+    // With DSA nothing else selects a unit, so pick the one drawing never samples from.
+    // Otherwise every edit would land on an unknown unit and flush the whole texture cache.
+    if (m_ActiveTexture == UNKNOWN || m_ActiveTexture - GL_TEXTURE0 >= MAX_TEXTURE_UNITS) {
+        ActiveTexture(GL_TEXTURE0 + EDIT_TEXTURE_UNIT);
+    }
+
+    int Index = GetTextureTargetIndex(Target);
+    GLuint Unit = m_ActiveTexture - GL_TEXTURE0;
+
+    // Targets the cache does not track cannot go stale
+    if (Index < 0 || !Filter(m_Textures[Unit][Index], Texture)) {
+        glBindTexture(Target, Texture);
+    }
+}
+
+
+void GLStateCache::OnDeleteProgram(GLuint Program)
+{
+    if (m_Program == Program) {
+        m_Program = UNKNOWN;
+    }
+}
+
+
+void GLStateCache::OnDeleteVertexArray(GLuint VAO)
+{
+    // Deleting the bound VAO reverts to VAO 0
+    if (m_VAO == VAO) {
+        m_VAO = 0;
+        m_Buffers[BUF_ELEMENT_ARRAY] = UNKNOWN;
+    }
+}
+
+
+void GLStateCache::OnDeleteBuffer(GLuint Buffer)
+{
+    for (unsigned int i = 0; i < NUM_BUFFER_TARGETS; i++) {
+        if (m_Buffers[i] == Buffer) {
+            m_Buffers[i] = 0;
+        }
+    }
+
+    for (unsigned int i = 0; i < MAX_UNIFORM_BINDINGS; i++) {
+        if (m_UniformBindings[i] == Buffer) {
+            m_UniformBindings[i] = 0;
+        }
+    }
+}
+
+
+void GLStateCache::OnDeleteTexture(GLuint Texture)
+{
+    for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+        for (unsigned int j = 0; j < NUM_TEXTURE_TARGETS; j++) {
+            if (m_Textures[i][j] == Texture) {
+                m_Textures[i][j] = 0;
+            }
+        }
+    }
+}
+
+
+void GLStateCache::PrintStats() const
+{
+    unsigned int Total = m_TotalStats.NumIssued + m_TotalStats.NumFiltered;
+
+    printf("GL state cache: %u calls issued, %u filtered (%.1f%%)\n", m_TotalStats.NumIssued, m_TotalStats.NumFiltered,
+        Total > 0 ? 100.0 * m_TotalStats.NumFiltered / Total : 0.0);
+}
@@ -0,0 +1,229 @@
+#include "..//headers/HeadlessContext.h"
+#include <stdio.h>
+
+#ifdef USE_EGL_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+
+HeadlessContext::~HeadlessContext()
+{
+    Destroy();
+}
+
+
+bool HeadlessContext::Init(int MajorVersion, int MinorVersion)
+{
+    if (InitEGL(MajorVersion, MinorVersion)) {
+        m_pBackendName = "EGL surfaceless";
+    }
+    else if (InitGLFW(MajorVersion, MinorVersion, GLFW_OSMESA_CONTEXT_API)) {
+        m_pBackendName = "GLFW OSMesa";
+    }
+    else if (InitGLFW(MajorVersion, MinorVersion, GLFW_NATIVE_CONTEXT_API)) {
+        m_pBackendName = "GLFW hidden window";
+    }
+    else {
+        fprintf(stderr, "Unable to create a headless GL %d.%d context\n", MajorVersion, MinorVersion);
+        return false;
+    }
+
+    printf("Headless context: %s, %s\n", m_pBackendName, (const char*)glGetString(GL_RENDERER));
+
+    return true;
+}
+
+
+#ifdef USE_EGL_HEADLESS
+
+bool HeadlessContext::InitEGL(int MajorVersion, int MinorVersion)
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    EGLDisplay Display = EGL_NO_DISPLAY;
+
+    if (eglGetPlatformDisplayEXT) {
+        Display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+
+    if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, NULL, NULL)) {
+        return false;
+    }
+
+    // Surfaceless, so any surface type will do (the default asks for window support)
+    const EGLint ConfigAttribs[] = {
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig Config;
+    EGLint NumConfigs = 0;
+
+    if (!eglBindAPI(EGL_OPENGL_API) ||
+        !eglChooseConfig(Display, ConfigAttribs, &Config, 1, &NumConfigs) || NumConfigs == 0) {
+        eglTerminate(Display);
+        return false;
+    }
+
+    const EGLint ContextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, MajorVersion,
+        EGL_CONTEXT_MINOR_VERSION, MinorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    EGLContext Context = eglCreateContext(Display, Config, EGL_NO_CONTEXT, ContextAttribs);
+
+    if (Context == EGL_NO_CONTEXT) {
+        eglTerminate(Display);
+        return false;
+    }
+
+    if (!eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, Context) ||
+        !gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        eglDestroyContext(Display, Context);
+        eglTerminate(Display);
+        return false;
+    }
+
+    m_EGLDisplay = Display;
+    m_EGLContext = Context;
+
+    return true;
+}
+
+#else
+
+bool HeadlessContext::InitEGL(int /*MajorVersion*/, int /*MinorVersion*/)
+{
+    return false;
+}
+
+#endif
+
+
+bool HeadlessContext::InitGLFW(int MajorVersion, int MinorVersion, int ContextAPI)
+{
+    if (!m_GLFWInitialized) {
+        if (!glfwInit()) {
+            return false;
+        }
+
+        m_GLFWInitialized = true;
+    }
+
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, ContextAPI);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, MajorVersion);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, MinorVersion);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    // The window size does not matter, nothing is drawn to it
+    m_pWindow = glfwCreateWindow(64, 64, "Skeletal Animation Capture", NULL, NULL);
+
+    if (!m_pWindow) {
+        return false;
+    }
+
+    glfwMakeContextCurrent(m_pWindow);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        glfwDestroyWindow(m_pWindow);
+        m_pWindow = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+
+void HeadlessContext::Destroy()
+{
+#ifdef USE_EGL_HEADLESS
+    if (m_EGLDisplay) {
+        eglMakeCurrent((EGLDisplay)m_EGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)m_EGLDisplay, (EGLContext)m_EGLContext);
+        eglTerminate((EGLDisplay)m_EGLDisplay);
+        m_EGLDisplay = NULL;
+        m_EGLContext = NULL;
+    }
+#endif
+
+    if (m_pWindow) {
+        glfwDestroyWindow(m_pWindow);
+        m_pWindow = NULL;
+    }
+
+    if (m_GLFWInitialized) {
+        glfwTerminate();
+        m_GLFWInitialized = false;
+    }
+
+    m_pBackendName = "none";
+}
+
+
+OffscreenTarget::~OffscreenTarget()
+{
+    if (m_FBO) {
+        glDeleteFramebuffers(1, &m_FBO);
+    }
+
+    if (m_ColorBuffer) {
+        glDeleteRenderbuffers(1, &m_ColorBuffer);
+    }
+
+    if (m_DepthBuffer) {
+        glDeleteRenderbuffers(1, &m_DepthBuffer);
+    }
+}
+
+
+bool OffscreenTarget::Init(int Width, int Height)
+{
+    m_Width = Width;
+    m_Height = Height;
+
+    glGenRenderbuffers(1, &m_ColorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_ColorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+
+    glGenRenderbuffers(1, &m_DepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height);
+
+    glGenFramebuffers(1, &m_FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer);
+
+    GLenum Status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    if (Status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Offscreen framebuffer %dx%d is incomplete: 0x%x\n", Width, Height, Status);
+        return false;
+    }
+
+    return true;
+}
+
+
+void OffscreenTarget::Bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    glViewport(0, 0, m_Width, m_Height);
+}
+
+
+void OffscreenTarget::ReadPixels(std::vector<unsigned char>& Pixels)
+{
+    Pixels.resize((size_t)m_Width * m_Height * 4);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, Pixels.data());
+}
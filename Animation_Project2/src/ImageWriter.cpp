@@ -0,0 +1,141 @@
+#include "..//headers/ImageWriter.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Largest payload of a deflate stored block
+#define MAX_STORED_BLOCK_SIZE 65535
+
+
+static unsigned int Crc32(unsigned int Crc, const unsigned char* pData, size_t Size)
+{
+    static unsigned int s_Table[256];
+    static bool s_TableReady = false;
+
+    if (!s_TableReady) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int c = i;
+
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+
+            s_Table[i] = c;
+        }
+
+        s_TableReady = true;
+    }
+
+    Crc = ~Crc;
+
+    for (size_t i = 0; i < Size; i++) {
+        Crc = s_Table[(Crc ^ pData[i]) & 0xFF] ^ (Crc >> 8);
+    }
+
+    return ~Crc;
+}
+
+
+static void PutBigEndian32(std::vector<unsigned char>& Out, unsigned int Value)
+{
+    Out.push_back((unsigned char)(Value >> 24));
+    Out.push_back((unsigned char)(Value >> 16));
+    Out.push_back((unsigned char)(Value >> 8));
+    Out.push_back((unsigned char)Value);
+}
+
+
+static void WriteChunk(FILE* f, const char* pType, const std::vector<unsigned char>& Data)
+{
+    std::vector<unsigned char> Chunk;
+    PutBigEndian32(Chunk, (unsigned int)Data.size());
+    Chunk.insert(Chunk.end(), pType, pType + 4);
+    Chunk.insert(Chunk.end(), Data.begin(), Data.end());
+
+    // The CRC covers the type and the data, not the length
+    PutBigEndian32(Chunk, Crc32(0, Chunk.data() + 4, Chunk.size() - 4));
+
+    fwrite(Chunk.data(), 1, Chunk.size(), f);
+}
+
+
+bool WritePNG(const char* pFilename, int Width, int Height, const unsigned char* pRGBA, bool FlipY)
+{
+    if (Width <= 0 || Height <= 0 || !pRGBA) {
+        return false;
+    }
+
+    // Filter type 0 (none) in front of every row
+    size_t RowSize = (size_t)Width * 4;
+    std::vector<unsigned char> Raw;
+    Raw.reserve((RowSize + 1) * Height);
+
+    for (int y = 0; y < Height; y++) {
+        const unsigned char* pRow = pRGBA + RowSize * (FlipY ? Height - 1 - y : y);
+        Raw.push_back(0);
+        Raw.insert(Raw.end(), pRow, pRow + RowSize);
+    }
+
+    // zlib stream made of stored deflate blocks
+    std::vector<unsigned char> Zlib;
+    Zlib.reserve(Raw.size() + Raw.size() / MAX_STORED_BLOCK_SIZE * 5 + 16);
+    Zlib.push_back(0x78);
+    Zlib.push_back(0x01);
+
+    unsigned int AdlerA = 1, AdlerB = 0;
+    size_t Pos = 0;
+
+    do {
+        size_t BlockSize = Raw.size() - Pos;
+
+        if (BlockSize > MAX_STORED_BLOCK_SIZE) {
+            BlockSize = MAX_STORED_BLOCK_SIZE;
+        }
+
+        bool IsLast = (Pos + BlockSize == Raw.size());
+
+        Zlib.push_back(IsLast ? 1 : 0);
+        Zlib.push_back((unsigned char)BlockSize);
+        Zlib.push_back((unsigned char)(BlockSize >> 8));
+        Zlib.push_back((unsigned char)~BlockSize);
+        Zlib.push_back((unsigned char)(~BlockSize >> 8));
+        Zlib.insert(Zlib.end(), Raw.begin() + Pos, Raw.begin() + Pos + BlockSize);
+
+        for (size_t i = Pos; i < Pos + BlockSize; i++) {
+            AdlerA = (AdlerA + Raw[i]) % 65521;
+            AdlerB = (AdlerB + AdlerA) % 65521;
+        }
+
+        Pos += BlockSize;
+    } while (Pos < Raw.size());
+
+    PutBigEndian32(Zlib, (AdlerB << 16) | AdlerA);
+
+    FILE* f = fopen(pFilename, "wb");
+
+    if (!f) {
+        fprintf(stderr, "Unable to open '%s'\n", pFilename);
+        return false;
+    }
+
+    static const unsigned char Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(Signature, 1, sizeof(Signature), f);
+
+    std::vector<unsigned char> Header;
+    PutBigEndian32(Header, (unsigned int)Width);
+    PutBigEndian32(Header, (unsigned int)Height);
+    Header.push_back(8);    // Bit depth
+    Header.push_back(6);    // Color type: RGBA
+    Header.push_back(0);    // Compression: deflate
+    Header.push_back(0);    // Filter method
+    Header.push_back(0);    // No interlace
+
+    WriteChunk(f, "IHDR", Header);
+    WriteChunk(f, "IDAT", Zlib);
+    WriteChunk(f, "IEND", std::vector<unsigned char>());
+
+    bool Ret = (ferror(f) == 0);
+    fclose(f);
+
+    return Ret;
+}
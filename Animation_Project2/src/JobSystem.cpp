@@ -0,0 +1,356 @@
+#include "..//headers/JobSystem.h"
+#include <stdio.h>
+
+// Rounds of looking for work before an idle worker goes to sleep
+#define IDLE_SPIN_COUNT 64
+
+// Set on the worker threads only, so that each one finds its own queue
+static thread_local JobSystem* t_pJobSystem = NULL;
+static thread_local int t_WorkerIndex = -1;
+
+
+bool JobSystem::WorkQueue::PushBack(const Job& j)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    if (Size == Jobs.size()) {
+        return false;
+    }
+
+    Jobs[(Head + Size) % Jobs.size()] = j;
+    Size++;
+
+    return true;
+}
+
+
+bool JobSystem::WorkQueue::PopBack(Job& j)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    if (Size == 0) {
+        return false;
+    }
+
+    Size--;
+    j = Jobs[(Head + Size) % Jobs.size()];
+
+    return true;
+}
+
+
+bool JobSystem::WorkQueue::PopFront(Job& j)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    if (Size == 0) {
+        return false;
+    }
+
+    j = Jobs[Head];
+    Head = (Head + 1) % Jobs.size();
+    Size--;
+
+    return true;
+}
+
+
+JobSystem::JobSystem(unsigned int NumWorkers)
+{
+    if (NumWorkers == 0) {
+        unsigned int NumHardwareThreads = std::thread::hardware_concurrency();
+        NumWorkers = NumHardwareThreads > 1 ? NumHardwareThreads - 1 : 1;
+    }
+
+    m_SharedQueue.Jobs.resize(QUEUE_SIZE);
+
+    for (unsigned int i = 0; i < NumWorkers; i++) {
+        WorkQueue* pQueue = new WorkQueue();
+        pQueue->Jobs.resize(QUEUE_SIZE);
+        m_Queues.push_back(pQueue);
+    }
+
+    // Only start the threads once every queue exists, they steal from each other
+    for (unsigned int i = 0; i < NumWorkers; i++) {
+        m_Workers.push_back(std::thread(&JobSystem::WorkerMain, this, i));
+    }
+}
+
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_SleepMutex);
+        m_Quit = true;
+    }
+
+    m_WakeUp.notify_all();
+
+    for (unsigned int i = 0; i < m_Workers.size(); i++) {
+        m_Workers[i].join();
+    }
+
+    for (unsigned int i = 0; i < m_Queues.size(); i++) {
+        delete m_Queues[i];
+    }
+}
+
+
+int JobSystem::GetWorkerIndex() const
+{
+    return (t_pJobSystem == this) ? t_WorkerIndex : -1;
+}
+
+
+void JobSystem::AddToCounter(JobCounter* pCounter, unsigned int NumJobs)
+{
+    if (pCounter) {
+        std::lock_guard<std::mutex> Lock(pCounter->m_Mutex);
+        pCounter->m_Count += NumJobs;
+        pCounter->m_Value.fetch_add(NumJobs, std::memory_order_relaxed);
+    }
+}
+
+
+void JobSystem::Run(JobFunc pFunc, void* pData, JobCounter* pCounter)
+{
+    Job j;
+    j.pFunc = pFunc;
+    j.pData = pData;
+    j.pCounter = pCounter;
+
+    AddToCounter(pCounter, 1);
+    Push(&j, 1);
+}
+
+
+void JobSystem::Run(const Job* pJobs, unsigned int NumJobs, JobCounter* pCounter)
+{
+    if (NumJobs == 0) {
+        return;
+    }
+
+    AddToCounter(pCounter, NumJobs);
+
+    if (!pCounter) {
+        Push(pJobs, NumJobs);
+        return;
+    }
+
+    // Push in small groups so that the workers can start before the whole batch is queued
+    Job Group[16];
+
+    for (unsigned int i = 0; i < NumJobs; i += 16) {
+        unsigned int GroupSize = (NumJobs - i < 16) ? NumJobs - i : 16;
+
+        for (unsigned int k = 0; k < GroupSize; k++) {
+            Group[k] = pJobs[i + k];
+            Group[k].pCounter = pCounter;
+        }
+
+        Push(Group, GroupSize);
+    }
+}
+
+
+void JobSystem::RunAfter(JobCounter& Dependency, JobFunc pFunc, void* pData, JobCounter* pCounter)
+{
+    Job j;
+    j.pFunc = pFunc;
+    j.pData = pData;
+    j.pCounter = pCounter;
+
+    AddToCounter(pCounter, 1);
+
+    {
+        std::lock_guard<std::mutex> Lock(Dependency.m_Mutex);
+
+        if (Dependency.m_Count > 0) {
+            Dependency.m_Continuations.push_back(j);
+            return;
+        }
+    }
+
+    Push(&j, 1);
+}
+
+
+void JobSystem::Push(const Job* pJobs, unsigned int NumJobs)
+{
+    int WorkerIndex = GetWorkerIndex();
+    WorkQueue& Queue = (WorkerIndex >= 0) ? *m_Queues[WorkerIndex] : m_SharedQueue;
+
+    for (unsigned int i = 0; i < NumJobs; i++) {
+        // Count before the job becomes visible, so that it never goes below zero
+        m_NumQueued.fetch_add(1);
+
+        if (!Queue.PushBack(pJobs[i])) {
+            // Queue full: run it right here rather than fail
+            m_NumQueued.fetch_sub(1);
+            Execute(pJobs[i]);
+        }
+    }
+
+    // Pairs with the check in WorkerMain(): either the sleeper sees the new jobs or we see it
+    if (m_NumSleeping.load() > 0) {
+        std::lock_guard<std::mutex> Lock(m_SleepMutex);
+
+        if (NumJobs == 1) {
+            m_WakeUp.notify_one();
+        }
+        else {
+            m_WakeUp.notify_all();
+        }
+    }
+}
+
+
+bool JobSystem::FindJob(int WorkerIndex, Job& j)
+{
+    if (m_NumQueued.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+
+    bool Found = false;
+    bool Stolen = false;
+
+    if (WorkerIndex >= 0) {
+        Found = m_Queues[WorkerIndex]->PopBack(j);
+    }
+
+    if (!Found) {
+        Found = m_SharedQueue.PopFront(j);
+    }
+
+    // Start with the next worker so that the thieves spread out
+    unsigned int NumQueues = (unsigned int)m_Queues.size();
+
+    for (unsigned int i = 1; !Found && i <= NumQueues; i++) {
+        unsigned int Victim = (unsigned int)(WorkerIndex + i) % NumQueues;
+
+        if ((int)Victim != WorkerIndex) {
+            Found = Stolen = m_Queues[Victim]->PopFront(j);
+        }
+    }
+
+    if (Found) {
+        m_NumQueued.fetch_sub(1);
+
+        WorkQueue& Queue = (WorkerIndex >= 0) ? *m_Queues[WorkerIndex] : m_SharedQueue;
+        Queue.NumJobs.fetch_add(1, std::memory_order_relaxed);
+
+        if (Stolen) {
+            Queue.NumSteals.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    return Found;
+}
+
+
+void JobSystem::Execute(const Job& j)
+{
+    j.pFunc(j.pData, j.Begin, j.End);
+
+    JobCounter* pCounter = j.pCounter;
+
+    if (!pCounter) {
+        return;
+    }
+
+    std::vector<Job> Continuations;
+
+    {
+        std::lock_guard<std::mutex> Lock(pCounter->m_Mutex);
+
+        if (--pCounter->m_Count == 0) {
+            Continuations.swap(pCounter->m_Continuations);
+        }
+    }
+
+    // Last touch of the counter, a waiter may destroy it right after. The continuations
+    // go after it: they may finish, and their waiter free this counter, before Push() returns.
+    pCounter->m_Value.fetch_sub(1, std::memory_order_release);
+
+    if (!Continuations.empty()) {
+        Push(Continuations.data(), (unsigned int)Continuations.size());
+    }
+}
+
+
+void JobSystem::Wait(JobCounter& Counter)
+{
+    int WorkerIndex = GetWorkerIndex();
+    Job j;
+
+    while (!Counter.IsDone()) {
+        if (FindJob(WorkerIndex, j)) {
+            Execute(j);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+void JobSystem::WorkerMain(unsigned int Index)
+{
+    t_pJobSystem = this;
+    t_WorkerIndex = (int)Index;
+
+    Job j;
+    unsigned int IdleCount = 0;
+
+    while (!m_Quit.load(std::memory_order_relaxed)) {
+        if (FindJob((int)Index, j)) {
+            Execute(j);
+            IdleCount = 0;
+            continue;
+        }
+
+        if (++IdleCount < IDLE_SPIN_COUNT) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> Lock(m_SleepMutex);
+        m_NumSleeping.fetch_add(1);
+        m_Queues[Index]->NumSleeps.fetch_add(1, std::memory_order_relaxed);
+        m_WakeUp.wait(Lock, [this] { return m_Quit.load() || m_NumQueued.load() > 0; });
+        m_NumSleeping.fetch_sub(1);
+        IdleCount = 0;
+    }
+}
+
+
+JobSystem::Stats JobSystem::GetStats() const
+{
+    Stats s;
+    s.NumJobs = m_SharedQueue.NumJobs.load(std::memory_order_relaxed);
+    s.NumSteals = m_SharedQueue.NumSteals.load(std::memory_order_relaxed);
+
+    for (unsigned int i = 0; i < m_Queues.size(); i++) {
+        s.NumJobs += m_Queues[i]->NumJobs.load(std::memory_order_relaxed);
+        s.NumSteals += m_Queues[i]->NumSteals.load(std::memory_order_relaxed);
+        s.NumSleeps += m_Queues[i]->NumSleeps.load(std::memory_order_relaxed);
+    }
+
+    return s;
+}
+
+
+void JobSystem::PrintStats() const
+{
+    Stats s = GetStats();
+
+    printf("Job system: %u threads, %llu jobs, %llu stolen, %llu worker sleeps\n",
+        GetNumThreads(), s.NumJobs, s.NumSteals, s.NumSleeps);
+}
+
+
+JobSystem& GetJobSystem()
+{
+    static JobSystem s_JobSystem;
+    return s_JobSystem;
+}
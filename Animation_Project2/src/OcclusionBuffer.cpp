@@ -0,0 +1,576 @@
+#include "..//headers/OcclusionBuffer.h"
+#include "..//headers/JobSystem.h"
+#include "..//headers/ImageWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+
+#if defined(CULLING_SSE)
+#include <emmintrin.h>
+#endif
+
+// Clip space w below this is at or behind the eye
+#define OCCLUSION_MIN_W         1e-5f
+// Triangles with less screen area than this (in pixels) cover nothing
+#define OCCLUSION_MIN_AREA      1e-6f
+// Largest depth difference (0..1) at which the triangles of a quad still count as coplanar
+#define OCCLUSION_QUAD_MAX_DEPTH_ERROR 1e-5f
+// Bounds per job in FilterVisible(); a test projects 8 corners and reads a few blocks
+#define OCCLUSION_TEST_MIN_BATCH 256
+
+const int OcclusionBuffer::WIDTH;
+const int OcclusionBuffer::HEIGHT;
+const int OcclusionBuffer::TILE_WIDTH;
+const int OcclusionBuffer::TILE_HEIGHT;
+const int OcclusionBuffer::BLOCK_SIZE;
+
+
+std::shared_ptr<const OccluderMesh> CreateBoxOccluder(const AABB& Box)
+{
+    std::shared_ptr<OccluderMesh> pMesh = std::make_shared<OccluderMesh>();
+
+    for (int i = 0; i < 8; i++) {
+        pMesh->Positions.push_back(glm::vec3((i & 1) ? Box.Max.x : Box.Min.x, (i & 2) ? Box.Max.y : Box.Min.y, (i & 4) ? Box.Max.z : Box.Min.z));
+    }
+
+    // Two triangles per face, the winding does not matter
+    static const unsigned int Faces[6][4] = {
+        { 0, 2, 6, 4 }, { 1, 3, 7, 5 },     // -x, +x
+        { 0, 1, 5, 4 }, { 2, 3, 7, 6 },     // -y, +y
+        { 0, 1, 3, 2 }, { 4, 5, 7, 6 },     // -z, +z
+    };
+
+    for (int i = 0; i < 6; i++) {
+        const unsigned int* f = Faces[i];
+        unsigned int Triangles[6] = { f[0], f[1], f[2], f[0], f[2], f[3] };
+        pMesh->Indices.insert(pMesh->Indices.end(), Triangles, Triangles + 6);
+    }
+
+    return pMesh;
+}
+
+
+OcclusionBuffer::OcclusionBuffer()
+{
+    static_assert(WIDTH % TILE_WIDTH == 0 && HEIGHT % TILE_HEIGHT == 0, "The tiles must cover the screen");
+    static_assert(TILE_WIDTH % BLOCK_SIZE == 0 && TILE_HEIGHT % BLOCK_SIZE == 0, "The blocks must not straddle tiles");
+    static_assert(TILE_WIDTH % 4 == 0, "The SSE rasterizer writes groups of 4 pixels within a tile");
+
+    m_Depth.assign(WIDTH * HEIGHT, 1.0f);
+    m_HiZ.assign(BLOCKS_X * BLOCKS_Y, 1.0f);
+}
+
+
+void OcclusionBuffer::Render(const glm::mat4& ViewProj, const Occluder* pOccluders, unsigned int NumOccluders, JobSystem* pJobs)
+{
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+    m_ViewProj = ViewProj;
+
+    SetupPolygons(ViewProj, pOccluders, NumOccluders, pJobs);
+
+    for (int i = 0; i < TILES_X * TILES_Y; i++) {
+        m_Bins[i].clear();
+    }
+
+    m_Stats.NumPolygons = 0;
+
+    for (unsigned int i = 0; i < m_Polygons.size(); i++) {
+        if (!m_PolygonValid[i]) {
+            continue;
+        }
+
+        const Polygon& t = m_Polygons[i];
+
+        for (int ty = t.MinY / TILE_HEIGHT; ty <= t.MaxY / TILE_HEIGHT; ty++) {
+            for (int tx = t.MinX / TILE_WIDTH; tx <= t.MaxX / TILE_WIDTH; tx++) {
+                m_Bins[ty * TILES_X + tx].push_back(i);
+            }
+        }
+
+        m_Stats.NumPolygons++;
+    }
+
+    // One job per tile, which clears it, draws its bin and builds its hierarchical Z
+    unsigned int NumTiles = TILES_X * TILES_Y;
+    auto RasterizeTiles = [this](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            RasterizeTile(i);
+        }
+    };
+
+    if (pJobs) {
+        pJobs->ParallelFor(NumTiles, 1, RasterizeTiles);
+    }
+    else {
+        RasterizeTiles(0, NumTiles);
+    }
+
+    m_Stats.NumTested = 0;
+    m_Stats.NumOccluded = 0;
+    m_Stats.RenderTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+}
+
+
+// Screen position and depth of a clip space vertex, false if it is at or behind the near plane
+static bool ProjectVertex(const glm::vec4& c, glm::vec2& p, float& z)
+{
+    if (c.w < OCCLUSION_MIN_W || c.z < -c.w) {
+        return false;
+    }
+
+    float InvW = 1.0f / c.w;
+    p = glm::vec2((c.x * InvW * 0.5f + 0.5f) * OcclusionBuffer::WIDTH, (c.y * InvW * 0.5f + 0.5f) * OcclusionBuffer::HEIGHT);
+    z = c.z * InvW * 0.5f + 0.5f;
+
+    return true;
+}
+
+
+// Twice the area of the triangle abc, positive when it is counter-clockwise
+static float SignedArea(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+{
+    glm::vec2 e1 = b - a;
+    glm::vec2 e2 = c - a;
+
+    return e1.x * e2.y - e1.y * e2.x;
+}
+
+
+void OcclusionBuffer::SetupPolygons(const glm::mat4& ViewProj, const Occluder* pOccluders, unsigned int NumOccluders, JobSystem* pJobs)
+{
+    m_FirstPolygon.resize(NumOccluders + 1);
+    m_FirstPolygon[0] = 0;
+
+    for (unsigned int i = 0; i < NumOccluders; i++) {
+        m_FirstPolygon[i + 1] = m_FirstPolygon[i] + (unsigned int)pOccluders[i].pMesh->Indices.size() / 3;
+    }
+
+    m_Polygons.resize(m_FirstPolygon[NumOccluders]);
+    m_PolygonValid.assign(m_Polygons.size(), 0);
+
+    auto SetupOccluders = [this, &ViewProj, pOccluders](unsigned int Begin, unsigned int End) {
+        std::vector<glm::vec4> Clip;
+
+        for (unsigned int o = Begin; o < End; o++) {
+            const OccluderMesh& Mesh = *pOccluders[o].pMesh;
+            glm::mat4 WorldViewProj = ViewProj * pOccluders[o].World;
+
+            Clip.resize(Mesh.Positions.size());
+
+            for (unsigned int i = 0; i < Mesh.Positions.size(); i++) {
+                Clip[i] = WorldViewProj * glm::vec4(Mesh.Positions[i], 1.0f);
+            }
+
+            for (unsigned int i = 0; i + 2 < Mesh.Indices.size(); i += 3) {
+                unsigned int Index = m_FirstPolygon[o] + i / 3;
+                Polygon& t = m_Polygons[Index];
+                unsigned int Indices[3] = { Mesh.Indices[i], Mesh.Indices[i + 1], Mesh.Indices[i + 2] };
+                float z[3];
+
+                // Dropping an occluder triangle only hides less, so anything that crosses
+                // the near plane goes instead of being clipped
+                bool Rejected = false;
+
+                for (int k = 0; k < 3; k++) {
+                    Rejected = Rejected || !ProjectVertex(Clip[Indices[k]], t.v[k], z[k]);
+                }
+
+                if (Rejected) {
+                    continue;
+                }
+
+                float Area = SignedArea(t.v[0], t.v[1], t.v[2]);
+
+                if (fabsf(Area) < OCCLUSION_MIN_AREA) {
+                    continue;
+                }
+
+                // Occluders are seen from both sides: flip the clockwise ones
+                if (Area < 0.0f) {
+                    std::swap(t.v[1], t.v[2]);
+                    std::swap(z[1], z[2]);
+                    std::swap(Indices[1], Indices[2]);
+                    Area = -Area;
+                }
+
+                glm::vec2 e1 = t.v[1] - t.v[0];
+                glm::vec2 e2 = t.v[2] - t.v[0];
+                float dz1 = z[1] - z[0];
+                float dz2 = z[2] - z[0];
+                t.dzdx = (dz1 * e2.y - dz2 * e1.y) / Area;
+                t.dzdy = (dz2 * e1.x - dz1 * e2.x) / Area;
+                t.z0 = z[0] - t.dzdx * t.v[0].x - t.dzdy * t.v[0].y;
+                t.NumVerts = 3;
+
+                // The next triangle's slot is left invalid when it joins this one
+                if (i + 5 < Mesh.Indices.size() && MergeQuad(t, Indices, &Mesh.Indices[i + 3], Clip.data())) {
+                    i += 3;
+                }
+
+                glm::vec2 Min = t.v[0];
+                glm::vec2 Max = t.v[0];
+
+                for (int k = 1; k < t.NumVerts; k++) {
+                    Min = glm::min(Min, t.v[k]);
+                    Max = glm::max(Max, t.v[k]);
+                }
+
+                t.MinX = std::max(0, (int)floorf(Min.x));
+                t.MinY = std::max(0, (int)floorf(Min.y));
+                t.MaxX = std::min(WIDTH - 1, (int)ceilf(Max.x));
+                t.MaxY = std::min(HEIGHT - 1, (int)ceilf(Max.y));
+
+                m_PolygonValid[Index] = (t.MinX <= t.MaxX && t.MinY <= t.MaxY) ? 1 : 0;
+            }
+        }
+    };
+
+    if (pJobs) {
+        pJobs->ParallelFor(NumOccluders, 1, SetupOccluders);
+    }
+    else if (NumOccluders > 0) {
+        SetupOccluders(0, NumOccluders);
+    }
+}
+
+
+// Faces are mostly quads split in two triangles. Drawn apart, each triangle only writes the
+// pixels it covers entirely and a strip along the shared edge is left open; drawn as one
+// polygon only its outline is. pNext joins t when it shares an edge with it, lies in the
+// same plane and makes a convex quad with it. pIndices are t's vertices, in t's order.
+bool OcclusionBuffer::MergeQuad(Polygon& t, const unsigned int* pIndices, const unsigned int* pNext, const glm::vec4* pClip)
+{
+    for (int k = 0; k < 3; k++) {
+        unsigned int a = pIndices[k];
+        unsigned int b = pIndices[(k + 1) % 3];
+        int NumShared = 0;
+        int Opposite = -1;
+
+        for (int j = 0; j < 3; j++) {
+            if (pNext[j] == a || pNext[j] == b) {
+                NumShared++;
+            }
+            else {
+                Opposite = j;
+            }
+        }
+
+        if (NumShared != 2 || Opposite < 0 || pNext[Opposite] == pIndices[(k + 2) % 3]) {
+            continue;
+        }
+
+        glm::vec2 d;
+        float z;
+
+        if (!ProjectVertex(pClip[pNext[Opposite]], d, z)) {
+            return false;
+        }
+
+        // Screen space depth is linear over a plane, so a coplanar vertex lies on t's
+        float Error = z - (t.z0 + t.dzdx * d.x + t.dzdy * d.y);
+
+        if (fabsf(Error) > OCCLUSION_QUAD_MAX_DEPTH_ERROR) {
+            return false;
+        }
+
+        glm::vec2 Quad[4] = { t.v[k], d, t.v[(k + 1) % 3], t.v[(k + 2) % 3] };
+
+        // The edge functions only describe convex polygons
+        for (int j = 0; j < 4; j++) {
+            if (SignedArea(Quad[j], Quad[(j + 1) % 4], Quad[(j + 2) % 4]) < OCCLUSION_MIN_AREA) {
+                return false;
+            }
+        }
+
+        for (int j = 0; j < 4; j++) {
+            t.v[j] = Quad[j];
+        }
+
+        // Push the plane back by the rounding error rather than let it come nearer than d
+        t.z0 += std::max(Error, 0.0f);
+        t.NumVerts = 4;
+
+        return true;
+    }
+
+    return false;
+}
+
+
+void OcclusionBuffer::RasterizeTile(unsigned int Tile)
+{
+    int TileX = (Tile % TILES_X) * TILE_WIDTH;
+    int TileY = (Tile / TILES_X) * TILE_HEIGHT;
+
+    for (int y = TileY; y < TileY + TILE_HEIGHT; y++) {
+        std::fill(m_Depth.begin() + y * WIDTH + TileX, m_Depth.begin() + y * WIDTH + TileX + TILE_WIDTH, 1.0f);
+    }
+
+    const std::vector<unsigned int>& Bin = m_Bins[Tile];
+
+    for (unsigned int i = 0; i < Bin.size(); i++) {
+        const Polygon& t = m_Polygons[Bin[i]];
+
+        RasterizePolygon(t, std::max(t.MinX, TileX), std::max(t.MinY, TileY),
+                          std::min(t.MaxX, TileX + TILE_WIDTH - 1), std::min(t.MaxY, TileY + TILE_HEIGHT - 1));
+    }
+
+    // Farthest depth of each block of the tile
+    for (int by = TileY / BLOCK_SIZE; by < (TileY + TILE_HEIGHT) / BLOCK_SIZE; by++) {
+        for (int bx = TileX / BLOCK_SIZE; bx < (TileX + TILE_WIDTH) / BLOCK_SIZE; bx++) {
+            float Farthest = 0.0f;
+
+            for (int y = by * BLOCK_SIZE; y < (by + 1) * BLOCK_SIZE; y++) {
+                const float* pRow = &m_Depth[y * WIDTH + bx * BLOCK_SIZE];
+
+                for (int x = 0; x < BLOCK_SIZE; x++) {
+                    Farthest = std::max(Farthest, pRow[x]);
+                }
+            }
+
+            m_HiZ[by * BLOCKS_X + bx] = Farthest;
+        }
+    }
+}
+
+
+// Only pixels the polygon covers entirely are written, with the farthest depth the polygon
+// has over them: the boxes are tested against every pixel they touch, so a pixel must never
+// hide more than the occluder does. Nearest depth wins. The rectangle lies within one tile.
+void OcclusionBuffer::RasterizePolygon(const Polygon& t, int MinX, int MinY, int MaxX, int MaxY)
+{
+    // Edge i runs from v[i] to v[i + 1]: E(p) = A * (p.y - a.y) - B * (p.x - a.x) is >= 0 inside.
+    // Over a pixel E is lowest at a corner, Inset below its value at the center. A triangle's
+    // fourth edge is 0 everywhere, which lets every pixel through.
+    float EdgeA[4] = {}, EdgeB[4] = {}, Inset[4] = {};
+    glm::vec2 Origin[4] = {};
+
+    for (int i = 0; i < t.NumVerts; i++) {
+        const glm::vec2& a = t.v[i];
+        const glm::vec2& b = t.v[(i + 1) % t.NumVerts];
+        EdgeA[i] = b.x - a.x;
+        EdgeB[i] = b.y - a.y;
+        Inset[i] = 0.5f * (fabsf(EdgeA[i]) + fabsf(EdgeB[i]));
+        Origin[i] = a;
+    }
+
+    // Likewise the depth plane is highest at a corner
+    float FarOffset = 0.5f * (fabsf(t.dzdx) + fabsf(t.dzdy));
+
+#if defined(CULLING_SSE)
+    // Groups of 4 pixels starting at a multiple of 4, so that a group never leaves the tile
+    int StartX = MinX & ~3;
+
+    __m128 Offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 Zero = _mm_setzero_ps();
+
+    for (int y = MinY; y <= MaxY; y++) {
+        float py = y + 0.5f;
+        float* pRow = &m_Depth[y * WIDTH];
+
+        // Per edge: E = Row - B * px
+        __m128 Row[4], B[4];
+
+        for (int i = 0; i < 4; i++) {
+            Row[i] = _mm_set1_ps(EdgeA[i] * (py - Origin[i].y) + EdgeB[i] * Origin[i].x - Inset[i]);
+            B[i] = _mm_set1_ps(EdgeB[i]);
+        }
+
+        __m128 RowZ = _mm_set1_ps(t.z0 + t.dzdy * py + FarOffset);
+        __m128 dzdx = _mm_set1_ps(t.dzdx);
+
+        for (int x = StartX; x <= MaxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), Offsets);
+
+            __m128 Inside = _mm_cmpge_ps(_mm_sub_ps(Row[0], _mm_mul_ps(B[0], px)), Zero);
+            Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_sub_ps(Row[1], _mm_mul_ps(B[1], px)), Zero));
+            Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_sub_ps(Row[2], _mm_mul_ps(B[2], px)), Zero));
+            Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_sub_ps(Row[3], _mm_mul_ps(B[3], px)), Zero));
+
+            if (_mm_movemask_ps(Inside) == 0) {
+                continue;
+            }
+
+            __m128 z = _mm_add_ps(RowZ, _mm_mul_ps(dzdx, px));
+            __m128 Old = _mm_loadu_ps(pRow + x);
+            __m128 New = _mm_min_ps(Old, z);
+
+            _mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(Inside, New), _mm_andnot_ps(Inside, Old)));
+        }
+    }
+#else
+    for (int y = MinY; y <= MaxY; y++) {
+        float py = y + 0.5f;
+        float* pRow = &m_Depth[y * WIDTH];
+
+        for (int x = MinX; x <= MaxX; x++) {
+            float px = x + 0.5f;
+            bool Inside = true;
+
+            for (int i = 0; i < t.NumVerts; i++) {
+                Inside = Inside && (EdgeA[i] * (py - Origin[i].y) - EdgeB[i] * (px - Origin[i].x) >= Inset[i]);
+            }
+
+            if (Inside) {
+                pRow[x] = std::min(pRow[x], t.z0 + t.dzdx * px + t.dzdy * py + FarOffset);
+            }
+        }
+    }
+#endif
+}
+
+
+bool OcclusionBuffer::IsRectVisible(int MinX, int MinY, int MaxX, int MaxY, float Depth) const
+{
+    for (int by = MinY / BLOCK_SIZE; by <= MaxY / BLOCK_SIZE; by++) {
+        for (int bx = MinX / BLOCK_SIZE; bx <= MaxX / BLOCK_SIZE; bx++) {
+            // Every occluder pixel of the block is nearer: hidden here
+            if (Depth > m_HiZ[by * BLOCKS_X + bx]) {
+                continue;
+            }
+
+            int x0 = std::max(MinX, bx * BLOCK_SIZE);
+            int x1 = std::min(MaxX, bx * BLOCK_SIZE + BLOCK_SIZE - 1);
+            int y0 = std::max(MinY, by * BLOCK_SIZE);
+            int y1 = std::min(MaxY, by * BLOCK_SIZE + BLOCK_SIZE - 1);
+
+            for (int y = y0; y <= y1; y++) {
+                const float* pRow = &m_Depth[y * WIDTH];
+
+                for (int x = x0; x <= x1; x++) {
+                    if (Depth <= pRow[x]) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+
+bool OcclusionBuffer::TestBox(const AABB& Box) const
+{
+    glm::vec2 Min(FLT_MAX);
+    glm::vec2 Max(-FLT_MAX);
+    float Nearest = FLT_MAX;
+
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 Corner((i & 1) ? Box.Max.x : Box.Min.x, (i & 2) ? Box.Max.y : Box.Min.y, (i & 4) ? Box.Max.z : Box.Min.z);
+        glm::vec4 c = m_ViewProj * glm::vec4(Corner, 1.0f);
+
+        // Reaches the eye or the near plane, nothing can be in front of it
+        if (c.w < OCCLUSION_MIN_W || c.z < -c.w) {
+            return true;
+        }
+
+        float InvW = 1.0f / c.w;
+        glm::vec2 p((c.x * InvW * 0.5f + 0.5f) * WIDTH, (c.y * InvW * 0.5f + 0.5f) * HEIGHT);
+
+        Min = glm::min(Min, p);
+        Max = glm::max(Max, p);
+        Nearest = std::min(Nearest, c.z * InvW * 0.5f + 0.5f);
+    }
+
+    int MinX = std::max(0, (int)floorf(Min.x));
+    int MinY = std::max(0, (int)floorf(Min.y));
+    int MaxX = std::min(WIDTH - 1, (int)floorf(Max.x));
+    int MaxY = std::min(HEIGHT - 1, (int)floorf(Max.y));
+
+    // Off the screen: not for this buffer to say
+    if (MinX > MaxX || MinY > MaxY) {
+        return true;
+    }
+
+    return IsRectVisible(MinX, MinY, MaxX, MaxY, Nearest);
+}
+
+
+bool OcclusionBuffer::IsVisible(const AABB& Box)
+{
+    bool Visible = TestBox(Box);
+
+    m_Stats.NumTested++;
+    m_Stats.TotalTested++;
+
+    if (!Visible) {
+        m_Stats.NumOccluded++;
+        m_Stats.TotalOccluded++;
+    }
+
+    return Visible;
+}
+
+
+unsigned int OcclusionBuffer::FilterVisible(const SphereArray& Spheres, unsigned int* pIndices, unsigned int Count, JobSystem* pJobs)
+{
+    // Keeps its capacity from frame to frame
+    m_Visible.resize(Count);
+
+    auto TestBatch = [this, &Spheres, pIndices](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            unsigned int s = pIndices[i];
+            glm::vec3 Center(Spheres.X()[s], Spheres.Y()[s], Spheres.Z()[s]);
+            m_Visible[i] = TestBox(AABB::FromSphere(Center, Spheres.Radius()[s])) ? 1 : 0;
+        }
+    };
+
+    if (pJobs) {
+        pJobs->ParallelFor(Count, OCCLUSION_TEST_MIN_BATCH, TestBatch);
+    }
+    else if (Count > 0) {
+        TestBatch(0, Count);
+    }
+
+    unsigned int NumVisible = 0;
+
+    for (unsigned int i = 0; i < Count; i++) {
+        pIndices[NumVisible] = pIndices[i];
+        NumVisible += m_Visible[i];
+    }
+
+    m_Stats.NumTested += Count;
+    m_Stats.NumOccluded += Count - NumVisible;
+    m_Stats.TotalTested += Count;
+    m_Stats.TotalOccluded += Count - NumVisible;
+
+    return NumVisible;
+}
+
+
+bool OcclusionBuffer::WriteDepthImage(const char* pFilename) const
+{
+    // Depth is far from linear, stretch whatever the occluders cover over the grey levels
+    float Nearest = 1.0f;
+
+    for (unsigned int i = 0; i < m_Depth.size(); i++) {
+        Nearest = std::min(Nearest, m_Depth[i]);
+    }
+
+    float Range = std::max(1.0f - Nearest, 1e-6f);
+    std::vector<unsigned char> Pixels(WIDTH * HEIGHT * 4);
+
+    for (unsigned int i = 0; i < m_Depth.size(); i++) {
+        unsigned char Grey = (m_Depth[i] >= 1.0f) ? 0 : (unsigned char)(64.0f + 191.0f * (1.0f - (m_Depth[i] - Nearest) / Range));
+
+        Pixels[i * 4 + 0] = Grey;
+        Pixels[i * 4 + 1] = Grey;
+        Pixels[i * 4 + 2] = Grey;
+        Pixels[i * 4 + 3] = 255;
+    }
+
+    // Row 0 is the bottom one
+    return WritePNG(pFilename, WIDTH, HEIGHT, Pixels.data(), true);
+}
+
+
+void OcclusionBuffer::PrintStats() const
+{
+    double Percent = m_Stats.TotalTested ? 100.0 * m_Stats.TotalOccluded / m_Stats.TotalTested : 0.0;
+
+    printf("Occlusion: %d x %d, last render %u polygons in %.3f ms, %llu of %llu tests occluded (%.1f%%)\n",
+        WIDTH, HEIGHT, m_Stats.NumPolygons, m_Stats.RenderTimeMs, m_Stats.TotalOccluded, m_Stats.TotalTested, Percent);
+}
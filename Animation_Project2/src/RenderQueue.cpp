@@ -0,0 +1,279 @@
+#include "..//headers/RenderQueue.h"
+#include "..//headers/SkinningTechnique.h"
+#include "..//headers/TextureArray.h"
+#include "..//headers/GLStateCache.h"
+#include <stdio.h>
+#include <utility>
+
+#define PROGRAM_KEY_BITS    12
+#define MATERIAL_KEY_BITS   20
+#define VAO_KEY_BITS        12
+#define DEPTH_KEY_BITS      20
+
+#define DEPTH_KEY_SHIFT     0
+#define VAO_KEY_SHIFT       (DEPTH_KEY_SHIFT + DEPTH_KEY_BITS)
+#define MATERIAL_KEY_SHIFT  (VAO_KEY_SHIFT + VAO_KEY_BITS)
+#define PROGRAM_KEY_SHIFT   (MATERIAL_KEY_SHIFT + MATERIAL_KEY_BITS)
+
+static_assert(PROGRAM_KEY_SHIFT + PROGRAM_KEY_BITS == 64, "The sort key fields must fill 64 bits");
+
+
+unsigned int RenderQueue::NewMaterialId()
+{
+    // 0 is left for packets without a material
+    static unsigned int s_NextId = 1;
+
+    unsigned int Id = s_NextId;
+    s_NextId = (s_NextId + 1) & ((1u << MATERIAL_KEY_BITS) - 1);
+
+    if (s_NextId == 0) {
+        s_NextId = 1;
+    }
+
+    return Id;
+}
+
+
+uint64_t RenderQueue::MakeSortKey(GLuint Program, unsigned int MaterialId, GLuint VAO, float Depth01)
+{
+    if (Depth01 < 0.0f) {
+        Depth01 = 0.0f;
+    }
+    else if (Depth01 > 1.0f) {
+        Depth01 = 1.0f;
+    }
+
+    uint64_t Depth = (uint64_t)(Depth01 * (float)((1u << DEPTH_KEY_BITS) - 1));
+
+    // GL names are small integers so the low bits are enough to tell them apart. A collision
+    // only costs a redundant state change, never a wrong one.
+    return ((uint64_t)(Program & ((1u << PROGRAM_KEY_BITS) - 1)) << PROGRAM_KEY_SHIFT) |
+           ((uint64_t)(MaterialId & ((1u << MATERIAL_KEY_BITS) - 1)) << MATERIAL_KEY_SHIFT) |
+           ((uint64_t)(VAO & ((1u << VAO_KEY_BITS) - 1)) << VAO_KEY_SHIFT) |
+           (Depth << DEPTH_KEY_SHIFT);
+}
+
+
+void RenderQueue::BeginFrame(float MaxDepth, FrameArena* pArena)
+{
+    m_MaxDepth = MaxDepth > 0.0f ? MaxDepth : 1.0f;
+
+    if (pArena) {
+        // Fresh containers on this frame's memory, sized for the busiest frame so far so
+        // that they do not leave dead copies behind in the arena as they grow
+        m_Packets = FrameVector<DrawPacket>(FrameAllocator<DrawPacket>(pArena));
+        m_Keys = FrameVector<SortEntry>(FrameAllocator<SortEntry>(pArena));
+        m_SortScratch = FrameVector<SortEntry>(FrameAllocator<SortEntry>(pArena));
+
+        m_Packets.reserve(m_PeakPackets);
+        m_Keys.reserve(m_PeakPackets);
+    }
+    else {
+        m_Packets.clear();
+        m_Keys.clear();
+    }
+
+    m_FrameStats = Stats();
+}
+
+
+void RenderQueue::Add(const DrawPacket& Packet)
+{
+    SortEntry Entry;
+    Entry.Key = MakeSortKey(Packet.pTechnique->GetProgram(),
+                            Packet.pMaterial ? Packet.pMaterial->renderId : 0,
+                            Packet.VAO,
+                            Packet.Depth / m_MaxDepth);
+    Entry.PacketIndex = static_cast<unsigned int>(m_Packets.size());
+
+    m_Packets.push_back(Packet);
+    m_Keys.push_back(Entry);
+}
+
+
+// LSD radix sort, one byte per pass. Passes where every key has the same byte are skipped,
+// which is most of them when a frame only uses a few programs and materials.
+void RenderQueue::Sort()
+{
+    size_t NumKeys = m_Keys.size();
+
+    if (NumKeys < 2) {
+        return;
+    }
+
+    m_SortScratch.resize(NumKeys);
+
+    SortEntry* pSrc = m_Keys.data();
+    SortEntry* pDst = m_SortScratch.data();
+
+    for (unsigned int Shift = 0; Shift < 64; Shift += 8) {
+        size_t Counts[256] = { 0 };
+
+        for (size_t i = 0; i < NumKeys; i++) {
+            Counts[(pSrc[i].Key >> Shift) & 0xFF]++;
+        }
+
+        if (Counts[(pSrc[0].Key >> Shift) & 0xFF] == NumKeys) {
+            continue;
+        }
+
+        size_t Offset = 0;
+
+        for (unsigned int i = 0; i < 256; i++) {
+            size_t Count = Counts[i];
+            Counts[i] = Offset;
+            Offset += Count;
+        }
+
+        for (size_t i = 0; i < NumKeys; i++) {
+            pDst[Counts[(pSrc[i].Key >> Shift) & 0xFF]++] = pSrc[i];
+        }
+
+        std::swap(pSrc, pDst);
+    }
+
+    if (pSrc != m_Keys.data()) {
+        m_Keys.swap(m_SortScratch);
+    }
+}
+
+
+void RenderQueue::BindMaterial(const DrawPacket& Packet)
+{
+    // Packed textures are shared by every sub-mesh of a model
+    if (Packet.pDiffuseArray && Packet.pDiffuseArray->NumLayers() > 0) {
+        Packet.pDiffuseArray->Bind(GL_TEXTURE0 + COLOR_ARRAY_UNIT_INDEX);
+    }
+
+    if (Packet.pSpecularArray && Packet.pSpecularArray->NumLayers() > 0) {
+        Packet.pSpecularArray->Bind(GL_TEXTURE0 + SPECULAR_EXPONENT_ARRAY_UNIT_INDEX);
+    }
+
+    if (Packet.MaterialTable != 0) {
+        GetGLState().BindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_TABLE_BLOCK_BINDING, Packet.MaterialTable);
+    }
+
+    if (!Packet.pMaterial) {
+        return;
+    }
+
+    const Material& material = *Packet.pMaterial;
+
+    if (material.diffuseMap) {
+        material.diffuseMap->Bind(GL_TEXTURE0 + COLOR_TEXTURE_UNIT_INDEX);
+    }
+
+    if (material.pSpecularExponent) {
+        material.pSpecularExponent->Bind(GL_TEXTURE0 + SPECULAR_EXPONENT_UNIT_INDEX);
+    }
+
+    Packet.pTechnique->SetMaterial(material);
+}
+
+
+void RenderQueue::Submit()
+{
+    Sort();
+
+    SkinningTechnique* pCurTechnique = NULL;
+    const Material* pCurMaterial = NULL;
+    const TextureArray* pCurDiffuseArray = NULL;
+    const TextureArray* pCurSpecularArray = NULL;
+    GLuint CurMaterialTable = 0;
+    GLuint CurVAO = 0;
+    GLuint CurBoneBuffer = 0;
+    GLintptr CurBoneOffset = 0;
+    bool MaterialValid = false;
+    bool VAOValid = false;
+    bool BonesValid = false;
+
+    for (size_t i = 0; i < m_Keys.size(); i++) {
+        const DrawPacket& Packet = m_Packets[m_Keys[i].PacketIndex];
+
+        if (Packet.pTechnique != pCurTechnique) {
+            Packet.pTechnique->Enable();
+            pCurTechnique = Packet.pTechnique;
+            MaterialValid = false;
+            m_FrameStats.NumProgramChanges++;
+        }
+
+        if (!MaterialValid || Packet.pMaterial != pCurMaterial || Packet.MaterialTable != CurMaterialTable ||
+            Packet.pDiffuseArray != pCurDiffuseArray || Packet.pSpecularArray != pCurSpecularArray) {
+            BindMaterial(Packet);
+            pCurMaterial = Packet.pMaterial;
+            CurMaterialTable = Packet.MaterialTable;
+            pCurDiffuseArray = Packet.pDiffuseArray;
+            pCurSpecularArray = Packet.pSpecularArray;
+            MaterialValid = true;
+            m_FrameStats.NumMaterialChanges++;
+        }
+
+        if (!VAOValid || Packet.VAO != CurVAO) {
+            GetGLState().BindVertexArray(Packet.VAO);
+            CurVAO = Packet.VAO;
+            VAOValid = true;
+            m_FrameStats.NumVAOChanges++;
+        }
+
+        // The sub-meshes of one instance share its palette
+        if (!BonesValid || Packet.BoneBuffer != CurBoneBuffer || Packet.BoneOffset != CurBoneOffset) {
+            pCurTechnique->SetBonePalette(Packet.BoneBuffer, Packet.BoneOffset);
+            CurBoneBuffer = Packet.BoneBuffer;
+            CurBoneOffset = Packet.BoneOffset;
+            BonesValid = true;
+        }
+
+        pCurTechnique->SetWorldMatrix(Packet.World);
+
+        if (Packet.IndirectBuffer != 0) {
+            GetGLState().BindBuffer(GL_DRAW_INDIRECT_BUFFER, Packet.IndirectBuffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, Packet.DrawCount, 0);
+        }
+        else {
+            // The attribute array is disabled so every vertex of the draw sees this value.
+            // The material colours come from the Material block, not the table.
+            int DiffuseLayer = Packet.pMaterial ? Packet.pMaterial->diffuseLayer : -1;
+            int SpecularLayer = Packet.pMaterial ? Packet.pMaterial->specularLayer : -1;
+            glVertexAttribI4i(SkinningTechnique::DRAW_PARAMS_LOCATION, DiffuseLayer, SpecularLayer, -1, 0);
+
+            glDrawElementsBaseVertex(GL_TRIANGLES,
+                Packet.NumIndices,
+                GL_UNSIGNED_INT,
+                (void*)(sizeof(unsigned int) * Packet.BaseIndex),
+                Packet.BaseVertex);
+        }
+
+        m_FrameStats.NumDrawCalls++;
+    }
+
+    m_FrameStats.NumPackets = static_cast<unsigned int>(m_Keys.size());
+
+    m_TotalStats.NumPackets += m_FrameStats.NumPackets;
+    m_TotalStats.NumDrawCalls += m_FrameStats.NumDrawCalls;
+    m_TotalStats.NumProgramChanges += m_FrameStats.NumProgramChanges;
+    m_TotalStats.NumMaterialChanges += m_FrameStats.NumMaterialChanges;
+    m_TotalStats.NumVAOChanges += m_FrameStats.NumVAOChanges;
+    m_NumFrames++;
+
+    if (m_Packets.size() > m_PeakPackets) {
+        m_PeakPackets = m_Packets.size();
+    }
+
+    m_Packets.clear();
+    m_Keys.clear();
+}
+
+
+void RenderQueue::PrintStats() const
+{
+    if (m_NumFrames == 0) {
+        return;
+    }
+
+    printf("Render queue: %.1f packets / %.1f draw calls per frame, %.1f program / %.1f material / %.1f VAO changes per frame\n",
+        (double)m_TotalStats.NumPackets / m_NumFrames,
+        (double)m_TotalStats.NumDrawCalls / m_NumFrames,
+        (double)m_TotalStats.NumProgramChanges / m_NumFrames,
+        (double)m_TotalStats.NumMaterialChanges / m_NumFrames,
+        (double)m_TotalStats.NumVAOChanges / m_NumFrames);
+}
@@ -0,0 +1,165 @@
+#include "..//headers/ResourcePools.h"
+#include "..//headers/SkinnedMesh.h"
+#include <stdio.h>
+
+// Clear() waits for the GPU in steps of this many nanoseconds
+#define CLEAR_WAIT_TIMEOUT_NS 100000000ull
+
+
+ResourcePools::ResourcePools()
+{
+}
+
+
+ResourcePools::~ResourcePools()
+{
+    Clear();
+}
+
+
+MeshHandle ResourcePools::LoadMesh(const std::string& Filename, TextureManager* pTextureManager)
+{
+    MeshResource Resource;
+    Resource.pMesh.reset(new SkinnedMesh(pTextureManager));
+    Resource.Filename = Filename;
+    Resource.pTextureManager = pTextureManager;
+
+    if (!Resource.pMesh->LoadMesh(Filename)) {
+        return MeshHandle();
+    }
+
+    m_Stats.NumLoads++;
+
+    return m_Meshes.Create(std::move(Resource));
+}
+
+
+bool ResourcePools::ReloadMesh(MeshHandle h)
+{
+    const MeshResource* pOld = m_Meshes.Get(h);
+
+    if (!pOld) {
+        return false;
+    }
+
+    MeshResource Resource;
+    Resource.pMesh.reset(new SkinnedMesh(pOld->pTextureManager));
+    Resource.Filename = pOld->Filename;
+    Resource.pTextureManager = pOld->pTextureManager;
+
+    if (!Resource.pMesh->LoadMesh(Resource.Filename)) {
+        printf("Reloading '%s' failed, keeping the old mesh\n", Resource.Filename.c_str());
+        return false;
+    }
+
+    m_Stats.NumReloads++;
+
+    return m_Meshes.Replace(h, std::move(Resource), m_CurrentFrame);
+}
+
+
+void ResourcePools::ReloadAllMeshes()
+{
+    for (unsigned int i = 0; i < m_Meshes.Size(); i++) {
+        ReloadMesh(m_Meshes.GetHandle(i));
+    }
+}
+
+
+bool ResourcePools::ReleaseMesh(MeshHandle h)
+{
+    if (!m_Meshes.Release(h, m_CurrentFrame)) {
+        return false;
+    }
+
+    m_Stats.NumReleases++;
+
+    return true;
+}
+
+
+SkinnedMesh* ResourcePools::GetMesh(MeshHandle h) const
+{
+    const MeshResource* pResource = m_Meshes.Get(h);
+    return pResource ? pResource->pMesh.get() : NULL;
+}
+
+
+void ResourcePools::BeginFrame()
+{
+    // The fences signal in order, stop at the first one still pending
+    while (!m_Fences.empty()) {
+        GLenum Result = glClientWaitSync(m_Fences.front().Fence, 0, 0);
+
+        if (Result != GL_ALREADY_SIGNALED && Result != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        m_CompletedFrame = m_Fences.front().Frame;
+        glDeleteSync(m_Fences.front().Fence);
+        m_Fences.pop_front();
+    }
+
+    Collect();
+}
+
+
+void ResourcePools::EndFrame()
+{
+    FrameFence f = { glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_CurrentFrame };
+    m_Fences.push_back(f);
+
+    m_CurrentFrame++;
+}
+
+
+void ResourcePools::Collect()
+{
+    unsigned int NumRetired = m_Meshes.NumRetired();
+
+    m_Meshes.Collect(m_CompletedFrame);
+
+    m_Stats.NumDestroyed += NumRetired - m_Meshes.NumRetired();
+}
+
+
+void ResourcePools::Clear()
+{
+    while (m_Meshes.Size() > 0) {
+        ReleaseMesh(m_Meshes.GetHandle(0));
+    }
+
+    if (m_Meshes.NumRetired() == 0 && m_Fences.empty()) {
+        return;
+    }
+
+    // Fence what was issued since the last EndFrame() too, then wait for the fences in order.
+    // glFinish() would do, but the GLRecorder has no GPU to wait for and does not provide it.
+    EndFrame();
+
+    while (!m_Fences.empty()) {
+        GLenum Result = glClientWaitSync(m_Fences.front().Fence, GL_SYNC_FLUSH_COMMANDS_BIT, CLEAR_WAIT_TIMEOUT_NS);
+
+        if (Result == GL_TIMEOUT_EXPIRED) {
+            continue;
+        }
+
+        if (Result == GL_WAIT_FAILED) {
+            printf("Waiting for the GPU failed, destroying the retired resources anyway\n");
+        }
+
+        glDeleteSync(m_Fences.front().Fence);
+        m_Fences.pop_front();
+    }
+
+    m_CompletedFrame = m_CurrentFrame;
+    Collect();
+}
+
+
+void ResourcePools::PrintStats() const
+{
+    printf("Resource pools: %u meshes, %u loads, %u reloads, %u releases, %u destroyed after the GPU, %u pending\n",
+        m_Meshes.Size(), m_Stats.NumLoads, m_Stats.NumReloads, m_Stats.NumReleases,
+        m_Stats.NumDestroyed, m_Meshes.NumRetired());
+}
@@ -0,0 +1,331 @@
+#include "..//headers/Scene.h"
+#include "..//headers/JobSystem.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+
+// Smallest slice of a level worth a job of its own
+#define SCENE_UPDATE_MIN_BATCH 2048
+
+const Scene::NodeId Scene::INVALID_NODE;
+
+
+Scene::NodeId Scene::CreateNode(NodeId Parent)
+{
+    unsigned int ParentIndex = INVALID_NODE;
+
+    if (Parent != INVALID_NODE) {
+        if (!IsAlive(Parent)) {
+            return INVALID_NODE;
+        }
+
+        ParentIndex = m_IdToIndex[Parent];
+    }
+
+    NodeId Id;
+
+    if (m_FreeIds.empty()) {
+        Id = (NodeId)m_IdToIndex.size();
+        m_IdToIndex.push_back(INVALID_NODE);
+    }
+    else {
+        Id = m_FreeIds.back();
+        m_FreeIds.pop_back();
+    }
+
+    // Appended after its parent, so parents still come first until Sort() restores the
+    // depth order
+    unsigned int Index = (unsigned int)m_Positions.size();
+
+    m_Positions.push_back(glm::vec3(0.0f));
+    m_Rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    m_Scales.push_back(glm::vec3(1.0f));
+    m_World.push_back(glm::mat4(1.0f));
+    m_Parents.push_back(ParentIndex);
+    m_Depths.push_back(ParentIndex == INVALID_NODE ? 0 : m_Depths[ParentIndex] + 1);
+    m_Flags.push_back(NODE_DIRTY);
+    m_IndexToId.push_back(Id);
+
+    m_IdToIndex[Id] = Index;
+    m_NeedsSort = true;
+
+    return Id;
+}
+
+
+void Scene::DestroyNode(NodeId Node)
+{
+    if (!IsAlive(Node)) {
+        return;
+    }
+
+    unsigned int Index = m_IdToIndex[Node];
+    m_Flags[Index] |= NODE_DESTROYED;
+
+    // Children always come after their parent, one pass finds the whole subtree
+    for (unsigned int i = Index; i < m_Positions.size(); i++) {
+        unsigned int Parent = m_Parents[i];
+
+        if (i != Index && (Parent == INVALID_NODE || !(m_Flags[Parent] & NODE_DESTROYED) || (m_Flags[i] & NODE_DESTROYED))) {
+            continue;
+        }
+
+        m_Flags[i] |= NODE_DESTROYED;
+        m_IdToIndex[m_IndexToId[i]] = INVALID_NODE;
+        m_FreeIds.push_back(m_IndexToId[i]);
+        m_NumDestroyed++;
+    }
+
+    m_NeedsSort = true;
+}
+
+
+bool Scene::IsAlive(NodeId Node) const
+{
+    return Node < m_IdToIndex.size() && m_IdToIndex[Node] != INVALID_NODE;
+}
+
+
+Scene::NodeId Scene::GetParent(NodeId Node) const
+{
+    unsigned int Parent = m_Parents[m_IdToIndex[Node]];
+    return (Parent == INVALID_NODE) ? INVALID_NODE : m_IndexToId[Parent];
+}
+
+
+void Scene::MarkDirty(unsigned int Index)
+{
+    if (m_Flags[Index] & NODE_DIRTY) {
+        return;
+    }
+
+    m_Flags[Index] |= NODE_DIRTY;
+
+    // Sort() counts them again anyway
+    if (!m_NeedsSort) {
+        m_Levels[m_Depths[Index]].NumDirty++;
+    }
+}
+
+
+void Scene::SetPosition(NodeId Node, const glm::vec3& Position)
+{
+    unsigned int Index = m_IdToIndex[Node];
+    m_Positions[Index] = Position;
+    MarkDirty(Index);
+}
+
+
+void Scene::SetRotation(NodeId Node, const glm::quat& Rotation)
+{
+    unsigned int Index = m_IdToIndex[Node];
+    m_Rotations[Index] = Rotation;
+    MarkDirty(Index);
+}
+
+
+void Scene::SetScale(NodeId Node, const glm::vec3& Scale)
+{
+    unsigned int Index = m_IdToIndex[Node];
+    m_Scales[Index] = Scale;
+    MarkDirty(Index);
+}
+
+
+void Scene::SetLocal(NodeId Node, const glm::vec3& Position, const glm::quat& Rotation, const glm::vec3& Scale)
+{
+    unsigned int Index = m_IdToIndex[Node];
+    m_Positions[Index] = Position;
+    m_Rotations[Index] = Rotation;
+    m_Scales[Index] = Scale;
+    MarkDirty(Index);
+}
+
+
+// Counting sort by depth, which drops the destroyed nodes and keeps the order of the
+// others within a depth
+void Scene::Sort()
+{
+    unsigned int NumOld = (unsigned int)m_Positions.size();
+    unsigned int NumLevels = 0;
+
+    for (unsigned int i = 0; i < NumOld; i++) {
+        if (!(m_Flags[i] & NODE_DESTROYED) && m_Depths[i] + 1 > NumLevels) {
+            NumLevels = m_Depths[i] + 1;
+        }
+    }
+
+    m_Levels.assign(NumLevels, Level());
+
+    for (unsigned int i = 0; i < NumOld; i++) {
+        if (!(m_Flags[i] & NODE_DESTROYED)) {
+            m_Levels[m_Depths[i]].End++;
+        }
+    }
+
+    unsigned int NumNew = 0;
+
+    for (unsigned int d = 0; d < NumLevels; d++) {
+        unsigned int Count = m_Levels[d].End;
+        m_Levels[d].Begin = NumNew;
+        m_Levels[d].End = NumNew;
+        NumNew += Count;
+    }
+
+    std::vector<unsigned int> NewIndex(NumOld, INVALID_NODE);
+
+    for (unsigned int i = 0; i < NumOld; i++) {
+        if (!(m_Flags[i] & NODE_DESTROYED)) {
+            NewIndex[i] = m_Levels[m_Depths[i]].End++;
+        }
+    }
+
+    std::vector<glm::vec3> Positions(NumNew);
+    std::vector<glm::quat> Rotations(NumNew);
+    std::vector<glm::vec3> Scales(NumNew);
+    std::vector<glm::mat4> World(NumNew);
+    std::vector<unsigned int> Parents(NumNew);
+    std::vector<unsigned int> Depths(NumNew);
+    std::vector<unsigned char> Flags(NumNew);
+    std::vector<NodeId> IndexToId(NumNew);
+
+    for (unsigned int i = 0; i < NumOld; i++) {
+        unsigned int n = NewIndex[i];
+
+        if (n == INVALID_NODE) {
+            continue;
+        }
+
+        Positions[n] = m_Positions[i];
+        Rotations[n] = m_Rotations[i];
+        Scales[n] = m_Scales[i];
+        World[n] = m_World[i];
+        Parents[n] = (m_Parents[i] == INVALID_NODE) ? INVALID_NODE : NewIndex[m_Parents[i]];
+        Depths[n] = m_Depths[i];
+        Flags[n] = m_Flags[i];
+        IndexToId[n] = m_IndexToId[i];
+
+        m_IdToIndex[IndexToId[n]] = n;
+
+        Level& l = m_Levels[Depths[n]];
+
+        if (Flags[n] & NODE_DIRTY) {
+            l.NumDirty++;
+        }
+
+        if (Flags[n] & NODE_CHANGED) {
+            l.HasChanged = true;
+        }
+    }
+
+    m_Positions.swap(Positions);
+    m_Rotations.swap(Rotations);
+    m_Scales.swap(Scales);
+    m_World.swap(World);
+    m_Parents.swap(Parents);
+    m_Depths.swap(Depths);
+    m_Flags.swap(Flags);
+    m_IndexToId.swap(IndexToId);
+
+    m_NumDestroyed = 0;
+    m_NeedsSort = false;
+    m_Stats.NumSorts++;
+}
+
+
+void Scene::UpdateRange(unsigned int Begin, unsigned int End)
+{
+    for (unsigned int i = Begin; i < End; i++) {
+        unsigned int Parent = m_Parents[i];
+        bool Changed = (m_Flags[i] & NODE_DIRTY) || (Parent != INVALID_NODE && (m_Flags[Parent] & NODE_CHANGED));
+
+        m_Flags[i] = (unsigned char)((m_Flags[i] & ~(NODE_DIRTY | NODE_CHANGED)) | (Changed ? NODE_CHANGED : 0));
+
+        if (!Changed) {
+            continue;
+        }
+
+        // Translate * Rotate * Scale, without the full matrix products
+        glm::mat3 R = glm::mat3_cast(m_Rotations[i]);
+        const glm::vec3& S = m_Scales[i];
+
+        glm::mat4 Local(glm::vec4(R[0] * S.x, 0.0f),
+                        glm::vec4(R[1] * S.y, 0.0f),
+                        glm::vec4(R[2] * S.z, 0.0f),
+                        glm::vec4(m_Positions[i], 1.0f));
+
+        m_World[i] = (Parent == INVALID_NODE) ? Local : m_World[Parent] * Local;
+    }
+}
+
+
+void Scene::Update(JobSystem* pJobs)
+{
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+    if (m_NeedsSort) {
+        Sort();
+    }
+
+    m_Stats.NumUpdated = 0;
+    m_Stats.NumLevelsSkipped = 0;
+
+    bool ParentChanged = false;
+
+    for (unsigned int d = 0; d < m_Levels.size(); d++) {
+        Level& l = m_Levels[d];
+
+        // Nothing set here and nothing moved above: the whole depth keeps its matrices
+        if (l.NumDirty == 0 && !ParentChanged) {
+            if (l.HasChanged) {
+                for (unsigned int i = l.Begin; i < l.End; i++) {
+                    m_Flags[i] &= ~NODE_CHANGED;
+                }
+
+                l.HasChanged = false;
+            }
+
+            m_Stats.NumLevelsSkipped++;
+            continue;
+        }
+
+        std::atomic<unsigned int> NumChanged{ 0 };
+
+        auto UpdateBatch = [this, &NumChanged](unsigned int Begin, unsigned int End) {
+            UpdateRange(Begin, End);
+
+            unsigned int Count = 0;
+
+            for (unsigned int i = Begin; i < End; i++) {
+                Count += (m_Flags[i] & NODE_CHANGED) ? 1 : 0;
+            }
+
+            NumChanged.fetch_add(Count, std::memory_order_relaxed);
+        };
+
+        // The depth above is complete, so every node of this one can go in parallel
+        if (pJobs) {
+            pJobs->ParallelFor(l.End - l.Begin, SCENE_UPDATE_MIN_BATCH, [&UpdateBatch, &l](unsigned int Begin, unsigned int End) {
+                UpdateBatch(l.Begin + Begin, l.Begin + End);
+            });
+        }
+        else {
+            UpdateBatch(l.Begin, l.End);
+        }
+
+        l.NumDirty = 0;
+        l.HasChanged = (NumChanged.load() > 0);
+        ParentChanged = l.HasChanged;
+        m_Stats.NumUpdated += NumChanged.load();
+    }
+
+    m_Stats.NumNodes = NumNodes();
+    m_Stats.UpdateTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+}
+
+
+void Scene::PrintStats() const
+{
+    printf("Scene: %u nodes, %u levels, last update %u nodes in %.3f ms, %llu sorts\n",
+        m_Stats.NumNodes, (unsigned int)m_Levels.size(), m_Stats.NumUpdated, m_Stats.UpdateTimeMs, m_Stats.NumSorts);
+}
@@ -0,0 +1,165 @@
+#include "..//headers/Skeleton.h"
+#include <algorithm>
+#include <cmath>
+
+
+unsigned int Skeleton::NumBones() const
+{
+    return std::min((unsigned int)BoneOffsets.size(), (unsigned int)BONES_BLOCK_MAX_BONES);
+}
+
+
+int Skeleton::FindJoint(const std::string& Name) const
+{
+    for (unsigned int i = 0; i < Joints.size(); i++) {
+        if (Joints[i].Name == Name) {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+
+template<typename T>
+static bool KeyTimeLess(float Time, const Keyframe<T>& Key)
+{
+    return Time < Key.Time;
+}
+
+
+// Pair of keys around Time and the blend factor between them
+template<typename T>
+static void FindKeys(const std::vector<Keyframe<T> >& Keys, float Time, unsigned int& First, unsigned int& Second, float& Factor)
+{
+    typename std::vector<Keyframe<T> >::const_iterator it = std::upper_bound(Keys.begin(), Keys.end(), Time, KeyTimeLess<T>);
+
+    if (it == Keys.begin()) {
+        First = Second = 0;
+        Factor = 0.0f;
+        return;
+    }
+
+    if (it == Keys.end()) {
+        First = Second = (unsigned int)Keys.size() - 1;
+        Factor = 0.0f;
+        return;
+    }
+
+    Second = (unsigned int)(it - Keys.begin());
+    First = Second - 1;
+
+    float Span = Keys[Second].Time - Keys[First].Time;
+    Factor = (Span > 0.0f) ? (Time - Keys[First].Time) / Span : 0.0f;
+}
+
+
+static glm::vec3 SampleVec3(const std::vector<Keyframe<glm::vec3> >& Keys, float Time, const glm::vec3& Default)
+{
+    if (Keys.empty()) {
+        return Default;
+    }
+
+    unsigned int First, Second;
+    float Factor;
+    FindKeys(Keys, Time, First, Second, Factor);
+
+    return glm::mix(Keys[First].Value, Keys[Second].Value, Factor);
+}
+
+
+static glm::quat SampleQuat(const std::vector<Keyframe<glm::quat> >& Keys, float Time)
+{
+    if (Keys.empty()) {
+        return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    unsigned int First, Second;
+    float Factor;
+    FindKeys(Keys, Time, First, Second, Factor);
+
+    return glm::normalize(glm::slerp(Keys[First].Value, Keys[Second].Value, Factor));
+}
+
+
+void SampleClip(const Skeleton& Skel, const AnimationClip* pClip, float Time, glm::mat4* pLocalPose)
+{
+    for (unsigned int i = 0; i < Skel.Joints.size(); i++) {
+        if (!pClip || i >= pClip->Tracks.size() || pClip->Tracks[i].IsEmpty()) {
+            pLocalPose[i] = Skel.Joints[i].BindLocal;
+            continue;
+        }
+
+        const JointTrack& Track = pClip->Tracks[i];
+
+        glm::vec3 Position = SampleVec3(Track.Positions, Time, glm::vec3(0.0f));
+        glm::quat Rotation = SampleQuat(Track.Rotations, Time);
+        glm::vec3 Scale = SampleVec3(Track.Scales, Time, glm::vec3(1.0f));
+
+        // Translate * Rotate * Scale
+        glm::mat3 R = glm::mat3_cast(Rotation);
+
+        pLocalPose[i] = glm::mat4(glm::vec4(R[0] * Scale.x, 0.0f),
+                                  glm::vec4(R[1] * Scale.y, 0.0f),
+                                  glm::vec4(R[2] * Scale.z, 0.0f),
+                                  glm::vec4(Position, 1.0f));
+    }
+}
+
+
+void ComputePalette(const Skeleton& Skel, const glm::mat4* pLocalPose, glm::mat4* pGlobalPose, glm::mat4* pPalette)
+{
+    // Parents come first, so their global transform is always ready
+    for (unsigned int i = 0; i < Skel.Joints.size(); i++) {
+        int Parent = Skel.Joints[i].Parent;
+        pGlobalPose[i] = (Parent < 0) ? pLocalPose[i] : pGlobalPose[Parent] * pLocalPose[i];
+    }
+
+    unsigned int NumBones = Skel.NumBones();
+
+    for (unsigned int b = 0; b < NumBones; b++) {
+        pPalette[b] = Skel.GlobalInverse * pGlobalPose[Skel.BoneJoints[b]] * Skel.BoneOffsets[b];
+    }
+}
+
+
+AABB ComputePoseBounds(const Skeleton& Skel, const glm::mat4* pPalette)
+{
+    AABB Bounds;
+    unsigned int NumBones = Skel.NumBones();
+
+    for (unsigned int b = 0; b < NumBones && b < Skel.BoneSpheres.size(); b++) {
+        const glm::vec4& Sphere = Skel.BoneSpheres[b];
+
+        if (Sphere.w < 0.0f) {
+            continue;
+        }
+
+        glm::vec3 Center = glm::vec3(pPalette[b] * glm::vec4(glm::vec3(Sphere), 1.0f));
+        Bounds.Merge(AABB::FromSphere(Center, Sphere.w));
+    }
+
+    // Not skinned at all: the mesh stays where it was modeled
+    return Bounds.IsEmpty() ? Skel.BindBounds : Bounds;
+}
+
+
+AABB ComputeClipBounds(const Skeleton& Skel, const AnimationClip& Clip, float SampleRate)
+{
+    std::vector<glm::mat4> LocalPose(Skel.NumJoints());
+    std::vector<glm::mat4> GlobalPose(Skel.NumJoints());
+    std::vector<glm::mat4> Palette(Skel.NumBones() + 1);
+
+    unsigned int NumSamples = (unsigned int)ceilf(Clip.Duration * SampleRate) + 1;
+    AABB Bounds;
+
+    for (unsigned int i = 0; i < NumSamples; i++) {
+        float Time = std::min(Clip.Duration, (float)i / SampleRate);
+
+        SampleClip(Skel, &Clip, Time, LocalPose.data());
+        ComputePalette(Skel, LocalPose.data(), GlobalPose.data(), Palette.data());
+        Bounds.Merge(ComputePoseBounds(Skel, Palette.data()));
+    }
+
+    return Bounds;
+}
@@ -1,11 +1,28 @@
 #include "..//headers/SkinnedMesh.h"
+#include "..//headers/SkinningTechnique.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+
+// Poses per second sampled for the bounds of a clip
+#define CLIP_BOUNDS_SAMPLE_RATE 30.0f
 
 
 void SkinnedMesh::Clear() {
+    GetGLState().OnDeleteVertexArray(m_VAO);
     glDeleteVertexArrays(1, &m_VAO);
+    m_VAO = 0;
+
+    for (unsigned int i = 0; i < NUM_BUFFERS; i++) {
+        GetGLState().OnDeleteBuffer(m_Buffers[i]);
+    }
     glDeleteBuffers(NUM_BUFFERS, m_Buffers);
 
+    for (unsigned int i = 0; i < NUM_BUFFERS; i++) {
+        m_Buffers[i] = 0;
+    }
+
 }
 
 bool SkinnedMesh::LoadMesh(const std::string& filename) {
@@ -14,7 +31,7 @@ bool SkinnedMesh::LoadMesh(const std::string& filename) {
 
     // Create the VAO
     glGenVertexArrays(1, &m_VAO);
-    glBindVertexArray(m_VAO);
+    GetGLState().BindVertexArray(m_VAO);
 
     // Create the buffers for the vertices attributes
     glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(m_Buffers), m_Buffers);
@@ -32,7 +49,7 @@ bool SkinnedMesh::LoadMesh(const std::string& filename) {
         return false;
     }
     // Make sure the VAO is not changed from the outside
-    glBindVertexArray(0);
+    GetGLState().BindVertexArray(0);
 
     return Ret;
 }
@@ -44,12 +61,18 @@ bool SkinnedMesh::InitFromScene(const aiScene* scene, const std::string& filenam
     m_Meshes.resize(scene->mNumMeshes);
     m_Materials.resize(scene->mNumMaterials);
 
+    for (unsigned int i = 0; i < m_Materials.size(); i++) {
+        m_Materials[i].renderId = RenderQueue::NewMaterialId();
+    }
+
     unsigned int numVertices = 0, numIndices = 0;
 
     CountVerticesAndIndices(scene, numVertices, numIndices);
     ReserveSpace(numVertices, numIndices);
     std::cout << "check POINT11" << std::endl;
     InitAllMeshes(scene);
+    CalcBounds();
+    LoadSkeleton(scene);
     std::cout << "check POINT22" << std::endl;
 
     if (!InitMaterials(scene, filename)) {
@@ -57,6 +80,7 @@ bool SkinnedMesh::InitFromScene(const aiScene* scene, const std::string& filenam
         return false;
 
     }
+    PackTextures();
     PopulateBuffers();
     std::cout << "check POINT44" << std::endl;
 
@@ -80,7 +104,7 @@ void SkinnedMesh::ReserveSpace(unsigned int totalVertices, unsigned int totalInd
     m_Positions.reserve(totalVertices);
     m_Normals.reserve(totalVertices);
     m_TexCoords.reserve(totalVertices);
-    m_Bones.reserve(totalVertices);
+    m_Bones.resize(totalVertices);  // Indexed by vertex while the bones load
     m_Indices.reserve(totalIndices);
 }
 
@@ -119,15 +143,78 @@ void SkinnedMesh::InitSingleMesh(unsigned int meshIndex, const aiMesh* mesh) {
 
     LoadMeshBones(meshIndex, mesh);
 
+    // Ratio of texture space to object space area, used to pick the mip level for streaming
+    float PosArea = 0.0f;
+    float UVArea = 0.0f;
+
     for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
         const aiFace& face = mesh->mFaces[i];
         assert(face.mNumIndices == 3);
         m_Indices.push_back(face.mIndices[0]);
         m_Indices.push_back(face.mIndices[1]);
         m_Indices.push_back(face.mIndices[2]);
+
+        const aiVector3D& p0 = mesh->mVertices[face.mIndices[0]];
+        const aiVector3D& p1 = mesh->mVertices[face.mIndices[1]];
+        const aiVector3D& p2 = mesh->mVertices[face.mIndices[2]];
+        PosArea += ((p1 - p0) ^ (p2 - p0)).Length() * 0.5f;
+
+        if (mesh->HasTextureCoords(0)) {
+            const aiVector3D& t0 = mesh->mTextureCoords[0][face.mIndices[0]];
+            const aiVector3D& t1 = mesh->mTextureCoords[0][face.mIndices[1]];
+            const aiVector3D& t2 = mesh->mTextureCoords[0][face.mIndices[2]];
+            UVArea += fabsf((t1.x - t0.x) * (t2.y - t0.y) - (t2.x - t0.x) * (t1.y - t0.y)) * 0.5f;
+        }
     }
+
+    m_Meshes[meshIndex].UVDensity = PosArea > 0.0f ? sqrtf(UVArea / PosArea) : 0.0f;
 }
 
+
+void SkinnedMesh::CalcBounds()
+{
+    if (m_Positions.empty()) {
+        return;
+    }
+
+    glm::vec3 Min = m_Positions[0];
+    glm::vec3 Max = m_Positions[0];
+
+    for (unsigned int i = 1; i < m_Positions.size(); i++) {
+        Min = glm::min(Min, m_Positions[i]);
+        Max = glm::max(Max, m_Positions[i]);
+    }
+
+    m_BoundsCenter = (Min + Max) * 0.5f;
+    m_BoundsRadius = 0.0f;
+
+    for (unsigned int i = 0; i < m_Positions.size(); i++) {
+        m_BoundsRadius = std::max(m_BoundsRadius, glm::length(m_Positions[i] - m_BoundsCenter));
+    }
+}
+
+
+void SkinnedMesh::GetTriangles(std::vector<glm::vec3>& Positions, std::vector<unsigned int>& Indices) const
+{
+    Positions = m_Positions;
+    Indices.clear();
+    Indices.reserve(m_Indices.size());
+
+    // The index buffer is per sub-mesh, drawn with BaseVertex
+    for (unsigned int i = 0; i < m_Meshes.size(); i++) {
+        for (unsigned int j = 0; j < m_Meshes[i].NumIndices; j++) {
+            Indices.push_back(m_Meshes[i].BaseVertex + m_Indices[m_Meshes[i].BaseIndex + j]);
+        }
+    }
+}
+
+// Assimp matrices are row-major
+static glm::mat4 ToGlm(const aiMatrix4x4& m)
+{
+    return glm::transpose(glm::make_mat4(&m.a1));
+}
+
+
 void SkinnedMesh::LoadMeshBones(unsigned int meshIndex, const aiMesh* mesh) {
     for (unsigned int i = 0; i < mesh->mNumBones; ++i) {
         LoadSingleBone(meshIndex, mesh->mBones[i]);
@@ -151,12 +238,150 @@ int SkinnedMesh::GetBoneId(const aiBone* bone) {
     if (it == m_BoneNameToIndexMap.end()) {
         int newId = static_cast<int>(m_BoneNameToIndexMap.size());
         m_BoneNameToIndexMap[name] = newId;
+        m_BoneOffsets.push_back(ToGlm(bone->mOffsetMatrix));
         return newId;
     }
     return it->second;
 }
 
 
+// Pre-order, so that every joint comes after its parent
+static void AddJoints(const aiNode* pNode, int Parent, Skeleton& Skel)
+{
+    SkeletonJoint Joint;
+    Joint.Name = pNode->mName.C_Str();
+    Joint.Parent = Parent;
+    Joint.BindLocal = ToGlm(pNode->mTransformation);
+
+    int Index = (int)Skel.Joints.size();
+    Skel.Joints.push_back(Joint);
+
+    for (unsigned int i = 0; i < pNode->mNumChildren; i++) {
+        AddJoints(pNode->mChildren[i], Index, Skel);
+    }
+}
+
+
+// Expects the bones of every sub-mesh to be loaded
+void SkinnedMesh::LoadSkeleton(const aiScene* pScene)
+{
+    std::shared_ptr<SkeletonAsset> pAsset = std::make_shared<SkeletonAsset>();
+    Skeleton& Skel = pAsset->Skel;
+
+    AddJoints(pScene->mRootNode, -1, Skel);
+
+    Skel.GlobalInverse = glm::inverse(ToGlm(pScene->mRootNode->mTransformation));
+    Skel.BoneOffsets = m_BoneOffsets;
+    Skel.BoneJoints.resize(m_BoneOffsets.size(), 0);
+
+    for (unsigned int i = 0; i < Skel.Joints.size(); i++) {
+        auto it = m_BoneNameToIndexMap.find(Skel.Joints[i].Name);
+
+        if (it != m_BoneNameToIndexMap.end()) {
+            Skel.Joints[i].Bone = (int)it->second;
+            Skel.BoneJoints[it->second] = i;
+        }
+    }
+
+    CalcBoneSpheres(Skel);
+
+    if (m_BoneOffsets.size() > BONES_BLOCK_MAX_BONES) {
+        printf("%u bones, only the first %u are animated\n", (unsigned int)m_BoneOffsets.size(), BONES_BLOCK_MAX_BONES);
+    }
+
+    LoadClips(pScene, *pAsset);
+
+    for (unsigned int i = 0; i < pAsset->Clips.size(); i++) {
+        pAsset->Clips[i].Bounds = ComputeClipBounds(Skel, pAsset->Clips[i], CLIP_BOUNDS_SAMPLE_RATE);
+    }
+
+    printf("Skeleton: %u joints, %u bones, %u clips\n", Skel.NumJoints(), (unsigned int)m_BoneOffsets.size(), (unsigned int)pAsset->Clips.size());
+
+    m_pSkeleton = pAsset;
+}
+
+
+// Two passes over the weighted vertices of each bone: their box, then the furthest from its center
+void SkinnedMesh::CalcBoneSpheres(Skeleton& Skel) const
+{
+    std::vector<AABB> Boxes(m_BoneOffsets.size());
+
+    for (unsigned int i = 0; i < m_Positions.size(); i++) {
+        Skel.BindBounds.Merge(m_Positions[i]);
+
+        for (int j = 0; j < MAX_NUM_BONES_PER_VERTEX; j++) {
+            if (m_Bones[i].Weights[j] > 0.0f) {
+                Boxes[m_Bones[i].BoneIDs[j]].Merge(m_Positions[i]);
+            }
+        }
+    }
+
+    Skel.BoneSpheres.assign(m_BoneOffsets.size(), glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+
+    for (unsigned int b = 0; b < Boxes.size(); b++) {
+        if (!Boxes[b].IsEmpty()) {
+            Skel.BoneSpheres[b] = glm::vec4(Boxes[b].GetCenter(), 0.0f);
+        }
+    }
+
+    for (unsigned int i = 0; i < m_Positions.size(); i++) {
+        for (int j = 0; j < MAX_NUM_BONES_PER_VERTEX; j++) {
+            if (m_Bones[i].Weights[j] > 0.0f) {
+                glm::vec4& Sphere = Skel.BoneSpheres[m_Bones[i].BoneIDs[j]];
+                Sphere.w = std::max(Sphere.w, glm::length(m_Positions[i] - glm::vec3(Sphere)));
+            }
+        }
+    }
+}
+
+
+void SkinnedMesh::LoadClips(const aiScene* pScene, SkeletonAsset& Asset)
+{
+    for (unsigned int a = 0; a < pScene->mNumAnimations; a++) {
+        const aiAnimation* pAnimation = pScene->mAnimations[a];
+
+        // Keys are in ticks; files that leave the rate out mean 25 per second
+        double TicksPerSecond = (pAnimation->mTicksPerSecond != 0.0) ? pAnimation->mTicksPerSecond : 25.0;
+
+        AnimationClip Clip;
+        Clip.Name = pAnimation->mName.C_Str();
+        Clip.Duration = (float)(pAnimation->mDuration / TicksPerSecond);
+        Clip.Tracks.resize(Asset.Skel.NumJoints());
+
+        for (unsigned int c = 0; c < pAnimation->mNumChannels; c++) {
+            const aiNodeAnim* pChannel = pAnimation->mChannels[c];
+            int Joint = Asset.Skel.FindJoint(pChannel->mNodeName.C_Str());
+
+            if (Joint < 0) {
+                continue;
+            }
+
+            JointTrack& Track = Clip.Tracks[Joint];
+
+            for (unsigned int k = 0; k < pChannel->mNumPositionKeys; k++) {
+                const aiVectorKey& Key = pChannel->mPositionKeys[k];
+                Keyframe<glm::vec3> Frame = { (float)(Key.mTime / TicksPerSecond), glm::vec3(Key.mValue.x, Key.mValue.y, Key.mValue.z) };
+                Track.Positions.push_back(Frame);
+            }
+
+            for (unsigned int k = 0; k < pChannel->mNumRotationKeys; k++) {
+                const aiQuatKey& Key = pChannel->mRotationKeys[k];
+                Keyframe<glm::quat> Frame = { (float)(Key.mTime / TicksPerSecond), glm::quat(Key.mValue.w, Key.mValue.x, Key.mValue.y, Key.mValue.z) };
+                Track.Rotations.push_back(Frame);
+            }
+
+            for (unsigned int k = 0; k < pChannel->mNumScalingKeys; k++) {
+                const aiVectorKey& Key = pChannel->mScalingKeys[k];
+                Keyframe<glm::vec3> Frame = { (float)(Key.mTime / TicksPerSecond), glm::vec3(Key.mValue.x, Key.mValue.y, Key.mValue.z) };
+                Track.Scales.push_back(Frame);
+            }
+        }
+
+        Asset.Clips.push_back(Clip);
+    }
+}
+
+
 bool SkinnedMesh::InitMaterials(const aiScene* pScene, const std::string& Filename)
 {
 
@@ -176,6 +401,20 @@ bool SkinnedMesh::InitMaterials(const aiScene* pScene, const std::string& Filena
         LoadColors(pMaterial, i);
     }
 
+    m_pTextureManager->FlushPendingLoads();
+
+    for (unsigned int i = 0; i < m_Materials.size(); i++) {
+        if (m_Materials[i].diffuseMap && !m_Materials[i].diffuseMap->IsLoaded()) {
+            printf("Error loading diffuse texture '%s'\n", m_Materials[i].diffuseMap->path.c_str());
+            exit(0);
+        }
+
+        if (m_Materials[i].pSpecularExponent && !m_Materials[i].pSpecularExponent->IsLoaded()) {
+            printf("Error loading specular texture '%s'\n", m_Materials[i].pSpecularExponent->path.c_str());
+            exit(0);
+        }
+    }
+
     return Ret;
 }
 
@@ -189,7 +428,7 @@ void SkinnedMesh::LoadTextures(const std::string& Dir, const aiMaterial* pMateri
 
 void SkinnedMesh::LoadDiffuseTexture(const std::string& Dir, const aiMaterial* pMaterial, int index)
 {
-    m_Materials[index].diffuseMap = NULL;
+    m_Materials[index].diffuseMap = nullptr;
 
     if (pMaterial->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
         aiString Path;
@@ -203,15 +442,8 @@ void SkinnedMesh::LoadDiffuseTexture(const std::string& Dir, const aiMaterial* p
 
             std::string FullPath = Dir + "/" + p;
 
-            m_Materials[index].diffuseMap = new Texture(GL_TEXTURE_2D, FullPath.c_str());
-
-            if (!m_Materials[index].diffuseMap->Load()) {
-                printf("Error loading diffuse texture '%s'\n", FullPath.c_str());
-                exit(0);
-            }
-            else {
-                printf("Loaded diffuse texture '%s'\n", FullPath.c_str());
-            }
+            // Decoded together with the other textures of the model in InitMaterials()
+            m_Materials[index].diffuseMap = m_pTextureManager->Request(FullPath, GL_TEXTURE_2D);
         }
     }
 }
@@ -219,7 +451,7 @@ void SkinnedMesh::LoadDiffuseTexture(const std::string& Dir, const aiMaterial* p
 
 void SkinnedMesh::LoadSpecularTexture(const std::string& Dir, const aiMaterial* pMaterial, int index)
 {
-    m_Materials[index].pSpecularExponent = NULL;
+    m_Materials[index].pSpecularExponent = nullptr;
 
     if (pMaterial->GetTextureCount(aiTextureType_SHININESS) > 0) {
         aiString Path;
@@ -236,19 +468,74 @@ void SkinnedMesh::LoadSpecularTexture(const std::string& Dir, const aiMaterial*
 
             std::string FullPath = Dir + "/" + p;
 
-            m_Materials[index].pSpecularExponent = new Texture(GL_TEXTURE_2D, FullPath.c_str());
+            // Decoded together with the other textures of the model in InitMaterials()
+            m_Materials[index].pSpecularExponent = m_pTextureManager->Request(FullPath, GL_TEXTURE_2D);
+        }
+    }
+}
 
-            if (!m_Materials[index].pSpecularExponent->Load()) {
-                printf("Error loading specular texture '%s'\n", FullPath.c_str());
-                exit(0);
-            }
-            else {
-                printf("Loaded specular texture '%s'\n", FullPath.c_str());
+// Collapses the per-material textures into arrays so that they are bound once per model
+void SkinnedMesh::PackTextures()
+{
+    PackTextureChannel(&Material::diffuseMap, &Material::diffuseLayer, m_DiffuseArray);
+    PackTextureChannel(&Material::pSpecularExponent, &Material::specularLayer, m_SpecularArray);
+}
+
+
+void SkinnedMesh::PackTextureChannel(std::shared_ptr<Texture> Material::* pChannel, int Material::* pLayer, TextureArray& Array)
+{
+    std::vector<Texture*> Candidates;
+
+    for (unsigned int i = 0; i < m_Materials.size(); i++) {
+        Texture* pTexture = (m_Materials[i].*pChannel).get();
+        m_Materials[i].*pLayer = -1;
+
+        // Streamed textures change their resident levels at runtime so they stay separate
+        if (!pTexture || !pTexture->IsLoaded() || pTexture->IsStreamed()) {
+            continue;
+        }
+
+        if (std::find(Candidates.begin(), Candidates.end(), pTexture) == Candidates.end()) {
+            Candidates.push_back(pTexture);
+        }
+    }
+
+    // The layers of an array share their format and size, and the shader samples one array
+    // per channel: the largest group of alike textures is packed, the others stay on their own
+    std::vector<Texture*> Layers;
+
+    for (unsigned int i = 0; i < Candidates.size(); i++) {
+        std::vector<Texture*> Group;
+
+        for (unsigned int j = 0; j < Candidates.size(); j++) {
+            if (TextureArray::CanShareArray(*Candidates[i], *Candidates[j])) {
+                Group.push_back(Candidates[j]);
             }
         }
+
+        if (Group.size() > Layers.size()) {
+            Layers.swap(Group);
+        }
+    }
+
+    // A single texture is bound once per mesh anyway
+    if (Layers.size() < 2 || !Array.Build(Layers)) {
+        return;
+    }
+
+    // The array holds a copy now. Dropping our references lets the TextureManager
+    // evict the originals once no other mesh uses them.
+    for (unsigned int i = 0; i < m_Materials.size(); i++) {
+        std::vector<Texture*>::iterator it = std::find(Layers.begin(), Layers.end(), (m_Materials[i].*pChannel).get());
+
+        if (it != Layers.end()) {
+            m_Materials[i].*pLayer = static_cast<int>(it - Layers.begin());
+            (m_Materials[i].*pChannel).reset();
+        }
     }
 }
 
+
 void SkinnedMesh::LoadColors(const aiMaterial* pMaterial, int index)
 {
     aiColor4D AmbientColor(0.0f, 0.0f, 0.0f, 0.0f);
@@ -290,63 +577,160 @@ void SkinnedMesh::LoadColors(const aiMaterial* pMaterial, int index)
 
 
 void SkinnedMesh::PopulateBuffers() {
-    glBindVertexArray(m_VAO);
+    GetGLState().BindVertexArray(m_VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[POS_VB]);
+    GetGLState().BindBuffer(GL_ARRAY_BUFFER, m_Buffers[POS_VB]);
     glBufferData(GL_ARRAY_BUFFER, m_Positions.size() * sizeof(glm::vec3), m_Positions.data(), GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[TEXCOORD_VB]);
+    GetGLState().BindBuffer(GL_ARRAY_BUFFER, m_Buffers[TEXCOORD_VB]);
     glBufferData(GL_ARRAY_BUFFER, m_TexCoords.size() * sizeof(glm::vec2), m_TexCoords.data(), GL_STATIC_DRAW);
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
 
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[NORMAL_VB]);
+    GetGLState().BindBuffer(GL_ARRAY_BUFFER, m_Buffers[NORMAL_VB]);
     glBufferData(GL_ARRAY_BUFFER, m_Normals.size() * sizeof(glm::vec3), m_Normals.data(), GL_STATIC_DRAW);
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[BONE_VB]);
+    GetGLState().BindBuffer(GL_ARRAY_BUFFER, m_Buffers[BONE_VB]);
     glBufferData(GL_ARRAY_BUFFER, m_Bones.size() * sizeof(VertexBoneData), m_Bones.data(), GL_STATIC_DRAW);
     glEnableVertexAttribArray(3);
     glVertexAttribIPointer(3, 4, GL_UNSIGNED_INT, sizeof(VertexBoneData), (void*)0);
     glEnableVertexAttribArray(4);
     glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(VertexBoneData), (void*)(sizeof(unsigned int) * 4));
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[INDEX_BUFFER]);
+    GetGLState().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[INDEX_BUFFER]);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_Indices.size() * sizeof(unsigned int), m_Indices.data(), GL_STATIC_DRAW);
 
-    glBindVertexArray(0);
+    m_UseMultiDraw = CanUseMultiDraw();
+
+    if (m_UseMultiDraw) {
+        PopulateMultiDrawBuffers();
+    }
+
+    GetGLState().BindVertexArray(0);
 }
 
-void SkinnedMesh::Render() {
-    glBindVertexArray(m_VAO);
+
+// Everything that differs between sub-meshes must be reachable from the draw id
+bool SkinnedMesh::CanUseMultiDraw() const
+{
+    if (!GetGLCapabilities().MultiDrawIndirect || m_Meshes.size() < 2 || m_Materials.size() > MATERIAL_TABLE_SIZE) {
+        return false;
+    }
+
+    // Textures that are not in the arrays need a bind per sub-mesh
+    for (unsigned int i = 0; i < m_Materials.size(); i++) {
+        if (m_Materials[i].diffuseMap || m_Materials[i].pSpecularExponent) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Expects the VAO to be bound
+void SkinnedMesh::PopulateMultiDrawBuffers()
+{
+    std::vector<DrawElementsIndirectCommand> Commands(m_Meshes.size());
+    std::vector<glm::ivec4> DrawParams(m_Meshes.size());
+
+    for (unsigned int i = 0; i < m_Meshes.size(); i++) {
+        const Material& material = m_Materials[m_Meshes[i].MaterialIndex];
+
+        Commands[i].Count = m_Meshes[i].NumIndices;
+        Commands[i].InstanceCount = 1;
+        Commands[i].FirstIndex = m_Meshes[i].BaseIndex;
+        Commands[i].BaseVertex = m_Meshes[i].BaseVertex;
+        Commands[i].BaseInstance = i;
+
+        DrawParams[i] = glm::ivec4(material.diffuseLayer, material.specularLayer, m_Meshes[i].MaterialIndex, 0);
+    }
+
+    MaterialTableBlock Table;
+
+    for (unsigned int i = 0; i < m_Materials.size(); i++) {
+        Table.Materials[i].AmbientColor = m_Materials[i].AmbientColor;
+        Table.Materials[i].DiffuseColor = m_Materials[i].DiffuseColor;
+        Table.Materials[i].SpecularColor = m_Materials[i].SpecularColor;
+    }
+
+    GetGLState().BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_Buffers[INDIRECT_BUFFER]);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, Commands.size() * sizeof(DrawElementsIndirectCommand), Commands.data(), GL_STATIC_DRAW);
+
+    // One element per draw: with a divisor of 1 the base instance picks the element
+    GetGLState().BindBuffer(GL_ARRAY_BUFFER, m_Buffers[DRAW_PARAMS_VB]);
+    glBufferData(GL_ARRAY_BUFFER, DrawParams.size() * sizeof(glm::ivec4), DrawParams.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(SkinningTechnique::DRAW_PARAMS_LOCATION);
+    glVertexAttribIPointer(SkinningTechnique::DRAW_PARAMS_LOCATION, 4, GL_INT, sizeof(glm::ivec4), nullptr);
+    glVertexAttribDivisor(SkinningTechnique::DRAW_PARAMS_LOCATION, 1);
+
+    GetGLState().BindBuffer(GL_UNIFORM_BUFFER, m_Buffers[MATERIAL_TABLE_UB]);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Table), &Table, GL_STATIC_DRAW);
+}
+
+void SkinnedMesh::AddToRenderQueue(RenderQueue& Queue, SkinningTechnique* pTechnique, const glm::mat4& World, const glm::vec3& CameraPos,
+                                   GLuint BoneBuffer, GLintptr BoneOffset) {
+    // All the sub-meshes share the model's bounds, so they get the same depth and end up
+    // ordered by material within it
+    glm::vec3 WorldCenter = glm::vec3(World * glm::vec4(m_BoundsCenter, 1.0f));
+
+    DrawPacket Packet;
+    Packet.pTechnique = pTechnique;
+    Packet.pDiffuseArray = &m_DiffuseArray;
+    Packet.pSpecularArray = &m_SpecularArray;
+    Packet.VAO = m_VAO;
+    Packet.World = World;
+    Packet.Depth = glm::length(WorldCenter - CameraPos);
+    Packet.BoneBuffer = BoneBuffer;
+    Packet.BoneOffset = BoneOffset;
+
+    if (m_UseMultiDraw) {
+        Packet.IndirectBuffer = m_Buffers[INDIRECT_BUFFER];
+        Packet.DrawCount = static_cast<GLsizei>(m_Meshes.size());
+        Packet.MaterialTable = m_Buffers[MATERIAL_TABLE_UB];
+
+        Queue.Add(Packet);
+        return;
+    }
 
     for (unsigned int i = 0; i < m_Meshes.size(); i++) {
         unsigned int MaterialIndex = m_Meshes[i].MaterialIndex;
 
         assert(MaterialIndex < m_Materials.size());
 
-        if (m_Materials[MaterialIndex].diffuseMap) {
-            m_Materials[MaterialIndex].diffuseMap->Bind(GL_TEXTURE0);
-        }
+        Packet.pMaterial = &m_Materials[MaterialIndex];
+        Packet.NumIndices = m_Meshes[i].NumIndices;
+        Packet.BaseIndex = m_Meshes[i].BaseIndex;
+        Packet.BaseVertex = m_Meshes[i].BaseVertex;
+
+        Queue.Add(Packet);
+    }
+}
+
 
-        if (m_Materials[MaterialIndex].pSpecularExponent) {
-            m_Materials[MaterialIndex].pSpecularExponent->Bind(GL_TEXTURE8);
+void SkinnedMesh::RequestTextureMips(TextureStreamer& Streamer, const glm::vec3& CameraLocalPos)
+{
+    // Distance to the closest point of the bounding sphere - good enough for small meshes
+    float Distance = std::max(glm::length(CameraLocalPos - m_BoundsCenter) - m_BoundsRadius, 0.0f);
+
+    for (unsigned int i = 0; i < m_Meshes.size(); i++) {
+        const Material& material = m_Materials[m_Meshes[i].MaterialIndex];
+
+        if (material.diffuseMap) {
+            Streamer.Request(material.diffuseMap.get(), m_Meshes[i].UVDensity, Distance);
         }
 
-        glDrawElementsBaseVertex(GL_TRIANGLES,
-            m_Meshes[i].NumIndices,
-            GL_UNSIGNED_INT,
-            (void*)(sizeof(unsigned int) * m_Meshes[i].BaseIndex),
-            m_Meshes[i].BaseVertex);
+        if (material.pSpecularExponent) {
+            Streamer.Request(material.pSpecularExponent.get(), m_Meshes[i].UVDensity, Distance);
+        }
     }
-
-    glBindVertexArray(0);
 }
 
 
@@ -1,11 +1,23 @@
 ﻿
 #include <iostream>
+#include <cmath>
 #include <glm/gtc/type_ptr.hpp>
 #include "..//headers/SkinningTechnique.h"
 #include "..//headers/Material.h"
 
 SkinningTechnique::SkinningTechnique() {}
 
+SkinningTechnique::~SkinningTechnique() {
+    GLuint Buffers[] = { m_LightsUBO, m_MaterialUBO, m_CameraUBO, m_DefaultMaterialTableUBO, m_IdentityBonesUBO };
+
+    for (unsigned int i = 0; i < sizeof(Buffers) / sizeof(Buffers[0]); i++) {
+        if (Buffers[i] != 0) {
+            GetGLState().OnDeleteBuffer(Buffers[i]);
+            glDeleteBuffers(1, &Buffers[i]);
+        }
+    }
+}
+
 bool SkinningTechnique::Init() {
 
     if (!Technique::Init()) {
@@ -25,86 +37,73 @@ bool SkinningTechnique::Init() {
     }
 
     // Assume shader program is compiled and linked at this point
-    WVPLoc = GetUniformLocation("gWVP");
+    WorldLoc = GetUniformLocation("gWorld");
     samplerLoc = GetUniformLocation("gSampler");
     samplerSpecularExponentLoc = GetUniformLocation("gSamplerSpecularExponent");
-    CameraLocalPosLoc = GetUniformLocation("gCameraLocalPos");
-    NumPointLightsLocation = GetUniformLocation("gNumPointLights");
-    NumSpotLightsLocation = GetUniformLocation("gNumSpotLights");
-
-    // Material
-    materialLoc.AmbientColor = GetUniformLocation("gMaterial.AmbientColor");
-    materialLoc.DiffuseColor = GetUniformLocation("gMaterial.DiffuseColor");
-    materialLoc.SpecularColor = GetUniformLocation("gMaterial.SpecularColor");
-
-    // Directional Light
-    dirLightLoc.Color = GetUniformLocation("gDirectionalLight.Base.Color");
-    dirLightLoc.AmbientIntensity = GetUniformLocation("gDirectionalLight.Base.AmbientIntensity");
-    dirLightLoc.Direction = GetUniformLocation("gDirectionalLight.Direction");
-    dirLightLoc.DiffuseIntensity = GetUniformLocation("gDirectionalLight.Base.DiffuseIntensity");
-
-    // Point Lights
-    char name[128];
-    for (unsigned int i = 0; i < MAX_POINT_LIGHTS; i++) {
-        snprintf(name, sizeof(name), "gPointLights[%d].Base.Color", i);
-        PointLightsLocation[i].Color = GetUniformLocation(name);
-
-        snprintf(name, sizeof(name), "gPointLights[%d].Base.AmbientIntensity", i);
-        PointLightsLocation[i].AmbientIntensity = GetUniformLocation(name);
+    samplerArrayLoc = GetUniformLocation("gSamplerArray");
+    samplerSpecularExponentArrayLoc = GetUniformLocation("gSamplerSpecularExponentArray");
+    displayBoneIndexLocation = GetUniformLocation("gDisplayBoneIndex");
 
-        snprintf(name, sizeof(name), "gPointLights[%d].LocalPos", i);
-        PointLightsLocation[i].Position = GetUniformLocation(name);
+    if (!BindUniformBlock("Lights", LIGHTS_BLOCK_BINDING, sizeof(LightsBlock)) ||
+        !BindUniformBlock("Material", MATERIAL_BLOCK_BINDING, sizeof(MaterialBlock)) ||
+        !BindUniformBlock("Camera", CAMERA_BLOCK_BINDING, sizeof(CameraBlock)) ||
+        !BindUniformBlock("MaterialTable", MATERIAL_TABLE_BLOCK_BINDING, sizeof(MaterialTableBlock)) ||
+        !BindUniformBlock("Bones", BONES_BLOCK_BINDING, sizeof(BonesBlock))) {
+        return false;
+    }
 
-        snprintf(name, sizeof(name), "gPointLights[%d].Base.DiffuseIntensity", i);
-        PointLightsLocation[i].DiffuseIntensity = GetUniformLocation(name);
+    m_LightsUBO = CreateUniformBuffer(LIGHTS_BLOCK_BINDING, sizeof(LightsBlock));
+    m_MaterialUBO = CreateUniformBuffer(MATERIAL_BLOCK_BINDING, sizeof(MaterialBlock));
+    m_CameraUBO = CreateUniformBuffer(CAMERA_BLOCK_BINDING, sizeof(CameraBlock));
 
-        snprintf(name, sizeof(name), "gPointLights[%d].Atten.Constant", i);
-        PointLightsLocation[i].Atten.Constant = GetUniformLocation(name);
+    // Meshes drawn with multi-draw bind their own table. This one only keeps the binding
+    // valid for the single draws, which never read it.
+    m_DefaultMaterialTableUBO = CreateUniformBuffer(MATERIAL_TABLE_BLOCK_BINDING, sizeof(MaterialTableBlock));
 
-        snprintf(name, sizeof(name), "gPointLights[%d].Atten.Linear", i);
-        PointLightsLocation[i].Atten.Linear = GetUniformLocation(name);
+    // Bind pose for the instances that come without a palette
+    BonesBlock* pIdentity = new BonesBlock();
 
-        snprintf(name, sizeof(name), "gPointLights[%d].Atten.Exp", i);
-        PointLightsLocation[i].Atten.Exp = GetUniformLocation(name);
+    for (unsigned int i = 0; i < BONES_BLOCK_MAX_BONES; i++) {
+        pIdentity->Bones[i] = glm::mat4(1.0f);
     }
 
-    // Spot Lights
-    for (unsigned int i = 0; i < MAX_SPOT_LIGHTS; i++) {
-        snprintf(name, sizeof(name), "gSpotLights[%d].Base.Base.Color", i);
-        SpotLightsLocation[i].Color = GetUniformLocation(name);
+    m_IdentityBonesUBO = CreateUniformBuffer(BONES_BLOCK_BINDING, sizeof(BonesBlock));
+    UploadUniformBuffer(m_IdentityBonesUBO, pIdentity, sizeof(BonesBlock));
+    delete pIdentity;
 
-        snprintf(name, sizeof(name), "gSpotLights[%d].Base.Base.AmbientIntensity", i);
-        SpotLightsLocation[i].AmbientIntensity = GetUniformLocation(name);
+    Enable();
+    SetTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+    SetSpecularExponentTextureUnit(SPECULAR_EXPONENT_UNIT_INDEX);
+    SetTextureArrayUnits(COLOR_ARRAY_UNIT_INDEX, SPECULAR_EXPONENT_ARRAY_UNIT_INDEX);
 
-        snprintf(name, sizeof(name), "gSpotLights[%d].Base.LocalPos", i);
-        SpotLightsLocation[i].Position = GetUniformLocation(name);
-
-        snprintf(name, sizeof(name), "gSpotLights[%d].Base.Base.DiffuseIntensity", i);
-        SpotLightsLocation[i].DiffuseIntensity = GetUniformLocation(name);
-
-        snprintf(name, sizeof(name), "gSpotLights[%d].Base.Atten.Constant", i);
-        SpotLightsLocation[i].Atten.Constant = GetUniformLocation(name);
-
-        snprintf(name, sizeof(name), "gSpotLights[%d].Base.Atten.Linear", i);
-        SpotLightsLocation[i].Atten.Linear = GetUniformLocation(name);
+    return Validate();
+}
 
-        snprintf(name, sizeof(name), "gSpotLights[%d].Base.Atten.Exp", i);
-        SpotLightsLocation[i].Atten.Exp = GetUniformLocation(name);
+GLuint SkinningTechnique::CreateUniformBuffer(UNIFORM_BLOCK_BINDING Binding, size_t Size) {
+    GLuint Buffer = 0;
+    glGenBuffers(1, &Buffer);
 
-        snprintf(name, sizeof(name), "gSpotLights[%d].Direction", i);
-        SpotLightsLocation[i].Direction = GetUniformLocation(name);
+    GetGLState().BindBuffer(GL_UNIFORM_BUFFER, Buffer);
+    glBufferData(GL_UNIFORM_BUFFER, Size, NULL, GL_DYNAMIC_DRAW);
 
-        snprintf(name, sizeof(name), "gSpotLights[%d].Cutoff", i);
-        SpotLightsLocation[i].Cutoff = GetUniformLocation(name);
-    }
+    // The binding points are never rebound, so the blocks stay attached for the program's lifetime
+    GetGLState().BindBufferBase(GL_UNIFORM_BUFFER, Binding, Buffer);
 
-    displayBoneIndexLocation = GetUniformLocation("gDisplayBoneIndex");
+    return Buffer;
+}
 
-    return true;
+void SkinningTechnique::UploadUniformBuffer(GLuint Buffer, const void* pData, size_t Size) {
+    GetGLState().BindBuffer(GL_UNIFORM_BUFFER, Buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, Size, pData);
+    m_NumUploads++;
 }
 
-void SkinningTechnique::SetWVP(const glm::mat4& WVP) {
-    glUniformMatrix4fv(WVPLoc, 1, GL_FALSE, glm::value_ptr(WVP));
+void SkinningTechnique::SetWorldMatrix(const glm::mat4& World) {
+    // Plain uniforms keep their value in the program object, so this is safe to skip too
+    if (UpdateBlock(m_World, World, m_WorldValid)) {
+        glUniformMatrix4fv(WorldLoc, 1, GL_FALSE, glm::value_ptr(World));
+        m_NumUploads++;
+    }
 }
 
 void SkinningTechnique::SetTextureUnit(unsigned int TextureUnit) {
@@ -115,53 +114,98 @@ void SkinningTechnique::SetSpecularExponentTextureUnit(unsigned int TextureUnit)
     glUniform1i(samplerSpecularExponentLoc, TextureUnit);
 }
 
-void SkinningTechnique::SetCameraLocalPos(const glm::vec3& CameraLocalPos) {
-    glUniform3fv(CameraLocalPosLoc, 1, glm::value_ptr(CameraLocalPos));
+void SkinningTechnique::SetTextureArrayUnits(unsigned int DiffuseTextureUnit, unsigned int SpecularExponentTextureUnit) {
+    glUniform1i(samplerArrayLoc, DiffuseTextureUnit);
+    glUniform1i(samplerSpecularExponentArrayLoc, SpecularExponentTextureUnit);
+}
+
+void SkinningTechnique::SetCamera(const glm::mat4& ViewProj, const glm::vec3& CameraWorldPos) {
+    CameraBlock Camera = m_Camera;
+    Camera.ViewProj = ViewProj;
+    Camera.CameraWorldPos = CameraWorldPos;
+
+    if (UpdateBlock(m_Camera, Camera, m_CameraValid)) {
+        UploadUniformBuffer(m_CameraUBO, &m_Camera, sizeof(m_Camera));
+    }
 }
 
 void SkinningTechnique::SetMaterial(const Material& material) {
-    glUniform3fv(materialLoc.AmbientColor, 1, glm::value_ptr(material.AmbientColor));
-    glUniform3fv(materialLoc.DiffuseColor, 1, glm::value_ptr(material.DiffuseColor));
-    glUniform3fv(materialLoc.SpecularColor, 1, glm::value_ptr(material.SpecularColor));
+    MaterialBlock Colors = m_Material;
+    Colors.AmbientColor = material.AmbientColor;
+    Colors.DiffuseColor = material.DiffuseColor;
+    Colors.SpecularColor = material.SpecularColor;
+
+    if (UpdateBlock(m_Material, Colors, m_MaterialValid)) {
+        UploadUniformBuffer(m_MaterialUBO, &m_Material, sizeof(m_Material));
+    }
+}
+
+static void PackPointLight(const PointLight& Light, PointLightStd140& Packed) {
+    Packed.Color = Light.Color;
+    Packed.AmbientIntensity = Light.AmbientIntensity;
+    Packed.Position = Light.WorldPosition;
+    Packed.DiffuseIntensity = Light.DiffuseIntensity;
+    Packed.Atten = glm::vec3(Light.Attenuation.Constant, Light.Attenuation.Linear, Light.Attenuation.Exp);
 }
 
 void SkinningTechnique::SetDirectionalLight(const DirectionalLight& Light) {
-    glUniform3fv(dirLightLoc.Color, 1, glm::value_ptr(Light.Color));
-    glUniform1f(dirLightLoc.AmbientIntensity, Light.AmbientIntensity);
-    glUniform3fv(dirLightLoc.Direction, 1, glm::value_ptr(Light.LocalDirection));
-    glUniform1f(dirLightLoc.DiffuseIntensity, Light.DiffuseIntensity);
+    m_Lights.DirectionalLight.Color = Light.Color;
+    m_Lights.DirectionalLight.AmbientIntensity = Light.AmbientIntensity;
+    m_Lights.DirectionalLight.Direction = Light.WorldDirection;
+    m_Lights.DirectionalLight.DiffuseIntensity = Light.DiffuseIntensity;
 }
 
 void SkinningTechnique::SetPointLights(unsigned int NumLights, const PointLight* pLights) {
-    glUniform1i(NumPointLightsLocation, NumLights);
+    if (NumLights > MAX_POINT_LIGHTS) {
+        NumLights = MAX_POINT_LIGHTS;
+    }
+
+    m_Lights.NumPointLights = NumLights;
 
     for (unsigned int i = 0; i < NumLights; ++i) {
-        glUniform3fv(PointLightsLocation[i].Color, 1, glm::value_ptr(pLights[i].Color));
-        glUniform1f(PointLightsLocation[i].AmbientIntensity, pLights[i].AmbientIntensity);
-        glUniform3fv(PointLightsLocation[i].Position, 1, glm::value_ptr(pLights[i].LocalPosition));
-        glUniform1f(PointLightsLocation[i].DiffuseIntensity, pLights[i].DiffuseIntensity);
-        glUniform1f(PointLightsLocation[i].Atten.Constant, pLights[i].Attenuation.Constant);
-        glUniform1f(PointLightsLocation[i].Atten.Linear, pLights[i].Attenuation.Linear);
-        glUniform1f(PointLightsLocation[i].Atten.Exp, pLights[i].Attenuation.Exp);
+        PackPointLight(pLights[i], m_Lights.PointLights[i]);
     }
 }
 
 void SkinningTechnique::SetSpotLights(unsigned int NumLights, const SpotLight* pLights) {
-    glUniform1i(NumSpotLightsLocation, NumLights);
+    if (NumLights > MAX_SPOT_LIGHTS) {
+        NumLights = MAX_SPOT_LIGHTS;
+    }
+
+    m_Lights.NumSpotLights = NumLights;
 
     for (unsigned int i = 0; i < NumLights; ++i) {
-        glUniform3fv(SpotLightsLocation[i].Color, 1, glm::value_ptr(pLights[i].Color));
-        glUniform1f(SpotLightsLocation[i].AmbientIntensity, pLights[i].AmbientIntensity);
-        glUniform3fv(SpotLightsLocation[i].Position, 1, glm::value_ptr(pLights[i].LocalPosition));
-        glUniform1f(SpotLightsLocation[i].DiffuseIntensity, pLights[i].DiffuseIntensity);
-        glUniform3fv(SpotLightsLocation[i].Direction, 1, glm::value_ptr(pLights[i].LocalDirection));
-        glUniform1f(SpotLightsLocation[i].Cutoff, pLights[i].Cutoff);
-        glUniform1f(SpotLightsLocation[i].Atten.Constant, pLights[i].Attenuation.Constant);
-        glUniform1f(SpotLightsLocation[i].Atten.Linear, pLights[i].Attenuation.Linear);
-        glUniform1f(SpotLightsLocation[i].Atten.Exp, pLights[i].Attenuation.Exp);
+        PackPointLight(pLights[i], m_Lights.SpotLights[i].Base);
+        m_Lights.SpotLights[i].Direction = glm::normalize(pLights[i].WorldDirection);
+        // Cutoff is given in degrees, the shader compares it against a dot product
+        m_Lights.SpotLights[i].Cutoff = cosf(glm::radians(pLights[i].Cutoff));
     }
 }
 
+void SkinningTechnique::CommitLights() {
+    if (UpdateBlock(m_UploadedLights, m_Lights, m_LightsValid)) {
+        UploadUniformBuffer(m_LightsUBO, &m_UploadedLights, sizeof(m_UploadedLights));
+    }
+}
+
+void SkinningTechnique::SetBonePalette(GLuint Buffer, GLintptr Offset) {
+    if (Buffer == 0) {
+        GetGLState().BindBufferBase(GL_UNIFORM_BUFFER, BONES_BLOCK_BINDING, m_IdentityBonesUBO);
+    }
+    else {
+        GetGLState().BindBufferRange(GL_UNIFORM_BUFFER, BONES_BLOCK_BINDING, Buffer, Offset, sizeof(BonesBlock));
+    }
+}
+
+void SkinningTechnique::GetUploadStats(unsigned int& NumUploads, unsigned int& NumSkipped) const {
+    NumUploads = m_NumUploads;
+    NumSkipped = m_NumSkippedUploads;
+}
+
+void SkinningTechnique::PrintStats() const {
+    printf("Skinning uniforms: %u uploads, %u skipped as unchanged\n", m_NumUploads, m_NumSkippedUploads);
+}
+
 void SkinningTechnique::SetDisplayBoneIndex(uint DisplayBoneIndex) {
     glUniform1i(displayBoneIndexLocation, DisplayBoneIndex);
 }
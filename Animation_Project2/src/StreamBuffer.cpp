@@ -0,0 +1,197 @@
+#include "..//headers/StreamBuffer.h"
+#include "..//headers/GLCapabilities.h"
+#include "..//headers/GLStateCache.h"
+#include <stdio.h>
+#include <chrono>
+
+// Polling interval while waiting for a fence
+#define FENCE_WAIT_TIMEOUT_NS   1000000ull
+
+
+StreamBuffer::~StreamBuffer()
+{
+    Clear();
+}
+
+
+void StreamBuffer::Clear()
+{
+    for (unsigned int i = 0; i < m_Fences.size(); i++) {
+        if (m_Fences[i]) {
+            glDeleteSync(m_Fences[i]);
+        }
+    }
+
+    m_Fences.clear();
+
+    if (m_Buffer != 0) {
+        if (m_pMapped) {
+            GetGLState().BindBuffer(m_Target, m_Buffer);
+            glUnmapBuffer(m_Target);
+            m_pMapped = NULL;
+        }
+
+        GetGLState().OnDeleteBuffer(m_Buffer);
+        glDeleteBuffers(1, &m_Buffer);
+        m_Buffer = 0;
+    }
+
+    m_Staging.clear();
+}
+
+
+bool StreamBuffer::Init(GLenum Target, GLsizeiptr FrameSize, unsigned int NumFrames)
+{
+    Clear();
+
+    const GLCapabilities& Caps = GetGLCapabilities();
+
+    m_Target = Target;
+    m_NumFrames = NumFrames > 0 ? NumFrames : 1;
+    m_CurFrame = 0;
+    m_Head = 0;
+    m_FlushedHead = 0;
+
+    if (Target == GL_UNIFORM_BUFFER && Caps.UniformBufferOffsetAlignment > 0) {
+        m_DefaultAlignment = Caps.UniformBufferOffsetAlignment;
+    }
+
+    // Regions start on an aligned offset so that every allocation can be
+    m_FrameSize = (FrameSize + m_DefaultAlignment - 1) / m_DefaultAlignment * m_DefaultAlignment;
+
+    glGenBuffers(1, &m_Buffer);
+    GetGLState().BindBuffer(m_Target, m_Buffer);
+
+    if (Caps.BufferStorage) {
+        GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr TotalSize = m_FrameSize * m_NumFrames;
+
+        glBufferStorage(m_Target, TotalSize, NULL, Flags);
+        m_pMapped = (unsigned char*)glMapBufferRange(m_Target, 0, TotalSize, Flags);
+
+        if (!m_pMapped) {
+            fprintf(stderr, "Unable to map the stream buffer persistently\n");
+            Clear();
+            return false;
+        }
+
+        m_Fences.resize(m_NumFrames, (GLsync)0);
+    }
+    else {
+        // Orphaning gives a fresh store every frame, so one region is enough
+        glBufferData(m_Target, m_FrameSize, NULL, GL_STREAM_DRAW);
+        m_Staging.resize(m_FrameSize);
+    }
+
+    return true;
+}
+
+
+void StreamBuffer::BeginFrame()
+{
+    m_Head = 0;
+    m_FlushedHead = 0;
+
+    if (!m_pMapped) {
+        // Tell the driver we don't need the old contents so it doesn't wait for the GPU
+        GetGLState().BindBuffer(m_Target, m_Buffer);
+        glBufferData(m_Target, m_FrameSize, NULL, GL_STREAM_DRAW);
+        return;
+    }
+
+    GLsync Fence = m_Fences[m_CurFrame];
+
+    if (!Fence) {
+        return;
+    }
+
+    GLenum Result = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+    if (Result == GL_TIMEOUT_EXPIRED) {
+        // The GPU is NumFrames behind: a stall, which the stats should make visible
+        m_Stats.NumFenceWaits++;
+
+        auto WaitStart = std::chrono::steady_clock::now();
+
+        do {
+            Result = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT_NS);
+        } while (Result == GL_TIMEOUT_EXPIRED);
+
+        m_Stats.FenceWaitTimeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - WaitStart).count();
+    }
+
+    if (Result == GL_WAIT_FAILED) {
+        fprintf(stderr, "Waiting for a stream buffer fence failed\n");
+    }
+
+    glDeleteSync(Fence);
+    m_Fences[m_CurFrame] = (GLsync)0;
+}
+
+
+bool StreamBuffer::Allocate(GLsizeiptr Size, Allocation& Alloc, GLsizeiptr Alignment)
+{
+    if (Alignment <= 0) {
+        Alignment = m_DefaultAlignment;
+    }
+
+    GLsizeiptr Start = (m_Head + Alignment - 1) / Alignment * Alignment;
+
+    if (m_Buffer == 0 || Start + Size > m_FrameSize) {
+        m_Stats.NumOverflows++;
+        return false;
+    }
+
+    m_Head = Start + Size;
+
+    if (m_pMapped) {
+        Alloc.Offset = m_CurFrame * m_FrameSize + Start;
+        Alloc.pData = m_pMapped + Alloc.Offset;
+    }
+    else {
+        Alloc.Offset = Start;
+        Alloc.pData = m_Staging.data() + Start;
+    }
+
+    Alloc.Buffer = m_Buffer;
+    Alloc.Size = Size;
+
+    m_Stats.NumAllocations++;
+    m_Stats.BytesAllocated += Size;
+
+    return true;
+}
+
+
+void StreamBuffer::Flush()
+{
+    // Coherent mappings need nothing, the writes are visible to the next command
+    if (m_pMapped || m_Head == m_FlushedHead) {
+        return;
+    }
+
+    GetGLState().BindBuffer(m_Target, m_Buffer);
+    glBufferSubData(m_Target, m_FlushedHead, m_Head - m_FlushedHead, m_Staging.data() + m_FlushedHead);
+
+    m_FlushedHead = m_Head;
+}
+
+
+void StreamBuffer::EndFrame()
+{
+    if (!m_pMapped) {
+        return;
+    }
+
+    m_Fences[m_CurFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_CurFrame = (m_CurFrame + 1) % m_NumFrames;
+}
+
+
+void StreamBuffer::PrintStats(const char* pName) const
+{
+    printf("Stream buffer '%s' (%s, %d KB x %u): %llu allocations, %.2f MB, %u overflows, %u fence waits (%.2f ms)\n",
+        pName, m_pMapped ? "persistent" : "orphaning", (int)(m_FrameSize / 1024), m_pMapped ? m_NumFrames : 1,
+        m_Stats.NumAllocations, m_Stats.BytesAllocated / (1024.0 * 1024.0), m_Stats.NumOverflows,
+        m_Stats.NumFenceWaits, m_Stats.FenceWaitTimeMs);
+}
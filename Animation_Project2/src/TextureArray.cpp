@@ -0,0 +1,133 @@
+#include "..//headers/TextureArray.h"
+#include "..//headers/Material.h"
+
+#include <algorithm>
+
+
+TextureArray::~TextureArray()
+{
+    Clear();
+}
+
+
+void TextureArray::Clear()
+{
+    if (m_textureObj != 0) {
+        GetGLState().OnDeleteTexture(m_textureObj);
+        glDeleteTextures(1, &m_textureObj);
+        m_textureObj = 0;
+    }
+
+    m_width = 0;
+    m_height = 0;
+    m_numLayers = 0;
+    m_sizeInBytes = 0;
+}
+
+
+bool TextureArray::CanShareArray(const Texture& a, const Texture& b)
+{
+    return a.GetInternalFormat() == b.GetInternalFormat() && a.isCompressed == b.isCompressed &&
+           a.imageWidth == b.imageWidth && a.imageHeight == b.imageHeight && a.numLevels == b.numLevels;
+}
+
+
+bool TextureArray::Build(const std::vector<Texture*>& Textures)
+{
+    Clear();
+
+    if (Textures.empty()) {
+        return false;
+    }
+
+    GLint MaxLayers = GetGLCapabilities().MaxArrayTextureLayers;
+
+    if ((GLint)Textures.size() > MaxLayers) {
+        printf("Can't pack %u textures into an array, the limit is %d layers\n", (unsigned int)Textures.size(), MaxLayers);
+        return false;
+    }
+
+    const Texture* pFirst = Textures[0];
+
+    for (unsigned int i = 1; i < Textures.size(); i++) {
+        if (!CanShareArray(*pFirst, *Textures[i])) {
+            printf("Can't pack '%s' with '%s', the format or the size differs\n", Textures[i]->path.c_str(), pFirst->path.c_str());
+            return false;
+        }
+    }
+
+    m_width = pFirst->imageWidth;
+    m_height = pFirst->imageHeight;
+    m_numLayers = static_cast<unsigned int>(Textures.size());
+
+    GLenum InternalFormat = pFirst->GetInternalFormat();
+    int NumLevels = pFirst->isKTX ? pFirst->numLevels : 1;
+
+    glGenTextures(1, &m_textureObj);
+    GetGLState().BindTextureForEdit(GL_TEXTURE_2D_ARRAY, m_textureObj);
+
+    // Storage for every level, the layers fill it below
+    for (int Level = 0; Level < NumLevels; Level++) {
+        GLsizei Width = std::max(m_width >> Level, 1);
+        GLsizei Height = std::max(m_height >> Level, 1);
+
+        if (pFirst->isCompressed) {
+            size_t LevelSize = pFirst->GetLevelSize(Level) * m_numLayers;
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, Level, InternalFormat, Width, Height, m_numLayers, 0, (GLsizei)LevelSize, NULL);
+            m_sizeInBytes += LevelSize;
+        }
+        else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, Level, InternalFormat, Width, Height, m_numLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            m_sizeInBytes += (pFirst->isKTX ? pFirst->GetLevelSize(Level) : (size_t)Width * Height * pFirst->imageBPP) * m_numLayers;
+        }
+    }
+
+    // The levels are copied from the files: reading them back from the GPU would decompress
+    // the cooked textures
+    stbi_set_flip_vertically_on_load(1);
+
+    for (unsigned int i = 0; i < Textures.size(); i++) {
+        if (!Textures[i]->CopyToArrayLayer(i)) {
+            GetGLState().BindTextureForEdit(GL_TEXTURE_2D_ARRAY, 0);
+            Clear();
+            return false;
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Same mip handling as the source textures
+    if (NumLevels > 1) {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, NumLevels - 1);
+    }
+    else if (pFirst->isCompressed) {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    else {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        m_sizeInBytes += m_sizeInBytes / 3;
+    }
+
+    GetGLState().BindTextureForEdit(GL_TEXTURE_2D_ARRAY, 0);
+
+    printf("Packed %u textures into a %dx%d texture array (%s, %d levels)\n", m_numLayers, m_width, m_height,
+        pFirst->isCompressed ? "compressed" : "uncompressed", NumLevels);
+
+    return true;
+}
+
+
+void TextureArray::Bind(GLenum TextureUnit) const
+{
+    GetGLState().BindTexture(TextureUnit - GL_TEXTURE0, GL_TEXTURE_2D_ARRAY, m_textureObj);
+}
+
+
+size_t TextureArray::GetSizeInBytes() const
+{
+    return m_sizeInBytes;
+}
@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include <gli/gli.hpp>
+#include <stb_image.h>
+
+#include "..//headers/TextureCooker.h"
+
+// A single mip level, always RGBA8
+struct CookImage {
+    int Width = 0;
+    int Height = 0;
+    std::vector<uint8_t> Pixels;
+
+    const uint8_t* GetTexel(int x, int y) const
+    {
+        // Clamp so that levels smaller than a block replicate their edge
+        x = std::min(x, Width - 1);
+        y = std::min(y, Height - 1);
+        return &Pixels[(y * Width + x) * 4];
+    }
+};
+
+
+static CookImage Downsample(const CookImage& Src)
+{
+    CookImage Dst;
+    Dst.Width = std::max(Src.Width / 2, 1);
+    Dst.Height = std::max(Src.Height / 2, 1);
+    Dst.Pixels.resize(Dst.Width * Dst.Height * 4);
+
+    // 2x2 box filter
+    for (int y = 0; y < Dst.Height; y++) {
+        for (int x = 0; x < Dst.Width; x++) {
+            const uint8_t* p00 = Src.GetTexel(x * 2, y * 2);
+            const uint8_t* p10 = Src.GetTexel(x * 2 + 1, y * 2);
+            const uint8_t* p01 = Src.GetTexel(x * 2, y * 2 + 1);
+            const uint8_t* p11 = Src.GetTexel(x * 2 + 1, y * 2 + 1);
+
+            for (int c = 0; c < 4; c++) {
+                Dst.Pixels[(y * Dst.Width + x) * 4 + c] = (uint8_t)((p00[c] + p10[c] + p01[c] + p11[c] + 2) / 4);
+            }
+        }
+    }
+
+    return Dst;
+}
+
+
+static void FetchBlock(const CookImage& Image, int bx, int by, uint8_t Block[16][4])
+{
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            memcpy(Block[y * 4 + x], Image.GetTexel(bx * 4 + x, by * 4 + y), 4);
+        }
+    }
+}
+
+
+static uint16_t PackRGB565(const uint8_t* c)
+{
+    return (uint16_t)(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+}
+
+
+static void UnpackRGB565(uint16_t v, int c[3])
+{
+    c[0] = ((v >> 11) & 31) * 255 / 31;
+    c[1] = ((v >> 5) & 63) * 255 / 63;
+    c[2] = (v & 31) * 255 / 31;
+}
+
+
+// BC1 color block from the inset bounding box of the texels (64 bits)
+static void EncodeBC1(const uint8_t Block[16][4], uint8_t* pDst)
+{
+    uint8_t Min[3] = { 255, 255, 255 };
+    uint8_t Max[3] = { 0, 0, 0 };
+
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            Min[c] = std::min(Min[c], Block[i][c]);
+            Max[c] = std::max(Max[c], Block[i][c]);
+        }
+    }
+
+    // Pull the end points in by 1/16 of the range to reduce the error from the extremes
+    for (int c = 0; c < 3; c++) {
+        int Inset = (Max[c] - Min[c]) >> 4;
+        Min[c] = (uint8_t)std::min(Min[c] + Inset, 255);
+        Max[c] = (uint8_t)std::max(Max[c] - Inset, 0);
+    }
+
+    uint16_t c0 = PackRGB565(Max);
+    uint16_t c1 = PackRGB565(Min);
+
+    uint32_t Indices = 0;
+
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+
+    if (c0 != c1) {
+        // c0 > c1 selects the four color mode
+        int Palette[4][3];
+        UnpackRGB565(c0, Palette[0]);
+        UnpackRGB565(c1, Palette[1]);
+
+        for (int c = 0; c < 3; c++) {
+            Palette[2][c] = (2 * Palette[0][c] + Palette[1][c]) / 3;
+            Palette[3][c] = (Palette[0][c] + 2 * Palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++) {
+            int Best = 0;
+            int BestDist = 0x7fffffff;
+
+            for (int p = 0; p < 4; p++) {
+                int dr = Block[i][0] - Palette[p][0];
+                int dg = Block[i][1] - Palette[p][1];
+                int db = Block[i][2] - Palette[p][2];
+                int Dist = dr * dr + dg * dg + db * db;
+
+                if (Dist < BestDist) {
+                    BestDist = Dist;
+                    Best = p;
+                }
+            }
+
+            Indices |= (uint32_t)Best << (i * 2);
+        }
+    }
+
+    pDst[0] = (uint8_t)(c0 & 0xff);
+    pDst[1] = (uint8_t)(c0 >> 8);
+    pDst[2] = (uint8_t)(c1 & 0xff);
+    pDst[3] = (uint8_t)(c1 >> 8);
+    memcpy(pDst + 4, &Indices, 4);
+}
+
+
+// BC4 single channel block, used for the BC3 alpha and both BC5 channels (64 bits)
+static void EncodeBC4(const uint8_t Block[16][4], int Channel, uint8_t* pDst)
+{
+    uint8_t Min = 255;
+    uint8_t Max = 0;
+
+    for (int i = 0; i < 16; i++) {
+        Min = std::min(Min, Block[i][Channel]);
+        Max = std::max(Max, Block[i][Channel]);
+    }
+
+    pDst[0] = Max;
+    pDst[1] = Min;
+
+    uint64_t Indices = 0;
+
+    if (Max != Min) {
+        // a0 > a1 selects the eight value mode
+        int Palette[8];
+        Palette[0] = Max;
+        Palette[1] = Min;
+
+        for (int p = 1; p < 7; p++) {
+            Palette[p + 1] = ((7 - p) * Max + p * Min) / 7;
+        }
+
+        for (int i = 0; i < 16; i++) {
+            int Best = 0;
+            int BestDist = 256;
+
+            for (int p = 0; p < 8; p++) {
+                int Dist = abs(Block[i][Channel] - Palette[p]);
+
+                if (Dist < BestDist) {
+                    BestDist = Dist;
+                    Best = p;
+                }
+            }
+
+            Indices |= (uint64_t)Best << (i * 3);
+        }
+    }
+
+    for (int b = 0; b < 6; b++) {
+        pDst[2 + b] = (uint8_t)(Indices >> (b * 8));
+    }
+}
+
+
+// BC7 mode 6 block: one subset, RGBA end points with 7 bits + a shared p-bit each
+// and 4 bit indices (128 bits). Only the single mode is used, which keeps the encoder
+// simple while still beating BC3 on gradients.
+static void EncodeBC7(const uint8_t Block[16][4], uint8_t* pDst)
+{
+    static const int Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    int Min[4] = { 255, 255, 255, 255 };
+    int Max[4] = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            Min[c] = std::min(Min[c], (int)Block[i][c]);
+            Max[c] = std::max(Max[c], (int)Block[i][c]);
+        }
+    }
+
+    // Quantize to 7 bits and pick the p-bit that best matches the low bit of the end point
+    int Ep[2][4];
+    int PBit[2];
+    const int* pSrc[2] = { Min, Max };
+
+    for (int e = 0; e < 2; e++) {
+        int LowBits = 0;
+
+        for (int c = 0; c < 4; c++) {
+            LowBits += pSrc[e][c] & 1;
+        }
+
+        PBit[e] = LowBits >= 2 ? 1 : 0;
+
+        for (int c = 0; c < 4; c++) {
+            Ep[e][c] = std::min(std::max((pSrc[e][c] - PBit[e] + 1) >> 1, 0), 127);
+        }
+    }
+
+    int Expanded[2][4];
+
+    for (int e = 0; e < 2; e++) {
+        for (int c = 0; c < 4; c++) {
+            Expanded[e][c] = (Ep[e][c] << 1) | PBit[e];
+        }
+    }
+
+    int Indices[16];
+
+    for (int i = 0; i < 16; i++) {
+        int Best = 0;
+        int BestDist = 0x7fffffff;
+
+        for (int w = 0; w < 16; w++) {
+            int Dist = 0;
+
+            for (int c = 0; c < 4; c++) {
+                int v = ((64 - Weights[w]) * Expanded[0][c] + Weights[w] * Expanded[1][c] + 32) >> 6;
+                Dist += (v - Block[i][c]) * (v - Block[i][c]);
+            }
+
+            if (Dist < BestDist) {
+                BestDist = Dist;
+                Best = w;
+            }
+        }
+
+        Indices[i] = Best;
+    }
+
+    // The high bit of the first index is implicit zero - swap the end points if needed
+    if (Indices[0] & 8) {
+        for (int c = 0; c < 4; c++) {
+            std::swap(Ep[0][c], Ep[1][c]);
+        }
+
+        std::swap(PBit[0], PBit[1]);
+
+        for (int i = 0; i < 16; i++) {
+            Indices[i] = 15 - Indices[i];
+        }
+    }
+
+    uint8_t Bits[16] = { 0 };
+    int Pos = 0;
+
+    auto Write = [&Bits, &Pos](uint32_t Value, int NumBits) {
+        for (int b = 0; b < NumBits; b++, Pos++) {
+            Bits[Pos >> 3] |= (uint8_t)(((Value >> b) & 1) << (Pos & 7));
+        }
+    };
+
+    Write(1 << 6, 7);       // mode 6
+
+    for (int c = 0; c < 4; c++) {
+        Write(Ep[0][c], 7);
+        Write(Ep[1][c], 7);
+    }
+
+    Write(PBit[0], 1);
+    Write(PBit[1], 1);
+
+    Write(Indices[0], 3);
+
+    for (int i = 1; i < 16; i++) {
+        Write(Indices[i], 4);
+    }
+
+    memcpy(pDst, Bits, 16);
+}
+
+
+static void EncodeBlock(const uint8_t Block[16][4], TEXTURE_COOK_FORMAT Format, uint8_t* pDst)
+{
+    switch (Format) {
+    case COOK_FORMAT_BC1:
+        EncodeBC1(Block, pDst);
+        break;
+
+    case COOK_FORMAT_BC3:
+        EncodeBC4(Block, 3, pDst);
+        EncodeBC1(Block, pDst + 8);
+        break;
+
+    case COOK_FORMAT_BC5:
+        EncodeBC4(Block, 0, pDst);
+        EncodeBC4(Block, 1, pDst + 8);
+        break;
+
+    case COOK_FORMAT_BC7:
+        EncodeBC7(Block, pDst);
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+static gli::format GetGLIFormat(TEXTURE_COOK_FORMAT Format)
+{
+    switch (Format) {
+    case COOK_FORMAT_BC1:
+        return gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+    case COOK_FORMAT_BC3:
+        return gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+    case COOK_FORMAT_BC5:
+        return gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+    case COOK_FORMAT_BC7:
+        return gli::FORMAT_RGBA_BP_UNORM_BLOCK16;
+    default:
+        return gli::FORMAT_UNDEFINED;
+    }
+}
+
+
+bool CookTexture(const std::string& SrcPath, const std::string& DstPath, TEXTURE_COOK_FORMAT Format)
+{
+    CookImage Base;
+    int NumChannels = 0;
+
+    // Same orientation as the runtime stb_image path so cooked and raw textures are interchangeable
+    stbi_set_flip_vertically_on_load(1);
+
+    unsigned char* pData = stbi_load(SrcPath.c_str(), &Base.Width, &Base.Height, &NumChannels, 4);
+
+    if (!pData) {
+        printf("Can't load texture from '%s' - %s\n", SrcPath.c_str(), stbi_failure_reason());
+        return false;
+    }
+
+    Base.Pixels.assign(pData, pData + Base.Width * Base.Height * 4);
+    stbi_image_free(pData);
+
+    if (Format == COOK_FORMAT_AUTO) {
+        Format = (NumChannels == 4 || NumChannels == 2) ? COOK_FORMAT_BC3 : COOK_FORMAT_BC1;
+    }
+
+    std::vector<CookImage> Levels;
+    Levels.push_back(Base);
+
+    while (Levels.back().Width > 1 || Levels.back().Height > 1) {
+        Levels.push_back(Downsample(Levels.back()));
+    }
+
+    gli::format GLIFormat = GetGLIFormat(Format);
+
+    gli::texture2d Cooked(GLIFormat, gli::extent2d(Base.Width, Base.Height), Levels.size());
+
+    size_t BlockSize = gli::block_size(GLIFormat);
+
+    for (size_t Level = 0; Level < Levels.size(); Level++) {
+        const CookImage& Image = Levels[Level];
+        int NumBlocksX = (Image.Width + 3) / 4;
+        int NumBlocksY = (Image.Height + 3) / 4;
+
+        uint8_t* pDst = (uint8_t*)Cooked.data(0, 0, Level);
+
+        if ((size_t)(NumBlocksX * NumBlocksY) * BlockSize != Cooked.size(Level)) {
+            printf("Unexpected level size %zu for level %zu of '%s'\n", Cooked.size(Level), Level, SrcPath.c_str());
+            return false;
+        }
+
+        uint8_t Block[16][4];
+
+        for (int by = 0; by < NumBlocksY; by++) {
+            for (int bx = 0; bx < NumBlocksX; bx++) {
+                FetchBlock(Image, bx, by, Block);
+                EncodeBlock(Block, Format, pDst);
+                pDst += BlockSize;
+            }
+        }
+    }
+
+    if (!gli::save_ktx(Cooked, DstPath)) {
+        printf("Error writing '%s'\n", DstPath.c_str());
+        return false;
+    }
+
+    printf("Cooked '%s' -> '%s' (%dx%d, %zu levels, %zu KB)\n", SrcPath.c_str(), DstPath.c_str(),
+        Base.Width, Base.Height, Levels.size(), Cooked.size() / 1024);
+
+    return true;
+}
+
+
+std::string GetCookedTexturePath(const std::string& SrcPath)
+{
+    size_t Dot = SrcPath.find_last_of('.');
+    size_t Slash = SrcPath.find_last_of("/\\");
+
+    if (Dot == std::string::npos || (Slash != std::string::npos && Dot < Slash)) {
+        return SrcPath + ".ktx";
+    }
+
+    return SrcPath.substr(0, Dot) + ".ktx";
+}
+
+
+bool ParseCookFormat(const char* pName, TEXTURE_COOK_FORMAT& Format)
+{
+    static const struct {
+        const char* pName;
+        TEXTURE_COOK_FORMAT Format;
+    } Formats[] = {
+        { "auto", COOK_FORMAT_AUTO },
+        { "bc1", COOK_FORMAT_BC1 },
+        { "bc3", COOK_FORMAT_BC3 },
+        { "bc5", COOK_FORMAT_BC5 },
+        { "bc7", COOK_FORMAT_BC7 },
+    };
+
+    for (unsigned int i = 0; i < sizeof(Formats) / sizeof(Formats[0]); i++) {
+        if (!strcmp(pName, Formats[i].pName)) {
+            Format = Formats[i].Format;
+            return true;
+        }
+    }
+
+    return false;
+}
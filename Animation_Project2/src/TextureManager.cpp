@@ -0,0 +1,251 @@
+#include "..//headers/TextureManager.h"
+#include "..//headers/TextureCooker.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <vector>
+
+
+TextureManager::~TextureManager()
+{
+    PrintStats();
+}
+
+
+std::string TextureManager::NormalizePath(const std::string& Path)
+{
+    std::string p(Path);
+    std::replace(p.begin(), p.end(), '\\', '/');
+
+#ifdef _WIN32
+    // The file system is case insensitive so "Tex.JPG" and "tex.jpg" are the same file
+    std::transform(p.begin(), p.end(), p.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+#endif
+
+    bool IsAbsolute = !p.empty() && p[0] == '/';
+
+    // Resolve "." and ".." and collapse repeated separators
+    std::vector<std::string> Parts;
+    size_t Start = 0;
+
+    while (Start <= p.size()) {
+        size_t End = p.find('/', Start);
+        if (End == std::string::npos) {
+            End = p.size();
+        }
+
+        std::string Part = p.substr(Start, End - Start);
+
+        if (Part == "..") {
+            if (!Parts.empty() && Parts.back() != "..") {
+                Parts.pop_back();
+            }
+            else if (!IsAbsolute) {
+                Parts.push_back(Part);
+            }
+        }
+        else if (!Part.empty() && Part != ".") {
+            Parts.push_back(Part);
+        }
+
+        Start = End + 1;
+    }
+
+    std::string Ret = IsAbsolute ? "/" : "";
+
+    for (unsigned int i = 0; i < Parts.size(); i++) {
+        if (i > 0) {
+            Ret += "/";
+        }
+        Ret += Parts[i];
+    }
+
+    return Ret;
+}
+
+
+std::string TextureManager::MakeKey(const std::string& NormalizedPath, GLenum TextureTarget)
+{
+    return NormalizedPath + "#" + std::to_string(TextureTarget);
+}
+
+
+std::string TextureManager::ResolvePath(const std::string& Path) const
+{
+    if (!m_PreferCooked) {
+        return Path;
+    }
+
+    std::string CookedPath = GetCookedTexturePath(Path);
+
+    if (CookedPath == Path) {
+        return Path;
+    }
+
+    FILE* f = fopen(CookedPath.c_str(), "rb");
+
+    if (!f) {
+        return Path;
+    }
+
+    fclose(f);
+
+    return CookedPath;
+}
+
+
+std::shared_ptr<Texture> TextureManager::Load(const std::string& Path, GLenum TextureTarget)
+{
+    std::shared_ptr<Texture> pTexture = Request(Path, TextureTarget);
+
+    FlushPendingLoads();
+
+    if (pTexture && !pTexture->IsLoaded()) {
+        return nullptr;
+    }
+
+    return pTexture;
+}
+
+
+std::shared_ptr<Texture> TextureManager::Request(const std::string& Path, GLenum TextureTarget)
+{
+    std::string NormalizedPath = NormalizePath(ResolvePath(Path));
+    std::string Key = MakeKey(NormalizedPath, TextureTarget);
+
+    auto it = m_Textures.find(Key);
+
+    if (it != m_Textures.end()) {
+        m_NumHits++;
+        it->second.LastUse = ++m_UseCounter;
+        return it->second.pTexture;
+    }
+
+    m_NumMisses++;
+
+    TextureEntry& Entry = m_Textures[Key];
+    Entry.pTexture = std::make_shared<Texture>(TextureTarget, NormalizedPath.c_str());
+    Entry.LastUse = ++m_UseCounter;
+
+    m_PendingLoads.push_back(Key);
+
+    return Entry.pTexture;
+}
+
+
+unsigned int TextureManager::FlushPendingLoads()
+{
+    if (m_PendingLoads.empty()) {
+        return 0;
+    }
+
+    std::vector<Texture*> Batch;
+
+    for (unsigned int i = 0; i < m_PendingLoads.size(); i++) {
+        Batch.push_back(m_Textures[m_PendingLoads[i]].pTexture.get());
+    }
+
+    auto DecodeStart = std::chrono::steady_clock::now();
+
+    // The flip flag is global in stb_image so set it once, before any job reads it
+    stbi_set_flip_vertically_on_load(1);
+
+    // One texture per job, they vary too much in size for larger batches. Failures are
+    // picked up below through IsDecoded().
+    GetJobSystem().ParallelFor((unsigned int)Batch.size(), 1, [&Batch](unsigned int Begin, unsigned int End) {
+        for (unsigned int i = Begin; i < End; i++) {
+            Batch[i]->Decode();
+        }
+    });
+
+    auto UploadStart = std::chrono::steady_clock::now();
+
+    unsigned int NumFailed = 0;
+
+    for (unsigned int i = 0; i < m_PendingLoads.size(); i++) {
+        auto it = m_Textures.find(m_PendingLoads[i]);
+        TextureEntry& Entry = it->second;
+
+        if (!Entry.pTexture->IsDecoded()) {
+            NumFailed++;
+            m_Textures.erase(it);
+            continue;
+        }
+
+        if (m_pStreamer && Entry.pTexture->IsStreamable()) {
+            m_pStreamer->Register(Entry.pTexture);
+        }
+        else {
+            Entry.pTexture->Upload();
+        }
+    }
+
+    auto UploadEnd = std::chrono::steady_clock::now();
+
+    m_DecodeTimeMs += std::chrono::duration<double, std::milli>(UploadStart - DecodeStart).count();
+    m_UploadTimeMs += std::chrono::duration<double, std::milli>(UploadEnd - UploadStart).count();
+
+    m_PendingLoads.clear();
+
+    if (m_MemoryBudget > 0 && GetMemoryUsage() > m_MemoryBudget) {
+        EvictUnused(m_MemoryBudget);
+    }
+
+    return NumFailed;
+}
+
+
+void TextureManager::EvictUnused(size_t BudgetBytes)
+{
+    std::vector<std::map<std::string, TextureEntry>::iterator> Candidates;
+
+    for (auto it = m_Textures.begin(); it != m_Textures.end(); it++) {
+        // The only remaining reference is our own
+        if (it->second.pTexture.use_count() == 1 && it->second.pTexture->IsLoaded()) {
+            Candidates.push_back(it);
+        }
+    }
+
+    std::sort(Candidates.begin(), Candidates.end(),
+        [](const std::map<std::string, TextureEntry>::iterator& a, const std::map<std::string, TextureEntry>::iterator& b) {
+            return a->second.LastUse < b->second.LastUse;
+        });
+
+    size_t MemoryUsage = GetMemoryUsage();
+
+    for (unsigned int i = 0; i < Candidates.size(); i++) {
+        if (BudgetBytes > 0 && MemoryUsage <= BudgetBytes) {
+            break;
+        }
+
+        MemoryUsage -= Candidates[i]->second.pTexture->GetSizeInBytes();
+        m_NumEvictions++;
+
+        // Releasing the last reference deletes the GL texture
+        m_Textures.erase(Candidates[i]);
+    }
+}
+
+
+size_t TextureManager::GetMemoryUsage() const
+{
+    size_t MemoryUsage = 0;
+
+    for (auto it = m_Textures.begin(); it != m_Textures.end(); it++) {
+        if (it->second.pTexture->IsLoaded()) {
+            MemoryUsage += it->second.pTexture->GetSizeInBytes();
+        }
+    }
+
+    return MemoryUsage;
+}
+
+
+void TextureManager::PrintStats() const
+{
+    printf("Texture cache: %u textures, %.2f MB resident, %u hits, %u misses, %u evictions\n",
+        NumTextures(), GetMemoryUsage() / (1024.0 * 1024.0), m_NumHits, m_NumMisses, m_NumEvictions);
+
+    printf("Texture loads: %.2f ms decoding on %u threads, %.2f ms uploading\n",
+        m_DecodeTimeMs, GetJobSystem().GetNumThreads(), m_UploadTimeMs);
+}
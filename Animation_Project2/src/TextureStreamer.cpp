@@ -0,0 +1,265 @@
+#include <glad/glad.h>
+#include "..//headers/TextureStreamer.h"
+#include "..//headers/Material.h"
+#include "..//headers/FrameArena.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+
+TextureStreamer::~TextureStreamer()
+{
+    for (unsigned int i = 0; i < m_PendingLoads.size(); i++) {
+        GetJobSystem().Wait(m_PendingLoads[i]->Counter);
+        m_PendingLoads[i]->pTexture->ReleaseStagingData();
+    }
+}
+
+
+void TextureStreamer::Register(const std::shared_ptr<Texture>& pTexture)
+{
+    StreamedTexture Entry;
+    Entry.pTexture = pTexture;
+    Entry.pRaw = pTexture.get();
+    Entry.TailLevel = pTexture->GetLevelForSize(m_TailSize);
+    Entry.WantedLevel = Entry.TailLevel;
+    Entry.TargetLevel = Entry.TailLevel;
+
+    pTexture->residentBaseLevel = Entry.TailLevel;
+    pTexture->streamerIndex = (int)m_Textures.size();
+    pTexture->Upload();
+
+    m_Textures.push_back(Entry);
+}
+
+
+void TextureStreamer::BeginFrame(const glm::vec3& CameraPos, float FOVDegrees, float ViewportHeight)
+{
+    m_CameraPos = CameraPos;
+    m_Frame++;
+
+    // Number of pixels covered by one world unit seen face on from one unit away
+    m_PixelsPerUnitAtUnitDistance = ViewportHeight / (2.0f * tanf(glm::radians(FOVDegrees) * 0.5f));
+
+    for (unsigned int i = 0; i < m_Textures.size(); i++) {
+        m_Textures[i].Requested = false;
+        m_Textures[i].MinDistance = FLT_MAX;
+    }
+}
+
+
+void TextureStreamer::Request(Texture* pTexture, float UVDensity, float Distance)
+{
+    if (!pTexture || !pTexture->IsStreamed()) {
+        return;
+    }
+
+    unsigned int Index = (unsigned int)pTexture->streamerIndex;
+
+    if (Index < m_Textures.size() && m_Textures[Index].pRaw == pTexture && !m_Textures[Index].pTexture.expired()) {
+        StreamedTexture& Entry = m_Textures[Index];
+        float TexelsPerUnit = UVDensity * (float)std::max(pTexture->imageWidth, pTexture->imageHeight);
+        float PixelsPerUnit = m_PixelsPerUnitAtUnitDistance / std::max(Distance, 0.01f);
+
+        // The level at which one texel covers about one pixel
+        float TexelsPerPixel = TexelsPerUnit / PixelsPerUnit;
+        int Level = TexelsPerPixel > 1.0f ? (int)floorf(log2f(TexelsPerPixel)) : 0;
+        Level = std::min(std::max(Level, 0), Entry.TailLevel);
+
+        Entry.WantedLevel = Entry.Requested ? std::min(Entry.WantedLevel, Level) : Level;
+        Entry.MinDistance = std::min(Entry.MinDistance, Distance);
+        Entry.Requested = true;
+    }
+}
+
+
+void TextureStreamer::Update(FrameArena* pArena)
+{
+    FinishLoads();
+
+    // Forget the textures that the TextureManager has evicted
+    m_Textures.erase(std::remove_if(m_Textures.begin(), m_Textures.end(),
+        [](const StreamedTexture& Entry) { return Entry.pTexture.expired(); }), m_Textures.end());
+
+    for (unsigned int i = 0; i < m_Textures.size(); i++) {
+        m_Textures[i].pRaw->streamerIndex = (int)i;
+    }
+
+    size_t Total = 0;
+
+    for (unsigned int i = 0; i < m_Textures.size(); i++) {
+        StreamedTexture& Entry = m_Textures[i];
+
+        if (Entry.Requested) {
+            Entry.TargetLevel = Entry.WantedLevel;
+            Entry.LastRequestFrame = m_Frame;
+        }
+        else if (m_Frame - Entry.LastRequestFrame > m_GracePeriod) {
+            // Nobody asked for it for a while so it falls back to the tail
+            Entry.TargetLevel = Entry.TailLevel;
+        }
+
+        Total += Entry.pRaw->GetLevelChainSize(Entry.TargetLevel);
+    }
+
+    // Over budget - coarsen the textures furthest from the camera first, one level at a time
+    while (m_MemoryBudget > 0 && Total > m_MemoryBudget) {
+        int Victim = -1;
+
+        for (unsigned int i = 0; i < m_Textures.size(); i++) {
+            const StreamedTexture& Entry = m_Textures[i];
+
+            if (Entry.TargetLevel < Entry.TailLevel &&
+                (Victim < 0 || Entry.MinDistance > m_Textures[Victim].MinDistance)) {
+                Victim = i;
+            }
+        }
+
+        if (Victim < 0) {
+            break;
+        }
+
+        StreamedTexture& Entry = m_Textures[Victim];
+        Total -= Entry.pRaw->GetLevelChainSize(Entry.TargetLevel);
+        Entry.TargetLevel++;
+        Total += Entry.pRaw->GetLevelChainSize(Entry.TargetLevel);
+    }
+
+    // Levels that are still allocated only need the base level moved, so apply all of those.
+    // The files for finer levels are read by jobs, closest first and rate limited.
+    FrameVector<StreamedTexture*> Uploads((FrameAllocator<StreamedTexture*>(pArena)));
+    FrameVector<StreamedTexture*> Trims((FrameAllocator<StreamedTexture*>(pArena)));
+    size_t Allocated = 0;
+
+    for (unsigned int i = 0; i < m_Textures.size(); i++) {
+        StreamedTexture& Entry = m_Textures[i];
+        Texture* pTexture = Entry.pRaw;
+
+        Allocated += pTexture->GetSizeInBytes();
+
+        if (Entry.TargetLevel >= pTexture->uploadedBaseLevel) {
+            if (Entry.TargetLevel != pTexture->residentBaseLevel) {
+                if (Entry.TargetLevel > pTexture->residentBaseLevel) {
+                    m_NumDrops++;
+                }
+                pTexture->SetBaseLevel(Entry.TargetLevel);
+            }
+
+            if (!Entry.Loading && pTexture->residentBaseLevel > pTexture->uploadedBaseLevel) {
+                Trims.push_back(&Entry);
+            }
+        }
+        else if (!Entry.Loading) {
+            Uploads.push_back(&Entry);
+        }
+    }
+
+    std::sort(Uploads.begin(), Uploads.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+        return a->MinDistance < b->MinDistance;
+    });
+
+    unsigned int NumStarted = 0;
+
+    for (unsigned int i = 0; i < Uploads.size() && NumStarted < m_MaxUploadsPerFrame; i++) {
+        StartLoad(*Uploads[i], Uploads[i]->TargetLevel, false);
+        NumStarted++;
+    }
+
+    // Over budget with the dropped levels - free them, furthest first, in the same limit
+    if (m_MemoryBudget == 0 || Allocated <= m_MemoryBudget) {
+        return;
+    }
+
+    std::sort(Trims.begin(), Trims.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+        return a->MinDistance > b->MinDistance;
+    });
+
+    for (unsigned int i = 0; i < Trims.size() && NumStarted < m_MaxUploadsPerFrame && Allocated > m_MemoryBudget; i++) {
+        const Texture* pTexture = Trims[i]->pRaw;
+        Allocated -= pTexture->GetSizeInBytes() - pTexture->GetLevelChainSize(pTexture->residentBaseLevel);
+        StartLoad(*Trims[i], pTexture->residentBaseLevel, true);
+        NumStarted++;
+    }
+}
+
+
+void TextureStreamer::DecodeJob(void* pData, unsigned int /*Begin*/, unsigned int /*End*/)
+{
+    PendingLoad* pLoad = (PendingLoad*)pData;
+    pLoad->Decoded = pLoad->pTexture->Decode();
+}
+
+
+void TextureStreamer::StartLoad(StreamedTexture& Entry, int BaseLevel, bool Trim)
+{
+    std::unique_ptr<PendingLoad> pLoad(new PendingLoad());
+    pLoad->pTexture = Entry.pTexture.lock();
+    pLoad->BaseLevel = BaseLevel;
+    pLoad->Trim = Trim;
+
+    Entry.Loading = true;
+
+    GetJobSystem().Run(DecodeJob, pLoad.get(), &pLoad->Counter);
+    m_PendingLoads.push_back(std::move(pLoad));
+}
+
+
+// Uploads the files that the jobs have read. Render thread only.
+void TextureStreamer::FinishLoads()
+{
+    unsigned int i = 0;
+
+    while (i < m_PendingLoads.size()) {
+        PendingLoad& Load = *m_PendingLoads[i];
+
+        if (!Load.Counter.IsDone()) {
+            i++;
+            continue;
+        }
+
+        Texture* pTexture = Load.pTexture.get();
+
+        if (Load.Decoded) {
+            if (Load.Trim) {
+                // Keep what has been moved back to since the trim started
+                pTexture->UploadLevels(std::min(Load.BaseLevel, pTexture->residentBaseLevel), true);
+                m_NumTrims++;
+            }
+            else {
+                pTexture->UploadLevels(Load.BaseLevel, false);
+                m_NumUploads++;
+            }
+        }
+
+        unsigned int Index = (unsigned int)pTexture->streamerIndex;
+
+        if (Index < m_Textures.size() && m_Textures[Index].pRaw == pTexture) {
+            m_Textures[Index].Loading = false;
+        }
+
+        m_PendingLoads[i] = std::move(m_PendingLoads.back());
+        m_PendingLoads.pop_back();
+    }
+}
+
+
+size_t TextureStreamer::GetMemoryUsage() const
+{
+    size_t MemoryUsage = 0;
+
+    for (unsigned int i = 0; i < m_Textures.size(); i++) {
+        if (!m_Textures[i].pTexture.expired()) {
+            MemoryUsage += m_Textures[i].pRaw->GetSizeInBytes();
+        }
+    }
+
+    return MemoryUsage;
+}
+
+
+void TextureStreamer::PrintStats() const
+{
+    printf("Texture streaming: %u textures, %.2f MB resident, %u level uploads, %u level drops, %u trims\n",
+        (unsigned int)m_Textures.size(), GetMemoryUsage() / (1024.0 * 1024.0), m_NumUploads, m_NumDrops, m_NumTrims);
+}
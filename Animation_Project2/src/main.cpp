@@ -2,27 +2,246 @@
 #include <glad/glad.h> // GLAD first
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
 
 #include "..//headers/Engine.h"
+#include "..//headers/TextureCooker.h"
+#include "..//headers/GLCapabilities.h"
+#include "..//headers/HeadlessContext.h"
+#include "..//headers/CameraPath.h"
+#include "..//headers/ImageWriter.h"
+#include "..//headers/FrameLoop.h"
+#include "..//headers/FramePipeline.h"
+#include "..//headers/JobSystem.h"
+#include "..//headers/Benchmarks.h"
+#include <chrono>
+#include <vector>
 
-bool IsGLVersionHigher(int major, int minor)
+
+// Captured frames are spaced at this rate along the camera path
+#define CAPTURE_FPS 30.0f
+
+
+// Offline step: Animation_Project2 --cook <src.jpg> <dst.ktx> [auto|bc1|bc3|bc5|bc7]
+static int CookMain(int argc, char* argv[])
 {
-    const char* versionStr = (const char*)glGetString(GL_VERSION);
-    if (!versionStr) return false;
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " --cook <source image> <destination ktx> [auto|bc1|bc3|bc5|bc7]\n";
+        return -1;
+    }
+
+    TEXTURE_COOK_FORMAT Format = COOK_FORMAT_AUTO;
+
+    if (argc > 4 && !ParseCookFormat(argv[4], Format)) {
+        std::cerr << "Unknown cook format '" << argv[4] << "'\n";
+        return -1;
+    }
+
+    return CookTexture(argv[2], argv[3], Format) ? 0 : -1;
+}
 
-    int glMajor = 0, glMinor = 0;
-    sscanf_s(versionStr, "%d.%d", &glMajor, &glMinor);
 
-    if (glMajor > major) return true;
-    if (glMajor == major && glMinor >= minor) return true;
-    return false;
+static double ElapsedMs(const std::chrono::high_resolution_clock::time_point& Start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
 }
 
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
 
+// Offline rendering: Animation_Project2 --capture <frames> <output dir> [width height] [camera path]
+// Renders without a window (see HeadlessContext) along a scripted camera path and writes
+// <output dir>/frame_NNNN.png plus <output dir>/timings.csv. The output directory must exist.
+// Without a path file the camera orbits the origin once every 4 seconds.
+static int CaptureMain(int argc, char* argv[])
+{
+    if (argc < 4 || argc == 5) {
+        std::cerr << "Usage: " << argv[0] << " --capture <frames> <output dir> [width height] [camera path]\n";
+        return -1;
+    }
+
+    int NumFrames = atoi(argv[2]);
+    const char* pOutputDir = argv[3];
+    int Width = 1280, Height = 720;
+
+    if (argc > 5) {
+        Width = atoi(argv[4]);
+        Height = atoi(argv[5]);
+    }
+
+    if (NumFrames <= 0 || Width <= 0 || Height <= 0) {
+        std::cerr << "Invalid frame count or size\n";
+        return -1;
+    }
+
+    CameraPath Path;
+
+    if (argc > 6) {
+        if (!Path.LoadFromFile(argv[6])) {
+            return -1;
+        }
+    }
+    else {
+        Path.MakeOrbit(glm::vec3(0.0f), 5.0f, 1.0f, 4.0f);
+    }
+
+    HeadlessContext Context;
+
+    if (!Context.Init(3, 3) || !InitGLCapabilities()) {
+        return -1;
+    }
+
+    std::string CSVName = std::string(pOutputDir) + "/timings.csv";
+    FILE* pCSV = fopen(CSVName.c_str(), "w");
+
+    if (!pCSV) {
+        std::cerr << "Unable to create '" << CSVName << "'\n";
+        return -1;
+    }
+
+    fprintf(pCSV, "frame,time,render_ms,readback_ms,write_ms\n");
+
+    int Ret = 0;
+
+    // Scoped so that the engine and the target release their GL objects before the
+    // context goes away
+    {
+        OffscreenTarget Target;
+        Engine* engine = new Engine();
+
+        if (!Target.Init(Width, Height) || !engine->Init()) {
+            std::cerr << "Engine initialization failed.\n";
+            delete engine;
+            fclose(pCSV);
+            return -1;
+        }
+
+        Target.Bind();
+        engine->OnResize(Width, Height);
+
+        std::vector<unsigned char> Pixels;
+        double TotalMs[3] = { 0.0, 0.0, 0.0 };
+
+        for (int i = 0; i < NumFrames; i++) {
+            float Time = i / CAPTURE_FPS;
+            glm::vec3 Position, LookAt;
+            Path.Evaluate(Time, Position, LookAt);
+            engine->GetCamera()->SetLookAt(Position, LookAt);
+
+            // glFinish so that the render time covers the GPU (or llvmpipe) work, not just submission
+            std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+            engine->RenderSceneCB();
+            glFinish();
+            double RenderMs = ElapsedMs(Start);
+
+            Start = std::chrono::high_resolution_clock::now();
+            Target.ReadPixels(Pixels);
+            double ReadbackMs = ElapsedMs(Start);
+
+            char Filename[1024];
+            snprintf(Filename, sizeof(Filename), "%s/frame_%04d.png", pOutputDir, i);
+
+            Start = std::chrono::high_resolution_clock::now();
+
+            if (!WritePNG(Filename, Width, Height, Pixels.data(), true)) {
+                Ret = -1;
+                break;
+            }
+
+            double WriteMs = ElapsedMs(Start);
 
-int main() {
+            fprintf(pCSV, "%d,%.4f,%.3f,%.3f,%.3f\n", i, Time, RenderMs, ReadbackMs, WriteMs);
+
+            TotalMs[0] += RenderMs;
+            TotalMs[1] += ReadbackMs;
+            TotalMs[2] += WriteMs;
+        }
+
+        printf("Captured %d frames at %dx%d: render %.2f ms, readback %.2f ms, write %.2f ms per frame\n",
+            NumFrames, Width, Height, TotalMs[0] / NumFrames, TotalMs[1] / NumFrames, TotalMs[2] / NumFrames);
+
+        delete engine;
+    }
+
+    fclose(pCSV);
+
+    return Ret;
+}
+
+
+// Options of the interactive mode: [--no-vsync] [--fps-cap <fps>] [--tick-rate <hz>] [--serial]
+// [--characters <count>] [--character-model <file>] [--walls <count> --wall-model <file>]
+static bool ParseOptions(int argc, char* argv[], FrameLoop::Settings& Settings, bool& Serial,
+                         unsigned int& NumCharacters, std::string& CharacterModel,
+                         unsigned int& NumWalls, std::string& WallModel)
+{
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--serial")) {
+            Serial = true;
+        }
+        else if (!strcmp(argv[i], "--characters") && i + 1 < argc) {
+            NumCharacters = (unsigned int)atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--character-model") && i + 1 < argc) {
+            CharacterModel = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--walls") && i + 1 < argc) {
+            NumWalls = (unsigned int)atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--wall-model") && i + 1 < argc) {
+            WallModel = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--no-vsync")) {
+            Settings.VSync = false;
+        }
+        else if (!strcmp(argv[i], "--fps-cap") && i + 1 < argc) {
+            Settings.MaxFPS = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--tick-rate") && i + 1 < argc && atof(argv[i + 1]) > 0.0) {
+            Settings.FixedStep = 1.0 / atof(argv[++i]);
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--no-vsync] [--fps-cap <fps>] [--tick-rate <hz>] [--serial]"
+                         " [--characters <count>] [--character-model <file>] [--walls <count> --wall-model <file>]\n";
+            return false;
+        }
+    }
+
+    if (NumWalls > 0 && WallModel.empty()) {
+        std::cerr << "--walls needs a --wall-model\n";
+        return false;
+    }
+
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    if (argc > 1 && !strcmp(argv[1], "--cook")) {
+        return CookMain(argc, argv);
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "--capture")) {
+        return CaptureMain(argc, argv);
+    }
+
+    int ExitCode = 0;
+
+    if (RunBenchmark(argc, argv, ExitCode)) {
+        return ExitCode;
+    }
+
+    FrameLoop::Settings LoopSettings;
+    bool Serial = false;    // Simulation on the main thread, for debugging
+    unsigned int NumCharacters = 0;
+    std::string CharacterModel = "res/Bot.fbx";
+    unsigned int NumWalls = 0;
+    std::string WallModel;
+
+    if (!ParseOptions(argc, argv, LoopSettings, Serial, NumCharacters, CharacterModel, NumWalls, WallModel)) {
+        return -1;
+    }
 
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
@@ -47,6 +266,12 @@ int main() {
         return -1;
     }
 
+    // Version and extensions are parsed once here, never per frame
+    if (!InitGLCapabilities()) {
+        std::cerr << "Failed to query the GL capabilities\n";
+        return -1;
+    }
+
     Engine* engine = new Engine();
 
     if (!engine->Init()) {
@@ -54,27 +279,61 @@ int main() {
         return -1;
     }
 
+    if (NumCharacters > 0 && !engine->SpawnCharacters(CharacterModel, NumCharacters)) {
+        return -1;
+    }
+
+    if (NumWalls > 0 && !engine->AddWalls(WallModel, NumWalls)) {
+        return -1;
+    }
+
     glfwSetWindowUserPointer(window, engine);
     glfwSetCursorPosCallback(window, Engine::MouseCallback);
+    glfwSetFramebufferSizeCallback(window, Engine::FramebufferSizeCallback);
+
+    // The window size is in screen coordinates, which may differ from pixels on high DPI displays
+    int FramebufferWidth = 0, FramebufferHeight = 0;
+    glfwGetFramebufferSize(window, &FramebufferWidth, &FramebufferHeight);
+    engine->OnResize(FramebufferWidth, FramebufferHeight);
+
+
+    glfwSwapInterval(LoopSettings.VSync ? 1 : 0);
 
+    FrameLoop Loop;
+    Loop.Init(LoopSettings);
+
+    // The simulation of the next frame runs as a job while this one renders
+    FramePipeline Pipeline;
+    Pipeline.Init([engine](const SimulationInput& Input, FramePacket& Packet) { engine->Simulate(Input, Packet); },
+        Serial ? NULL : &GetJobSystem());
+
+    SimulationInput Input;
 
     while (!glfwWindowShouldClose(window)) {
 
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        glfwPollEvents();
 
+        // The simulation runs at a fixed rate whatever the render rate is
+        Input.NumSteps = Loop.BeginFrame();
+        Input.FixedStep = Loop.GetFixedStep();
+        Input.Alpha = Loop.GetAlpha();
+        engine->GatherInput(window, Input);
 
-        engine->RenderSceneCB();
-        engine->ProcessInput(window, deltaTime);
+        const FramePacket& Packet = Pipeline.Advance(Input);
+        engine->Render(Packet);
 
-        //engine.Update(currentTime);
-        //engine.Render();
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        Loop.EndFrame();
 
+        Input.FrameIndex++;
     }
 
+    Pipeline.Flush();
+    Pipeline.PrintStats();
+    GetJobSystem().PrintStats();
+    Loop.PrintStats();
+    delete engine;
+
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
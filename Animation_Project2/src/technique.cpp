@@ -24,6 +24,7 @@
 #include <sstream>  // for std::stringstream
 #include <iostream> // for std::cerr or std::cout
 #include "..//headers/technique.h"
+#include "..//headers/GLStateCache.h"
 
 #define GLCheckError() (glGetError() == GL_NO_ERROR)
 #define INVALID_UNIFORM_LOCATION 0xffffffff
@@ -47,6 +48,7 @@ Technique::~Technique()
 
     if (m_shaderProg != 0)
     {
+        GetGLState().OnDeleteProgram(m_shaderProg);
         glDeleteProgram(m_shaderProg);
         m_shaderProg = 0;
     }
@@ -56,6 +58,7 @@ Technique::~Technique()
 bool Technique::Init()
 {
     if (m_shaderProg) {
+        GetGLState().OnDeleteProgram(m_shaderProg);
         glDeleteProgram(m_shaderProg);
     }
 
@@ -156,16 +159,6 @@ bool Technique::Finalize()
         return false;
     }
 
-    glValidateProgram(m_shaderProg);
-
-    glGetProgramiv(m_shaderProg, GL_VALIDATE_STATUS, &Success);
-
-    if (Success == 0) {
-        glGetProgramInfoLog(m_shaderProg, sizeof(ErrorLog), NULL, ErrorLog);
-        fprintf(stderr, "Invalid shader program: '%s'\n", ErrorLog);
-        return false;
-    }
-
     // Delete the intermediate shader objects that have been added to the program
     for (ShaderObjList::iterator it = m_shaderObjList.begin(); it != m_shaderObjList.end(); it++) {
         glDeleteShader(*it);
@@ -179,6 +172,25 @@ bool Technique::Finalize()
 }
 
 
+bool Technique::Validate()
+{
+    GLint Success = 0;
+    GLchar ErrorLog[1024] = { 0 };
+
+    glValidateProgram(m_shaderProg);
+
+    glGetProgramiv(m_shaderProg, GL_VALIDATE_STATUS, &Success);
+
+    if (Success == 0) {
+        glGetProgramInfoLog(m_shaderProg, sizeof(ErrorLog), NULL, ErrorLog);
+        fprintf(stderr, "Invalid shader program: '%s'\n", ErrorLog);
+        return false;
+    }
+
+    return true;
+}
+
+
 void Technique::PrintUniformList()
 {
     int Count = 0;
@@ -201,7 +213,30 @@ void Technique::PrintUniformList()
 
 void Technique::Enable()
 {
-    glUseProgram(m_shaderProg);
+    GetGLState().UseProgram(m_shaderProg);
+}
+
+
+bool Technique::BindUniformBlock(const char* pBlockName, GLuint BindingPoint, size_t HostSize)
+{
+    GLuint BlockIndex = glGetUniformBlockIndex(m_shaderProg, pBlockName);
+
+    if (BlockIndex == GL_INVALID_INDEX) {
+        fprintf(stderr, "Warning! Unable to get the index of uniform block '%s'\n", pBlockName);
+        return false;
+    }
+
+    GLint BlockSize = 0;
+    glGetActiveUniformBlockiv(m_shaderProg, BlockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &BlockSize);
+
+    if ((size_t)BlockSize > HostSize) {
+        fprintf(stderr, "Uniform block '%s' is %d bytes in the shader but %d bytes in C++\n", pBlockName, BlockSize, (int)HostSize);
+        return false;
+    }
+
+    glUniformBlockBinding(m_shaderProg, BlockIndex, BindingPoint);
+
+    return true;
 }
 
 